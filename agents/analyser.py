@@ -122,8 +122,8 @@ Use when:
 - heavy CPU compute in Python per iteration
 - pure-ish function, independent iterations
 Example transformation idea:
-- extract worker(x) -> result
-- run with ProcessPoolExecutor.map(worker, items)
+- extract worker(lo, hi, ...) -> results for that range of iterations
+- run with the persistent pool: maap_pool.map_range(worker, n, maap_pool.share(data))
 
 B) thread_pool  (I/O-bound concurrency; good for blocking I/O)
 Use when:
@@ -0,0 +1,213 @@
+"""
+Batch mode support: source discovery, CPU-set leasing and the summary report.
+A batch runs several pipelines at once. LLM requests overlap freely, but a
+validation (or autotuning) run holds a disjoint set of CPUs for its whole
+duration and its binaries are pinned to them with taskset, so concurrent
+timing runs do not share cores. Every pipeline uses its own work directory.
+"""
+
+import fnmatch
+import json
+import math
+import os
+import queue
+import shlex
+import sys
+import threading
+from contextlib import contextmanager
+from dataclasses import dataclass, field
+from typing import List, Optional
+
+SOURCE_EXTENSIONS = (".c", ".py")
+# Flags from compile_commands.json that change what the validator compiles
+_KEPT_FLAGS = ("-I", "-D", "-U", "-std=", "-include")
+
+
+@dataclass
+class BatchSource:
+    path: str
+    name: str                          # path relative to the batch root, without extension
+    extra_cflags: List[str] = field(default_factory=list)
+
+
+def _relative_name(path: str, root: str) -> str:
+    rel = os.path.relpath(path, root)
+    return os.path.splitext(rel)[0] if not rel.startswith("..") else os.path.splitext(os.path.basename(path))[0]
+
+
+def compile_flags(entry: dict) -> List[str]:
+    """-I/-D/-U/-std/-include flags of one compile_commands.json entry, include paths made absolute."""
+    args = entry.get("arguments") or shlex.split(entry.get("command", ""))
+    directory = entry.get("directory", ".")
+    flags, i = [], 1
+    while i < len(args):
+        arg = args[i]
+        if arg in ("-I", "-D", "-U", "-include") and i + 1 < len(args):
+            arg, i = arg + args[i + 1], i + 1
+        if arg.startswith("-I"):
+            flags.append("-I" + os.path.normpath(os.path.join(directory, arg[2:])))
+        elif arg.startswith("-include"):
+            flags += ["-include", os.path.normpath(os.path.join(directory, arg[len("-include"):]))]
+        elif arg.startswith(_KEPT_FLAGS):
+            flags.append(arg)
+        i += 1
+    return flags
+
+
+def discover_sources(path: str, exclude: Optional[List[str]] = None) -> List[BatchSource]:
+    """
+    C and Python sources under a directory, or the C translation units of a
+    compile_commands.json (with their include and define flags). `exclude` holds
+    glob patterns matched against paths relative to the root.
+    """
+    exclude = exclude or []
+    sources = []
+    if os.path.isfile(path) and os.path.basename(path).endswith(".json"):
+        root = os.path.dirname(os.path.abspath(path))
+        with open(path, encoding="utf-8") as f:
+            entries = json.load(f)
+        seen = set()
+        for entry in entries:
+            file = os.path.normpath(os.path.join(entry.get("directory", root), entry["file"]))
+            if not file.endswith(".c") or file in seen:
+                continue
+            seen.add(file)
+            sources.append(BatchSource(file, _relative_name(file, root), compile_flags(entry)))
+    else:
+        root = os.path.abspath(path)
+        for dirpath, dirnames, filenames in os.walk(root):
+            dirnames[:] = sorted(d for d in dirnames if not d.startswith((".", "__")))
+            for filename in sorted(filenames):
+                if filename.endswith(SOURCE_EXTENSIONS):
+                    file = os.path.join(dirpath, filename)
+                    sources.append(BatchSource(file, _relative_name(file, root)))
+    return [s for s in sources if not any(fnmatch.fnmatch(os.path.relpath(s.path, root), p) for p in exclude)]
+
+
+class CpuSetAllocator:
+    """Fixed, disjoint CPU sets handed out one per concurrent validation."""
+
+    def __init__(self, cpus: List[int], per_slot: int):
+        per_slot = max(1, min(per_slot, len(cpus)))
+        self.slots = [cpus[i:i + per_slot] for i in range(0, len(cpus) - per_slot + 1, per_slot)]
+        self._free = queue.Queue()
+        for slot in self.slots:
+            self._free.put(slot)
+
+    @contextmanager
+    def lease(self):
+        slot = self._free.get()
+        try:
+            yield slot
+        finally:
+            self._free.put(slot)
+
+
+_allocator: Optional[CpuSetAllocator] = None
+
+
+def available_cpus() -> List[int]:
+    try:
+        return sorted(os.sched_getaffinity(0))
+    except AttributeError:
+        return list(range(os.cpu_count() or 1))
+
+
+def set_allocator(allocator: Optional[CpuSetAllocator]) -> None:
+    global _allocator
+    _allocator = allocator
+
+
+@contextmanager
+def cpu_lease():
+    """A CPU set for the duration of a timing run; [] (unpinned) outside batch mode."""
+    if _allocator is None:
+        yield []
+        return
+    with _allocator.lease() as cpus:
+        yield cpus
+
+
+class ThreadLog:
+    """
+    sys.stdout replacement that sends each pipeline thread's prints to its own
+    log file, so concurrent pipelines do not interleave on the console.
+    """
+
+    def __init__(self, console):
+        self.console = console
+        self._local = threading.local()
+
+    @contextmanager
+    def to_file(self, path: str):
+        with open(path, "w", encoding="utf-8") as f:
+            self._local.file = f
+            try:
+                yield
+            finally:
+                self._local.file = None
+
+    def _target(self):
+        return getattr(self._local, "file", None) or self.console
+
+    def share(self, fn):
+        """fn wrapped so that, run on a worker thread, it prints into the calling thread's log."""
+        file = getattr(self._local, "file", None)
+
+        def run(*args, **kwargs):
+            self._local.file = file
+            try:
+                return fn(*args, **kwargs)
+            finally:
+                self._local.file = None
+        return run
+
+    def write(self, text):
+        return self._target().write(text)
+
+    def flush(self):
+        self._target().flush()
+
+    def __getattr__(self, name):
+        return getattr(self.console, name)
+
+
+def in_pipeline_log(fn):
+    """fn for a pipeline's worker threads: their prints follow the pipeline's (batch mode) or go to stdout."""
+    return sys.stdout.share(fn) if isinstance(sys.stdout, ThreadLog) else fn
+
+
+def batch_summary(records: List[dict], wall_time: float) -> dict:
+    passed = [r for r in records if r["status"] == "passed"]
+    speedups = [r["speedup"] for r in passed if r.get("speedup")]
+    return {
+        "files": len(records),
+        "passed": len(passed),
+        "failed": sum(r["status"] == "failed" for r in records),
+        "errors": sum(r["status"] == "error" for r in records),
+        "geomean_speedup": math.exp(sum(math.log(s) for s in speedups) / len(speedups)) if speedups else None,
+        "wall_time": wall_time,
+        "pipeline_time": sum(r.get("seconds") or 0.0 for r in records),
+        "files_per_hour": len(records) * 3600.0 / wall_time if wall_time > 0 else None,
+        "results": records,
+    }
+
+
+def format_batch_summary(summary: dict) -> str:
+    lines = ["=== Batch Summary ===", f"{'File':<48} {'Status':<7} {'Speedup':>8} {'Original':>9} {'Tuned':>9} "
+                                     f"{'Tries':>5} {'Time (s)':>9}"]
+    for r in summary["results"]:
+        speedup = f"{r['speedup']:.2f}x" if r.get("speedup") else "-"
+        orig = f"{r['original_time']:.4f}" if r.get("original_time") is not None else "-"
+        ref = f"{r['refactored_time']:.4f}" if r.get("refactored_time") is not None else "-"
+        lines.append(f"{r['name']:<48} {r['status']:<7} {speedup:>8} {orig:>9} {ref:>9} "
+                     f"{r.get('iterations') or 0:>5} {r.get('seconds') or 0.0:>9.1f}")
+        if r["status"] != "passed" and r.get("error"):
+            lines.append(f"    {r['error'].splitlines()[0][:100]}")
+    geomean = f"{summary['geomean_speedup']:.2f}x" if summary["geomean_speedup"] else "N/A"
+    lines.append(f"{summary['passed']}/{summary['files']} passed, {summary['failed']} failed, "
+                 f"{summary['errors']} errors; geometric mean speedup of passing files: {geomean}")
+    lines.append(f"Wall time {summary['wall_time']:.1f}s for {summary['pipeline_time']:.1f}s of pipeline time "
+                 f"({summary['files_per_hour']:.0f} files/hour)" if summary["files_per_hour"] else
+                 f"Wall time {summary['wall_time']:.1f}s")
+    return "\n".join(lines) + "\n"
@@ -0,0 +1,47 @@
+"""
+Helpers for the shared C benchmark harness (benchmarks/c/include/bench.h).
+Every harness-driven binary prints one JSON line such as
+{"bench": "heavy_loop", "clock": "wall", "median": 0.08, ...}
+after its regular output. These helpers pull that line out of captured
+stdout and strip it before outputs are compared.
+"""
+
+import json
+import os
+from typing import List
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCH_INCLUDE_DIR = os.path.join(REPO_ROOT, "benchmarks", "c", "include")
+BENCH_HEADER = os.path.join(BENCH_INCLUDE_DIR, "bench.h")
+MAAP_RNG_HEADER = os.path.join(BENCH_INCLUDE_DIR, "maap_rng.h")
+# Headers generated code may include; copied next to the sources for script-based validation
+BENCH_HEADERS = [BENCH_HEADER, MAAP_RNG_HEADER]
+# Runtime modules generated Python code may import (persistent process pool, shared-memory arrays)
+PY_RUNTIME_DIR = os.path.join(REPO_ROOT, "benchmarks", "python", "include")
+PY_RUNTIME = [os.path.join(PY_RUNTIME_DIR, "maap_pool.py")]
+
+
+def _as_bench_record(line: str):
+    line = line.strip()
+    if not (line.startswith("{") and '"bench"' in line):
+        return None
+    try:
+        record = json.loads(line)
+    except json.JSONDecodeError:
+        return None
+    return record if isinstance(record, dict) and "bench" in record else None
+
+
+def parse_bench_lines(output: str) -> List[dict]:
+    """Returns every harness result record found in the program output, in order."""
+    records = []
+    for line in output.splitlines():
+        record = _as_bench_record(line)
+        if record is not None:
+            records.append(record)
+    return records
+
+
+def strip_bench_lines(output: str) -> str:
+    """Removes harness result lines so the remaining output can be compared."""
+    return "\n".join(line for line in output.splitlines() if _as_bench_record(line) is None)
@@ -0,0 +1,462 @@
+"""
+Pointer alias analysis for C kernels (pycparser AST).
+Traces every pointer argument at every call site back to the objects it can
+point to (malloc/calloc/aligned_alloc sites, arrays, globals) and decides,
+per function, which pointer parameters can be `restrict`-qualified: a
+parameter qualifies when, at every call site, it points to a different object
+than each other pointer parameter that either of them writes through.
+
+The analysis is flow-insensitive. A variable assigned in several places may
+point to any of the objects assigned to it, except for pointers that are only
+exchanged with each other (tmp = a; a = b; b = tmp), which stay distinct after
+any number of swaps. Parameters of functions without call sites (library
+entry points) are unknown, so nothing is proven for them.
+"""
+
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Set, Tuple
+
+from pycparser import c_ast
+
+_ALLOCATORS = ('malloc', 'calloc', 'realloc', 'aligned_alloc')
+
+
+@dataclass(frozen=True)
+class Origin:
+    """One object a pointer may point into."""
+    kind: str                         # "malloc", "calloc", "aligned_alloc", "posix_memalign", "array", "global"
+    function: str
+    name: str
+    line: object
+    column: object = None
+    alignment: Optional[int] = None   # guaranteed alignment of the object's start, when explicit
+
+    def describe(self) -> str:
+        if self.kind in ("array", "global"):
+            return f"{self.kind} {self.name} (line {self.line})"
+        return f"{self.kind} in {self.function} (line {self.line})"
+
+
+UNKNOWN = None    # an origin set containing UNKNOWN is not traceable
+
+
+@dataclass
+class CallSite:
+    caller: str
+    line: object
+    args: List[c_ast.Node]
+
+
+@dataclass
+class FunctionInfo:
+    name: str
+    line: object
+    params: List[str] = field(default_factory=list)
+    pointer_params: List[str] = field(default_factory=list)
+    restrict_params: Set[str] = field(default_factory=set)
+    written: Set[str] = field(default_factory=set)            # pointer params written (or passed on) through
+    assignments: Dict[str, List[c_ast.Node]] = field(default_factory=dict)
+    objects: Dict[str, Origin] = field(default_factory=dict)  # local arrays and allocation sites by variable
+    swaps: Dict[Tuple[str, str], Set[str]] = field(default_factory=dict)   # exchanged pair -> temporaries
+    swap_rvalues: Set[int] = field(default_factory=set)       # ids of the a = b and b = tmp rvalues of those swaps
+    globals_used: Set[str] = field(default_factory=set)
+    has_loops: bool = False
+
+
+@dataclass
+class AliasVerdict:
+    function: str
+    line: object
+    params: List[str]
+    call_sites: int
+    origins: Dict[str, List[str]]
+    restrict_safe: List[str]
+    conflicts: List[str]
+    aligned: Dict[str, int]
+    swapped: List[Tuple[str, str]]
+
+
+def _is_pointer(decl_type) -> bool:
+    return isinstance(decl_type, (c_ast.PtrDecl, c_ast.ArrayDecl))
+
+
+def _const_int(node) -> Optional[int]:
+    if isinstance(node, c_ast.Constant) and node.type == 'int':
+        try:
+            return int(node.value.rstrip('uUlL'), 0)
+        except ValueError:
+            return None
+    return None
+
+
+def _strip(expr):
+    """Pointer expression -> the expression naming its object (casts, offsets and &a[i] removed)."""
+    while True:
+        if isinstance(expr, c_ast.Cast):
+            expr = expr.expr
+        elif isinstance(expr, c_ast.BinaryOp) and expr.op in ('+', '-'):
+            expr = expr.left if not isinstance(expr.left, c_ast.Constant) else expr.right
+        elif isinstance(expr, c_ast.UnaryOp) and expr.op == '&' and isinstance(expr.expr, c_ast.ArrayRef):
+            expr = expr.expr.name
+        elif isinstance(expr, c_ast.UnaryOp) and expr.op in ('p++', 'p--', '++', '--'):
+            expr = expr.expr
+        else:
+            return expr
+
+
+def _has_offset(expr) -> bool:
+    while isinstance(expr, c_ast.Cast):
+        expr = expr.expr
+    return not isinstance(expr, (c_ast.ID, c_ast.FuncCall))
+
+
+def _call_name(node) -> Optional[str]:
+    return node.name.name if isinstance(node, c_ast.FuncCall) and isinstance(node.name, c_ast.ID) else None
+
+
+class _FunctionWalker(c_ast.NodeVisitor):
+    """Collects assignments, objects, call sites and written parameters of one function."""
+
+    def __init__(self, info: FunctionInfo, global_names: Set[str], calls: Dict[str, List[CallSite]]):
+        self.info = info
+        self.global_names = global_names
+        self.calls = calls
+        self.locals: Set[str] = set()
+
+    def visit_Decl(self, node):
+        if node.name:
+            self.locals.add(node.name)
+            line = node.coord.line if node.coord else "unknown"
+            if isinstance(node.type, c_ast.ArrayDecl):
+                self.info.objects[node.name] = Origin("array", self.info.name, node.name, line)
+            if node.init is not None and _is_pointer(node.type):
+                self.info.assignments.setdefault(node.name, []).append(node.init)
+        self.generic_visit(node)
+
+    def visit_Assignment(self, node):
+        if isinstance(node.lvalue, c_ast.ID) and node.op == '=':
+            self.info.assignments.setdefault(node.lvalue.name, []).append(node.rvalue)
+        self._write_target(node.lvalue)
+        self.generic_visit(node)
+
+    def visit_UnaryOp(self, node):
+        if node.op in ('++', '--', 'p++', 'p--'):
+            self._write_target(node.expr)
+        self.generic_visit(node)
+
+    def visit_For(self, node):
+        self.info.has_loops = True
+        self.generic_visit(node)
+
+    visit_While = visit_For
+    visit_DoWhile = visit_For
+
+    def visit_ID(self, node):
+        if node.name in self.global_names and node.name not in self.locals:
+            self.info.globals_used.add(node.name)
+
+    def visit_FuncCall(self, node):
+        name = _call_name(node)
+        args = node.args.exprs if node.args is not None else []
+        line = node.coord.line if node.coord else "unknown"
+        target = args[0].expr if args and isinstance(args[0], c_ast.Cast) else (args[0] if args else None)
+        if name == 'posix_memalign' and len(args) == 3 and isinstance(target, c_ast.UnaryOp) \
+                and target.op == '&' and isinstance(target.expr, c_ast.ID):
+            var = target.expr.name
+            self.info.objects[var] = Origin("posix_memalign", self.info.name, var, line,
+                                            node.coord.column if node.coord else None, _const_int(args[1]))
+            self.info.assignments.setdefault(var, []).append(node)
+        elif name is not None:
+            self.calls.setdefault(name, []).append(CallSite(self.info.name, line, list(args)))
+            # A parameter handed to another function may be written there
+            for arg in args:
+                base = _strip(arg)
+                if isinstance(base, c_ast.ID) and base.name in self.info.pointer_params:
+                    self.info.written.add(base.name)
+        if node.args is not None:
+            self.visit(node.args)
+
+    def visit_Compound(self, node):
+        items = node.block_items or []
+        for first, second, third in zip(items, items[1:], items[2:]):
+            swap = _swap_pair(first, second, third)
+            if swap:
+                pair, tmp = swap
+                self.info.swaps.setdefault(pair, set()).add(tmp)
+                self.info.swap_rvalues |= {id(_rvalue(second)), id(_rvalue(third))}
+        self.generic_visit(node)
+
+    def _write_target(self, lvalue):
+        while isinstance(lvalue, (c_ast.ArrayRef, c_ast.StructRef)) or \
+                (isinstance(lvalue, c_ast.UnaryOp) and lvalue.op == '*'):
+            lvalue = lvalue.name if isinstance(lvalue, (c_ast.ArrayRef, c_ast.StructRef)) else lvalue.expr
+            base = _strip(lvalue)
+            if isinstance(base, c_ast.ID) and base.name in self.info.pointer_params:
+                self.info.written.add(base.name)
+                return
+
+
+def _simple_assign(stmt) -> Optional[Tuple[str, str]]:
+    if isinstance(stmt, c_ast.Decl) and isinstance(stmt.init, c_ast.ID):
+        return stmt.name, stmt.init.name
+    if isinstance(stmt, c_ast.Assignment) and stmt.op == '=' and isinstance(stmt.lvalue, c_ast.ID) \
+            and isinstance(stmt.rvalue, c_ast.ID):
+        return stmt.lvalue.name, stmt.rvalue.name
+    return None
+
+
+def _rvalue(stmt):
+    return stmt.init if isinstance(stmt, c_ast.Decl) else stmt.rvalue
+
+
+def _swap_pair(first, second, third) -> Optional[Tuple[Tuple[str, str], str]]:
+    """tmp = a; a = b; b = tmp -> ((a, b), tmp)."""
+    s1, s2, s3 = _simple_assign(first), _simple_assign(second), _simple_assign(third)
+    if s1 and s2 and s3:
+        tmp, a = s1
+        if s2[0] == a and s3 == (s2[1], tmp) and len({tmp, a, s2[1]}) == 3:
+            return tuple(sorted((a, s2[1]))), tmp
+    return None
+
+
+class AliasAnalysis:
+    """Whole-translation-unit points-to sets for pointer parameters and the restrict verdicts built on them."""
+
+    def __init__(self, ast: c_ast.FileAST):
+        self.functions: Dict[str, FunctionInfo] = {}
+        self.calls: Dict[str, List[CallSite]] = {}
+        self.globals: Dict[str, Origin] = {}
+        for ext in ast.ext:
+            if isinstance(ext, c_ast.Decl) and isinstance(ext.type, c_ast.ArrayDecl):
+                line = ext.coord.line if ext.coord else "unknown"
+                self.globals[ext.name] = Origin("global", "", ext.name, line)
+        for ext in ast.ext:
+            if not isinstance(ext, c_ast.FuncDef):
+                continue
+            info = FunctionInfo(ext.decl.name, ext.coord.line if ext.coord else "unknown")
+            params = ext.decl.type.args.params if ext.decl.type.args is not None else []
+            for param in params:
+                if not isinstance(param, c_ast.Decl) or param.name is None:
+                    continue
+                info.params.append(param.name)
+                if _is_pointer(param.type):
+                    info.pointer_params.append(param.name)
+                    if 'restrict' in getattr(param.type, 'quals', []):
+                        info.restrict_params.add(param.name)
+            self.functions[info.name] = info
+            _FunctionWalker(info, set(self.globals), self.calls).visit(ext.body)
+        self._param_origins: Dict[Tuple[str, str], frozenset] = {}
+        self._solve()
+
+    # ---- points-to sets ------------------------------------------------
+
+    def _solve(self):
+        """Iterates the parameter points-to sets to a fixpoint over all call sites."""
+        for info in self.functions.values():
+            for p in info.pointer_params:
+                self._param_origins[(info.name, p)] = frozenset()
+        changed = True
+        while changed:
+            changed = False
+            for info in self.functions.values():
+                sites = self.calls.get(info.name, [])
+                for index, p in enumerate(info.params):
+                    if p not in info.pointer_params:
+                        continue
+                    origins = set() if sites else {UNKNOWN}
+                    for site in sites:
+                        if index >= len(site.args):
+                            origins.add(UNKNOWN)
+                            continue
+                        origins |= self.origins(site.caller, site.args[index])
+                    origins = frozenset(origins)
+                    if origins != self._param_origins[(info.name, p)]:
+                        self._param_origins[(info.name, p)] = origins
+                        changed = True
+
+    def origins(self, function: str, expr, _seen=None) -> Set[Optional[Origin]]:
+        """Objects the pointer expression `expr` (evaluated in `function`) may point into."""
+        info = self.functions[function]
+        base = _strip(expr)
+        if isinstance(base, c_ast.FuncCall):
+            name = _call_name(base)
+            line = base.coord.line if base.coord else "unknown"
+            if name in _ALLOCATORS:
+                args = base.args.exprs if base.args is not None else []
+                alignment = _const_int(args[0]) if name == 'aligned_alloc' and args else None
+                found = {Origin(name, function, name, line, base.coord.column if base.coord else None, alignment)}
+                if name == 'realloc' and args:
+                    found |= self.origins(function, args[0], _seen)
+                return found
+            if name == 'posix_memalign':
+                return set()
+            return {UNKNOWN}
+        if not isinstance(base, c_ast.ID):
+            return {UNKNOWN}
+        name = base.name
+        seen = _seen or set()
+        if name in seen:
+            return set()
+        seen = seen | {name}
+        if not (name in info.objects or name in info.pointer_params or info.assignments.get(name)):
+            return {self.globals[name]} if name in self.globals else {UNKNOWN}
+        # Inside an assignment cycle (a = b; b = a) the objects come in through the other members
+        found: Set[Optional[Origin]] = set()
+        if name in info.objects:
+            found.add(info.objects[name])
+        if name in info.pointer_params:
+            found |= self._param_origins.get((function, name), {UNKNOWN})
+        for rvalue in info.assignments.get(name, []):
+            if isinstance(rvalue, c_ast.FuncCall) and _call_name(rvalue) == 'posix_memalign':
+                continue
+            found |= self.origins(function, rvalue, seen)
+        return found if _seen else (found or {UNKNOWN})
+
+    def _initial_origins(self, function: str, name: str) -> Set[Optional[Origin]]:
+        """
+        Objects assigned to `name` other than by the exchanges of a tmp swap. Any other
+        assignment from the partner (a = b outside the swap) merges the partner's objects in.
+        """
+        info = self.functions[function]
+        found: Set[Optional[Origin]] = set()
+        if name in info.objects:
+            found.add(info.objects[name])
+        for rvalue in info.assignments.get(name, []):
+            if id(rvalue) in info.swap_rvalues:
+                continue
+            if isinstance(rvalue, c_ast.FuncCall) and _call_name(rvalue) == 'posix_memalign':
+                continue
+            found |= self.origins(function, rvalue, {name})
+        return found or {UNKNOWN}
+
+    def _swapped(self, function: str, a: str, b: str) -> bool:
+        """a and b are only ever exchanged with each other and start on distinct objects."""
+        info = self.functions[function]
+        temps = info.swaps.get(tuple(sorted((a, b))))
+        if temps is None:
+            return False
+        # The temporaries must only ever hold a or b
+        for tmp in temps:
+            if any(not (isinstance(r, c_ast.ID) and r.name in (a, b)) for r in info.assignments.get(tmp, [])):
+                return False
+        oa, ob = self._initial_origins(function, a), self._initial_origins(function, b)
+        return UNKNOWN not in oa and UNKNOWN not in ob and not (oa & ob)
+
+    # ---- distinctness --------------------------------------------------
+
+    def _distinct(self, function: str, x, y, assumed: Set[Tuple[str, str, str]]) -> bool:
+        ox, oy = self.origins(function, x), self.origins(function, y)
+        if UNKNOWN not in ox and UNKNOWN not in oy and not (ox & oy):
+            return True
+        bx, by = _strip(x), _strip(y)
+        if not (isinstance(bx, c_ast.ID) and isinstance(by, c_ast.ID)) or bx.name == by.name:
+            return False
+        if self._swapped(function, bx.name, by.name):
+            return True
+        info = self.functions[function]
+        if bx.name in info.pointer_params and by.name in info.pointer_params \
+                and not info.assignments.get(bx.name) and not info.assignments.get(by.name):
+            return self.params_distinct(function, bx.name, by.name, assumed)
+        return False
+
+    def distinct(self, function: str, a: str, b: str) -> bool:
+        """True when the pointers or arrays named a and b in `function` point to different objects."""
+        return a != b and function in self.functions and self._distinct(function, c_ast.ID(a), c_ast.ID(b), set())
+
+    def params_distinct(self, function: str, p: str, q: str, assumed=None) -> bool:
+        """
+        True when parameters p and q of `function` point to different objects at
+        every call site. Recursive calls that pass the same pair on are assumed
+        distinct (the pair is then distinct iff it is at the outer call sites).
+        """
+        key = (function, *sorted((p, q)))
+        assumed = assumed or set()
+        if key in assumed:
+            return True
+        assumed = assumed | {key}
+        info = self.functions[function]
+        sites = self.calls.get(function, [])
+        if not sites:
+            return False
+        ip, iq = info.params.index(p), info.params.index(q)
+        for site in sites:
+            if max(ip, iq) >= len(site.args):
+                return False
+            if not self._distinct(site.caller, site.args[ip], site.args[iq], assumed):
+                return False
+        return True
+
+    # ---- verdicts ------------------------------------------------------
+
+    def verdict(self, function: str) -> AliasVerdict:
+        info = self.functions[function]
+        params = info.pointer_params
+        conflicts = []
+        unsafe: Set[str] = set()
+        for i, p in enumerate(params):
+            for q in params[i + 1:]:
+                if p not in info.written and q not in info.written:
+                    continue   # read-only pairs may alias under restrict
+                if not self.params_distinct(function, p, q):
+                    conflicts.append(f"{p}/{q}")
+                    unsafe |= {p, q}
+        origins = {}
+        aligned = {}
+        for p in params:
+            found = self._param_origins.get((function, p), {UNKNOWN})
+            if UNKNOWN in found:
+                unsafe.add(p)
+            # A restrict pointer must also be the only way the callee reaches the object
+            if any(o is not UNKNOWN and o.kind == "global" and o.name in info.globals_used for o in found):
+                unsafe.add(p)
+            origins[p] = sorted({o.describe() if o is not UNKNOWN else "untraced" for o in found})
+            alignments = {o.alignment if o is not UNKNOWN else None for o in found}
+            offsets = any(_has_offset(site.args[info.params.index(p)])
+                          for site in self.calls.get(function, []) if info.params.index(p) < len(site.args))
+            if len(alignments) == 1 and None not in alignments and not offsets:
+                aligned[p] = alignments.pop()
+        swapped = sorted({pair for site in self.calls.get(function, [])
+                          for pair in self.functions[site.caller].swaps
+                          if self._swapped(site.caller, *pair) and any(isinstance(_strip(a), c_ast.ID) and _strip(a).name in pair for a in site.args)})
+        return AliasVerdict(function, info.line, params, len(self.calls.get(function, [])), origins,
+                            [p for p in params if p not in unsafe], conflicts, aligned, swapped)
+
+    def kernels(self) -> List[AliasVerdict]:
+        """Verdicts for functions with loops and at least two pointer parameters."""
+        return [self.verdict(name) for name, info in self.functions.items()
+                if info.has_loops and len(info.pointer_params) >= 2]
+
+
+def unproven_restrict(ast: c_ast.FileAST) -> List[str]:
+    """restrict-qualified parameters the analysis cannot prove safe, as "function(param)"."""
+    analysis = AliasAnalysis(ast)
+    found = []
+    for name, info in analysis.functions.items():
+        if not info.restrict_params:
+            continue
+        safe = set(analysis.verdict(name).restrict_safe)
+        found += [f"{name}({p})" for p in info.pointer_params if p in info.restrict_params and p not in safe]
+    return found
+
+
+def format_alias_report(verdicts: List[AliasVerdict]) -> str:
+    if not verdicts:
+        return ""
+    report = "Pointer Aliasing (pointer arguments traced from every call site to their allocations):\n"
+    for v in verdicts:
+        report += f"  - {v.function}({', '.join(v.params)}) line {v.line}, {v.call_sites} call site(s)\n"
+        for p in v.params:
+            report += f"      {p} -> {', '.join(v.origins[p])}\n"
+        for a, b in v.swapped:
+            report += f"      {a}/{b} are exchanged by the caller (tmp swap keeps them distinct)\n"
+        if v.conflicts:
+            report += f"      may alias: {', '.join(v.conflicts)}\n"
+        if v.restrict_safe:
+            report += f"      restrict-safe: {', '.join(v.restrict_safe)} " \
+                      f"(qualify as `T *restrict {v.restrict_safe[0]}`)\n"
+        else:
+            report += "      restrict-safe: none\n"
+        if v.aligned:
+            clause = ", ".join(f"{p}:{n}" for p, n in v.aligned.items())
+            report += f"      aligned({clause}) holds for the simd loops\n"
+    return report + "\n"
@@ -15,9 +15,18 @@ CandidateType = Literal[
     "reduction",      # #pragma omp parallel for reduction(...)
     "task_graph",     # #pragma omp parallel sections
     "vectorize",      # #pragma omp simd
+    "loop_interchange",  # reorder nested loops for unit-stride inner access
+    "tiling",         # cache/register blocking of a loop nest
+    "stencil",        # neighbourhood sweep: halo tiling, time-step fusion
+    "first_touch",    # initialization loop parallelized like its consumer for NUMA page placement
+    "offload",        # #pragma omp target teams distribute parallel for / target data (GPU)
+    "array_reduction",  # accumulation into array elements several iterations update (histogram, scatter-add)
+    "pipeline",       # read -> process -> write loop as dependency-ordered tasks (#pragma omp task depend)
 ]
 
 Parallelizable = Literal["yes", "maybe", "no"]
+Schedule = Literal["static", "dynamic", "guided", "runtime"]
+ProcBind = Literal["close", "spread", "primary"]
 
 class CCandidate(BaseModel):
     id: str = Field(..., description="Unique id like C001")
@@ -29,9 +38,26 @@ class CCandidate(BaseModel):
     blockers: List[str] = Field(default_factory=list, description="Concrete reasons preventing parallelization")
     recommendation: Optional[str] = Field(
         None,
-        description="OpenMP pragma: parallel_for | parallel_for_reduction | parallel_sections | simd | none"
+        description="OpenMP pragma: parallel_for | parallel_for_reduction | parallel_for_array_reduction | parallel_sections | simd | loop_interchange | tiling | stencil_tiling | first_touch | target_teams | target_data | task | task_pipeline | none"
     )
     validation_checks: List[str] = Field(default_factory=list, description="Checks for validation agent")
+    schedule: Optional[Schedule] = Field(
+        None,
+        description="Loop schedule kind; static for uniform iterations, dynamic/guided for varying cost, runtime to let the validator pick"
+    )
+    chunk: Optional[int] = Field(None, description="Chunk size for the schedule clause, if any")
+    collapse: Optional[int] = Field(
+        None, description="Number of perfectly nested independent levels to collapse, when the dependence analysis allows 2+"
+    )
+    if_clause: Optional[str] = Field(
+        None, description="Condition for an if() clause on the parallel pragma, e.g. \"n > 4096\", when the default size is below break-even"
+    )
+    proc_bind: Optional[ProcBind] = Field(
+        None, description="proc_bind clause for the parallel pragma; set on first_touch candidates and their consumer loops"
+    )
+    map_clauses: List[str] = Field(
+        default_factory=list, description="map clauses of an offload candidate, e.g. \"map(to: A[0:n*n], B[0:n*n])\""
+    )
 
 class CAnalysisOutput(BaseModel):
     summary: str = Field(..., description="1-3 sentences summarizing main opportunities")
@@ -45,10 +71,12 @@ Given C source code and an AST loop report with line ranges, identify code regio
 
 You must output structured candidates with:
 - location (start_line, end_line)
-- type (loop_map | reduction | task_graph | vectorize)
+- type (loop_map | reduction | task_graph | vectorize | loop_interchange | tiling | stencil | first_touch | offload | array_reduction |
+  pipeline)
 - parallelizable (yes/maybe/no)
 - reason, blockers
-- recommendation label (parallel_for | parallel_for_reduction | parallel_sections | simd | none)
+- recommendation label (parallel_for | parallel_for_reduction | parallel_for_array_reduction | parallel_sections | simd | loop_interchange | tiling | stencil_tiling | first_touch | target_teams | target_data | task | task_pipeline |
+  none)
 - validation_checks (2-5 items)
 
 ────────────────────────────────────────────────────────
@@ -82,6 +110,10 @@ Example:
       #pragma omp section
       compute_b();
   }}
+Recursive divide and conquer (the AST report lists "Recursive Function" with 2+ self-calls) is also a task_graph,
+recommended as task: each independent recursive call becomes `#pragma omp task` above a size cutoff, followed by
+`#pragma omp taskwait` before the results are combined. Blockers: calls that overlap in memory, allocator calls in
+the combine step (list them so they are hoisted into one preallocated scratch buffer).
 
 D) vectorize
 Definition: small inner loops or element-wise operations suitable for SIMD.
@@ -92,6 +124,103 @@ Example:
       a[i] = b[i] * c[i];
   }}
 
+E) loop_interchange
+Definition: a loop nest whose innermost loop strides through memory (the AST report lists "Strided Access");
+reordering the loops makes the inner access unit-stride. Usually combined with parallel for on the outer loop.
+Example (i-j-k -> i-k-j):
+  for(int i=0; i<N; i++)
+      for(int k=0; k<N; k++)
+          for(int j=0; j<N; j++)
+              C[i*N + j] += A[i*N + k] * B[k*N + j];
+
+F) tiling
+Definition: a nest that re-reads the same data across outer iterations (matrix products, stencils); blocking it into
+tiles that fit in cache reuses data before eviction. Report tile sizes as tunables.
+Example:
+  for(int ii=0; ii<N; ii+=TILE_I)
+      for(int kk=0; kk<N; kk+=TILE_K)
+          for(int i=ii; i<min(ii+TILE_I,N); i++)
+              for(int k=kk; k<min(kk+TILE_K,N); k++) ...
+
+G) stencil
+Definition: each output point is computed from a fixed neighbourhood of an input array that is not written in the
+same sweep (the AST report lists "Stencil"), usually inside a time loop that swaps input/output buffers. Classify
+these as stencil, not loop_map: a plain parallel for is safe but every sweep still streams the whole grid through
+memory. The recommended form cuts the grid into row bands or 2D tiles with halo cells, advances several time steps
+per tile (overlapped tiling) and, for separable kernels such as a box blur, uses two 1D passes.
+Example:
+  for(int r=1; r<rows-1; r++)
+      for(int c=1; c<cols-1; c++)
+          out[r*cols + c] = (in[(r-1)*cols + c] + in[r*cols + c] + in[(r+1)*cols + c]) / 3.0;
+Blockers: an in-place update (same array read at neighbour offsets and written) is a loop-carried dependency.
+Points the kernel never writes (the outer frame) keep whatever the destination buffer held; mention them in
+validation_checks.
+
+H) first_touch
+Definition: a loop that only initializes arrays (the AST report lists "First Touch") which a later parallel loop
+sweeps. Pages live on the NUMA node of the thread that first writes them, so a serial initialization puts all data
+on one socket and the parallel kernel reads remotely from the others. Give the initialization the consumer's
+partition: schedule="static" like the consumer (never dynamic), and proc_bind="spread" on both this candidate and
+the consumer candidate so thread t runs on the same place in both regions. When the report says the index ranges
+differ, say in the reason how to reshape the initialization into the consumer's outer loop.
+Parallelize it even when the cost model puts it below break-even: placement, not its own time, is the gain.
+Example:
+  #pragma omp parallel for schedule(static) proc_bind(spread)
+  for(int i=0; i<N; i++) {{ a[i] = 0.0; b[i] = i; }}
+  ...
+  #pragma omp parallel for schedule(static) proc_bind(spread)
+  for(int i=0; i<N; i++) c[i] = a[i] + b[i];
+
+I) offload (only when the AST report has "Offload" lines: the run targets a GPU)
+Definition: a dense loop nest with enough work to pay for a kernel launch and its host<->device copies.
+- recommendation target_teams on each loop of the kernel function the report names, with its map clauses in
+  map_clauses (read-only arrays to, write-only arrays from, read and written arrays tofrom, per-call temporaries
+  alloc). The loops must not call anything but math functions. Temporaries the report says carry values from one
+  loop to the next belong in its `target data map(alloc: ...)` around all of the kernel's loops, never in a
+  per-loop map(alloc:).
+- "Device Residency" names the caller loop that repeats the kernel (time steps): add a second offload candidate
+  spanning that loop, recommendation target_data, with the report's map clauses, so arrays are copied once
+  instead of on every call. If the report says the host touches an array between calls, add a validation check
+  for the `target update from(...)` it needs.
+- Validation checks: "compare output with sequential", "every pointer used on the device is mapped".
+
+J) array_reduction
+Definition: a loop accumulates into array elements that other iterations also update (the AST report lists
+"Array Reduction"): a histogram h[b[i]]++, a scatter-add y[col[k]] += v, or a symmetric pair loop adding to f[i]
+and subtracting from f[j]. The scalar reduction clause does not cover it, and a plain parallel for races on the
+elements. Classify it as array_reduction, recommendation parallel_for_array_reduction, parallelizable "yes" when
+every access to the array in the loop is that update (the report only lists such arrays), and name in the reason
+the strategy the report picked for this array size and thread count:
+- array section: `reduction(+:h[0:n])` with the report's extent (small arrays; each thread gets a stack copy);
+- private copies: one heap copy per thread, merged pairwise in log2(threads) rounds (arrays too big for the stack);
+- atomic: `#pragma omp atomic` on each update (huge arrays, or fewer updates than elements x threads).
+Validation checks: "compare output with sequential"; floating-point sums add in a different order, so mention
+the tolerance for double accumulators.
+
+K) pipeline
+Definition: a loop (often `for (;;)` or `while`) whose every iteration reads a block from a file or descriptor,
+processes it and writes the result (the AST report lists it under "streaming pipeline loop(s)"). The read carries
+the stream position and "Carried State" into the next iteration and the writes must stay in order, so it is not
+a parallel for; but processing block k can run while block k+1 is read and block k-1 is written. Classify it as
+pipeline, recommendation task_pipeline, spanning the whole loop, parallelizable "yes" when the process stage does
+not touch the streams. Put in the reason the stages with their lines, the "Carried State" that stays in the read
+task, and the "Stage Buffers" and "Process Scratch" arrays that need one copy per ring slot. Running totals
+("Accumulated") are summed in the write task, which runs in order.
+Blockers: the process stage calls the I/O functions itself; a later read depends on what an earlier write
+produced (same file).
+Validation checks: "output file identical to sequential", "records and checksum match".
+
+Only propose E/F/G when the reordered nest computes the same result (independent iterations or a reordering of a
+reduction that the validation tolerance allows).
+
+Time-stepped kernels (a step function called inside a loop):
+- If the AST report lists "Heap Allocation Hot Spots", say so in the reason: per-step malloc/free should move to
+  scratch buffers allocated once by the caller, and the validation_checks should include "no allocation per step".
+- When a step has several parallelizable loops separated only by data dependencies (e.g. force then integrate),
+  note that they can share one parallel region with `omp for` and barriers instead of one fork/join per loop.
+- A pairwise loop that updates both element i and element j (symmetric interactions) is an array reduction
+  (J above), not a blocker.
+
 ────────────────────────────────────────────────────────
 2) Decide if it is parallelizable
 
@@ -99,19 +228,77 @@ Example:
 - maybe: possible after refactor (e.g., remove shared mutation)
 - no: not safe (true dependency, required ordering)
 
+Dependence evidence:
+- Loops with array accesses carry a "Dependence Analysis" block: every loop level is marked "independent" or
+  "carried: <array pair> (distance d)" / "scalar x (reduction +)" / "call f() (effects not analyzed)", computed
+  with GCD and Banerjee tests on the affine subscripts.
+- Base parallelizable and the blockers on it: an "independent" level is "yes"; a level carried only by scalar
+  reductions is parallel_for_reduction; a level carried by an array dependence is "no" for that level, and the
+  array pair with its distance is the blocker. Only reason about call side effects yourself.
+- Non-affine subscripts (indirect indices, pointer arithmetic) are assumed to conflict; say so in the reason
+  rather than claiming independence. An array the report lists under "Array Reduction" is the exception: its
+  carried dependences are the accumulation itself (candidate J), not a blocker.
+- Follow "Evidence-based suggestion": put the collapse(n) depth in collapse and prefer its simd level for simd.
+- "Pointer Aliasing" traces pointer parameters to their allocations at every call site. Distinct array
+  parameters ("restrict-safe") rule out the "pointer aliasing" blocker for that function; mention restrict in the
+  reason of its loop candidates. Parameters listed under "may alias" keep the blocker.
+
 Common blockers to list explicitly:
 - loop-carried dependency: value from previous iteration used
 - shared mutable state: writing to same memory location
 - function calls with side effects: printf, file I/O, etc.
 - pointer aliasing: uncertain memory access patterns
+- rng state: rand()/srand()/rand_r()/drand48() in the loop (the AST report says "BLOCKER: calls rand()"); list it as
+  "rng state: rand()". A Monte Carlo loop (samples only feed a count or sum) is still "maybe" with recommendation
+  parallel_for_reduction: the implementer moves it onto per-block counter-based streams. Add a validation check
+  "compare with a statistical tolerance": the new stream changes the estimate within its sampling error.
+  Loops that must reproduce the exact rand() sequence (e.g. input generation compared bit-for-bit) are "no".
+
+Cost model:
+- Top-level loops carry "Estimated Work": trip count x per-iteration cost, priced with the fork/join and
+  parallel for overheads measured on this machine (the "Cost Model" line). A loop "BELOW BREAK-EVEN" is
+  parallelizable "no", recommendation none, blocker "too little work: <estimate>", even when it is independent;
+  the validator applies the same rule after you.
+- When its size is a runtime parameter the report gives "use if(n > T)": keep the verdict and set if_clause
+  to that condition, so the region only forks for large inputs.
+- Task recursion: the "Cost Model" line gives the work a task must carry; use it to pick the serial cutoff.
+- "Arithmetic Intensity" gives a loop's flops per byte with no reuse (streamed) and with perfect reuse
+  (compulsory), classified against this machine's ridge point (the "Roofline" line). A loop that is
+  "bandwidth-bound even with perfect cache reuse" gains at most the ratio of multi-thread to single-thread triad
+  bandwidth: recommend fusing it with neighbouring loops over the same arrays rather than more threads.
+  "blocking pays off": recommend tiling along with the parallel loop. Compute-bound loops scale with threads.
+- "Runtime Share" is the loop's measured share of a profiled run, callees included, with the Amdahl bound on
+  parallelizing it alone. Spend the analysis on the loops with the largest share. A loop marked "cold" is left
+  sequential: report no candidate for it (first_touch loops excepted).
+- A loop marked "Harness" is the bench.h repetition loop that times the benchmark (it calls bench_now and
+  bench_record). It must stay serial: report no candidate for it; the loops and calls inside it are fair game.
+
+Schedule (parallel_for / parallel_for_reduction / parallel_for_array_reduction only):
+- The AST report lists "Iteration Cost: varies" when iteration cost depends on the iterator (triangular inner loops,
+  a callee that loops up to its argument such as trial division, early exits). A static split then leaves one
+  thread with most of the work.
+- Uniform cost: schedule="static", chunk=null.
+- Varying cost: schedule="dynamic" with a chunk large enough to amortize scheduling (an iteration doing little work
+  needs chunks of 64+; heavy iterations can use 1-16), or "guided" for monotonically growing/shrinking cost.
+- Unsure: schedule="runtime"; the validator times several OMP_SCHEDULE values and keeps the fastest.
 
 ────────────────────────────────────────────────────────
 3) Recommendation label (MUST choose one)
 
 - parallel_for: independent iterations, use #pragma omp parallel for
 - parallel_for_reduction: accumulator pattern, use reduction clause
+- parallel_for_array_reduction: accumulation into a shared array, with the strategy the "Array Reduction" line gives
 - parallel_sections: independent blocks, use #pragma omp parallel sections  
+- task: recursive divide and conquer, use #pragma omp task / taskwait with a serial cutoff
+- task_pipeline: read/process/write stages as #pragma omp task depend(...) over a ring of buffers
 - simd: inner loop vectorization, use #pragma omp simd
+- loop_interchange: reorder the nest for unit-stride inner access (plus parallel for on the outer loop)
+- tiling: block the nest into cache-sized tiles with tunable tile sizes (plus parallel for over tiles)
+- stencil_tiling: halo tiles with fused time steps (plus parallel for over tiles); plain parallel_for is acceptable
+  when the time loop is not in the candidate's range
+- first_touch: parallel for with the consumer loop's schedule(static) and proc_bind
+- target_teams: #pragma omp target teams distribute parallel for with map clauses (offload kernels)
+- target_data: #pragma omp target data around a loop that repeats offloaded kernels
 - none: no meaningful parallelism
 
 ────────────────────────────────────────────────────────
@@ -119,7 +306,10 @@ Common blockers to list explicitly:
 
 For each candidate region:
 - Use AST report line numbers for loops when available.
-- Provide: id, type, start_line, end_line, parallelizable, reason, blockers, recommendation, validation_checks.
+- Large files arrive with cold function bodies elided (`/* MAAP: name is cold; ... */`); report no candidates in
+  them and count lines in the code as given.
+- Provide: id, type, start_line, end_line, parallelizable, reason, blockers, recommendation, validation_checks,
+  and schedule/chunk/collapse/if_clause/proc_bind for loop candidates, map_clauses for offload candidates.
 - validation_checks must be concrete (e.g., "compare output with sequential", "verify no data races").
 
 Do NOT write code. Output only structured data matching the schema.
@@ -0,0 +1,446 @@
+"""
+Array reductions: loops that accumulate into array elements another iteration
+of the parallel loop may also update. Examples are a histogram `h[b[i]]++`,
+a scatter-add `y[col[k]] += v[k] * x[i]`, and the symmetric pair loop of an
+n-body step, which adds to f[i] and subtracts from f[j]. The scalar reduction
+detection never sees these, and the dependence analysis can only report the
+array as carried. These loops still parallelize when each thread accumulates
+privately. There are three ways to do that, and the cheaper one depends on
+the array's size against the thread count:
+  - an OpenMP array-section reduction, reduction(+:h[0:n]): every thread gets
+    a private zeroed copy (on its stack) that the runtime adds into h at the
+    end; for small arrays;
+  - per-thread copies allocated once on the heap and merged pairwise in
+    log2(threads) rounds, each round parallel over the elements; for arrays too
+    big for the stack whose copies still fit in cache;
+  - #pragma omp atomic on each update, when the copies would cost more to zero
+    and merge (threads x elements) than the loop has updates, or would not fit
+    in the cache.
+"""
+
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+from pycparser import c_ast, c_generator
+
+from agents.c_ast_helpers import TYPE_SIZES, array_base, id_names, indexed_arrays, loop_bound, loop_var, top_level_loops
+from agents.c_cost_model import CostEstimator, Unresolved
+from agents.c_dependence import NonAffine, affine_form
+
+SECTION_BYTES = 64 * 1024             # per private copy: array-section copies live on each thread's stack
+PRIVATE_BYTES = 4 * 1024 * 1024       # per private copy: above this the copies no longer stay cached
+_OPERATORS = {'+=': '+', '-=': '+', '*=': '*', '|=': '|', '&=': '&', '^=': '^'}
+_COMBINE = {'+': '+', '-': '+', '*': '*', '|': '|', '&': '&', '^': '^'}
+_ALLOCATORS = {"malloc", "calloc", "aligned_alloc"}
+
+
+@dataclass
+class ArrayReduction:
+    line: int                             # the loop whose iterations are split
+    function: str
+    array: str
+    op: str                               # reduction operator: + * | & ^
+    updates: List[str]                    # source text of every update of the array in the loop
+    index: str                            # how the conflicting subscript is formed
+    element: str                          # element type
+    extent: Optional[str] = None          # element count in the function's own variables, e.g. "nbins"
+    elements: Optional[float] = None      # its value at the default size
+    threads: int = 1
+    executions: Optional[float] = None    # updates the loop performs per run, at the default size
+    strategy: str = "atomic"              # section | private | atomic
+    index_arrays: List[str] = field(default_factory=list)
+
+    @property
+    def copy_bytes(self) -> Optional[float]:
+        return self.elements * TYPE_SIZES.get(self.element, 8) if self.elements is not None else None
+
+    def clause(self) -> Optional[str]:
+        return f"reduction({self.op}:{self.array}[0:{self.extent}])" if self.strategy == "section" else None
+
+    def describe(self) -> str:
+        size = (f"{self.elements:.0f} x {self.element} = {_kib(self.copy_bytes)} per private copy"
+                if self.elements is not None else f"extent {self.extent or 'unknown'}")
+        text = f"{self.array} (operator {self.op}) via {', '.join(self.updates)}: {self.index}; {size}"
+        if self.strategy == "section":
+            return text + f", {self.threads} thread(s) -> array section: {self.clause()}"
+        if self.strategy == "private":
+            why = "too large for a stack section" if self.elements is not None else "size known only at run time"
+            return (text + f", {self.threads} thread(s) -> per-thread copies of {self.extent} elements allocated "
+                           f"once, merged pairwise in log2(threads) rounds ({why})")
+        if self.elements is None and self.extent is None:
+            reason = "the extent is unknown, so private copies cannot be sized"
+        elif self.executions is not None and self.elements is not None \
+                and self.executions < self.elements * self.threads:
+            reason = (f"~{self.executions:.3g} updates against {self.threads} x {self.elements:.0f} elements "
+                      "to zero and merge in private copies")
+        else:
+            reason = f"{self.threads} private copies would not fit in cache"
+        return text + f" -> #pragma omp atomic on each update ({reason})"
+
+
+def _kib(size: float) -> str:
+    return f"{size / 1024:.1f} KiB" if size < 1024 * 1024 else f"{size / 1024 / 1024:.1f} MiB"
+
+
+def choose_strategy(elements: Optional[float], element_bytes: int, threads: int, executions: Optional[float],
+                    sized: bool) -> str:
+    """section, private or atomic for an array of `elements` updated `executions` times (None: unknown)."""
+    if elements is None:
+        return "private" if sized else "atomic"
+    if executions is not None and executions < elements * max(threads, 1):
+        return "atomic"
+    copy = elements * element_bytes
+    if copy <= SECTION_BYTES:
+        return "section"
+    return "private" if copy <= PRIVATE_BYTES else "atomic"
+
+
+def _subscripts(ref: c_ast.ArrayRef) -> List[c_ast.Node]:
+    subscripts = []
+    node = ref
+    while isinstance(node, c_ast.ArrayRef):
+        subscripts.insert(0, node.subscript)
+        node = node.name
+    return subscripts
+
+
+def _bare_index(ref: c_ast.ArrayRef, var: str) -> bool:
+    """Whether `ref` is a one-dimensional a[var], ignoring casts."""
+    subscripts = _subscripts(ref)
+    if len(subscripts) != 1:
+        return False
+    node = subscripts[0]
+    while isinstance(node, c_ast.Cast):
+        node = node.expr
+    return isinstance(node, c_ast.ID) and node.name == var
+
+
+def _update(node) -> Optional[Tuple[c_ast.ArrayRef, str, Optional[c_ast.Node]]]:
+    """(target, operator, the target's read in the rvalue) for a[k] op= x, a[k]++ and a[k] = a[k] op x."""
+    generator = c_generator.CGenerator()
+    if isinstance(node, c_ast.Assignment) and isinstance(node.lvalue, c_ast.ArrayRef):
+        if node.op in _OPERATORS:
+            return node.lvalue, _OPERATORS[node.op], None
+        rvalue = node.rvalue
+        if node.op == '=' and isinstance(rvalue, c_ast.BinaryOp) and rvalue.op in _COMBINE \
+                and generator.visit(rvalue.left) == generator.visit(node.lvalue):
+            return node.lvalue, _COMBINE[rvalue.op], rvalue.left
+    if isinstance(node, c_ast.UnaryOp) and node.op in ('++', '--', 'p++', 'p--') \
+            and isinstance(node.expr, c_ast.ArrayRef):
+        return node.expr, '+', None
+    return None
+
+
+class _LoopScan:
+    """Every array update, plain store and read in one loop, with its nested iterators and locals."""
+
+    def __init__(self, loop: c_ast.For):
+        self.var = loop_var(loop)
+        self.inner: Dict[str, c_ast.For] = {}
+        self.locals: Dict[str, Optional[c_ast.Node]] = {}
+        self.written = set()
+        self.updates: Dict[str, List[Tuple[c_ast.Node, c_ast.ArrayRef, str]]] = {}
+        self.stores = set()
+        self.reads: Dict[str, List[c_ast.ArrayRef]] = {}
+        self.walk(loop.stmt)
+
+    def walk(self, node, skip=()):
+        if isinstance(node, c_ast.For):
+            var = loop_var(node)
+            if var:
+                self.inner[var] = node
+        elif isinstance(node, c_ast.Decl) and node.name:
+            self.locals[node.name] = node.init
+        elif isinstance(node, c_ast.Assignment) and isinstance(node.lvalue, c_ast.ID):
+            self.written.add(node.lvalue.name)
+        elif isinstance(node, c_ast.UnaryOp) and node.op in ('++', '--', 'p++', 'p--') \
+                and isinstance(node.expr, c_ast.ID):
+            self.written.add(node.expr.name)
+        update = _update(node)
+        if update is not None:
+            target, op, read = update
+            base = array_base(target)
+            if base:
+                self.updates.setdefault(base, []).append((node, target, op))
+            for subscript in _subscripts(target):
+                self.walk(subscript)
+            if isinstance(node, c_ast.Assignment):
+                self.walk(node.rvalue, skip=(read,))
+            return
+        if isinstance(node, c_ast.Assignment) and isinstance(node.lvalue, c_ast.ArrayRef):
+            base = array_base(node.lvalue)
+            if base:
+                self.stores.add(base)
+            for subscript in _subscripts(node.lvalue):
+                self.walk(subscript)
+            self.walk(node.rvalue)
+            return
+        if isinstance(node, c_ast.ArrayRef):
+            if not any(node is s for s in skip):
+                base = array_base(node)
+                if base:
+                    self.reads.setdefault(base, []).append(node)
+            for subscript in _subscripts(node):
+                self.walk(subscript)
+            return
+        for _, child in node.children():
+            self.walk(child, skip)
+
+    def expanded(self, expr) -> Tuple[set, set]:
+        """(names, arrays) an index depends on, loop-local scalars replaced by their initializers."""
+        names, arrays, seen = set(), set(), set()
+        pending = [expr]
+        while pending:
+            node = pending.pop()
+            arrays |= indexed_arrays(node)
+            for name in id_names(node):
+                if name in self.locals and name not in seen and name not in self.inner:
+                    seen.add(name)
+                    if self.locals[name] is not None:
+                        pending.append(self.locals[name])
+                    else:
+                        names.add(name)
+                else:
+                    names.add(name)
+        return names - arrays, arrays
+
+    def owned(self, target: c_ast.ArrayRef) -> bool:
+        """
+        True when a subscript is c*i plus a loop-invariant offset for the parallel iterator i,
+        so no other iteration writes the element. An inner iterator or a symbolic
+        coefficient next to i (out[i + j], a[i*n]) lets several iterations meet.
+        """
+        variant = (self.written | set(self.locals)) - set(self.inner)
+        for subscript in _subscripts(target):
+            try:
+                form = affine_form(subscript, [self.var, *self.inner], variant)
+            except NonAffine:
+                continue
+            terms = {key for key, coefficient in form.items() if key[0] is not None and coefficient}
+            if terms == {(self.var, ())}:
+                return True
+        return False
+
+    def index_kind(self, targets: List[c_ast.ArrayRef]) -> Tuple[str, List[str], Optional[str]]:
+        """(description, index arrays, inner iterator) of the conflicting subscripts."""
+        generator = c_generator.CGenerator()
+        names, arrays = set(), set()
+        direct = []
+        for target in targets:
+            for subscript in _subscripts(target):
+                n, a = self.expanded(subscript)
+                names |= n
+                arrays |= a
+                node = subscript
+                while isinstance(node, c_ast.Cast):
+                    node = node.expr
+                if isinstance(node, c_ast.ID) and node.name in self.locals and self.locals[node.name] is not None:
+                    node = self.locals[node.name]
+                    while isinstance(node, c_ast.Cast):
+                        node = node.expr
+                direct.append(isinstance(node, c_ast.ArrayRef))
+        inner = next((v for v in self.inner if v in names), None)
+        texts = ", ".join(generator.visit(t) for t in targets)
+        if arrays and all(direct):
+            return f"indirect index through {', '.join(a + '[]' for a in sorted(arrays))}", sorted(arrays), inner
+        if arrays:
+            return f"index computed from {', '.join(a + '[]' for a in sorted(arrays))}", sorted(arrays), inner
+        if inner:
+            return (f"inner-loop index {inner} ({texts}): elements other iterations of {self.var} also update",
+                    [], inner)
+        if self.var in names:
+            return f"non-affine index in {self.var}", [], None
+        return "the same element in every iteration", [], None
+
+
+class _Extents:
+    """Element count and type of an array, traced to its declaration, allocation or a caller's."""
+
+    def __init__(self, ast: c_ast.FileAST):
+        self.estimator = CostEstimator(ast)
+        self.generator = c_generator.CGenerator()
+        self.globals = {ext.name: ext for ext in ast.ext if isinstance(ext, c_ast.Decl) and ext.name}
+
+    def _decls(self, function: str) -> Dict[str, c_ast.Decl]:
+        fn = self.estimator.functions[function]
+        found = {}
+        for param in self.estimator.params(function):
+            found[param] = next(p for p in fn.decl.type.args.params if isinstance(p, c_ast.Decl) and p.name == param)
+
+        def walk(node):
+            if isinstance(node, c_ast.Decl) and node.name:
+                found.setdefault(node.name, node)
+            for _, child in node.children():
+                walk(child)
+        walk(fn.body)
+        return found
+
+    def _allocation(self, function: str, array: str) -> Optional[c_ast.Node]:
+        """Element-count expression of array = malloc(n * sizeof(T)) / calloc(n, sizeof(T)) in function."""
+        sites = []
+
+        def walk(node):
+            if isinstance(node, c_ast.Decl) and node.name == array and node.init is not None:
+                sites.append(node.init)
+            elif isinstance(node, c_ast.Assignment) and isinstance(node.lvalue, c_ast.ID) \
+                    and node.lvalue.name == array and node.op == '=':
+                sites.append(node.rvalue)
+            for _, child in node.children():
+                walk(child)
+        walk(self.estimator.functions[function].body)
+        for expr in sites:
+            while isinstance(expr, c_ast.Cast):
+                expr = expr.expr
+            if not (isinstance(expr, c_ast.FuncCall) and isinstance(expr.name, c_ast.ID)
+                    and expr.name.name in _ALLOCATORS and expr.args):
+                continue
+            args = expr.args.exprs
+            if expr.name.name == "calloc" and len(args) == 2:
+                return args[0]
+            size = args[-1]
+            if isinstance(size, c_ast.BinaryOp) and size.op == '*':
+                for count, other in ((size.left, size.right), (size.right, size.left)):
+                    if isinstance(other, c_ast.UnaryOp) and other.op == 'sizeof':
+                        return count
+        return None
+
+    def _value(self, expr, function: str) -> Optional[float]:
+        try:
+            return self.estimator.value(expr, function, {})[0]
+        except (Unresolved, ValueError, ZeroDivisionError, OverflowError):
+            return None
+
+    def executions(self, loop: c_ast.For, function: str, updates: List[c_ast.Node]) -> Optional[float]:
+        """How often the update statements run in one execution of loop; None when a bound is unknown."""
+        estimator = self.estimator
+
+        def count(node, env) -> float:
+            if any(node is u for u in updates):
+                return 1.0
+            if isinstance(node, c_ast.For):
+                trips, _, var = estimator.trips(node, function, env)
+                start = node.init.decls[0].init if isinstance(node.init, c_ast.DeclList) else node.init.rvalue
+                lo, _ = estimator.value(start, function, env)
+                # Inner bounds that depend on this iterator see its mean value (triangular nests)
+                return trips * count(node.stmt, dict(env, **{var: lo + trips / 2}))
+            if isinstance(node, (c_ast.While, c_ast.DoWhile)):
+                raise Unresolved()
+            return sum(count(child, env) for _, child in node.children())
+        try:
+            return count(loop, {})
+        except (Unresolved, AttributeError, ValueError, OverflowError):
+            return None
+
+    def resolve(self, function: str, array: str, depth: int = 0) -> Tuple[Optional[str], Optional[float], str]:
+        """(count text in function's variables, count value, element type)."""
+        decls = self._decls(function)
+        decl = decls.get(array) or self.globals.get(array)
+        if decl is None:
+            return None, None, "double"
+        node, dims = decl.type, []
+        while isinstance(node, (c_ast.ArrayDecl, c_ast.PtrDecl)):
+            if isinstance(node, c_ast.ArrayDecl) and node.dim is not None:
+                dims.append(node.dim)
+            node = node.type
+        names = getattr(getattr(node, "type", None), "names", None) or ["double"]
+        element = names[-1]
+        if dims:
+            text = " * ".join(self.generator.visit(d) for d in dims)
+            values = [self._value(d, function) for d in dims]
+            return text, (None if None in values else _product(values)), element
+        count = self._allocation(function, array) if array in decls else None
+        if count is not None:
+            return self.generator.visit(count), self._value(count, function), element
+        params = self.estimator.params(function)
+        if array not in params or depth > 3:
+            return None, None, element
+        index = params.index(array)
+        texts, values = set(), []
+        for caller, args in self.estimator.calls.get(function, []):
+            if index >= len(args) or not isinstance(args[index], c_ast.ID):
+                return None, None, element
+            text, value, _ = self.resolve(caller, args[index].name, depth + 1)
+            # The caller's extent, renamed to the parameter it is passed as
+            renamed = next((p for p, a in zip(params, args) if text is not None and self.generator.visit(a) == text),
+                           None)
+            texts.add(renamed)
+            values.append(value)
+        if not values:
+            return None, None, element
+        return (texts.pop() if len(texts) == 1 else None), (None if None in values else max(values)), element
+
+
+def _product(values) -> float:
+    out = 1.0
+    for v in values:
+        out *= v
+    return out
+
+
+def _parallel_loops(loop: c_ast.For) -> List[c_ast.For]:
+    """
+    The loop, or when its iterator neither indexes an array nor bounds a nested loop
+    (a time-step or repeat loop), the outermost loops nested in it.
+    """
+    var, used, inner = loop_var(loop), set(), []
+
+    def walk(node):
+        if isinstance(node, c_ast.ArrayRef):
+            used.update(id_names(node.subscript))
+        if isinstance(node, c_ast.For):
+            inner.append(node)
+            used.update(*(id_names(n) for n in (node.init, node.cond) if n is not None))
+        for _, child in node.children():
+            walk(child)
+    walk(loop.stmt)
+    if var is None or var in used or not inner:
+        return [loop]
+    return [l for n in _nested_fors(loop.stmt) for l in _parallel_loops(n)]
+
+
+def _nested_fors(node) -> List[c_ast.For]:
+    if isinstance(node, c_ast.For):
+        return [node]
+    return [l for _, child in node.children() for l in _nested_fors(child)]
+
+
+def array_reductions(ast: c_ast.FileAST, threads: int) -> Dict[int, List[ArrayReduction]]:
+    """
+    Array reductions of every outermost loop, keyed by its line. An array qualifies
+    when at least one of its updates can hit an element another iteration of the
+    loop also updates, every access to it in the loop is an update with the same
+    combining operator, and it is not declared inside the loop.
+    """
+    extents = _Extents(ast)
+    generator = c_generator.CGenerator()
+    found: Dict[int, List[ArrayReduction]] = {}
+    for loop, function in ((l, fn) for top, fn in top_level_loops(ast) for l in _parallel_loops(top)):
+        scan = _LoopScan(loop)
+        if scan.var is None:
+            continue
+        line = loop.coord.line if loop.coord else 0
+        for array, updates in scan.updates.items():
+            ops = {op for _, _, op in updates}
+            if array in scan.locals or array in scan.stores or array in scan.reads or len(ops) != 1:
+                continue
+            conflicting = [target for _, target, _ in updates if not scan.owned(target)]
+            if not conflicting:
+                continue
+            index, index_arrays, inner = scan.index_kind(conflicting)
+            extent, elements, element = extents.resolve(function, array)
+            if extent is None and elements is None and inner is not None \
+                    and all(_bare_index(t, inner) for t in conflicting):
+                # A pair loop over j < n indexing a[j] touches elements [0, n); any
+                # other subscript of j has an unknown extent and stays atomic
+                extent = loop_bound(scan.inner[inner], generator)
+                elements = extents._value(scan.inner[inner].cond.right, function) if extent else None
+            op = ops.pop()
+            executions = extents.executions(loop, function, [u for u, _, _ in updates])
+            strategy = choose_strategy(elements, TYPE_SIZES.get(element, 8), threads, executions,
+                                       extent is not None)
+            if strategy == "section" and extent is None:
+                extent = f"{elements:.0f}"
+            found.setdefault(line, []).append(ArrayReduction(
+                line, function, array, op, [generator.visit(u) for u, _, _ in updates], index, element, extent,
+                elements, threads, executions, strategy, index_arrays))
+    return found
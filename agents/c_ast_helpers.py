@@ -0,0 +1,191 @@
+"""
+Helpers over pycparser trees shared by the C analyses: names and arrays an
+expression refers to, loop iterators and bounds, line ranges, loop and node
+walks, and the call sets the cost models treat specially.
+"""
+
+import re
+from typing import Dict, Optional, Set, Tuple
+
+from pycparser import c_ast, c_generator, c_parser
+
+LIBM = {"sin", "cos", "tan", "asin", "acos", "atan", "atan2", "sinh", "cosh", "tanh", "exp", "exp2", "log",
+        "log2", "log10", "pow", "cbrt", "hypot", "erf", "lgamma", "tgamma", "sinf", "cosf", "expf", "logf", "powf"}
+CHEAP_MATH = {"sqrt", "sqrtf", "fabs", "fabsf", "abs", "labs", "floor", "ceil", "fmin", "fmax", "round", "trunc",
+              "fma", "min", "max"}
+HARNESS_CALLS = {"bench_now", "bench_record", "bench_report", "bench_init", "printf", "fprintf", "puts"}
+TYPE_SIZES = {"char": 1, "short": 2, "int": 4, "float": 4, "long": 8, "double": 8}
+
+
+def id_names(node) -> set:
+    found = set()
+
+    def walk(n):
+        if isinstance(n, c_ast.ID):
+            found.add(n.name)
+        for _, child in n.children():
+            walk(child)
+    walk(node)
+    return found
+
+
+def array_base(ref: c_ast.ArrayRef) -> Optional[str]:
+    node = ref
+    while isinstance(node, c_ast.ArrayRef):
+        node = node.name
+    return node.name if isinstance(node, c_ast.ID) else None
+
+
+def indexed_arrays(node) -> set:
+    """Names of every array or pointer indexed anywhere in node."""
+    found = set()
+
+    def walk(n):
+        if isinstance(n, c_ast.ArrayRef):
+            base = array_base(n)
+            if base:
+                found.add(base)
+        for _, child in n.children():
+            walk(child)
+    walk(node)
+    return found
+
+
+def collect_accesses(node, read: Set[str], written: Set[str]) -> None:
+    """Adds the arrays node reads and writes (a compound assignment or ++ does both)."""
+    if isinstance(node, c_ast.Assignment) and isinstance(node.lvalue, c_ast.ArrayRef):
+        base = array_base(node.lvalue)
+        if base:
+            written.add(base)
+            if node.op != "=":
+                read.add(base)
+        collect_accesses(node.lvalue.subscript, read, written)
+        collect_accesses(node.rvalue, read, written)
+        return
+    if isinstance(node, c_ast.UnaryOp) and node.op in ("++", "--", "p++", "p--") \
+            and isinstance(node.expr, c_ast.ArrayRef):
+        base = array_base(node.expr)
+        if base:
+            read.add(base)
+            written.add(base)
+    elif isinstance(node, c_ast.ArrayRef):
+        base = array_base(node)
+        if base:
+            read.add(base)
+    for _, child in node.children():
+        collect_accesses(child, read, written)
+
+
+def loop_var(loop: c_ast.For) -> Optional[str]:
+    init = loop.init
+    if isinstance(init, c_ast.DeclList) and init.decls:
+        return init.decls[0].name
+    if isinstance(init, c_ast.Assignment) and isinstance(init.lvalue, c_ast.ID):
+        return init.lvalue.name
+    return None
+
+
+def loop_bound(loop: c_ast.For, generator) -> Optional[str]:
+    cond = loop.cond
+    if isinstance(cond, c_ast.BinaryOp) and cond.op in ("<", "<=", "!=") and isinstance(cond.left, c_ast.ID):
+        return generator.visit(cond.right)
+    return None
+
+
+def is_harness_loop(loop: c_ast.For) -> bool:
+    """Whether `loop` is the benchmark's repetition loop: its body calls bench_now or bench_record."""
+    def walk(n):
+        if isinstance(n, c_ast.FuncCall) and isinstance(n.name, c_ast.ID) and n.name.name in ("bench_now",
+                                                                                                 "bench_record"):
+            return True
+        return any(walk(child) for _, child in n.children())
+    return walk(loop.stmt)
+
+
+def node_line(node) -> int:
+    return node.coord.line if node.coord else 0
+
+
+def node_end_line(node) -> int:
+    lines = [node_line(node)]
+    for _, child in node.children():
+        lines.append(node_end_line(child))
+    return max(lines)
+
+
+def for_loops(node, within=()):
+    """Every for loop under node with the function-local loops enclosing it."""
+    for _, child in node.children():
+        if isinstance(child, c_ast.For):
+            yield child, within
+            yield from for_loops(child, within + (child,))
+        else:
+            yield from for_loops(child, within)
+
+
+def top_level_loops(node, function=None, found=None):
+    """
+    (loop, function) for every outermost for loop of every function under node.
+    The harness repetition loop does not count: the loops inside it are outermost.
+    """
+    found = [] if found is None else found
+    if isinstance(node, c_ast.FuncDef):
+        function = node.decl.name
+    if isinstance(node, c_ast.For) and function and not is_harness_loop(node):
+        found.append((node, function))
+        return found
+    for _, child in node.children():
+        top_level_loops(child, function, found)
+    return found
+
+
+def walk_nodes(node, skip=frozenset()):
+    """node and everything under it, pruning the subtrees whose id() is in skip."""
+    if id(node) in skip:
+        return
+    yield node
+    for _, child in node.children():
+        yield from walk_nodes(child, skip)
+
+
+class Renamer(c_generator.CGenerator):
+    """C generator that prints identifiers through a rename map."""
+
+    def __init__(self, names: Dict[str, str]):
+        super().__init__()
+        self.names = names
+
+    def visit_ID(self, n):
+        return self.names.get(n.name, n.name)
+
+
+def balanced_parens(text: str, start: int) -> Tuple[str, int]:
+    """(text inside the parenthesis opening at start, index after its match)."""
+    depth, i = 0, start
+    while i < len(text):
+        if text[i] == "(":
+            depth += 1
+        elif text[i] == ")":
+            depth -= 1
+            if depth == 0:
+                return text[start + 1:i], i + 1
+        i += 1
+    return text[start + 1:], len(text)
+
+
+def parse_with_pragmas(code: str) -> c_ast.FileAST:
+    """Parses generated code with its pragmas kept as Pragma nodes."""
+    from agents.c_ast_utils import preprocess_c_code
+    # Join continued pragma lines, keeping later line numbers, and protect pragmas from the preprocessor
+    lines, out = code.splitlines(), []
+    i = 0
+    while i < len(lines):
+        line, extra = lines[i], 0
+        while line.rstrip().endswith("\\") and i + 1 < len(lines) and line.lstrip().startswith("#"):
+            i += 1
+            line, extra = line.rstrip()[:-1] + " " + lines[i].strip(), extra + 1
+        out.append(re.sub(r"^(\s*)#\s*pragma\b", r"\1__MAAP_PRAGMA__", line))
+        out.extend([""] * extra)
+        i += 1
+    text = preprocess_c_code("\n".join(out)).replace("__MAAP_PRAGMA__", "#pragma")
+    return c_parser.CParser().parse(text, filename="<offload>")
@@ -6,6 +6,16 @@ that can potentially be parallelized using OpenMP.
 
 import re
 from pycparser import c_parser, c_ast, c_generator
+from agents.c_ast_helpers import is_harness_loop
+from agents.c_dependence import analyze_nest, format_dependence_report
+from agents.c_alias import AliasAnalysis, format_alias_report
+from agents.c_cost_model import DEFAULT_OVERHEADS, estimate_loops, describe_cost, format_overheads
+from agents.c_roofline import estimate_intensity, describe_intensity, format_machine
+from agents.c_numa import first_touch_loops
+from agents.c_array_reduction import array_reductions
+from agents.c_pipeline import format_pipelines, streaming_pipelines
+from agents.c_offload import offload_plan, describe_kernel, describe_region
+from agents.c_profiler import COLD_SHARE, describe_share, format_profile
 
 
 def preprocess_c_code(source_code: str) -> str:
@@ -19,8 +29,8 @@ def preprocess_c_code(source_code: str) -> str:
     # Remove single-line comments
     code = re.sub(r'//.*?$', '', source_code, flags=re.MULTILINE)
     
-    # Remove multi-line comments
-    code = re.sub(r'/\*.*?\*/', '', code, flags=re.DOTALL)
+    # Remove multi-line comments, keeping their newlines so AST line numbers match the source
+    code = re.sub(r'/\*.*?\*/', lambda m: '\n' * m.group(0).count('\n'), code, flags=re.DOTALL)
     
     # Simple macro expansion for object-like macros: #define KEY VALUE
     # This is a heuristic to handle simple constants like SIZE
@@ -39,8 +49,8 @@ def preprocess_c_code(source_code: str) -> str:
         code = re.sub(r'\b' + re.escape(name) + r'\b', macros[name], code)
 
     # Remove #include and other preprocessor directives (pycparser can't handle them)
-    # Remove any line starting with #
-    code = re.sub(r'^\s*#.*?$', '', code, flags=re.MULTILINE)
+    # Remove any line starting with # (the line itself stays, empty, for the same reason)
+    code = re.sub(r'^[ \t]*#.*?$', '', code, flags=re.MULTILINE)
     
     return code
 
@@ -51,11 +61,12 @@ class CLoopVisitor(c_ast.NodeVisitor):
     their parallelization potential.
     """
     
-    def __init__(self):
+    def __init__(self, functions=None):
         self.loops = []
         self.current_depth = 0
         self.variables_read = set()
         self.variables_written = set()
+        self.functions = functions or {}
     
     def visit_For(self, node):
         """Visit a for-loop node and extract parallelization-relevant info."""
@@ -70,6 +81,7 @@ class CLoopVisitor(c_ast.NodeVisitor):
             "potential_reductions": [],
             "potential_private_vars": [],
             "potential_shared_vars": [],
+            "harness": is_harness_loop(node),
         }
         
         # Extract initialization variable
@@ -84,8 +96,8 @@ class CLoopVisitor(c_ast.NodeVisitor):
         if node.next:
             loop_info["increment"] = self._node_to_string(node.next)
         
-        # Analyze loop body for variable usage
-        if node.stmt:
+        # Analyze loop body for variable usage; the bench.h timing loop stays serial
+        if node.stmt and not loop_info["harness"]:
             body_analyzer = CLoopBodyAnalyzer()
             body_analyzer.visit(node.stmt)
             loop_info["potential_reductions"] = list(body_analyzer.potential_reductions)
@@ -93,13 +105,22 @@ class CLoopVisitor(c_ast.NodeVisitor):
             loop_info["potential_shared_vars"] = list(body_analyzer.shared_vars)
             loop_info["has_function_calls"] = body_analyzer.has_function_calls
             loop_info["has_array_access"] = body_analyzer.has_array_access
+            loop_info["rng_calls"] = sorted(body_analyzer.rng_calls)
+            if loop_info["init_var"] and not _contains_for(node.stmt):
+                loop_info["strided_accesses"] = _strided_accesses(node.stmt, loop_info["init_var"])
+            if self.current_depth == 0:
+                loop_info["stencil"] = _stencil_info(node)
+                loop_info["dependence"] = analyze_nest(node)
+                if loop_info["init_var"]:
+                    loop_info["iteration_cost"] = _iteration_cost(node.stmt, loop_info["init_var"], self.functions)
         
         self.loops.append(loop_info)
         
-        # Visit nested loops
-        self.current_depth += 1
+        # Visit nested loops; those of the harness loop are outermost
+        nesting = 0 if loop_info["harness"] else 1
+        self.current_depth += nesting
         self.generic_visit(node)
-        self.current_depth -= 1
+        self.current_depth -= nesting
     
     def _extract_init_var(self, init_node):
         """Extract the loop iteration variable from initialization."""
@@ -122,6 +143,452 @@ class CLoopVisitor(c_ast.NodeVisitor):
             return "complex_expression"
 
 
+def _contains_for(node) -> bool:
+    """True if the subtree contains a nested for-loop."""
+    finder = _ForFinder()
+    finder.visit(node)
+    return finder.found
+
+
+class _ForFinder(c_ast.NodeVisitor):
+    def __init__(self):
+        self.found = False
+
+    def visit_For(self, node):
+        self.found = True
+
+
+def _stride_coefficient(expr, var):
+    """
+    Coefficient of `var` in a subscript expression: None if var does not occur,
+    "1" for unit stride, the multiplier's source text (e.g. "N") for linear
+    strides, "non-affine" otherwise.
+    """
+    generator = c_generator.CGenerator()
+    if isinstance(expr, c_ast.ID):
+        return "1" if expr.name == var else None
+    if isinstance(expr, c_ast.Constant):
+        return None
+    if isinstance(expr, c_ast.Cast):
+        return _stride_coefficient(expr.expr, var)
+    if isinstance(expr, c_ast.UnaryOp) and expr.op in ('-', '+'):
+        return _stride_coefficient(expr.expr, var)
+    if isinstance(expr, c_ast.BinaryOp) and expr.op in ('+', '-'):
+        left = _stride_coefficient(expr.left, var)
+        right = _stride_coefficient(expr.right, var)
+        if left and right:
+            return "non-affine"
+        return left or right
+    if isinstance(expr, c_ast.BinaryOp) and expr.op == '*':
+        left = _stride_coefficient(expr.left, var)
+        right = _stride_coefficient(expr.right, var)
+        if left and right:
+            return "non-affine"
+        if left:
+            other = generator.visit(expr.right)
+            return other if left == "1" else f"{left}*{other}"
+        if right:
+            other = generator.visit(expr.left)
+            return other if right == "1" else f"{other}*{right}"
+        return None
+    # Anything else (calls, indirect indices, division) is non-affine if var occurs inside
+    finder = _IDFinder(var)
+    finder.visit(expr)
+    return "non-affine" if finder.found else None
+
+
+class _IDFinder(c_ast.NodeVisitor):
+    def __init__(self, name):
+        self.name = name
+        self.found = False
+
+    def visit_ID(self, node):
+        if node.name == self.name:
+            self.found = True
+
+
+class _ArrayRefCollector(c_ast.NodeVisitor):
+    """Collects outermost ArrayRef nodes (a[i][j] is collected once)."""
+    def __init__(self):
+        self.refs = []
+
+    def visit_ArrayRef(self, node):
+        self.refs.append(node)
+        self.visit(node.subscript)
+
+
+def _strided_accesses(body, var):
+    """
+    Array accesses in an innermost loop body whose address does not advance by
+    one element per iteration of `var` (e.g. B[k*N + j] in a k loop).
+    Returns a list of (access source text, stride description).
+    """
+    generator = c_generator.CGenerator()
+    collector = _ArrayRefCollector()
+    collector.visit(body)
+    strided = []
+    for ref in collector.refs:
+        # Walk a[i][j]: the last subscript is contiguous, outer ones stride by a row
+        subscripts = []
+        node = ref
+        while isinstance(node, c_ast.ArrayRef):
+            subscripts.append(node.subscript)
+            node = node.name
+        stride = None
+        for depth, subscript in enumerate(subscripts):
+            coefficient = _stride_coefficient(subscript, var)
+            if coefficient is None:
+                continue
+            if depth > 0:
+                stride = "one row per iteration"
+            elif coefficient != "1":
+                stride = f"stride {coefficient}"
+        if stride:
+            text = generator.visit(ref)
+            if (text, stride) not in strided:
+                strided.append((text, stride))
+    return strided
+
+
+def _constant_value(node):
+    """Integer value of a (possibly negated) integer constant, else None."""
+    if isinstance(node, c_ast.UnaryOp) and node.op == '-':
+        value = _constant_value(node.expr)
+        return -value if value is not None else None
+    if isinstance(node, c_ast.Constant) and node.type == 'int':
+        try:
+            return int(node.value.rstrip('uUlL'), 0)
+        except ValueError:
+            return None
+    return None
+
+
+class _NestCollector(c_ast.NodeVisitor):
+    """
+    Collects, for one loop nest: iterator variables, "window" loops with small
+    constant bounds (e.g. for (dr = -1; dr <= 1; dr++)), arrays written and
+    array reads.
+    """
+    def __init__(self):
+        self.iterators = []
+        self.windows = {}
+        self.written = set()
+        self.reads = []
+
+    def visit_For(self, node):
+        var = _for_init_var(node.init)
+        if var:
+            self.iterators.append(var)
+            span = _for_constant_span(node)
+            if span is not None and span <= 9:
+                self.windows[var] = span
+        self.generic_visit(node)
+
+    def visit_Assignment(self, node):
+        target = node.lvalue
+        while isinstance(target, c_ast.ArrayRef):
+            target = target.name
+        if isinstance(target, c_ast.ID) and isinstance(node.lvalue, c_ast.ArrayRef):
+            self.written.add(target.name)
+            self.visit(node.lvalue.subscript)
+        elif not isinstance(node.lvalue, c_ast.ArrayRef):
+            self.visit(node.lvalue)
+        self.visit(node.rvalue)
+
+    def visit_ArrayRef(self, node):
+        self.reads.append(node)
+        self.visit(node.subscript)
+
+
+def _for_init_var(init):
+    if isinstance(init, c_ast.DeclList) and init.decls:
+        return init.decls[0].name
+    if isinstance(init, c_ast.Assignment) and isinstance(init.lvalue, c_ast.ID):
+        return init.lvalue.name
+    return None
+
+
+def _for_constant_span(node):
+    """Trip count of `for (v = a; v <= b / v < b; v++)` with constant a and b, else None."""
+    init = node.init
+    start = None
+    if isinstance(init, c_ast.DeclList) and init.decls and init.decls[0].init is not None:
+        start = _constant_value(init.decls[0].init)
+    elif isinstance(init, c_ast.Assignment):
+        start = _constant_value(init.rvalue)
+    cond = node.cond
+    if start is None or not isinstance(cond, c_ast.BinaryOp) or cond.op not in ('<', '<='):
+        return None
+    end = _constant_value(cond.right)
+    if end is None:
+        return None
+    return end - start + (1 if cond.op == '<=' else 0)
+
+
+def _stencil_info(nest):
+    """
+    Detects a stencil sweep in a loop nest: an array read at several
+    neighbouring offsets of the nest iterators (constant offsets such as
+    a[i-1], a[i+1], or small constant-bound window loops such as
+    in[(r+dr)*cols + (c+dc)]) while a different array is written.
+    Returns {"input", "output", "points"} or None.
+    """
+    collector = _NestCollector()
+    collector.visit(nest)
+    sweep_vars = [v for v in collector.iterators if v not in collector.windows]
+    if not sweep_vars or not collector.written:
+        return None
+
+    generator = c_generator.CGenerator()
+    by_array = {}
+    for ref in collector.reads:
+        base = ref
+        while isinstance(base, c_ast.ArrayRef):
+            base = base.name
+        if not isinstance(base, c_ast.ID) or base.name in collector.written:
+            continue
+        ids = _IDCollector()
+        ids.visit(ref)
+        if not any(v in ids.names for v in sweep_vars):
+            continue
+        entry = by_array.setdefault(base.name, {"refs": set(), "windows": set()})
+        entry["refs"].add(generator.visit(ref))
+        entry["windows"].update(v for v in collector.windows if v in ids.names)
+
+    for name, entry in by_array.items():
+        points = len(entry["refs"])
+        for var in entry["windows"]:
+            points *= collector.windows[var]
+        if points >= 3:
+            return {"input": name, "output": ", ".join(sorted(collector.written)), "points": points}
+    return None
+
+
+class _IDCollector(c_ast.NodeVisitor):
+    def __init__(self):
+        self.names = set()
+
+    def visit_ID(self, node):
+        self.names.add(node.name)
+
+
+class _CostVisitor(c_ast.NodeVisitor):
+    """Loops and early exits inside a loop body, as seen by _iteration_cost."""
+    def __init__(self):
+        self.inner_loops = []
+        self.early_exits = 0
+        self.calls = []
+
+    def visit_For(self, node):
+        self.inner_loops.append(node)
+        self.generic_visit(node)
+
+    visit_While = visit_For
+    visit_DoWhile = visit_For
+
+    def visit_Break(self, node):
+        self.early_exits += 1
+
+    def visit_Return(self, node):
+        self.early_exits += 1
+        self.generic_visit(node)
+
+    def visit_FuncCall(self, node):
+        self.calls.append(node)
+        self.generic_visit(node)
+
+
+def _loop_bound_ids(loop):
+    """Identifiers in the header (init and condition) of an inner loop."""
+    finder = _IDCollector()
+    for part in (getattr(loop, 'init', None), loop.cond):
+        if part is not None:
+            finder.visit(part)
+    return finder.names
+
+
+def _iteration_cost(body, var, functions):
+    """
+    Estimates whether the cost of one iteration of a loop over `var` varies:
+      - "triangular": an inner loop bound depends on var (e.g. j = i+1 .. n)
+      - "data-dependent": a called function loops up to (or exits early on) a
+        bound derived from its argument, as in is_prime(i); or the body exits early
+    Returns (kind, reason); kind is "uniform" when nothing varies.
+    Variable cost calls for schedule(dynamic|guided) instead of the static default.
+    """
+    cost = _CostVisitor()
+    cost.visit(body)
+    for loop in cost.inner_loops:
+        if var in _loop_bound_ids(loop):
+            return "triangular", f"inner loop bound depends on {var}"
+    for call in cost.calls:
+        name = _call_name(call)
+        func = functions.get(name)
+        if func is None or not call.args:
+            continue
+        ids = _IDCollector()
+        ids.visit(call.args)
+        if var not in ids.names:
+            continue
+        params = []
+        if func.decl.type.args:
+            params = [p.name for p in func.decl.type.args.params if getattr(p, 'name', None)]
+        callee = _CostVisitor()
+        callee.visit(func.body)
+        for loop in callee.inner_loops:
+            if set(params) & _loop_bound_ids(loop):
+                return "data-dependent", f"{name}() loops up to a bound taken from its argument ({var})"
+    if cost.early_exits and cost.inner_loops:
+        return "data-dependent", "inner loop exits early"
+    return "uniform", "no iteration-dependent inner work found"
+
+
+_ALLOC_FUNCS = ('malloc', 'calloc', 'realloc')
+
+# libc generators with hidden or caller-carried sequential state
+_RNG_FUNCS = ('rand', 'srand', 'rand_r', 'random', 'srandom', 'drand48', 'erand48', 'lrand48', 'srand48')
+
+
+def _call_name(node):
+    if isinstance(node, c_ast.FuncCall) and isinstance(node.name, c_ast.ID):
+        return node.name.name
+    return None
+
+
+class _CallGraphVisitor(c_ast.NodeVisitor):
+    """
+    Records, per function: pointers assigned from malloc/calloc/realloc, pointers
+    passed to free, allocations made inside a loop body, every function called
+    (with the number of call sites) and the functions called inside loop bodies.
+    """
+    def __init__(self):
+        self.functions = {}
+        self.current = None
+        self.loop_depth = 0
+
+    def visit_FuncDef(self, node):
+        self.current = {
+            "name": node.decl.name,
+            "line": node.coord.line if node.coord else "unknown",
+            "allocs": {},
+            "frees": set(),
+            "loop_allocs": [],
+            "calls": {},
+            "loop_calls": {},
+        }
+        self.functions[node.decl.name] = self.current
+        self.loop_depth = 0
+        self.generic_visit(node)
+        self.current = None
+
+    def visit_For(self, node):
+        self.loop_depth += 1
+        self.generic_visit(node)
+        self.loop_depth -= 1
+
+    visit_While = visit_For
+    visit_DoWhile = visit_For
+
+    def visit_Decl(self, node):
+        if node.init is not None:
+            self._record_alloc(node.name, node.init, node)
+        self.generic_visit(node)
+
+    def visit_Assignment(self, node):
+        if isinstance(node.lvalue, c_ast.ID):
+            self._record_alloc(node.lvalue.name, node.rvalue, node)
+        self.generic_visit(node)
+
+    def visit_FuncCall(self, node):
+        name = _call_name(node)
+        if self.current is not None and name:
+            line = node.coord.line if node.coord else "unknown"
+            if name == 'free' and node.args and node.args.exprs and isinstance(node.args.exprs[0], c_ast.ID):
+                self.current["frees"].add(node.args.exprs[0].name)
+            elif name not in _ALLOC_FUNCS:
+                site = self.current["calls"].setdefault(name, {"line": line, "count": 0})
+                site["count"] += 1
+                if self.loop_depth > 0:
+                    self.current["loop_calls"].setdefault(name, line)
+        self.generic_visit(node)
+
+    def _record_alloc(self, var, expr, node):
+        while isinstance(expr, c_ast.Cast):
+            expr = expr.expr
+        func = _call_name(expr)
+        if self.current is None or func not in _ALLOC_FUNCS:
+            return
+        line = node.coord.line if node.coord else "unknown"
+        self.current["allocs"].setdefault(var, line)
+        if self.loop_depth > 0:
+            self.current["loop_allocs"].append((var, func, line))
+
+
+def _heap_hot_spots(graph):
+    """
+    Heap traffic that repeats on a hot path and can be hoisted into a buffer
+    allocated once by the caller:
+      - allocations inside a loop body
+      - functions that allocate and free the same pointer on every call and
+        are called inside a loop (e.g. a per-step scratch array) or from a
+        recursive function (e.g. the merge step of a merge sort)
+    Returns a list of human-readable findings.
+    """
+    findings = []
+    for func in graph.functions.values():
+        for var, alloc, line in func["loop_allocs"]:
+            freed = " and freed" if var in func["frees"] else ""
+            findings.append(f"{func['name']}: {var} = {alloc}(...) at line {line} runs inside a loop{freed}; "
+                            f"allocate it once before the loop and reuse it")
+    for caller in graph.functions.values():
+        recursive = caller["name"] in caller["calls"]
+        for callee_name, site in caller["calls"].items():
+            callee = graph.functions.get(callee_name)
+            if callee is None or callee_name == caller["name"]:
+                continue
+            if callee_name in caller["loop_calls"]:
+                where = f"inside a loop in {caller['name']} (line {caller['loop_calls'][callee_name]})"
+            elif recursive:
+                where = f"from the recursive function {caller['name']} (line {site['line']})"
+            else:
+                continue
+            scratch = sorted(v for v in callee["allocs"] if v in callee["frees"])
+            if scratch:
+                findings.append(f"{callee_name} (line {callee['line']}) allocates and frees {', '.join(scratch)} "
+                                f"on every call and is called {where}; "
+                                f"hoist them into persistent scratch buffers owned by the caller")
+    return findings
+
+
+def _rng_seeding(graph):
+    """
+    Functions that seed a libc generator from time(), e.g.
+    `unsigned seed = time(NULL); ... rand_r(&seed)`. Every caller that runs in
+    the same second gets the same stream, so parallel callers repeat samples.
+    """
+    findings = []
+    for func in graph.functions.values():
+        rng = sorted(name for name in func["calls"] if name in _RNG_FUNCS)
+        if rng and 'time' in func["calls"]:
+            findings.append(f"{func['name']} (line {func['line']}) seeds {', '.join(rng)} from time(); "
+                            f"concurrent callers draw identical streams. Give each caller its own "
+                            f"maap_rng stream (maap_rng_init(&rng, seed, stream_id))")
+    return findings
+
+
+def _recursive_functions(graph):
+    """
+    Directly recursive functions as (name, line, self-call count). Two or more
+    self-calls indicate divide and conquer, where each call can become a task.
+    """
+    found = []
+    for func in graph.functions.values():
+        site = func["calls"].get(func["name"])
+        if site:
+            found.append((func["name"], func["line"], site["count"]))
+    return found
+
+
 class CLoopBodyAnalyzer(c_ast.NodeVisitor):
     """
     Analyzes the body of a loop to detect:
@@ -140,6 +607,7 @@ class CLoopBodyAnalyzer(c_ast.NodeVisitor):
         self.all_vars_written = set()
         self.has_function_calls = False
         self.has_array_access = False
+        self.rng_calls = set()
     
     def visit_Assignment(self, node):
         """Detect assignments and potential reductions."""
@@ -174,6 +642,9 @@ class CLoopBodyAnalyzer(c_ast.NodeVisitor):
     def visit_FuncCall(self, node):
         """Detect function calls which may have side effects."""
         self.has_function_calls = True
+        name = _call_name(node)
+        if name in _RNG_FUNCS:
+            self.rng_calls.add(name)
         self.generic_visit(node)
     
     def visit_ArrayRef(self, node):
@@ -182,40 +653,78 @@ class CLoopBodyAnalyzer(c_ast.NodeVisitor):
         self.generic_visit(node)
 
 
-def analyze_c_code_ast(source_code: str) -> str:
+def analyze_c_code_ast(source_code: str, overheads=None, machine=None, offload=False, ast=None, profile=None) -> str:
     """
     Parses C source code and returns a detailed report of potential
     parallelizable loops with OpenMP-relevant information.
     
     Args:
         source_code: The C source code to analyze
+        overheads: Measured OpenMP overheads (agents.c_cost_model.calibrate) for the
+            per-loop work estimates; DEFAULT_OVERHEADS when omitted
+        machine: Measured triad bandwidth and peak (agents.c_roofline.calibrate_roofline)
+            that classifies each loop's arithmetic intensity; intensities only when omitted
+        offload: Also plan `omp target` offload kernels and device-resident data regions
+        ast: The already parsed unit (agents.c_frontend.parse_unit); source_code is
+            parsed with the regex preprocessor when omitted
+        profile: Runtime shares of the loops (agents.c_profiler.profile_original), in
+            source_code's line numbers; cold loops are listed without their analysis
         
     Returns:
         A string report describing found loops and parallelization opportunities
     """
-    # Preprocess to remove comments and #include directives
-    preprocessed_code = preprocess_c_code(source_code)
-    
-    parser = c_parser.CParser()
-    
-    try:
-        ast = parser.parse(preprocessed_code, filename='<input>')
-    except Exception as e:
-        return f"C Parsing Error: {e}\n\nNote: pycparser requires preprocessed C code. " \
-               f"Please ensure #include directives are resolved or removed for analysis."
+    if ast is None:
+        # Preprocess to remove comments and #include directives
+        preprocessed_code = preprocess_c_code(source_code)
+        
+        parser = c_parser.CParser()
+        
+        try:
+            ast = parser.parse(preprocessed_code, filename='<input>')
+        except Exception as e:
+            return f"C Parsing Error: {e}\n\nNote: pycparser requires preprocessed C code. " \
+                   f"Please ensure #include directives are resolved or removed for analysis."
     
-    visitor = CLoopVisitor()
+    functions = {ext.decl.name: ext for ext in ast.ext if isinstance(ext, c_ast.FuncDef)}
+    visitor = CLoopVisitor(functions)
     visitor.visit(ast)
     
     section_visitor = SectionVisitor()
     section_visitor.visit(ast)
     
-    if not visitor.loops and not section_visitor.sections:
+    call_graph = _CallGraphVisitor()
+    call_graph.visit(ast)
+    heap_findings = _heap_hot_spots(call_graph)
+    recursive = _recursive_functions(call_graph)
+    rng_findings = _rng_seeding(call_graph)
+    alias_verdicts = AliasAnalysis(ast).kernels()
+    overheads = overheads or DEFAULT_OVERHEADS
+    loop_costs = estimate_loops(ast, overheads)
+    intensities = estimate_intensity(ast)
+    first_touch = {ft.line: ft for ft in first_touch_loops(ast)}
+    array_updates = array_reductions(ast, overheads.threads)
+    pipelines = streaming_pipelines(ast)
+    pipeline_lines = {p.line: i for i, p in enumerate(pipelines, 1)}
+    plan = offload_plan(ast, overheads) if offload else None
+    offload_notes = {}
+    for kernel in (plan.kernels.values() if plan else []):
+        offload_notes[kernel.loops[0]] = "Offload: " + describe_kernel(kernel, plan)
+        for line in kernel.loops[1:]:
+            offload_notes[line] = f"Offload: part of the {kernel.function} kernel, same target teams pragma"
+    for region in (plan.regions if plan else []):
+        offload_notes[region.line] = "Device Residency: " + describe_region(region)
+    
+    if not visitor.loops and not section_visitor.sections and not recursive and not pipelines:
         return "No parallelizable loops or sections found."
     
     report = "=== C AST Static Analysis Report ===\n\n"
     
     if visitor.loops:
+        report += format_overheads(overheads) + "\n"
+        if machine is not None:
+            report += format_machine(machine) + "\n"
+        if profile is not None:
+            report += format_profile(profile) + "\n"
         report += f"Found {len(visitor.loops)} for-loop(s):\n\n"
     
     for i, loop in enumerate(visitor.loops, 1):
@@ -225,6 +734,17 @@ def analyze_c_code_ast(source_code: str) -> str:
         report += f"  Condition: {loop['condition'] or 'unknown'}\n"
         report += f"  Increment: {loop['increment'] or 'unknown'}\n"
         report += f"  Nested: {'Yes (depth ' + str(loop['depth']) + ')' if loop['is_nested'] else 'No'}\n"
+        if loop['harness']:
+            report += "  Harness: bench.h repetition loop (calls bench_now/bench_record); it times the " \
+                      "repetitions and must stay serial: no pragma\n\n"
+            continue
+        share = profile.at(loop['start_line']) if profile is not None else None
+        if share is not None:
+            report += f"  Runtime Share: {describe_share(share)}\n"
+            # First-touch loops are cheap by nature; their value is where they place the pages
+            if share.share < COLD_SHARE and loop['start_line'] not in first_touch:
+                report += "\n"
+                continue
         
         # Parallelization hints
         report += "\n  Parallelization Analysis:\n"
@@ -234,6 +754,9 @@ def analyze_c_code_ast(source_code: str) -> str:
             for var, op in loop['potential_reductions']:
                 report += f"      - {var} (operator: {op})\n"
         
+        for reduction in array_updates.get(loop['start_line'], []):
+            report += f"    Array Reduction: {reduction.describe()}; candidate type 'array_reduction'\n"
+        
         if loop.get('potential_private_vars'):
             report += f"    Potential Private Variables: {', '.join(loop['potential_private_vars'])}\n"
         
@@ -247,17 +770,65 @@ def analyze_c_code_ast(source_code: str) -> str:
         if loop.get('has_function_calls'):
             report += "    WARNING: Contains function calls (check for side effects)\n"
         
-        if loop.get('has_array_access'):
+        if loop.get('dependence') and loop['dependence'].levels:
+            report += format_dependence_report(loop['dependence'])
+        elif loop.get('has_array_access'):
             report += "    NOTE: Contains array accesses (verify no data races)\n"
         
+        if loop.get('rng_calls'):
+            report += f"    BLOCKER: calls {', '.join(c + '()' for c in loop['rng_calls'])} (sequential RNG state; " \
+                      "threads serialize or race on it). Rewrite onto per-block maap_rng.h streams with a reduction\n"
+        
+        if loop.get('strided_accesses'):
+            report += "    Strided Access (innermost loop, non-unit stride in " \
+                      f"{loop['init_var']}; consider loop interchange or tiling):\n"
+            for access, stride in loop['strided_accesses']:
+                report += f"      - {access} ({stride})\n"
+        
+        stencil = loop.get('stencil')
+        if stencil:
+            report += f"    Stencil: {stencil['output']} computed from a {stencil['points']}-point " \
+                      f"neighbourhood of {stencil['input']}; candidate type 'stencil' " \
+                      "(tile with halo cells, fuse time steps per tile)\n"
+        
+        cost = loop.get('iteration_cost')
+        if cost and cost[0] != "uniform":
+            report += f"    Iteration Cost: varies ({cost[0]}: {cost[1]}); use schedule(dynamic, CHUNK) or " \
+                      "schedule(guided), or schedule(runtime) to let the validator time OMP_SCHEDULE candidates\n"
+        
+        work = loop_costs.get(loop['start_line']) if loop['depth'] == 0 else None
+        if work is not None:
+            report += f"    Estimated Work: {describe_cost(work, overheads)}\n"
+        intensity = intensities.get(loop['start_line']) if loop['depth'] == 0 else None
+        if intensity is not None and intensity.flops:
+            report += f"    Arithmetic Intensity: {describe_intensity(intensity, machine)}\n"
+        
+        touch = first_touch.get(loop['start_line'])
+        if touch is not None:
+            report += f"    First Touch: {touch.describe()}; candidate type 'first_touch'\n"
+        
+        if loop['start_line'] in offload_notes:
+            report += f"    {offload_notes[loop['start_line']]}\n"
+        
+        # Pipelines get their task structure below instead of a parallel for
+        if loop['start_line'] in pipeline_lines:
+            report += f"    Pipeline: read -> process -> write per iteration (Pipeline " \
+                      f"{pipeline_lines[loop['start_line']]} below); candidate type 'pipeline'\n\n"
+            continue
+        
         # OpenMP suggestion
         report += "\n  Suggested OpenMP pragma:\n"
         pragma = "    #pragma omp parallel for"
+        if cost and cost[0] != "uniform":
+            pragma += " schedule(runtime)"
         
         if loop.get('potential_reductions'):
             reductions = [f"reduction({op.replace('=', '')}:{var})" 
                          for var, op in loop['potential_reductions']]
             pragma += " " + " ".join(reductions)
+        sections = [r.clause() for r in array_updates.get(loop['start_line'], []) if r.clause()]
+        if sections:
+            pragma += " " + " ".join(sections)
         
         if loop.get('potential_private_vars'):
             pragma += f" private({', '.join(loop['potential_private_vars'])})"
@@ -277,6 +848,37 @@ def analyze_c_code_ast(source_code: str) -> str:
              report += "        ...\n"
              report += "    }\n\n"
     
+    if recursive:
+        report += f"Found {len(recursive)} recursive function(s):\n\n"
+        for name, line, calls in recursive:
+            report += f"--- Recursive Function {name} ---\n"
+            report += f"  Line: {line}\n"
+            report += f"  Self-calls: {calls}\n"
+            if calls >= 2:
+                report += "  Divide and conquer: the independent recursive calls can run as tasks\n"
+                report += "  Suggested OpenMP pragmas (with a size cutoff below which the calls stay serial):\n"
+                report += "    #pragma omp task if(size > CUTOFF)   /* all but the last recursive call */\n"
+                report += "    #pragma omp taskwait                 /* before combining the results */\n"
+                report += "    top-level call inside #pragma omp parallel + #pragma omp single\n"
+            report += "\n"
+    
+    report += format_pipelines(pipelines)
+    
+    if rng_findings:
+        report += "RNG State:\n"
+        for finding in rng_findings:
+            report += f"  - {finding}\n"
+        report += "\n"
+    
+    if heap_findings:
+        report += "Heap Allocation Hot Spots (allocator calls repeated on a hot path contend " \
+                  "once the caller runs in parallel):\n"
+        for finding in heap_findings:
+            report += f"  - {finding}\n"
+        report += "\n"
+    
+    report += format_alias_report(alias_verdicts)
+    
     return report
 
 class VariableUsageVisitor(c_ast.NodeVisitor):
@@ -331,6 +933,15 @@ class SectionVisitor(c_ast.NodeVisitor):
     def __init__(self):
         self.sections = [] # List of {start_line, end_line, statements}
         
+    def visit_For(self, node):
+        # The statements of the harness loop's body set up and time a repetition; only
+        # blocks nested in them can hold sections
+        if is_harness_loop(node) and isinstance(node.stmt, c_ast.Compound):
+            for stmt in node.stmt.block_items or []:
+                self.visit(stmt)
+            return
+        self.generic_visit(node)
+        
     def visit_Compound(self, node):
         # A Compound block (like { ... }) contains a list of statements
         if not node.block_items:
@@ -347,7 +958,9 @@ class SectionVisitor(c_ast.NodeVisitor):
                 'read': usage.read,
                 'written': usage.written,
                 'calls': usage.func_calls,
-                'line': stmt.coord.line if stmt.coord else -1
+                'line': stmt.coord.line if stmt.coord else -1,
+                # The harness loop and bench.h calls time the program; no section may hold them
+                'harness': any(c.startswith("bench_") for c in usage.func_calls),
             }
             current_batch.append(stmt_info)
             
@@ -357,6 +970,9 @@ class SectionVisitor(c_ast.NodeVisitor):
         
         i = 0
         while i < len(current_batch) - 1:
+            if current_batch[i]['harness']:
+                i += 1
+                continue
             # Try to find a group starting at i
             group = [current_batch[i]]
             combined_read = set(current_batch[i]['read'])
@@ -365,6 +981,8 @@ class SectionVisitor(c_ast.NodeVisitor):
             j = i + 1
             while j < len(current_batch):
                 next_stmt = current_batch[j]
+                if next_stmt['harness']:
+                    break
                 
                 # Check dependency with ALL statements currently in the group
                 # Actually, for Sections, we want:
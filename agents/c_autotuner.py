@@ -0,0 +1,295 @@
+"""
+Autotuner for validated OpenMP code.
+Searches a small space around the version that passed validation: compiler
+flags, tile-size macros introduced by tiling transformations, collapse depth,
+schedule kind/chunk and thread count. Every configuration is built, timed
+with the repeat-based harness and compared with the original program's
+output; the fastest correct one is kept, with its settings written into the
+source where they can be (schedule, collapse, tile defaults) and recorded
+otherwise (flags, threads).
+
+The space is searched one dimension at a time (coordinate descent) starting
+from the validated configuration, within a trial budget. Flags and macros
+need a rebuild; schedule and thread count only change the environment.
+"""
+
+import re
+import subprocess
+from dataclasses import dataclass, field, replace
+from typing import Dict, List, Optional
+
+from pycparser import c_ast, c_parser
+
+from agents.c_dependence import analyze_nest, collapse_depth
+from agents.c_frontend import parse_unit
+from agents.c_scaling import default_thread_counts
+from agents.c_schedule import schedule_clause
+from agents.c_validation_engine import (CValidationConfig, compare_outputs, compile_c, compile_command, exe_name,
+                                        measure, run_binary, run_environment, with_output_order,
+                                        with_rng_tolerance)
+
+TUNE_SCHEDULES = ["static", "static,16", "dynamic,16", "dynamic,64", "guided"]
+# -ffast-math reassociates floating-point reductions; only tried when outputs may differ by this much
+FAST_MATH_MIN_REL_TOL = 1e-6
+
+_LOOP_PRAGMA = re.compile(r"^(\s*#\s*pragma\s+omp\b[^\n]*?\bfor\b)([^\n]*)$", re.MULTILINE)
+_SCHEDULE = re.compile(r"\s*schedule\s*\([^)]*\)")
+_COLLAPSE = re.compile(r"\s*collapse\s*\(\s*\d+\s*\)")
+
+
+@dataclass
+class TuningConfig:
+    flags: List[str]
+    threads: int
+    schedule: Optional[str] = None        # OMP_SCHEDULE value; None keeps the clauses in the source
+    collapse: Optional[int] = None        # None keeps the clauses in the source
+    defines: Dict[str, int] = field(default_factory=dict)
+
+    def build_key(self):
+        return tuple(self.flags), self.schedule is not None, self.collapse, tuple(sorted(self.defines.items()))
+
+    def label(self) -> str:
+        parts = [" ".join(self.flags), f"threads={self.threads}"]
+        if self.schedule:
+            parts.append(f"schedule={self.schedule}")
+        if self.collapse:
+            parts.append(f"collapse={self.collapse}")
+        parts += [f"{k}={v}" for k, v in sorted(self.defines.items())]
+        return ", ".join(parts)
+
+
+@dataclass
+class TuningTrial:
+    config: TuningConfig
+    time: Optional[float]
+    error: Optional[str] = None
+    samples: List[float] = field(default_factory=list)
+
+
+@dataclass
+class TuningResult:
+    baseline: TuningTrial
+    best: TuningTrial
+    trials: List[TuningTrial]
+    source: str                           # tuned source with schedule/collapse/tile defaults applied
+    compile_command: List[str]
+    env: Dict[str, str]
+
+
+def loop_pragma_depths(code: str, config: Optional[CValidationConfig] = None) -> Dict[int, int]:
+    """
+    Line of each `#pragma omp ... for` -> how many loops under it may be collapsed,
+    from the dependence analysis of the nest that follows the pragma.
+    """
+    try:
+        ast = parse_unit(code, config).ast
+    except c_parser.ParseError:
+        return {}
+    loops = {}
+
+    class _Loops(c_ast.NodeVisitor):
+        def visit_For(self, node):
+            if node.coord:
+                loops[node.coord.line] = node
+            self.generic_visit(node)
+
+    _Loops().visit(ast)
+    lines = code.splitlines()
+    depths = {}
+    for match in _LOOP_PRAGMA.finditer(code):
+        line = code.count("\n", 0, match.start()) + 1
+        following = next((l for l in range(line + 1, min(line + 4, len(lines) + 1)) if l in loops), None)
+        if following is not None:
+            depths[line] = max(collapse_depth(analyze_nest(loops[following])), 1)
+    return depths
+
+
+def apply_loop_clauses(code: str, schedule: Optional[str] = None, collapse: Optional[int] = None,
+                       depths: Optional[Dict[int, int]] = None) -> str:
+    """
+    Rewrites every `omp ... for` pragma: schedule -> the given clause ("runtime" or
+    an OMP_SCHEDULE value), collapse -> min(collapse, depth the nest allows).
+    """
+    depths = depths if depths is not None else loop_pragma_depths(code)
+
+    def rewrite(match):
+        head, tail = match.group(1), match.group(2)
+        line = code.count("\n", 0, match.start()) + 1
+        if schedule is not None:
+            tail = _SCHEDULE.sub("", tail)
+            tail += " schedule(runtime)" if schedule == "runtime" else " " + schedule_clause(schedule)
+        if collapse is not None:
+            tail = _COLLAPSE.sub("", tail)
+            depth = min(collapse, depths.get(line, 1))
+            if depth > 1:
+                tail += f" collapse({depth})"
+        return head + tail
+
+    return _LOOP_PRAGMA.sub(rewrite, code)
+
+
+def apply_defines(code: str, defines: Dict[str, int]) -> str:
+    """Rewrites the #ifndef-guarded default of each tunable macro, defining it
+    at the top of the file when the source never does."""
+    for name, value in defines.items():
+        code, count = re.subn(rf"^(\s*#\s*define\s+{re.escape(name)}\s+)\S+", rf"\g<1>{value}", code,
+                              flags=re.MULTILINE)
+        if not count:
+            code = f"#define {name} {value}\n{code}"
+    return code
+
+
+def _macro_defaults(code: str, tunables: Dict[str, int]) -> Dict[str, int]:
+    found = {}
+    for name, default in tunables.items():
+        match = re.search(rf"^\s*#\s*define\s+{re.escape(name)}\s+(\d+)", code, flags=re.MULTILINE)
+        found[name] = int(match.group(1)) if match else int(default)
+    return found
+
+
+def flag_candidates(config: CValidationConfig, code: str) -> List[List[str]]:
+    candidates = [list(config.opt_flags), ["-O3"], ["-O3", "-march=native"]]
+    uses_float = re.search(r"\b(double|float)\b", code) is not None
+    if uses_float and config.rel_tol >= FAST_MATH_MIN_REL_TOL:
+        candidates.append(["-O3", "-march=native", "-ffast-math"])
+    unique = []
+    for flags in candidates:
+        if flags not in unique:
+            unique.append(flags)
+    return unique
+
+
+def _tile_values(default: int) -> List[int]:
+    values = {max(8, default // 4), max(8, default // 2), default, default * 2, default * 4}
+    return sorted(values)
+
+
+class Autotuner:
+    def __init__(self, work_dir: str, config: CValidationConfig, code: str,
+                 tunables: Optional[Dict[str, int]] = None, budget: int = 32,
+                 original_exe: str = exe_name("original"), source: str = "tuned.c"):
+        self.work_dir = work_dir
+        self.config = with_rng_tolerance(with_output_order(config, code), code)
+        self.code = code
+        self.tunables = _macro_defaults(code, tunables or {})
+        self.budget = budget
+        self.source = source
+        self.trials: List[TuningTrial] = []
+        self.builds: Dict[tuple, Optional[str]] = {}
+        self.depths = loop_pragma_depths(code, self.config)
+        proc, _ = run_binary(work_dir, original_exe, run_environment(config), config.run_timeout, cpus=config.cpus)
+        self.expected = proc.stdout
+
+    def _build(self, tc: TuningConfig):
+        """Returns (exe, error), reusing earlier builds of the same source and flags."""
+        key = tc.build_key()
+        if key in self.builds:
+            return self.builds[key]
+        index = len(self.builds)
+        source = f"tune_{index}.c"
+        code = apply_loop_clauses(self.code, "runtime" if tc.schedule else None, tc.collapse, self.depths)
+        with open(f"{self.work_dir}/{source}", "w", encoding="utf-8") as f:
+            f.write(code)
+        exe = exe_name(f"tune_{index}")
+        ok, log = compile_c(self._compile_config(tc), self.work_dir, source, exe, openmp=True)
+        self.builds[key] = (exe, None) if ok else (None, log)
+        return self.builds[key]
+
+    def _compile_config(self, tc: TuningConfig) -> CValidationConfig:
+        defines = [f"-D{k}={v}" for k, v in sorted(tc.defines.items())]
+        return replace(self.config, opt_flags=list(tc.flags), extra_cflags=[*self.config.extra_cflags, *defines])
+
+    def _env(self, tc: TuningConfig) -> Dict[str, str]:
+        env = run_environment(self.config, tc.threads)
+        if tc.schedule:
+            env["OMP_SCHEDULE"] = tc.schedule
+        return env
+
+    def evaluate(self, tc: TuningConfig) -> TuningTrial:
+        for trial in self.trials:
+            if trial.config == tc:
+                return trial
+        exe, error = self._build(tc)
+        if exe is None:
+            trial = TuningTrial(tc, None, f"compile failed: {error.splitlines()[-1] if error else ''}")
+        else:
+            try:
+                run = measure(self.config, self.work_dir, exe, self._env(tc))
+                mismatch = compare_outputs(self.expected, run.stdout, self.config)
+                trial = TuningTrial(tc, None, f"output differs ({mismatch})") if mismatch else \
+                    TuningTrial(tc, run.time, samples=run.samples)
+            except (RuntimeError, subprocess.TimeoutExpired) as e:
+                trial = TuningTrial(tc, None, str(e).splitlines()[0])
+        self.trials.append(trial)
+        return trial
+
+    def _descend(self, best: TuningTrial, variants: List[TuningConfig]) -> TuningTrial:
+        for tc in variants:
+            if len(self.trials) >= self.budget:
+                break
+            trial = self.evaluate(tc)
+            if trial.time is not None and (best.time is None or trial.time < best.time):
+                best = trial
+        return best
+
+    def run(self) -> TuningResult:
+        base = TuningConfig(list(self.config.opt_flags), self.config.threads())
+        baseline = self.evaluate(base)
+        best = baseline
+
+        best = self._descend(best, [replace(best.config, flags=f) for f in flag_candidates(self.config, self.code)])
+        for name, default in self.tunables.items():
+            best = self._descend(best, [replace(best.config, defines={**best.config.defines, name: v})
+                                        for v in _tile_values(default)])
+        max_depth = max(self.depths.values(), default=1)
+        if max_depth > 1:
+            best = self._descend(best, [replace(best.config, collapse=n) for n in range(1, max_depth + 1)])
+        if self.depths:
+            schedules = self.config.schedules or TUNE_SCHEDULES
+            best = self._descend(best, [replace(best.config, schedule=s) for s in schedules])
+        best = self._descend(best, [replace(best.config, threads=t) for t in default_thread_counts(self.config.threads(), self.config.cpus)])
+
+        tc = best.config
+        code = apply_loop_clauses(self.code, tc.schedule, tc.collapse, self.depths)
+        code = apply_defines(code, tc.defines)
+        with open(f"{self.work_dir}/{self.source}", "w", encoding="utf-8") as f:
+            f.write(code)
+        command = compile_command(replace(self.config, opt_flags=list(tc.flags)), self.source,
+                                  exe_name("tuned"), openmp=True)
+        env = {"OMP_NUM_THREADS": str(tc.threads), "OMP_PROC_BIND": self.config.proc_bind,
+               "OMP_PLACES": self.config.places}
+        return TuningResult(baseline, best, self.trials, code, command, env)
+
+
+def tuning_summary(result: TuningResult, original_time: Optional[float]) -> dict:
+    """JSON-serializable record of the search, saved as tuning.json next to the tuned source."""
+    best, baseline = result.best, result.baseline
+    return {
+        "config": vars(best.config),
+        "time": best.time,
+        "baseline_time": baseline.time,
+        "gain_over_validated": baseline.time / best.time if best.time and baseline.time else None,
+        "speedup": original_time / best.time if best.time and original_time else None,
+        "compile_command": " ".join(result.compile_command),
+        "env": result.env,
+        "trials": [{"config": t.config.label(), "time": t.time, "error": t.error} for t in result.trials],
+    }
+
+
+def format_tuning_report(result: TuningResult, original_time: Optional[float]) -> str:
+    lines = ["=== Autotuning ===", f"{'Time (s)':>10}  Configuration"]
+    for t in result.trials:
+        mark = "  <- best" if t is result.best else ""
+        if t.time is None:
+            lines.append(f"{'failed':>10}  {t.config.label()}  ({t.error})")
+        else:
+            lines.append(f"{t.time:>10.4f}  {t.config.label()}{mark}")
+    best, baseline = result.best, result.baseline
+    if best.time and baseline.time:
+        lines.append(f"Validated configuration: {baseline.time:.4f}s; tuned: {best.time:.4f}s "
+                     f"({baseline.time / best.time:.2f}x)")
+    if best.time and original_time:
+        lines.append(f"Tuned speedup over the original: {original_time / best.time:.2f}x")
+    lines.append(f"Build: {' '.join(result.compile_command)}")
+    lines.append(f"Run with: {' '.join(f'{k}={v}' for k, v in result.env.items())}")
+    return "\n".join(lines) + "\n"
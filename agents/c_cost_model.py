@@ -0,0 +1,411 @@
+"""
+Static cost model for C loop candidates.
+Estimates the work of each top-level loop (trip count x per-iteration cost)
+from the AST and compares it with the fork/join overhead measured on this
+machine by benchmarks/c/tools/omp_overhead.c. Loops whose work cannot pay for
+a parallel region are marked "too little work" before any validation run is
+spent on them; when the trip count is a runtime parameter, an
+`if(n > threshold)` clause is suggested instead.
+
+Trip counts come from loop bounds resolved through local initializers,
+bench_param_long() defaults and call-site arguments. Per-iteration cost counts
+arithmetic, array accesses and libm calls, and follows calls into functions of
+the same file. Anything unresolved leaves the estimate unknown, and unknown
+loops are never overridden.
+"""
+
+import json
+import math
+import os
+import platform
+import subprocess
+from dataclasses import asdict, dataclass
+from typing import Dict, List, Optional, Tuple
+
+from pycparser import c_ast, c_generator
+
+from agents.bench_utils import BENCH_INCLUDE_DIR
+from agents.c_ast_helpers import CHEAP_MATH, HARNESS_CALLS, LIBM, TYPE_SIZES, top_level_loops
+from agents.cache import CACHE_DIR
+from agents.c_validation_engine import CValidationConfig, pinned, run_environment
+
+TOOLS_DIR = os.path.join(os.path.dirname(BENCH_INCLUDE_DIR), "tools")
+
+# Work must exceed the break-even point by this factor before a region is worth forking
+SAFETY = 4.0
+
+
+_UNKNOWN_CALL_OPS = 20
+
+
+@dataclass
+class Overheads:
+    threads: int
+    fork_join_ns: float
+    parallel_for_ns: float
+    task_ns: float
+    ns_per_op: float
+    ns_per_libm: float
+    source: str = "measured"
+
+
+DEFAULT_OVERHEADS = Overheads(threads=os.cpu_count() or 1, fork_join_ns=2000.0, parallel_for_ns=2500.0,
+                              task_ns=200.0, ns_per_op=1.0, ns_per_libm=15.0, source="default")
+
+
+def run_calibration(tool: str, flags: List[str], config: CValidationConfig, cache_dir: str = CACHE_DIR) -> Optional[dict]:
+    """
+    Builds and runs benchmarks/c/tools/<tool>.c once per host, compiler and thread
+    count and returns the JSON line it prints; the result is cached in
+    cache_dir/<tool>.json. None when the tool cannot be built or run.
+    """
+    threads = config.threads()
+    key = f"{platform.node()}|{config.compiler}|{threads}"
+    cache_path = os.path.join(cache_dir, f"{tool}.json")
+    cache = {}
+    if os.path.exists(cache_path):
+        try:
+            with open(cache_path, encoding="utf-8") as f:
+                cache = json.load(f)
+        except (OSError, json.JSONDecodeError):
+            cache = {}
+    if key in cache:
+        return cache[key]
+
+    os.makedirs(cache_dir, exist_ok=True)
+    exe = os.path.join(os.path.abspath(cache_dir), tool)
+    source = os.path.join(TOOLS_DIR, f"{tool}.c")
+    try:
+        subprocess.run([config.compiler, *flags, "-fopenmp", source, "-o", exe, "-lm"],
+                       check=True, capture_output=True, timeout=config.compile_timeout)
+        proc = subprocess.run(pinned([exe], config.cpus), env=run_environment(config), capture_output=True, text=True,
+                              timeout=config.run_timeout, check=True)
+        measured = json.loads(proc.stdout.strip().splitlines()[-1])
+    except (OSError, subprocess.SubprocessError, ValueError, IndexError):
+        return None
+    cache[key] = measured
+    with open(cache_path, "w", encoding="utf-8") as f:
+        json.dump(cache, f, indent=2)
+    return measured
+
+
+def calibrate(config: Optional[CValidationConfig] = None, cache_dir: str = CACHE_DIR) -> Overheads:
+    """
+    Measured overheads for this host, compiler and thread count (tools/omp_overhead.c).
+    Falls back to DEFAULT_OVERHEADS when it cannot be built or run.
+    """
+    config = config or CValidationConfig()
+    measured = run_calibration("omp_overhead", ["-O2"], config, cache_dir)
+    try:
+        return Overheads(**measured)
+    except TypeError:
+        return Overheads(**{**asdict(DEFAULT_OVERHEADS), "threads": config.threads()})
+
+
+@dataclass
+class LoopCost:
+    line: int
+    function: str
+    var: Optional[str]
+    trips: Optional[float]
+    ops_per_iter: Optional[float]
+    libm_per_iter: float = 0.0
+    bytes_per_iter: float = 0.0
+    bound: Optional[str] = None           # source text of a runtime-sized bound, e.g. "n"
+    work_ns: Optional[float] = None
+    break_even_ns: Optional[float] = None
+    profitable: Optional[bool] = None     # None: unknown or single thread
+    threshold: Optional[int] = None       # trips needed to break even (with SAFETY)
+
+
+class Unresolved(Exception):
+    pass
+
+
+class CostEstimator:
+    """Resolves loop bounds and body costs over one translation unit."""
+
+    def __init__(self, ast: c_ast.FileAST):
+        self.generator = c_generator.CGenerator()
+        self.functions: Dict[str, c_ast.FuncDef] = {}
+        self.calls: Dict[str, List[Tuple[str, List[c_ast.Node]]]] = {}
+        self.inits: Dict[str, Dict[str, List[c_ast.Node]]] = {}
+        for ext in ast.ext:
+            if isinstance(ext, c_ast.FuncDef):
+                self.functions[ext.decl.name] = ext
+        for name, fn in self.functions.items():
+            self.inits[name] = {}
+            self._collect(name, fn.body)
+
+    def _collect(self, function: str, node):
+        if isinstance(node, c_ast.Decl) and node.init is not None and node.name:
+            self.inits[function].setdefault(node.name, []).append(node.init)
+        elif isinstance(node, c_ast.Assignment) and isinstance(node.lvalue, c_ast.ID):
+            # Any later assignment makes the value flow-dependent; record it so the name is not resolved
+            self.inits[function].setdefault(node.lvalue.name, []).append(None)
+        elif isinstance(node, c_ast.UnaryOp) and node.op in ('++', '--', 'p++', 'p--') \
+                and isinstance(node.expr, c_ast.ID):
+            self.inits[function].setdefault(node.expr.name, []).append(None)
+        elif isinstance(node, c_ast.FuncCall) and isinstance(node.name, c_ast.ID) and node.name.name in self.functions:
+            self.calls.setdefault(node.name.name, []).append((function, node.args.exprs if node.args else []))
+        for _, child in node.children():
+            self._collect(function, child)
+
+    def params(self, function: str) -> List[str]:
+        args = self.functions[function].decl.type.args
+        return [p.name for p in (args.params if args else []) if isinstance(p, c_ast.Decl)]
+
+    # ---- values --------------------------------------------------------
+
+    def value(self, expr, function: str, env: Dict[str, float], depth: int = 0) -> Tuple[float, Optional[str]]:
+        """(numeric value, runtime parameter it depends on or None); raises Unresolved."""
+        if depth > 12:
+            raise Unresolved()
+        if isinstance(expr, c_ast.Constant):
+            if expr.type in ("int", "long", "unsigned int", "unsigned long"):
+                return float(int(expr.value.rstrip("uUlL"), 0)), None
+            if expr.type in ("double", "float"):
+                return float(expr.value.rstrip("fFlL")), None
+            raise Unresolved()
+        if isinstance(expr, c_ast.ID):
+            if expr.name in env:
+                return env[expr.name], None
+            inits = self.inits[function].get(expr.name, [])
+            if len(inits) == 1 and inits[0] is not None:
+                value, runtime = self.value(inits[0], function, env, depth + 1)
+                return value, runtime and expr.name
+            if not inits and expr.name in self.params(function):
+                return self._param_value(function, expr.name, depth)
+            raise Unresolved()
+        if isinstance(expr, c_ast.Cast):
+            return self.value(expr.expr, function, env, depth + 1)
+        if isinstance(expr, c_ast.UnaryOp):
+            if expr.op == 'sizeof':
+                node = expr.expr
+                names = getattr(getattr(getattr(node, 'type', None), 'type', None), 'names', None) or []
+                return float(TYPE_SIZES.get(names[-1], 8) if names else 8), None
+            value, runtime = self.value(expr.expr, function, env, depth + 1)
+            if expr.op == '-':
+                return -value, runtime
+            if expr.op == '+':
+                return value, runtime
+            raise Unresolved()
+        if isinstance(expr, c_ast.BinaryOp):
+            left, lr = self.value(expr.left, function, env, depth + 1)
+            right, rr = self.value(expr.right, function, env, depth + 1)
+            ops = {'+': lambda: left + right, '-': lambda: left - right, '*': lambda: left * right,
+                   '/': lambda: left / right if right else math.inf, '%': lambda: left % right if right else 0,
+                   '<': lambda: float(left < right), '>': lambda: float(left > right),
+                   '<=': lambda: float(left <= right), '>=': lambda: float(left >= right),
+                   '==': lambda: float(left == right), '!=': lambda: float(left != right)}
+            if expr.op not in ops:
+                raise Unresolved()
+            return ops[expr.op](), lr or rr
+        if isinstance(expr, c_ast.TernaryOp):
+            cond, runtime = self.value(expr.cond, function, env, depth + 1)
+            value, vr = self.value(expr.iftrue if cond else expr.iffalse, function, env, depth + 1)
+            return value, runtime or vr
+        if isinstance(expr, c_ast.FuncCall) and isinstance(expr.name, c_ast.ID):
+            args = expr.args.exprs if expr.args else []
+            if expr.name.name == "bench_param_long" and len(args) == 2:
+                value, _ = self.value(args[1], function, env, depth + 1)
+                return value, (args[0].value.strip('"') if isinstance(args[0], c_ast.Constant) else "param")
+            if expr.name.name == "bench_class_bytes":
+                return 0.0, "size-class"
+            if expr.name.name == "sqrt" and args:
+                value, runtime = self.value(args[0], function, env, depth + 1)
+                return math.sqrt(max(value, 0.0)), runtime
+        raise Unresolved()
+
+    def _param_value(self, function: str, name: str, depth: int) -> Tuple[float, Optional[str]]:
+        """Largest value passed for a parameter over all call sites."""
+        index = self.params(function).index(name)
+        sites = self.calls.get(function, [])
+        if not sites:
+            raise Unresolved()
+        values, runtime = [], None
+        for caller, args in sites:
+            if caller == function or index >= len(args):
+                continue   # recursive calls pass smaller problems
+            value, r = self.value(args[index], caller, {}, depth + 1)
+            values.append(value)
+            runtime = runtime or (r and name)
+        if not values:
+            raise Unresolved()
+        return max(values), runtime
+
+    # ---- costs ---------------------------------------------------------
+
+    def trips(self, loop: c_ast.For, function: str, env: Dict[str, float]) -> Tuple[float, Optional[str], str]:
+        """(trip count, runtime parameter or None, loop variable)."""
+        init = loop.init
+        if isinstance(init, c_ast.DeclList) and init.decls:
+            var, start = init.decls[0].name, init.decls[0].init
+        elif isinstance(init, c_ast.Assignment) and isinstance(init.lvalue, c_ast.ID):
+            var, start = init.lvalue.name, init.rvalue
+        else:
+            raise Unresolved()
+        cond, step = loop.cond, loop.next
+        if not (isinstance(cond, c_ast.BinaryOp) and isinstance(cond.left, c_ast.ID) and cond.left.name == var):
+            raise Unresolved()
+        lo, lr = self.value(start, function, env)
+        hi, hr = self.value(cond.right, function, env)
+        if isinstance(step, c_ast.UnaryOp) and step.op in ('p++', '++', 'p--', '--'):
+            stride = 1.0 if '+' in step.op else -1.0
+        elif isinstance(step, c_ast.Assignment) and step.op in ('+=', '-='):
+            stride, _ = self.value(step.rvalue, function, env)
+            stride = stride if step.op == '+=' else -stride
+        else:
+            raise Unresolved()
+        if stride == 0:
+            raise Unresolved()
+        span = {'<': hi - lo, '<=': hi - lo + 1, '>': lo - hi, '>=': lo - hi + 1, '!=': abs(hi - lo)}.get(cond.op)
+        if span is None:
+            raise Unresolved()
+        runtime = hr or lr
+        bound = self.generator.visit(cond.right) if runtime else None
+        return max(0.0, math.ceil(span / abs(stride))), bound, var
+
+    def cost(self, node, function: str, env: Dict[str, float], stack=()) -> Tuple[float, float, float]:
+        """(arithmetic ops, libm calls, bytes accessed) executed by `node`, once."""
+        if node is None:
+            return 0.0, 0.0, 0.0
+        if isinstance(node, c_ast.For):
+            trips, _, var = self.trips(node, function, env)
+            lo, _ = self.value(node.init.decls[0].init if isinstance(node.init, c_ast.DeclList)
+                               else node.init.rvalue, function, env)
+            # Inner bounds that depend on this iterator see its mean value (triangular nests)
+            inner = dict(env, **{var: lo + trips / 2})
+            ops, libm, data = self.cost(node.stmt, function, inner, stack)
+            return trips * (ops + 2), trips * libm, trips * data
+        if isinstance(node, (c_ast.While, c_ast.DoWhile)):
+            raise Unresolved()
+        if isinstance(node, c_ast.If):
+            cond = self.cost(node.cond, function, env, stack)
+            then = self.cost(node.iftrue, function, env, stack)
+            other = self.cost(node.iffalse, function, env, stack)
+            return tuple(c + max(t, o) for c, t, o in zip(cond, then, other))
+        if isinstance(node, c_ast.FuncCall):
+            name = node.name.name if isinstance(node.name, c_ast.ID) else None
+            ops, libm, data = self.cost(node.args, function, env, stack)
+            if name in LIBM:
+                return ops, libm + 1, data
+            if name in CHEAP_MATH:
+                return ops + 2, libm, data
+            if name in HARNESS_CALLS:
+                return ops, libm, data
+            if name in self.functions and name not in stack:
+                params = self.params(name)
+                args = node.args.exprs if node.args else []
+                callee_env = {}
+                for p, a in zip(params, args):
+                    try:
+                        callee_env[p], _ = self.value(a, function, env)
+                    except Unresolved:
+                        pass
+                body = self.cost(self.functions[name].body, name, callee_env, stack + (name,))
+                return ops + body[0] + 5, libm + body[1], data + body[2]
+            return ops + _UNKNOWN_CALL_OPS, libm, data
+        ops = libm = data = 0.0
+        if isinstance(node, c_ast.BinaryOp):
+            ops += 4 if node.op in ('/', '%') else 1
+        elif isinstance(node, c_ast.Assignment) and node.op != '=':
+            ops += 1
+        elif isinstance(node, c_ast.ArrayRef):
+            ops += 1
+            data += 8
+        for _, child in node.children():
+            o, l, d = self.cost(child, function, env, stack)
+            ops, libm, data = ops + o, libm + l, data + d
+        return ops, libm, data
+
+    def loop_cost(self, loop: c_ast.For, function: str, overheads: Overheads) -> LoopCost:
+        result = LoopCost(loop.coord.line if loop.coord else 0, function, None, None, None)
+        try:
+            trips, bound, var = self.trips(loop, function, {})
+            lo, _ = self.value(loop.init.decls[0].init if isinstance(loop.init, c_ast.DeclList)
+                               else loop.init.rvalue, function, {})
+            ops, libm, data = self.cost(loop.stmt, function, {var: lo + trips / 2}, (function,))
+        except (Unresolved, AttributeError, ValueError, OverflowError):
+            return result
+        result.var, result.trips, result.bound = var, trips, bound
+        result.ops_per_iter, result.libm_per_iter, result.bytes_per_iter = ops + 2, libm, data
+        per_iter_ns = result.ops_per_iter * overheads.ns_per_op + libm * overheads.ns_per_libm
+        result.work_ns = trips * per_iter_ns
+        threads = overheads.threads
+        if threads > 1:
+            # Parallel time = overhead + work / threads, equal to the sequential time at break-even
+            result.break_even_ns = overheads.parallel_for_ns * threads / (threads - 1)
+            result.profitable = result.work_ns >= SAFETY * result.break_even_ns
+            if per_iter_ns > 0:
+                result.threshold = int(math.ceil(SAFETY * result.break_even_ns / per_iter_ns))
+        return result
+
+
+def estimate_loops(ast: c_ast.FileAST, overheads: Overheads) -> Dict[int, LoopCost]:
+    """Cost of every outermost for-loop, keyed by its line."""
+    estimator = CostEstimator(ast)
+    return {cost.line: cost for cost in (estimator.loop_cost(loop, fn, overheads)
+                                         for loop, fn in top_level_loops(ast))}
+
+
+def _duration(ns: float) -> str:
+    if ns >= 1e6:
+        return f"{ns / 1e6:.2f} ms"
+    if ns >= 1e3:
+        return f"{ns / 1e3:.1f} us"
+    return f"{ns:.0f} ns"
+
+
+def describe_cost(cost: LoopCost, overheads: Overheads) -> str:
+    if cost.work_ns is None:
+        return "unknown (trip count or body cost not resolvable statically)"
+    libm = f" + {cost.libm_per_iter:g} libm" if cost.libm_per_iter else ""
+    text = (f"~{cost.trips:.3g} iterations x ~{cost.ops_per_iter:.0f} ops{libm} "
+            f"= ~{_duration(cost.work_ns)} per execution, ~{cost.trips * cost.bytes_per_iter / 1024:.0f} KiB streamed "
+            "(traffic without cache reuse, not the working set)")
+    if cost.profitable is None:
+        return text + f"; single thread ({overheads.threads}), break-even not evaluated"
+    verdict = "worth a parallel region" if cost.profitable else "BELOW BREAK-EVEN (too little work)"
+    text += f"; parallel for overhead {_duration(overheads.parallel_for_ns)} at {overheads.threads} threads -> {verdict}"
+    if not cost.profitable and cost.bound and cost.threshold:
+        text += f"; size is a runtime parameter, use if({cost.bound} > {cost.threshold})"
+    return text
+
+
+def apply_cost_model(candidates, costs: Dict[int, LoopCost], overheads: Overheads) -> List[str]:
+    """
+    Overrides loop candidates that cannot amortize a parallel region. Fixed-size
+    loops become parallelizable="no" with a "too little work" blocker; runtime-sized
+    loops keep their verdict and get an if() clause. Returns one note per change.
+    """
+    notes = []
+    for cand in candidates:
+        if cand.parallelizable == "no" or cand.recommendation in ("simd", "none"):
+            continue
+        if cand.type not in ("loop_map", "reduction", "tiling", "loop_interchange", "stencil", "array_reduction"):
+            continue
+        cost = next((c for line, c in sorted(costs.items()) if cand.start_line <= line <= cand.end_line), None)
+        if cost is None or cost.profitable is not False:
+            continue
+        reason = (f"too little work: ~{_duration(cost.work_ns)} per execution vs "
+                  f"{_duration(overheads.parallel_for_ns)} parallel for overhead at {overheads.threads} threads")
+        if cost.bound and cost.threshold:
+            cand.if_clause = f"{cost.bound} > {cost.threshold}"
+            notes.append(f"{cand.id}: default size below break-even, added if({cand.if_clause})")
+        else:
+            cand.parallelizable = "no"
+            cand.recommendation = "none"
+            cand.blockers = list(cand.blockers) + [reason]
+            notes.append(f"{cand.id}: {reason}")
+    return notes
+
+
+def format_overheads(overheads: Overheads) -> str:
+    origin = "measured by benchmarks/c/tools/omp_overhead.c" if overheads.source == "measured" \
+        else "defaults, not calibrated"
+    return (f"Cost Model ({origin}): {overheads.threads} threads, fork/join {_duration(overheads.fork_join_ns)}, "
+            f"parallel for {_duration(overheads.parallel_for_ns)}, task spawn {_duration(overheads.task_ns)}, "
+            f"{overheads.ns_per_op:.2f} ns/op, {overheads.ns_per_libm:.1f} ns per libm call\n"
+            f"  A task needs > {_duration(SAFETY * overheads.task_ns)} of work to pay for its spawn "
+            f"(use it as the recursion cutoff)\n")
@@ -0,0 +1,735 @@
+"""
+Array dependence analysis for C loop nests (pycparser AST).
+Extracts affine subscripts, tests every pair of accesses to the same array
+with the GCD and Banerjee tests under direction vectors, and reports for each
+loop level whether a dependence is carried there. Parallel for, collapse and
+simd decisions can then rest on the subscripts instead of on "contains array
+accesses".
+
+A subscript is an affine form over the nest iterators whose coefficients are
+integers or loop-invariant symbols. Linearized subscripts such as
+a[r*cols + c] are split into one equation per symbolic stride (delinearized)
+when the loop bounds prove that the inner index stays within one row
+(0 <= c < cols); otherwise the subscript is treated as non-affine. Symbolic
+offsets that multiply no iterator (a[n-i], a[i+m]) cannot be compared with a
+different offset; such pairs, and stores through pointer arithmetic
+(*(a+i) = ...), are assumed to conflict at every level. Distinct array names
+are assumed not to overlap.
+"""
+
+import math
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+from pycparser import c_ast, c_generator
+
+INF = float("inf")
+
+# Calls assumed to have no side effects on program memory
+PURE_FUNCTIONS = {
+    "sqrt", "sqrtf", "cbrt", "fabs", "fabsf", "abs", "labs", "sin", "cos", "tan", "sinf", "cosf", "tanf",
+    "asin", "acos", "atan", "atan2", "sinh", "cosh", "tanh", "exp", "expf", "exp2", "log", "logf", "log2",
+    "log10", "pow", "powf", "floor", "ceil", "round", "trunc", "fmod", "fmin", "fmax", "fminf", "fmaxf",
+    "hypot", "fma", "min", "max",
+}
+
+# Operators accepted by an OpenMP reduction clause
+REDUCTION_OPS = ('+', '-', '*', '&', '|', '^', '&&', '||')
+
+# Affine form: {(iterator or None, symbolic stride): integer coefficient}
+Term = Tuple[Optional[str], Tuple[str, ...]]
+Affine = Dict[Term, int]
+
+
+class NonAffine(Exception):
+    pass
+
+
+@dataclass
+class LoopLevel:
+    var: str
+    line: object
+    node: c_ast.For
+    lower: float = -INF
+    upper: float = INF
+    upper_symbolic: Optional[Tuple[str, int]] = None   # (n, k): the iterator stays <= n + k
+    depth: int = 0
+    rectangular: bool = True      # bounds do not depend on outer iterators
+    perfect_child: bool = False   # body is exactly one nested for-loop
+    has_child: bool = False       # contains another for-loop at any position
+
+
+@dataclass
+class Access:
+    array: str
+    subscripts: List[c_ast.Node]
+    is_write: bool
+    loops: List[LoopLevel]
+    text: str
+    line: object
+    forms: Optional[List[Affine]] = None   # None when a subscript is not affine
+    pointer: bool = False                  # store through a pointer expression: never affine
+
+
+@dataclass
+class Dependence:
+    source: Access
+    sink: Access
+    kind: str                       # flow | anti | output
+    level: Optional[int]            # carrying level index, None = loop-independent
+    distance: Optional[int] = None  # exact distance at `level` when known
+    exact: bool = True              # False when a subscript is not affine or the offsets are not comparable
+
+
+@dataclass
+class NestDependences:
+    levels: List[LoopLevel]
+    dependences: List[Dependence] = field(default_factory=list)
+    # scalar -> [(kind of one write, levels at which that write is carried)]
+    scalars: Dict[str, List[Tuple[str, List[int]]]] = field(default_factory=dict)
+    shared_iterators: List[str] = field(default_factory=list)
+    # call name -> levels enclosing the call; effects of the callee are not analyzed
+    calls: Dict[str, List[int]] = field(default_factory=dict)
+
+    def scalar_kind(self, name: str, level: int) -> Optional[str]:
+        """How `name` is carried at `level`: one reduction kind, "recurrence", "write; privatize" or None."""
+        kinds = {kind for kind, levels in self.scalars.get(name, []) if level in levels}
+        if not kinds:
+            return None
+        return kinds.pop() if len(kinds) == 1 else "write"
+
+    def carried_at(self, level: int) -> List[str]:
+        reasons = []
+        for dep in self.dependences:
+            if dep.level == level:
+                what = f"{dep.kind} on {dep.source.array}"
+                if not dep.exact:
+                    what += " (non-affine subscript or unknown offset)"
+                elif dep.distance is not None:
+                    what += f" (distance {dep.distance})"
+                if what not in reasons:
+                    reasons.append(what)
+        for name in self.scalars:
+            kind = self.scalar_kind(name, level)
+            if kind:
+                reasons.append(f"scalar {name} ({kind})")
+        for name, levels in self.calls.items():
+            if level in levels:
+                reasons.append(f"call {name}() (effects not analyzed)")
+        for name in self.shared_iterators:
+            if self.iterator_level(name) > level:
+                reasons.append(f"iterator {name} declared outside the loop (make it private)")
+        return reasons
+
+    def array_carried_at(self, level: int) -> bool:
+        return any(dep.level == level for dep in self.dependences)
+
+    def iterator_level(self, name):
+        for k, loop in enumerate(self.levels):
+            if loop.var == name:
+                return k
+        return -1
+
+
+def _ids(node) -> set:
+    names = set()
+
+    class Finder(c_ast.NodeVisitor):
+        def visit_ID(self, n):
+            names.add(n.name)
+
+    if node is not None:
+        Finder().visit(node)
+    return names
+
+
+def _update_kind(name: str, target: str, op: str, rvalue) -> str:
+    """
+    How an assignment `target op rvalue` carries the scalar `name` (target is the
+    lvalue text, name its base variable). Only x op= e and x = x op e with an
+    OpenMP reduction operator and x absent from e are reductions; other updates
+    that read x are recurrences.
+    """
+    generator = c_generator.CGenerator()
+    if op != '=':
+        if op[:-1] in REDUCTION_OPS and name not in _ids(rvalue):
+            return f"reduction {op[:-1]}"
+        return "recurrence"
+    if isinstance(rvalue, c_ast.BinaryOp) and rvalue.op in REDUCTION_OPS:
+        if generator.visit(rvalue.left) == target and name not in _ids(rvalue.right):
+            return f"reduction {rvalue.op}"
+        if rvalue.op != '-' and generator.visit(rvalue.right) == target and name not in _ids(rvalue.left):
+            return f"reduction {rvalue.op}"
+    if name in _ids(rvalue):
+        return "recurrence"
+    return "write; privatize"
+
+
+def _add(a: Affine, b: Affine, sign: int = 1) -> Affine:
+    out = dict(a)
+    for key, value in b.items():
+        out[key] = out.get(key, 0) + sign * value
+        if out[key] == 0:
+            del out[key]
+    return out
+
+
+def affine_form(expr, iterators, variant) -> Affine:
+    """
+    Affine form of a subscript. Raises NonAffine for products of iterators,
+    indirect indices, and scalars written inside the nest.
+    """
+    generator = c_generator.CGenerator()
+    if isinstance(expr, c_ast.ID):
+        if expr.name in iterators:
+            return {(expr.name, ()): 1}
+        if expr.name in variant:
+            raise NonAffine(expr.name)
+        return {(None, (expr.name,)): 1}
+    if isinstance(expr, c_ast.Constant):
+        if expr.type != 'int':
+            raise NonAffine(expr.value)
+        value = int(expr.value.rstrip('uUlL'), 0)
+        return {(None, ()): value} if value else {}
+    if isinstance(expr, c_ast.Cast):
+        return affine_form(expr.expr, iterators, variant)
+    if isinstance(expr, c_ast.UnaryOp) and expr.op in ('-', '+'):
+        inner = affine_form(expr.expr, iterators, variant)
+        return {k: -v for k, v in inner.items()} if expr.op == '-' else inner
+    if isinstance(expr, c_ast.BinaryOp) and expr.op in ('+', '-'):
+        return _add(affine_form(expr.left, iterators, variant),
+                    affine_form(expr.right, iterators, variant), 1 if expr.op == '+' else -1)
+    if isinstance(expr, c_ast.BinaryOp) and expr.op == '*':
+        left = affine_form(expr.left, iterators, variant)
+        right = affine_form(expr.right, iterators, variant)
+        out: Affine = {}
+        for (it1, sym1), c1 in left.items():
+            for (it2, sym2), c2 in right.items():
+                if it1 and it2:
+                    raise NonAffine(generator.visit(expr))
+                out = _add(out, {(it1 or it2, tuple(sorted(sym1 + sym2))): c1 * c2})
+        return out
+    # Division, modulo, calls, nested array reads: fine as an opaque invariant, not otherwise
+    names = _ids(expr)
+    if names & (set(iterators) | set(variant)) or isinstance(expr, (c_ast.ArrayRef, c_ast.FuncCall)):
+        raise NonAffine(generator.visit(expr))
+    return {(None, (generator.visit(expr),)): 1}
+
+
+def _constant(expr) -> Optional[int]:
+    try:
+        form = affine_form(expr, (), ())
+    except (NonAffine, ValueError):
+        return None
+    if all(key == (None, ()) for key in form):
+        return form.get((None, ()), 0)
+    return None
+
+
+def _symbolic_bound(expr, exclusive: int) -> Optional[Tuple[str, int]]:
+    """n - 1 -> ("n", -1) (minus `exclusive` for a strict bound); None unless one symbol with coefficient 1."""
+    try:
+        form = affine_form(expr, (), ())
+    except (NonAffine, ValueError):
+        return None
+    symbols = [(sym, c) for (_, sym), c in form.items() if sym]
+    if len(symbols) != 1 or symbols[0][1] != 1 or len(symbols[0][0]) != 1:
+        return None
+    return symbols[0][0][0], form.get((None, ()), 0) - exclusive
+
+
+def _delinearizable(form: Affine, levels: Dict[str, LoopLevel]) -> bool:
+    """
+    Whether splitting `form` by symbolic stride is exact: for r*n + c, the part
+    below the stride (c) must provably stay in [0, n). Only a single stride is
+    checked; the part must be at most one iterator bounded by n plus iterators
+    and a constant with numeric bounds.
+    """
+    strides = {sym for (it, sym) in form if it and sym}
+    if not strides:
+        return True
+    if len(strides) != 1 or len(next(iter(strides))) != 1:
+        return False
+    stride = next(iter(strides))[0]
+    if any(sym and sym != (stride,) for (_, sym) in form):
+        return False
+    low = high = form.get((None, ()), 0)
+    bounded = False
+    for (it, sym), c in form.items():
+        if not it or sym:
+            continue
+        level = levels.get(it)
+        if level is None or level.lower == -INF:
+            return False
+        if c == 1 and not bounded and level.upper == INF and level.upper_symbolic \
+                and level.upper_symbolic[0] == stride:
+            # c <= n + k contributes n + k to the maximum; the rest must make up for k
+            bounded = True
+            low += level.lower
+            high += level.upper_symbolic[1]
+            continue
+        if level.upper == INF:
+            return False
+        tlo, thi = _term_range(c, level.lower, level.upper)
+        low, high = low + tlo, high + thi
+    # Without the bounded iterator the part is a constant range, below n only when it is 0
+    return low >= 0 and (high <= -1 if bounded else high == 0)
+
+
+def _loop_level(node: c_ast.For, outer_vars) -> Optional[LoopLevel]:
+    init = node.init
+    var, start = None, None
+    if isinstance(init, c_ast.DeclList) and init.decls:
+        var, start = init.decls[0].name, init.decls[0].init
+    elif isinstance(init, c_ast.Assignment) and isinstance(init.lvalue, c_ast.ID):
+        var, start = init.lvalue.name, init.rvalue
+    if var is None:
+        return None
+    level = LoopLevel(var, node.coord.line if node.coord else "unknown", node)
+    bound_ids = _ids(start) | _ids(node.cond.right if isinstance(node.cond, c_ast.BinaryOp) else None)
+    level.rectangular = not (bound_ids & set(outer_vars))
+
+    step = node.next
+    unit = (isinstance(step, c_ast.UnaryOp) and step.op in ('p++', '++')) or \
+           (isinstance(step, c_ast.Assignment) and step.op == '+=' and _constant(step.rvalue) == 1)
+    cond = node.cond
+    if unit and level.rectangular:
+        lower = _constant(start) if start is not None else None
+        if lower is not None:
+            level.lower = lower
+        if isinstance(cond, c_ast.BinaryOp) and isinstance(cond.left, c_ast.ID) and cond.left.name == var:
+            upper = _constant(cond.right)
+            if upper is not None and cond.op in ('<', '<='):
+                level.upper = upper - 1 if cond.op == '<' else upper
+            elif cond.op in ('<', '<='):
+                level.upper_symbolic = _symbolic_bound(cond.right, 1 if cond.op == '<' else 0)
+    elif not unit:
+        # Non-unit or decreasing steps: keep the bounds unknown (conservative)
+        level.lower, level.upper = -INF, INF
+    return level
+
+
+class _NestWalker(c_ast.NodeVisitor):
+    """Collects loop levels, array accesses with their enclosing loops, and scalar writes."""
+
+    def __init__(self):
+        self.levels: List[LoopLevel] = []
+        self.stack: List[LoopLevel] = []
+        self.accesses: List[Access] = []
+        self.written_scalars: Dict[str, List[Tuple[str, List[LoopLevel]]]] = {}
+        self.declared: Dict[str, int] = {}      # scalar -> number of enclosing loops at its declaration
+        self.calls: Dict[str, List[List[LoopLevel]]] = {}
+        # Scalar reads and writes in program order: (name, "read" | "write", enclosing loops)
+        self.uses: List[Tuple[str, str, List[LoopLevel]]] = []
+        self.generator = c_generator.CGenerator()
+
+    def visit_For(self, node):
+        level = _loop_level(node, [l.var for l in self.stack])
+        if level is None:
+            self.generic_visit(node)
+            return
+        level.depth = len(self.stack)
+        if self.stack:
+            self.stack[-1].has_child = True
+        body = node.stmt
+        items = body.block_items if isinstance(body, c_ast.Compound) else [body]
+        level.perfect_child = bool(items) and len(items) == 1 and isinstance(items[0], c_ast.For)
+        if isinstance(node.init, c_ast.DeclList):
+            self.declared[level.var] = len(self.stack) + 1
+        else:
+            self._scalar_write(level.var, "write")
+        self.levels.append(level)
+        self.stack.append(level)
+        self.visit(node.stmt)
+        if node.cond is not None:
+            self.visit(node.cond)
+        self.stack.pop()
+
+    def visit_Decl(self, node):
+        if node.name and self.stack:
+            self.declared.setdefault(node.name, len(self.stack))
+        self.generic_visit(node)
+
+    def visit_Assignment(self, node):
+        if isinstance(node.lvalue, c_ast.ArrayRef):
+            self._access(node.lvalue, True)
+            if node.op != '=':
+                self._access(node.lvalue, False)
+        elif isinstance(node.lvalue, c_ast.ID):
+            # The right-hand side is read before the store
+            self.visit(node.rvalue)
+            self._scalar_write(node.lvalue.name, _update_kind(node.lvalue.name, node.lvalue.name,
+                                                              node.op, node.rvalue))
+            return
+        elif self._store(node.lvalue, node.op, node.rvalue):
+            return
+        else:
+            self.visit(node.lvalue)
+        self.visit(node.rvalue)
+
+    def visit_UnaryOp(self, node):
+        if node.op in ('++', '--', 'p++', 'p--'):
+            if isinstance(node.expr, c_ast.ArrayRef):
+                self._access(node.expr, True)
+                self._access(node.expr, False)
+                return
+            if isinstance(node.expr, c_ast.ID):
+                self._scalar_write(node.expr.name, "reduction +")
+                return
+            if self._store(node.expr, '+=', c_ast.Constant('int', '1')):
+                return
+        self.generic_visit(node)
+
+    def visit_ArrayRef(self, node):
+        self._access(node, False)
+
+    def visit_ID(self, node):
+        self.uses.append((node.name, "read", list(self.stack)))
+
+    def _store(self, lvalue, op, rvalue) -> bool:
+        """
+        Records a store `lvalue op rvalue` through *(p + i), *p++, p->f or s.f. A field
+        of an array element is a store to that element and a field of a local struct a
+        scalar write; both also visit the right-hand side and return True. Anything else is
+        an opaque pointer store and returns False.
+        """
+        if isinstance(lvalue, c_ast.StructRef):
+            if isinstance(lvalue.name, c_ast.ArrayRef):
+                self._access(lvalue.name, True)
+                if op != '=':
+                    self._access(lvalue.name, False)
+                self.visit(rvalue)
+                return True
+            if lvalue.type == '.' and isinstance(lvalue.name, c_ast.ID):
+                name = lvalue.name.name
+                self.visit(rvalue)
+                if op != '=':
+                    self.uses.append((name, "read", list(self.stack)))
+                kind = _update_kind(name, self.generator.visit(lvalue), op, rvalue)
+                if kind.startswith("reduction"):
+                    # A reduction clause cannot name a struct member
+                    kind = "recurrence"
+                self._scalar_write(name, kind)
+                return True
+        base = lvalue
+        while not isinstance(base, c_ast.ID):
+            if isinstance(base, (c_ast.UnaryOp, c_ast.Cast)):
+                base = base.expr
+            elif isinstance(base, c_ast.BinaryOp):
+                base = base.left
+            elif isinstance(base, (c_ast.StructRef, c_ast.ArrayRef)):
+                base = base.name
+            else:
+                return False
+        self.accesses.append(Access(base.name, [], True, list(self.stack), self.generator.visit(lvalue),
+                                    lvalue.coord.line if lvalue.coord else "unknown", pointer=True))
+        return False
+
+    def visit_FuncCall(self, node):
+        name = node.name.name if isinstance(node.name, c_ast.ID) else self.generator.visit(node.name)
+        if name not in PURE_FUNCTIONS:
+            self.calls.setdefault(name, []).append(list(self.stack))
+        if node.args is not None:
+            self.visit(node.args)
+
+    def _scalar_write(self, name, kind):
+        self.written_scalars.setdefault(name, []).append((kind, list(self.stack)))
+        self.uses.append((name, "write", list(self.stack)))
+
+    def read_first(self, name: str, loop: LoopLevel) -> bool:
+        """Whether the first use of `name` in the body of `loop` is a read (its value comes from the last iteration)."""
+        for used, how, stack in self.uses:
+            if used == name and any(l is loop for l in stack):
+                return how == "read"
+        return False
+
+    def _access(self, ref, is_write):
+        subscripts = []
+        node = ref
+        while isinstance(node, c_ast.ArrayRef):
+            subscripts.insert(0, node.subscript)
+            node = node.name
+        name = node.name if isinstance(node, c_ast.ID) else self.generator.visit(node)
+        self.accesses.append(Access(name, subscripts, is_write, list(self.stack), self.generator.visit(ref),
+                                    ref.coord.line if ref.coord else "unknown"))
+        for subscript in subscripts:
+            self.visit(subscript)
+
+
+def _term_range(coefficient: int, lower: float, upper: float) -> Tuple[float, float]:
+    """Range of coefficient * x for x in [lower, upper]."""
+    if coefficient == 0:
+        return 0.0, 0.0
+    values = [coefficient * lower, coefficient * upper]
+    return min(values), max(values)
+
+
+def _pair_range(a: int, b: int, lower: float, upper: float, direction: str) -> Tuple[float, float]:
+    """Range of a*i - b*i' over L <= i, i' <= U under direction '<' (i < i'), '>' or '*'."""
+    if direction == '*':
+        lo1, hi1 = _term_range(a, lower, upper)
+        lo2, hi2 = _term_range(-b, lower, upper)
+        return lo1 + lo2, hi1 + hi2
+    # Vertices and recession directions of the region {i < i'} (or {i > i'})
+    finite = lower > -INF and upper < INF
+    if direction == '<':
+        vertices = [(lower, lower + 1), (lower, upper), (upper - 1, upper)] if finite else []
+        rays = []
+        if upper == INF:
+            rays += [(0, 1), (1, 1)]
+            if lower > -INF:
+                vertices = [(lower, lower + 1)]
+        if lower == -INF:
+            rays += [(-1, 0), (-1, -1)]
+            if upper < INF:
+                vertices = [(upper - 1, upper)]
+    else:
+        vertices = [(lower + 1, lower), (upper, lower), (upper, upper - 1)] if finite else []
+        rays = []
+        if upper == INF:
+            rays += [(1, 0), (1, 1)]
+            if lower > -INF:
+                vertices = [(lower + 1, lower)]
+        if lower == -INF:
+            rays += [(0, -1), (-1, -1)]
+            if upper < INF:
+                vertices = [(upper, upper - 1)]
+    if finite and upper - lower < 1:
+        return INF, -INF   # empty: the loop runs at most once
+    if not vertices:
+        vertices = [(0, 1) if direction == '<' else (1, 0)]
+    evaluate = lambda p: a * p[0] - b * p[1]
+    lo = min(evaluate(v) for v in vertices)
+    hi = max(evaluate(v) for v in vertices)
+    for ray in rays:
+        slope = evaluate(ray)
+        if slope < 0:
+            lo = -INF
+        elif slope > 0:
+            hi = INF
+    return lo, hi
+
+
+def _equations(source: Access, sink: Access):
+    """
+    One (coeff_source, coeff_sink, constant difference) triple per dimension and
+    symbolic stride multiplying an iterator. None when the two subscripts differ
+    in a symbolic offset that multiplies no iterator (n in a[n-i] vs a[i]): its
+    value is unknown, so the difference cannot be tested.
+    """
+    equations = []
+    for fa, fb in zip(source.forms, sink.forms):
+        groups = {sym for (_, sym) in fa} | {sym for (_, sym) in fb}
+        for sym in groups:
+            a = {it: c for (it, s), c in fa.items() if s == sym and it}
+            b = {it: c for (it, s), c in fb.items() if s == sym and it}
+            constant = fb.get((None, sym), 0) - fa.get((None, sym), 0)
+            if sym and not a and not b:
+                if constant:
+                    return None
+                continue
+            equations.append((a, b, constant))
+    return equations
+
+
+def _feasible(equations, common: List[LoopLevel], only_a: List[LoopLevel], only_b: List[LoopLevel],
+              directions: List[str]) -> bool:
+    """GCD and Banerjee tests of a*I - b*I' = constant under one direction vector."""
+    for a, b, constant in equations:
+        coefficients = []
+        lo = hi = 0.0
+        for k, loop in enumerate(common):
+            ca, cb = a.get(loop.var, 0), b.get(loop.var, 0)
+            if directions[k] == '=':
+                coefficients.append(ca - cb)
+                tlo, thi = _term_range(ca - cb, loop.lower, loop.upper)
+            else:
+                coefficients += [ca, cb]
+                tlo, thi = _pair_range(ca, cb, loop.lower, loop.upper, directions[k])
+                if tlo > thi:
+                    return False
+            lo, hi = lo + tlo, hi + thi
+        for loop in only_a:
+            coefficients.append(a.get(loop.var, 0))
+            tlo, thi = _term_range(a.get(loop.var, 0), loop.lower, loop.upper)
+            lo, hi = lo + tlo, hi + thi
+        for loop in only_b:
+            coefficients.append(b.get(loop.var, 0))
+            tlo, thi = _term_range(-b.get(loop.var, 0), loop.lower, loop.upper)
+            lo, hi = lo + tlo, hi + thi
+        divisor = 0
+        for c in coefficients:
+            divisor = math.gcd(divisor, abs(c))
+        if divisor == 0:
+            if constant != 0:
+                return False
+        elif constant % divisor != 0:
+            return False
+        if not (lo <= constant <= hi):
+            return False
+    return True
+
+
+def _distance(equations, level: LoopLevel) -> Optional[int]:
+    """Exact i' - i at `level` when some equation involves only that iterator with equal coefficients."""
+    for a, b, constant in equations:
+        if set(a) | set(b) == {level.var} and a.get(level.var) == b.get(level.var) and a.get(level.var):
+            coefficient = a[level.var]
+            if constant % coefficient == 0:
+                return -constant // coefficient
+    return None
+
+
+def _test_pair(source: Access, sink: Access, kind: str) -> List[Dependence]:
+    common = []
+    for la, lb in zip(source.loops, sink.loops):
+        if la.node is not lb.node:
+            break
+        common.append(la)
+    if source.forms is None or sink.forms is None or len(source.forms) != len(sink.forms):
+        return [Dependence(source, sink, kind, k, exact=False) for k in range(len(common))]
+
+    only_a = source.loops[len(common):]
+    only_b = sink.loops[len(common):]
+    equations = _equations(source, sink)
+    if equations is None:
+        return [Dependence(source, sink, kind, k, exact=False) for k in range(len(common))]
+    found = []
+    reverse = {"flow": "anti", "anti": "flow"}.get(kind, kind)
+    for k in range(len(common)):
+        prefix = ['='] * k
+        rest = ['*'] * (len(common) - k - 1)
+        distance = _distance(equations, common[k])
+        # '<': `source` runs in the earlier iteration; '>': `sink` does, so the roles swap
+        if _feasible(equations, common, only_a, only_b, prefix + ['<'] + rest) and (distance is None or distance > 0):
+            found.append(Dependence(source, sink, kind, k, distance))
+        if _feasible(equations, common, only_a, only_b, prefix + ['>'] + rest) and (distance is None or distance < 0):
+            found.append(Dependence(sink, source, reverse, k, -distance if distance is not None else None))
+    if _feasible(equations, common, only_a, only_b, ['='] * len(common)) and source is not sink:
+        found.append(Dependence(source, sink, kind, None, 0))
+    return found
+
+
+def analyze_nest(nest: c_ast.For) -> NestDependences:
+    """Dependence summary for the loop nest rooted at `nest`."""
+    walker = _NestWalker()
+    walker.visit(nest)
+    result = NestDependences(walker.levels)
+    iterators = [l.var for l in walker.levels]
+    variant = set(walker.written_scalars) - set(iterators)
+
+    for access in walker.accesses:
+        if access.pointer:
+            continue
+        try:
+            access.forms = [affine_form(s, iterators, variant) for s in access.subscripts]
+        except (NonAffine, ValueError):
+            access.forms = None
+        # A linearized subscript whose inner index may leave its row cannot be split per stride
+        if access.forms and not all(_delinearizable(f, {l.var: l for l in access.loops}) for f in access.forms):
+            access.forms = None
+
+    by_array: Dict[str, List[Access]] = {}
+    for access in walker.accesses:
+        by_array.setdefault(access.array, []).append(access)
+    for accesses in by_array.values():
+        for i, first in enumerate(accesses):
+            for second in accesses[i:]:
+                if not (first.is_write or second.is_write):
+                    continue
+                kind = "output" if first.is_write and second.is_write else \
+                       ("flow" if first.is_write else "anti")
+                result.dependences += _test_pair(first, second, kind)
+
+    level_of = {l.node: k for k, l in enumerate(walker.levels)}
+    for name, writes in walker.written_scalars.items():
+        if name in iterators:
+            if name not in walker.declared:
+                result.shared_iterators.append(name)
+            continue
+        declared_depth = walker.declared.get(name, 0)
+        for kind, stack in writes:
+            # Shared at every enclosing level deeper than the loop whose body declares it
+            loops = stack[declared_depth:]
+            if kind == "write; privatize":
+                # Read before its first write in the body: the previous iteration's value flows in
+                flow = [level_of[loop.node] for loop in loops if walker.read_first(name, loop)]
+                if flow:
+                    result.scalars.setdefault(name, []).append(("recurrence", flow))
+                loops = [loop for loop in loops if level_of[loop.node] not in flow]
+            carried = [level_of[loop.node] for loop in loops]
+            if carried:
+                result.scalars.setdefault(name, []).append((kind, carried))
+    for name, stacks in walker.calls.items():
+        levels = sorted({level_of[loop.node] for stack in stacks for loop in stack})
+        if levels:
+            result.calls[name] = levels
+    return result
+
+
+def collapse_depth(result: NestDependences) -> int:
+    """Number of outer levels that are perfectly nested, rectangular and free of carried dependences."""
+    depth = 0
+    for k, level in enumerate(result.levels):
+        if level.depth != k or result.carried_at(k) or (k > 0 and not level.rectangular):
+            break
+        depth += 1
+        if not level.perfect_child:
+            break
+    return depth
+
+
+def _simd_suggestion(result: NestDependences, k: int) -> Optional[str]:
+    """simd verdict for a loop that contains no other loop."""
+    level = result.levels[k]
+    if any(k in levels for levels in result.calls.values()):
+        return None
+    if result.array_carried_at(k):
+        distances = [d.distance for d in result.dependences if d.level == k and d.distance is not None and d.exact]
+        exact = all(d.exact for d in result.dependences if d.level == k)
+        if exact and distances and len(distances) == len([d for d in result.dependences if d.level == k]) \
+                and all(abs(d) > 1 for d in distances):
+            return f"simd safelen({min(abs(d) for d in distances)}) on {level.var} (line {level.line})"
+        return None
+    kinds = [result.scalar_kind(name, k) for name in result.scalars]
+    kinds = [kind for kind in kinds if kind]
+    if any(not kind.startswith("reduction") for kind in kinds):
+        return None
+    if any(result.iterator_level(name) > k for name in result.shared_iterators):
+        return None
+    return f"simd on {level.var} (line {level.line})" + (" with reduction" if kinds else "")
+
+
+def format_dependence_report(result: NestDependences, indent: str = "    ") -> str:
+    if not result.levels:
+        return ""
+    lines = [f"{indent}Dependence Analysis (per loop level, nested loops indented):"]
+    for k, level in enumerate(result.levels):
+        reasons = result.carried_at(k)
+        status = "carried: " + "; ".join(reasons) if reasons else "independent"
+        lines.append(f"{indent}  {'  ' * level.depth}{level.var} (line {level.line}): {status}")
+
+    loop_independent = sorted({f"{d.source.array}" for d in result.dependences if d.level is None})
+    if loop_independent:
+        lines.append(f"{indent}  Same-iteration (not carried) dependences: {', '.join(loop_independent)}")
+    if any(not d.exact for d in result.dependences):
+        lines.append(f"{indent}  Non-affine subscripts, unknown symbolic offsets and pointer stores "
+                     "are assumed to conflict")
+
+    suggestions = []
+    if not result.carried_at(0):
+        depth = collapse_depth(result)
+        suggestions.append(f"parallel for on {result.levels[0].var}" +
+                           (f" with collapse({depth})" if depth > 1 else ""))
+    else:
+        free = [l.var for k, l in enumerate(result.levels) if k > 0 and not result.carried_at(k)]
+        if free:
+            suggestions.append(f"outer level carried; inner independent levels: {', '.join(free)}")
+    for k, level in enumerate(result.levels):
+        if not level.has_child:
+            simd = _simd_suggestion(result, k)
+            if simd and (k > 0 or not suggestions or "parallel for" in suggestions[0]):
+                suggestions.append(simd)
+    if suggestions:
+        lines.append(f"{indent}  Evidence-based suggestion: {'; '.join(suggestions)}")
+    return "\n".join(lines) + "\n"
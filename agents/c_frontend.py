@@ -0,0 +1,373 @@
+"""
+C front end for whole source trees.
+The regex preprocessor in agents.c_ast_utils drops every # line and
+substitutes object-like macros textually. Real headers, function-like macros
+and #if blocks defeat it, and a file that names a type from a header
+(uint32_t, FILE, omp_lock_t) does not parse at all. This module runs the
+compiler's own preprocessor instead (`gcc -E`). The C library headers are
+replaced by the stubs in fake_libc_include, which define only the type names
+and macros pycparser needs, while project headers resolve through the
+include directories and the -I/-D flags of compile_commands.json.
+Linemarkers keep every node at its line in the original file. Top-level
+nodes from headers are dropped after parsing, so reports cover the
+translation unit's own code, as before.
+
+Parsed ASTs are pickled in the artifact cache, keyed by the preprocessed
+text, so a header edit invalidates exactly the units that include it. In
+batch mode, analyze_units builds the AST reports of all translation units in
+a process pool before the pipelines start.
+
+Large files are cut down to their hot functions before they reach the LLM:
+the cost model ranks functions by estimated loop work, and the bodies of the
+rest are replaced by a one-line stub. restore() puts the cold bodies back into
+the implementer's output. Prompt size and latency then follow the size of the
+kernels, not of the file.
+"""
+
+import json
+import multiprocessing
+import os
+import re
+import subprocess
+import time
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import asdict, dataclass
+from typing import Dict, List, Optional, Tuple
+
+from pycparser import c_ast, c_parser
+
+from agents import (c_alias, c_array_reduction, c_ast_utils, c_cost_model, c_dependence, c_numa, c_offload,
+                    c_pipeline, c_profiler, c_roofline)
+from agents.batch import compile_flags
+from agents.cache import ArtifactCache, blank_literals, digest, file_digest, function_spans, source_version
+from agents.c_ast_helpers import top_level_loops
+from agents.c_ast_utils import analyze_c_code_ast
+from agents.c_cost_model import estimate_loops
+from agents.c_profiler import Profile
+from agents.c_validation_engine import CValidationConfig
+
+FAKE_LIBC_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fake_libc_include")
+MAIN_FILE = "<stdin>"
+# GCC extensions pycparser does not parse, defined away before preprocessing
+_EXTENSIONS = ["-D__attribute__(x)=", "-D__extension__=", "-D__restrict=restrict", "-D__restrict__=restrict",
+               "-D__inline=inline", "-D__inline__=inline", "-D__asm__(x)=", "-D__asm(x)=",
+               "-D__volatile__=volatile", "-D__const=const", "-D__signed__=signed"]
+_PRAGMA = re.compile(r"^[ \t]*#[ \t]*pragma\b.*$", re.MULTILINE)
+
+HOT_VIEW_LINES = 300                  # files up to this size go to the LLM whole
+HOT_SHARE = 0.95                      # hot functions hold this share of the estimated loop work
+MIN_ELIDED_LINES = 5                  # shorter cold functions are kept as they are
+_STUB = re.compile(r"/\* MAAP: (\w+) is cold; \d+ lines elided, restored after implementation \*/ \}")
+
+AST_VERSION = file_digest(__file__, os.path.join(FAKE_LIBC_DIR, "_fake_defines.h"),
+                          os.path.join(FAKE_LIBC_DIR, "_fake_typedefs.h"))[:16]
+AST_REPORT_VERSION = digest(AST_VERSION, source_version(c_ast_utils, c_alias, c_array_reduction, c_cost_model,
+                                                        c_dependence, c_numa, c_offload, c_pipeline, c_profiler,
+                                                        c_roofline))[:16]
+
+
+class FrontendError(RuntimeError):
+    pass
+
+
+@dataclass
+class TranslationUnit:
+    ast: c_ast.FileAST                    # top-level nodes of the source file itself
+    preprocessor: str                     # "cpp" (compiler -E) or "regex" (fallback)
+    seconds: float
+    cached: bool = False
+    note: str = ""                        # why the regex fallback was used
+
+
+@dataclass
+class HotView:
+    """The source with cold function bodies stubbed out, and the line map back to the source."""
+    text: str
+    hot: List[str]
+    elided: Dict[str, str]                # cold function -> its original lines from the body's opening brace
+    line_map: List[int]                   # view line - 1 -> source line
+
+    def source_line(self, line: int) -> int:
+        return self.line_map[min(max(line, 1), len(self.line_map)) - 1] if self.line_map else line
+
+
+@dataclass
+class UnitReport:
+    ast_report: str
+    preprocessor: str = "regex"
+    seconds: float = 0.0
+    cached: bool = False
+    functions: int = 0
+    view: Optional[HotView] = None
+    note: str = ""
+
+    @classmethod
+    def from_dict(cls, d: dict) -> "UnitReport":
+        view = d.get("view")
+        return cls(**{**d, "view": HotView(**view) if view else None})
+
+
+def preprocess(code: str, config: CValidationConfig) -> str:
+    """The preprocessed unit, linemarkers kept and #pragma lines blanked; FrontendError when cpp fails."""
+    cmd = [config.compiler, "-E", "-nostdinc", f"-I{FAKE_LIBC_DIR}", *[f"-I{d}" for d in config.include_dirs],
+           *_EXTENSIONS, *config.extra_cflags, "-x", "c", "-"]
+    try:
+        proc = subprocess.run(cmd, input=code, capture_output=True, text=True, timeout=60)
+    except (OSError, subprocess.SubprocessError) as e:
+        raise FrontendError(f"{config.compiler} -E could not run: {e}")
+    if proc.returncode != 0:
+        first = next((l for l in proc.stderr.splitlines() if "error" in l), proc.stderr.strip()[:200])
+        raise FrontendError(f"{config.compiler} -E failed: {first}")
+    # Pragmas stay in the source the LLM sees; pycparser only accepts them in some positions
+    return _PRAGMA.sub("", proc.stdout)
+
+
+def _regex_unit(code: str, start: float, note: str) -> TranslationUnit:
+    ast = c_parser.CParser().parse(c_ast_utils.preprocess_c_code(code), filename="<input>")
+    return TranslationUnit(ast, "regex", time.perf_counter() - start, note=note)
+
+
+def parse_unit(code: str, config: Optional[CValidationConfig] = None,
+               cache: Optional[ArtifactCache] = None) -> TranslationUnit:
+    """
+    Parses one translation unit through the compiler's preprocessor, falling back
+    to the regex preprocessor when cpp or pycparser rejects it. The fallback's
+    c_parser.ParseError propagates when neither parses.
+    """
+    start = time.perf_counter()
+    config = config or CValidationConfig()
+    try:
+        text = preprocess(code, config)
+    except FrontendError as e:
+        return _regex_unit(code, start, str(e))
+    key = digest(text, AST_VERSION)
+    ast = cache.get_object("ast", key) if cache is not None else None
+    if ast is not None:
+        return TranslationUnit(ast, "cpp", time.perf_counter() - start, cached=True)
+    try:
+        full = c_parser.CParser().parse(text, filename=MAIN_FILE)
+    except c_parser.ParseError as e:
+        return _regex_unit(code, start, f"pycparser: {e}")
+    ast = c_ast.FileAST([n for n in full.ext if n.coord is None or n.coord.file == MAIN_FILE])
+    if cache is not None:
+        cache.put_object("ast", key, ast)
+    return TranslationUnit(ast, "cpp", time.perf_counter() - start)
+
+
+def _called(node) -> set:
+    found = set()
+    for _, child in node.children():
+        if isinstance(child, c_ast.FuncCall) and isinstance(child.name, c_ast.ID):
+            found.add(child.name.name)
+        found |= _called(child)
+    return found
+
+
+def _has_inner_loop(node) -> bool:
+    return any(isinstance(child, c_ast.For) or _has_inner_loop(child) for _, child in node.children())
+
+
+def hot_functions(ast: c_ast.FileAST, overheads, work: Optional[Dict[str, float]] = None) -> List[str]:
+    """
+    Functions holding HOT_SHARE of the loop work, plus the file's functions they
+    call. `work` (function -> ns) overrides the cost model's estimate, e.g. with
+    a measured profile. Functions whose nested loops the cost model cannot bound
+    are kept too, since nothing shows they are cold.
+    """
+    functions = {ext.decl.name: ext for ext in ast.ext if isinstance(ext, c_ast.FuncDef)}
+    unknown = []
+    if work is None:
+        work = {}
+        for cost in estimate_loops(ast, overheads).values():
+            if cost.work_ns is not None:
+                work[cost.function] = work.get(cost.function, 0.0) + cost.work_ns
+        unknown = [fn for loop, fn in top_level_loops(ast) if _has_inner_loop(loop) and fn not in work]
+    total, covered, hot = sum(work.values()), 0.0, []
+    for name in sorted(work, key=work.get, reverse=True):
+        if hot and covered >= HOT_SHARE * total:
+            break
+        hot.append(name)
+        covered += work[name]
+    hot += [fn for fn in unknown if fn not in hot]
+    # Callees are part of a kernel's legality (side effects, aliasing), so they travel with it
+    pending = list(hot)
+    while pending:
+        for callee in _called(functions[pending.pop()].body):
+            if callee in functions and callee not in hot:
+                hot.append(callee)
+                pending.append(callee)
+    return [name for name in functions if name in hot]
+
+
+def hot_view(code: str, hot: List[str]) -> Optional[HotView]:
+    """code with every other function's body stubbed; None for short files or when nothing is cold."""
+    lines = code.splitlines()
+    if len(lines) <= HOT_VIEW_LINES or not hot:
+        return None
+    clean = blank_literals(code).splitlines()
+    out, line_map, elided = [], [], {}
+    line = 1
+    for span in function_spans(code):
+        brace = next((i for i in range(span.start_line, span.end_line + 1) if "{" in clean[i - 1]), None)
+        if span.name in hot or brace is None or span.end_line - brace < MIN_ELIDED_LINES:
+            continue
+        for i in range(line, brace):
+            out.append(lines[i - 1])
+            line_map.append(i)
+        head = lines[brace - 1][:clean[brace - 1].index("{") + 1]
+        out.append(f"{head} /* MAAP: {span.name} is cold; {span.end_line - brace + 1} lines elided, "
+                   f"restored after implementation */ }}")
+        line_map.append(brace)
+        elided[span.name] = "\n".join(lines[brace - 1:span.end_line])
+        line = span.end_line + 1
+    if not elided:
+        return None
+    for i in range(line, len(lines) + 1):
+        out.append(lines[i - 1])
+        line_map.append(i)
+    return HotView("\n".join(out) + "\n", hot, elided, line_map)
+
+
+def restore(modified: str, view: HotView) -> Tuple[str, List[int]]:
+    """
+    The implementer's output with the cold bodies put back, and the map from its
+    lines to the restored file's lines. A stub the LLM dropped stays dropped; the
+    build then fails and the retry sees the error.
+    """
+    out, line_map = [], []
+    for line in modified.splitlines():
+        match = _STUB.search(line)
+        line_map.append(len(out) + 1)
+        if match and match.group(1) in view.elided:
+            out.extend(view.elided[match.group(1)].splitlines())
+        else:
+            out.append(line)
+    return "\n".join(out) + "\n", line_map
+
+
+def map_lines(items: List[dict], line_of) -> List[dict]:
+    """Candidates or changes with start_line/end_line moved through line_of."""
+    return [{**item, "start_line": line_of(item["start_line"]), "end_line": line_of(item["end_line"])}
+            for item in items]
+
+
+def unit_report(code: str, config: CValidationConfig, overheads, machine=None, offload: bool = False,
+                cache: Optional[ArtifactCache] = None, profile: Optional[Profile] = None) -> UnitReport:
+    """
+    The AST report for one unit (of its hot view when the file is large), cached by
+    source and flags. With a runtime profile, measured function shares pick the hot
+    functions and each loop's share is part of the report.
+    """
+    key = digest(code, config.include_dirs, config.extra_cflags, asdict(overheads),
+                 asdict(machine) if machine else None, offload, asdict(profile) if profile else None,
+                 AST_REPORT_VERSION)
+    cached = cache.get("ast_report", key) if cache is not None else None
+    if isinstance(cached, dict):
+        return UnitReport.from_dict({**cached, "cached": True})
+    start = time.perf_counter()
+    try:
+        unit = parse_unit(code, config, cache)
+    except Exception:
+        # Neither preprocessor yields a parse; the report carries pycparser's error
+        result = UnitReport(analyze_c_code_ast(code, overheads, machine, offload))
+    else:
+        functions = [ext.decl.name for ext in unit.ast.ext if isinstance(ext, c_ast.FuncDef)]
+        view = hot_view(code, hot_functions(unit.ast, overheads, profile.functions if profile else None))
+        ast = unit.ast
+        if view is not None:
+            try:
+                ast = parse_unit(view.text, config, cache).ast
+            except Exception:
+                view = None
+        text = view.text if view is not None else code
+        if profile is not None and view is not None:
+            profile = profile.remapped(view.line_map)
+        result = UnitReport(analyze_c_code_ast(text, overheads, machine, offload, ast=ast, profile=profile),
+                            unit.preprocessor,
+                            functions=len(functions), view=view, note=unit.note)
+    result.seconds = time.perf_counter() - start
+    if cache is not None:
+        cache.put("ast_report", key, asdict(result))
+    return result
+
+
+def describe_unit(report: UnitReport, source_lines: int) -> str:
+    where = "gcc -E with fake libc headers" if report.preprocessor == "cpp" else \
+        f"regex preprocessor ({report.note})" if report.note else "regex preprocessor"
+    text = f"Front end: {where}, {report.seconds:.2f}s" + (" (cached)" if report.cached else "")
+    if report.view is not None:
+        text += (f"; {len(report.view.hot)} of {report.functions} function(s) are hot "
+                 f"({', '.join(report.view.hot)}), the LLM sees {len(report.view.line_map)} of {source_lines} lines")
+    return text
+
+
+@dataclass
+class UnitJob:
+    path: str
+    config: CValidationConfig
+    overheads: object
+    machine: object = None
+    offload: bool = False
+    # The report depends on a runtime profile the pipeline takes later; only the AST is prebuilt
+    parse_only: bool = False
+
+
+def _run_job(job: UnitJob, cache_dir: Optional[str]) -> Tuple[str, Optional[UnitReport], str]:
+    try:
+        with open(job.path, encoding="utf-8") as f:
+            code = f.read()
+        cache = ArtifactCache(cache_dir) if cache_dir else None
+        if job.parse_only:
+            unit = parse_unit(code, job.config, cache)
+            return job.path, UnitReport("", unit.preprocessor, unit.seconds, unit.cached, note=unit.note), ""
+        return job.path, unit_report(code, job.config, job.overheads, job.machine, job.offload, cache), ""
+    except Exception as e:
+        return job.path, None, str(e)
+
+
+def analyze_units(jobs: List[UnitJob], cache_dir: Optional[str], workers: int) -> Dict[str, UnitReport]:
+    """AST reports for many translation units, built in a process pool (pycparser holds the GIL)."""
+    if workers <= 1 or len(jobs) <= 1:
+        results = [_run_job(job, cache_dir) for job in jobs]
+    else:
+        methods = multiprocessing.get_all_start_methods()
+        context = multiprocessing.get_context("fork" if "fork" in methods else "spawn")
+        with ProcessPoolExecutor(max_workers=min(workers, len(jobs)), mp_context=context) as pool:
+            results = list(pool.map(_run_job, jobs, [cache_dir] * len(jobs)))
+    return {path: report for path, report, _ in results if report is not None}
+
+
+def format_frontend_summary(reports: Dict[str, UnitReport], jobs: int, wall_time: float, workers: int) -> str:
+    cpp = sum(r.preprocessor == "cpp" for r in reports.values())
+    cached = sum(r.cached for r in reports.values())
+    views = [r for r in reports.values() if r.view is not None]
+    text = (f"Front end: {len(reports)}/{jobs} translation unit(s) analyzed in {wall_time:.1f}s on {workers} "
+            f"process(es); {cpp} via gcc -E, {len(reports) - cpp} via the regex fallback, {cached} from cache")
+    if views:
+        text += f"; {len(views)} large file(s) reduced to their hot functions"
+    return text
+
+
+def compile_flags_for(path: str) -> List[str]:
+    """
+    The -I/-D/-U/-std/-include flags of `path` from the nearest compile_commands.json
+    in its directory, a parent, or a build/ subdirectory of either; [] when none lists it.
+    """
+    target = os.path.normpath(os.path.abspath(path))
+    directory = os.path.dirname(target)
+    while True:
+        for candidate in (os.path.join(directory, "compile_commands.json"),
+                          os.path.join(directory, "build", "compile_commands.json")):
+            try:
+                with open(candidate, encoding="utf-8") as f:
+                    entries = json.load(f)
+            except (OSError, json.JSONDecodeError):
+                continue
+            for entry in entries:
+                root = entry.get("directory", os.path.dirname(candidate))
+                if os.path.normpath(os.path.join(root, entry.get("file", ""))) == target:
+                    return compile_flags(entry)
+        parent = os.path.dirname(directory)
+        if parent == directory:
+            return []
+        directory = parent
@@ -4,7 +4,7 @@ Transforms C code to use OpenMP pragmas for parallel execution.
 Uses the same structured output format as the Python implementer.
 """
 
-from typing import List, Optional, Literal
+from typing import Dict, List, Optional, Literal
 from pydantic import BaseModel, Field
 from langchain_core.prompts import ChatPromptTemplate
 from LLMs.llms import llm
@@ -13,10 +13,21 @@ from LLMs.llms import llm
 class CAppliedChange(BaseModel):
     start_line: int = Field(..., description="Loop start line modified")
     end_line: int = Field(..., description="Loop end line modified")
-    pragma: Literal["parallel_for", "parallel_for_reduction", "parallel_sections", "simd"] = Field(
-        ..., description="OpenMP pragma applied"
+    pragma: Literal["parallel_for", "parallel_for_reduction", "parallel_for_array_reduction", "parallel_sections",
+                    "simd", "loop_interchange", "tiling", "stencil_tiling", "first_touch", "target_teams", "target_data",
+                    "task", "taskwait", "taskgroup", "task_pipeline", "restrict"] = Field(
+        ..., description="OpenMP pragma or loop transformation applied"
     )
+    schedule: Optional[Literal["static", "dynamic", "guided", "runtime"]] = Field(
+        None, description="schedule(...) kind emitted on the loop, if any"
+    )
+    chunk: Optional[int] = Field(None, description="Chunk size emitted in the schedule clause, if any")
+    collapse: Optional[int] = Field(None, description="collapse(n) depth emitted on the loop, if any")
     note: Optional[str] = Field(None, description="Short explanation of what changed")
+    tunables: Dict[str, int] = Field(
+        default_factory=dict,
+        description="Compile-time tunables introduced, macro name -> default (e.g. {\"TILE_I\": 64}); each is #ifndef-guarded"
+    )
 
 class CImplementerOutput(BaseModel):
     modified_code: str = Field(..., description="Full modified C code after implementation.")
@@ -32,8 +43,17 @@ Refactor the provided C code to parallelize identified safe candidates using Ope
 Supported Pragmas:
 1. `#pragma omp parallel for` - For independent loop iterations
 2. `#pragma omp parallel for reduction(op:var)` - For accumulator patterns
+   (`reduction(op:a[0:n])` array sections, private copies or atomics for accumulations into arrays)
 3. `#pragma omp parallel sections` - For independent code blocks
 4. `#pragma omp simd` - For SIMD vectorization of inner loops
+5. `#pragma omp task` / `#pragma omp taskwait` / `#pragma omp taskgroup` - For recursive divide and conquer
+   (`#pragma omp task depend(...)` - For read -> process -> write pipelines)
+
+Supported Loop Transformations (combine with the pragmas above):
+6. Loop interchange - reorder a loop nest so the innermost loop accesses memory with unit stride
+7. Tiling - block a loop nest into cache-sized tiles with tunable tile sizes
+8. Stencil tiling - sweep a stencil in tiles with halo cells, fusing several time steps per tile
+9. Restrict qualification - mark non-overlapping pointer parameters `restrict` so the compiler drops alias checks
 
 You will receive:
 - Original C code
@@ -52,10 +72,163 @@ Rules:
       - Wrap in `#pragma omp parallel sections` with `#pragma omp section` for each block.
    D. Vectorization:
       - Add `#pragma omp simd` for inner loops suitable for SIMD.
+   E. Loop Interchange:
+      - Reorder the loops (e.g. i-j-k -> i-k-j for matrix products) so the inner loop is unit-stride;
+        initialize accumulated outputs before the reordered nest.
+      - Keep `#pragma omp parallel for` on the outermost loop; record pragma="loop_interchange".
+   F. Tiling:
+      - Introduce each tile size as a guarded macro so the validator can tune it with -D:
+        `#ifndef TILE_I` / `#define TILE_I 64` / `#endif`
+      - Clamp tile bounds at the array edge; parallelize the outermost tile loop.
+      - Record pragma="tiling" and list the macros with their defaults in `tunables`.
+   G. Stencil Tiling:
+      - Without a time loop in range, a stencil is a Loop Map: `#pragma omp parallel for` on the row loop.
+      - With the time loop in range, split the rows into bands of BAND_ROWS rows and advance FUSE_STEPS steps per band
+        before the next band: load the band plus FUSE_STEPS halo rows per side, shrink the computed range by one
+        stencil radius per fused step, and write only the band's own rows to the destination. Keep intermediate
+        steps in per-thread scratch rows allocated once; parallelize the band loop.
+      - Points the original never writes (the frame) must keep the value the destination buffer would have held.
+      - Record pragma="stencil_tiling" with BAND_ROWS and FUSE_STEPS (#ifndef-guarded) in `tunables`.
+   H. Recursive Tasks:
+      - Start the recursion inside `#pragma omp parallel` + `#pragma omp single` (in a wrapper, not in the recursion).
+      - Put `#pragma omp task` before every recursive call but the last and `#pragma omp taskwait` before the combine
+        step; use `#pragma omp taskgroup` instead when the tasks spawn further tasks that must also finish.
+      - Below a size cutoff run the calls serially (plain recursion or an insertion sort for small ranges), with
+        the cutoff as an #ifndef-guarded TASK_CUTOFF macro recorded in `tunables`.
+      - Replace per-call malloc/free in the combine step with one scratch buffer allocated in the wrapper; a merge
+        sort can ping-pong between the array and the scratch buffer instead of copying halves out.
+      - Record pragma="task" (or "taskgroup") on the recursive function.
+   I. Random Number Streams (loops flagged "rng state"):
+      - Add `#include "maap_rng.h"` (counter-based Philox streams, next to bench.h) and remove srand()/rand() from
+        the parallelized loop.
+      - Split the iterations into blocks of RNG_BLOCK samples (#ifndef-guarded, default 4096) and parallelize over
+        blocks with the reduction. Each block b owns `maap_rng rng; maap_rng_init(&rng, SEED, (uint64_t)b);`, where
+        SEED is the srand() argument, so results do not depend on the thread count.
+      - Draw values with maap_rng_uniform(&rng) (in (0,1); replaces (double)rand() / RAND_MAX), or fill arrays of
+        MAAP_RNG_BATCH values with maap_rng_fill_uniform() and run the per-sample work over the arrays.
+      - Never seed per thread from time(NULL) or omp_get_thread_num() alone.
+      - The new streams change the estimate within its sampling error; the validator then compares outputs with a
+        1e-3 relative tolerance. Keep rand() wherever the exact sequence matters (input generation).
+   J. First Touch (NUMA page placement):
+      - Parallelize the initialization loop with the same partition as the loop that later reads the arrays:
+        `#pragma omp parallel for schedule(static) proc_bind(spread)` on both, with the same iteration range and no
+        chunk, so each thread first writes the pages it reads later. Never use dynamic schedules on either loop.
+      - If the ranges differ (flat i < R*C init vs. a row loop r = 1..R-2), rewrite the initialization as the
+        consumer's outer loop over rows (covering every row, frame included) with an inner loop over columns.
+      - The values written must not change; do not fold the initialization into the kernel.
+      - Record pragma="first_touch" on the initialization loop.
+   K. Offload (candidates with recommendation target_teams / target_data):
+      - Kernel loops: `#pragma omp target teams distribute parallel for` followed by the candidate's "Map" clauses,
+        e.g. `map(to: A[0:n*n], B[0:n*n]) map(tofrom: C[0:n*n])`. Lengths are element counts in the function's own
+        variables. Scalars need no map. Add `collapse(2)` when the analysis gives it. `map(from:)` copies the whole
+        section back; use `tofrom` instead when the loops write only part of it.
+      - Temporaries malloc'd in the kernel function and used by one loop get `map(alloc: tmp[0:n])` on that loop;
+        keep the malloc/free on the host. A temporary several loops use must be mapped once: put the report's
+        `#pragma omp target data map(alloc: ...)` around all of the kernel's loops and leave it out of the loops'
+        own clauses. A map(alloc:) on each loop gives every target region a fresh, uninitialized device buffer.
+      - target_data: put `#pragma omp target data` with its map clauses directly above the repeating loop (inside
+        the timed region). The kernels keep their own map clauses: inside the data region they find the arrays
+        present and copy nothing. If host code between calls reads or writes a mapped array, put
+        `#pragma omp target update from(a[0:n])` before it (or `to(...)` after a host write).
+      - Every pointer a target region dereferences must be mapped there or by an enclosing target data; the
+        validator fails the change otherwise.
+      - Record pragma="target_teams" on each kernel loop and pragma="target_data" on the region.
+   L. Array Reduction (candidates with recommendation parallel_for_array_reduction):
+      - Use the strategy of the loop's "Array Reduction" line:
+        - array section: `#pragma omp parallel for reduction(+:h[0:n])` with the given extent (element count in
+          the function's variables; a pointer needs the explicit section).
+        - private copies: allocate `T *priv = calloc((size_t)nthreads * n, sizeof *priv)` once outside the region,
+          where nthreads = omp_get_max_threads(). Inside `#pragma omp parallel` each thread accumulates into
+          priv + omp_get_thread_num() * n under `#pragma omp for`. Then merge in log2(nthreads) rounds: for
+          stride = 1, 2, 4, ..., add copy t + stride into copy t for every t that is a multiple of 2 * stride,
+          with `#pragma omp for` over the elements and the implicit barrier between rounds. Finally add copy 0
+          into the array and free priv.
+        - atomic: `#pragma omp atomic` directly above each update statement (`h[k] += x;`, not a compound block).
+      - The accumulated values must not change except for the order of floating-point additions. Keep scalar
+        reductions in the same loop in their reduction clause.
+      - Record pragma="parallel_for_array_reduction" and name the strategy in the note.
+   M. Pipeline (candidates with recommendation task_pipeline):
+      - Turn the buffers the report lists as "Stage Buffers" and "Process Scratch" into a ring of NBUF slots, an
+        #ifndef-guarded PIPE_BUFFERS macro (default 2) recorded in `tunables`. Allocate them once, before the loop.
+      - Put the "Carried State" (stream position, partial-line remainder) in a reader struct and the writer's
+        running totals in a writer struct, both declared before the parallel region so the tasks share them.
+      - When the trip count is only known after a read (EOF), compute the number of blocks up front from the file
+        size (fstat/stat) and read fixed-size blocks; the last read takes the remainder.
+      - Inside `#pragma omp parallel` + `#pragma omp single`, create three tasks per block k with b = k % NBUF:
+        `#pragma omp task depend(inout: reader) depend(out: slot[b])` for the read,
+        `#pragma omp task depend(inout: slot[b])` for the processing, and
+        `#pragma omp task depend(in: slot[b]) depend(inout: writer)` for the write, each with firstprivate(b).
+        The out dependence on slot[b] makes read k+NBUF wait until block k is written.
+      - A heavy process stage may split its block at line boundaries and use `#pragma omp taskloop` over the parts.
+      - Output bytes and their order must be identical to the sequential program.
+      - Record pragma="task_pipeline" spanning the loop.
 4) Always add `#include <omp.h>` at the top.
 5) Safety:
    - Do NOT use `private()` clauses for loop-local variables.
    - Variables declared inside the loop are automatically private.
+   - The bench.h repetition loop (`for (rep = 0; rep < bench_runs(); rep++)` around bench_now/bench_record) times
+     the benchmark and must stay serial: never put a pragma on it or move code across bench_now/bench_record.
+6) Schedule clause:
+   - Emit the schedule the analysis gives for a loop candidate: `schedule(static)` may be omitted, dynamic/guided
+     are written as `schedule(dynamic, 64)` with the suggested chunk; record schedule and chunk in the change.
+   - For "runtime" write `schedule(runtime)`; the validator times OMP_SCHEDULE candidates and replaces the clause
+     with the fastest one.
+   - When the analysis gives collapse n >= 2, emit `collapse(n)` on the outer loop; the collapsed loops must be
+     perfectly nested (no statements between them) and their bounds must not depend on each other.
+   - When a candidate has an "If clause", add it to the parallel pragma (`#pragma omp parallel for if(n > 4096)`)
+     so small inputs run sequentially; candidates whose blocker is "too little work" stay sequential.
+   - When a candidate has a "Proc bind", add `proc_bind(kind)` to its parallel pragma. Threads are placed on
+     OMP_PLACES (the validator runs with OMP_PLACES=cores); do not call setenv or omp_set_* for placement.
+7) Scaling feedback:
+   - If the previous validation output contains a scaling "Recommendation:", follow it: add the suggested
+     `num_threads(n)` clause, or leave the region sequential if it says the region does not scale.
+8) Time-stepped kernels:
+   - Move malloc/free listed under "Heap Allocation Hot Spots" out of the step: allocate the scratch buffers once in
+     the caller and pass them in.
+   - Keep one `#pragma omp parallel for` per loop. The validator merges adjacent parallel loops, and kernels called
+     from a step loop, into one `#pragma omp parallel` region itself (nowait only where no dependence crosses the
+     loops) and keeps the merge when it is faster.
+
+9) Pointer aliasing:
+   - Only qualify the parameters listed as "restrict-safe" under "Pointer Aliasing" in the AST report, e.g.
+     `void vector_ops(double *restrict a, double *restrict b, double *restrict c, int n)`, and update any
+     prototype to match. Record one change with pragma="restrict" spanning the function signature.
+   - When the report lists "aligned(p:n)", the simd loops of that function may use `#pragma omp simd aligned(p:n)`.
+     Never add aligned() for plain malloc buffers.
+   - The validator rejects restrict on parameters the analysis did not prove distinct.
+
+10) Vectorization feedback:
+   - A previous validation output may contain a "Vectorization Report" with each candidate loop marked
+     vectorized or NOT vectorized, plus the compiler's reason. For a loop marked [omp simd] but not vectorized,
+     remove the cause: add restrict for possible aliasing, use a simd reduction clause for a reduction, or hoist conditionals
+     and calls. If the cause is a true dependence, drop the pragma.
+   - Keep loops that were vectorized unchanged.
+
+11) Hardware counter feedback:
+   - A "Hardware Counters" block ends with "Diagnosis:" lines. Act on them:
+     - memory-bound: cut memory traffic (tiling, fusing loops over the same arrays, float instead of double
+       when the tolerance allows); more threads will not help.
+     - parallel overhead or few CPUs busy: make regions coarser (parallelize an outer loop, merge regions, raise
+       the chunk) or leave small regions sequential.
+     - IPC fell: look for false sharing and shared accumulators; use reduction clauses or padded per-thread data.
+
+12) Roofline feedback:
+   - A "Roofline" block places the timed region against the measured triad bandwidth and FMA peak.
+     - "at the bandwidth ceiling": more threads or schedules will not help. Move fewer bytes: fuse loops that sweep
+       the same arrays, reuse data while it is in cache, use smaller element types when the tolerance allows.
+     - "bandwidth-bound" below the ceiling: fix strided access and initialize arrays in parallel (first touch).
+     - "compute headroom left": vectorize the inner loop, block for cache reuse or parallelize further.
+     - "blocking pays off": the data fits the compulsory intensity only with reuse; tile the loop nest.
+
+13) Large files:
+   - A function whose body is only `/* MAAP: name is cold; N lines elided, restored after implementation */` was cut
+     from the input because it holds little of the work. Copy that line unchanged (signature included); the
+     validator puts the original body back. Never parallelize, rename or remove a cold function.
+
+14) Variants:
+   - A "VARIANT i of K" line asks for one of several alternative transformations, validated and timed side by side.
+     Follow its strategy wherever the analysis allows it; where it does not (no nest to collapse, nothing to tile),
+     apply the recommendations and say so in the change note. The fastest correct variant is kept.
 
 Output requirements:
 - Return the full modified C code.
@@ -75,6 +248,8 @@ ANALYSIS REPORT:
 
 {previous_error}
 
+{variant}
+
 Constraints:
 - Apply changes only to the regions referenced in the analysis report.
 - If the analysis report does not explicitly say a candidate is safe, do not parallelize it.
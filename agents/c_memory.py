@@ -0,0 +1,200 @@
+"""
+Peak memory and allocation counts for validated C binaries.
+Timing alone misses a transformation that privatizes arrays per thread or
+mallocs inside a parallel loop, which can multiply memory use. Each binary
+runs once more (one repeat, no warmup) and the report records:
+  - allocation calls, bytes requested and the peak of live heap bytes, from
+    benchmarks/c/tools/malloc_interpose.c preloaded with LD_PRELOAD;
+  - peak RSS, the VmHWM the interposer reads at exit. Without it, the
+    ru_maxrss that os.wait4 returns for the child is used instead. Linux
+    keeps ru_maxrss across execve, so that figure is at least the
+    validator's own RSS at spawn time and small programs look alike;
+  - the allocation rate over the run's wall time.
+The memory gate then fails validation when the refactored peak RSS exceeds
+--max-memory-growth times the original's. Growth below MEMORY_SLACK passes
+regardless, since the OpenMP runtime and thread stacks alone add a few MiB,
+and the gate is skipped when the two figures come from different sources.
+
+The interposer needs Linux and a dynamically linked binary; without it only
+the rusage peak RSS is reported. Without os.wait4 (Windows) nothing is
+measured and validation is unaffected.
+"""
+
+import json
+import os
+import subprocess
+import sys
+import threading
+import time
+from dataclasses import asdict, dataclass
+from typing import Dict, Optional, Tuple
+
+from agents.cache import CACHE_DIR, file_digest
+from agents.c_cost_model import TOOLS_DIR
+from agents.c_validation_engine import CValidationConfig, pinned, run_environment
+
+INTERPOSER = "malloc_interpose"
+ALLOC_FILE = "maap_alloc.jsonl"
+MEMORY_SLACK = 16 << 20                  # bytes of RSS growth that never fail the gate
+_build_lock = threading.Lock()           # pipelines of one batch share the cached build
+
+
+@dataclass
+class MemoryUsage:
+    peak_rss: int                         # bytes
+    elapsed: float                        # wall time of the measured run, seconds
+    allocations: Optional[int] = None     # None without the interposer
+    frees: Optional[int] = None
+    bytes: Optional[int] = None
+    peak_heap: Optional[int] = None       # highest live heap bytes
+    rss_source: str = "rusage"            # "proc" (VmHWM from the interposer) or "rusage" (wait4 ru_maxrss)
+
+    @property
+    def allocation_rate(self) -> Optional[float]:
+        return self.allocations / self.elapsed if self.allocations is not None and self.elapsed > 0 else None
+
+    @property
+    def byte_rate(self) -> Optional[float]:
+        return self.bytes / self.elapsed if self.bytes is not None and self.elapsed > 0 else None
+
+    def summary(self) -> dict:
+        return {**asdict(self), "allocation_rate": self.allocation_rate, "byte_rate": self.byte_rate}
+
+
+def build_interposer(config: CValidationConfig, cache_dir: str = CACHE_DIR) -> Optional[str]:
+    """Path of the preload library, built once per compiler and source; None off Linux or when it cannot be built."""
+    if not sys.platform.startswith("linux"):
+        return None
+    source = os.path.join(TOOLS_DIR, f"{INTERPOSER}.c")
+    tag = file_digest(source)[:12]
+    library = os.path.join(os.path.abspath(cache_dir), f"{INTERPOSER}-{os.path.basename(config.compiler)}-{tag}.so")
+    with _build_lock:
+        if os.path.exists(library):
+            return library
+        os.makedirs(cache_dir, exist_ok=True)
+        partial = f"{library}.{os.getpid()}"
+        try:
+            subprocess.run([config.compiler, "-O2", "-shared", "-fPIC", source, "-o", partial, "-ldl"],
+                           check=True, capture_output=True, timeout=config.compile_timeout)
+            os.replace(partial, library)
+        except (OSError, subprocess.SubprocessError):
+            return None
+    return library
+
+
+def _rss_bytes(maxrss: int) -> int:
+    # ru_maxrss is in KiB on Linux and in bytes on macOS
+    return maxrss if sys.platform == "darwin" else maxrss * 1024
+
+
+def measure_memory(work_dir: str, exe: str, config: CValidationConfig, interposer: Optional[str] = None,
+                   threads: Optional[int] = None) -> Optional[MemoryUsage]:
+    """One run of exe with the harness at one repeat; None when it fails or wait4 is unavailable."""
+    if not hasattr(os, "wait4"):
+        return None
+    env = run_environment(config, threads)
+    env.update({"BENCH_WARMUP": "0", "BENCH_REPEATS": "1"})
+    alloc_path = os.path.join(os.path.abspath(work_dir), ALLOC_FILE)
+    if interposer:
+        env["LD_PRELOAD"] = " ".join(filter(None, [interposer, env.get("LD_PRELOAD")]))
+        env["MAAP_ALLOC_OUT"] = alloc_path
+        if os.path.exists(alloc_path):
+            os.remove(alloc_path)
+    path = exe if os.path.isabs(exe) else os.path.join(".", exe)
+    start = time.perf_counter()
+    try:
+        proc = subprocess.Popen(pinned([path], config.cpus), cwd=work_dir, env=env,
+                                stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    except OSError:
+        return None
+    # Reaped here rather than by Popen.wait so the child's own rusage is returned
+    timer = threading.Timer(config.run_timeout, proc.kill)
+    timer.start()
+    try:
+        _, status, rusage = os.wait4(proc.pid, 0)
+    finally:
+        timer.cancel()
+    elapsed = time.perf_counter() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode != 0:
+        return None
+    usage = MemoryUsage(_rss_bytes(rusage.ru_maxrss), elapsed)
+    records = []
+    try:
+        with open(alloc_path, encoding="utf-8") as f:
+            records = [json.loads(line) for line in f if line.strip()]
+    except (OSError, json.JSONDecodeError):
+        pass
+    if records:
+        # One line per process that loaded the library (a fork adds one)
+        usage.allocations = sum(r["allocations"] for r in records)
+        usage.frees = sum(r["frees"] for r in records)
+        usage.bytes = sum(r["bytes"] for r in records)
+        usage.peak_heap = max(r["peak_live_bytes"] for r in records)
+        hwm = max(r.get("peak_rss_kb", -1) for r in records)
+        if hwm > 0:
+            usage.peak_rss, usage.rss_source = hwm * 1024, "proc"
+    return usage
+
+
+def memory_growth(original: MemoryUsage, refactored: MemoryUsage) -> Optional[float]:
+    return refactored.peak_rss / original.peak_rss if original.peak_rss > 0 else None
+
+
+def memory_gate(original: MemoryUsage, refactored: MemoryUsage, budget: Optional[float]) -> Tuple[bool, str]:
+    """
+    (passes, verdict). A budget of None or 0 disables the gate, and so does a pair of
+    peak RSS figures from different sources: the rusage one includes the validator's
+    RSS at spawn time, which VmHWM does not.
+    """
+    growth = memory_growth(original, refactored)
+    if not budget or growth is None:
+        return True, ""
+    if original.rss_source != refactored.rss_source:
+        return True, (f"not applied: peak RSS of the original from {original.rss_source}, "
+                      f"of the refactored from {refactored.rss_source}")
+    added = refactored.peak_rss - original.peak_rss
+    if growth > budget and added > MEMORY_SLACK:
+        return False, (f"Memory growth: peak RSS {_size(refactored.peak_rss)} is {growth:.2f}x the original's "
+                       f"{_size(original.peak_rss)}, above the {budget:.2f}x budget (--max-memory-growth); "
+                       f"avoid per-thread copies of large arrays and allocations inside parallel loops")
+    return True, f"Peak RSS {growth:.2f}x the original's, within the {budget:.2f}x budget"
+
+
+def _size(n: Optional[float]) -> str:
+    if n is None:
+        return "-"
+    for unit in ("B", "KiB", "MiB", "GiB"):
+        if abs(n) < 1024 or unit == "GiB":
+            return f"{n:.0f} {unit}" if unit == "B" else f"{n:.1f} {unit}"
+        n /= 1024
+
+
+def _count(n: Optional[float]) -> str:
+    return f"{n:,.0f}" if n is not None else "-"
+
+
+def format_memory_report(original: MemoryUsage, refactored: MemoryUsage, verdict: str = "") -> str:
+    rows = [
+        ("peak RSS", _size(original.peak_rss), _size(refactored.peak_rss)),
+        ("peak live heap", _size(original.peak_heap), _size(refactored.peak_heap)),
+        ("allocations", _count(original.allocations), _count(refactored.allocations)),
+        ("allocated bytes", _size(original.bytes), _size(refactored.bytes)),
+        ("allocations/s", _count(original.allocation_rate), _count(refactored.allocation_rate)),
+        ("allocated/s", *(_size(u.byte_rate) + "/s" if u.byte_rate is not None else "-"
+                          for u in (original, refactored))),
+    ]
+    lines = ["=== Memory (one repeat) ===", f"{'':<18} {'Original':>14} {'Refactored':>14}"]
+    lines += [f"{name:<18} {a:>14} {b:>14}" for name, a, b in rows]
+    if original.allocations is None:
+        lines.append("Allocation counts need the LD_PRELOAD interposer (Linux, dynamically linked binaries)")
+    if "rusage" in (original.rss_source, refactored.rss_source):
+        lines.append("Peak RSS from wait4 rusage: includes the validator's RSS at spawn time")
+    if verdict:
+        lines.append(f"Memory gate: {verdict}")
+    return "\n".join(lines) + "\n"
+
+
+def memory_summary(original: MemoryUsage, refactored: MemoryUsage) -> Dict[str, object]:
+    return {"original": original.summary(), "refactored": refactored.summary(),
+            "rss_growth": memory_growth(original, refactored)}
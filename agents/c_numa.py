@@ -0,0 +1,213 @@
+"""
+NUMA placement for C kernels.
+Linux puts a page on the node of the thread that first writes it. Arrays that
+a serial loop initializes therefore all live on one socket, and a parallel
+kernel over them reads remotely from every other socket. This module finds
+initialization loops whose arrays a later loop sweeps, in the same function
+or in a callee that receives the arrays as arguments. Given the consumer's
+static schedule and thread binding, the initialization then touches each page
+from the thread that later reads it.
+
+It also reads the node topology from sysfs and turns the perf node-* counters
+(agents.c_perf_counters) into local and remote traffic for the validation report.
+"""
+
+import glob
+import os
+import re
+from dataclasses import dataclass
+from typing import Dict, List, Optional
+
+from pycparser import c_ast, c_generator
+
+from agents.c_ast_helpers import (CHEAP_MATH, LIBM, Renamer, array_base, for_loops, id_names, indexed_arrays,
+                                  loop_bound, loop_var, node_end_line, node_line)
+from agents.c_perf_counters import CACHE_LINE
+
+_NODE_DIR = "/sys/devices/system/node"
+
+
+@dataclass
+class FirstTouch:
+    line: int                             # initialization loop
+    end_line: int
+    function: str
+    arrays: List[str]                     # as named in the initializing function
+    consumer_line: int
+    consumer_function: str
+    consumer_header: str                  # "for (int i = 0; i < n; i++)", parameters renamed to the caller's names
+    same_space: bool                      # the two loops run over the same index range
+
+    def describe(self) -> str:
+        where = f"line {self.consumer_line}" + (f" ({self.consumer_function})" if self.consumer_function != self.function else "")
+        text = f"initializes {', '.join(self.arrays)} that the loop at {where} sweeps"
+        if self.same_space:
+            return text + "; same index range: give this loop the consumer's schedule(static) and proc_bind"
+        return (text + f"; the consumer iterates `{self.consumer_header}`: restructure this loop into the same "
+                       f"outer loop (or flatten both) so a static split hands each thread the rows it later reads")
+
+
+def _initialized(loop: c_ast.For) -> Optional[List[str]]:
+    """
+    Arrays a loop only stores to, indexed by its own iterator (nested loops
+    allowed), without reading any of them; None when the loop does anything else.
+    """
+    var = loop_var(loop)
+    if var is None:
+        return None
+    written, read = [], set()
+
+    def statement(node) -> bool:
+        if isinstance(node, c_ast.Compound):
+            return all(statement(s) for s in node.block_items or [])
+        if isinstance(node, c_ast.For):
+            return statement(node.stmt)
+        if isinstance(node, c_ast.Decl):
+            if node.init is not None:
+                read.update(indexed_arrays(node.init))
+            return expression(node.init) if node.init is not None else True
+        if isinstance(node, c_ast.Assignment) and node.op == "=" and isinstance(node.lvalue, c_ast.ArrayRef):
+            base = array_base(node.lvalue)
+            if base is None or var not in id_names(node.lvalue.subscript):
+                return False
+            if base not in written:
+                written.append(base)
+            read.update(indexed_arrays(node.rvalue))
+            return expression(node.rvalue)
+        if isinstance(node, c_ast.Assignment) and isinstance(node.lvalue, c_ast.ID):
+            read.update(indexed_arrays(node.rvalue))
+            return expression(node.rvalue)
+        return False
+
+    def expression(node) -> bool:
+        # Calls other than math functions may have side effects the placement would reorder
+        if isinstance(node, c_ast.FuncCall):
+            if not (isinstance(node.name, c_ast.ID) and node.name.name in LIBM | CHEAP_MATH):
+                return False
+        return all(expression(child) for _, child in node.children())
+
+    if not statement(loop.stmt) or not written or read & set(written):
+        return None
+    return written
+
+
+def _calls(node):
+    for _, child in node.children():
+        if isinstance(child, c_ast.FuncCall):
+            yield child
+        yield from _calls(child)
+
+
+def first_touch_loops(ast: c_ast.FileAST) -> List[FirstTouch]:
+    """Initialization loops paired with the first later loop that sweeps the same arrays."""
+    functions = {ext.decl.name: ext for ext in ast.ext if isinstance(ext, c_ast.FuncDef)}
+    generator = c_generator.CGenerator()
+    found = []
+    for name, fn in functions.items():
+        loops = list(for_loops(fn.body))
+        inits = []
+        for loop, within in loops:
+            # Report the outermost initializing loop of a nest only
+            if any(outer in inits for outer in within):
+                continue
+            arrays = _initialized(loop)
+            if arrays:
+                inits.append(loop)
+                consumer = _consumer(loop, arrays, name, fn, loops, functions, generator)
+                if consumer is not None:
+                    found.append(consumer)
+    return found
+
+
+def _consumer(init: c_ast.For, arrays: List[str], name: str, fn: c_ast.FuncDef, loops, functions,
+              generator) -> Optional[FirstTouch]:
+    # The first loop after the initialization (in this function, or in a callee handed the arrays) that
+    # indexes one of them and is not itself an initialization
+    end = node_end_line(init)
+    candidates = []
+    for loop, _ in loops:
+        if node_line(loop) > end and indexed_arrays(loop) & set(arrays) and _initialized(loop) is None:
+            candidates.append((node_line(loop), loop, name, {}))
+    for call in _calls(fn.body):
+        callee = functions.get(call.name.name) if isinstance(call.name, c_ast.ID) else None
+        if callee is None or node_line(call) <= end or callee.decl.type.args is None:
+            continue
+        params = [p.name for p in callee.decl.type.args.params if isinstance(p, c_ast.Decl)]
+        args = call.args.exprs if call.args else []
+        mapping = {p: generator.visit(a) for p, a in zip(params, args)}
+        passed = {p for p, a in zip(params, args) if isinstance(a, c_ast.ID) and a.name in arrays}
+        for loop, within in for_loops(callee.body):
+            if not within and indexed_arrays(loop) & passed:
+                candidates.append((node_line(call), loop, callee.decl.name, mapping))
+                break
+    if not candidates:
+        return None
+    _, loop, consumer_function, mapping = min(candidates, key=lambda c: c[0])
+    renamer = Renamer(mapping)
+    header = (f"for ({renamer.visit(loop.init) if loop.init else ''}; {renamer.visit(loop.cond) if loop.cond else ''}; "
+              f"{renamer.visit(loop.next) if loop.next else ''})")
+    consumed = indexed_arrays(loop)
+    touched = [a for a in arrays if a in consumed or any(mapping.get(p) == a for p in consumed)]
+    init_bound = loop_bound(init, generator)
+    consumer_bound = renamer.visit(loop.cond.right) if isinstance(loop.cond, c_ast.BinaryOp) else None
+    return FirstTouch(node_line(init), end, name, touched or arrays, node_line(loop), consumer_function, header,
+                      init_bound is not None and init_bound == consumer_bound)
+
+
+def _cpulist(text: str) -> List[int]:
+    cpus = []
+    for part in text.strip().split(","):
+        if "-" in part:
+            lo, hi = part.split("-")
+            cpus += range(int(lo), int(hi) + 1)
+        elif part:
+            cpus.append(int(part))
+    return cpus
+
+
+def numa_nodes() -> Dict[int, List[int]]:
+    """NUMA node -> CPUs, from sysfs; one node holding every CPU where sysfs has no node entries."""
+    nodes = {}
+    for path in glob.glob(os.path.join(_NODE_DIR, "node[0-9]*", "cpulist")):
+        node = int(re.search(r"node(\d+)", path).group(1))
+        try:
+            with open(path, encoding="utf-8") as f:
+                cpus = _cpulist(f.read())
+        except (OSError, ValueError):
+            continue
+        if cpus:
+            nodes[node] = cpus
+    return dict(sorted(nodes.items())) or {0: list(range(os.cpu_count() or 1))}
+
+
+def _ranges(cpus: List[int]) -> str:
+    parts, start = [], None
+    for i, cpu in enumerate(cpus):
+        if start is None:
+            start = cpu
+        if i + 1 == len(cpus) or cpus[i + 1] != cpu + 1:
+            parts.append(f"{start}-{cpu}" if cpu != start else str(cpu))
+            start = None
+    return ",".join(parts)
+
+
+def remote_traffic(counters) -> Optional[dict]:
+    """Local and remote DRAM load traffic (bytes/s) and the remote share, from perf node-loads/node-load-misses."""
+    loads, remote = counters.get("node-loads"), counters.get("node-load-misses")
+    if counters.remote_share is None or counters.elapsed <= 0:
+        return None
+    return {"local_bytes_per_s": (loads - remote) * CACHE_LINE / counters.elapsed,
+            "remote_bytes_per_s": remote * CACHE_LINE / counters.elapsed, "remote_share": counters.remote_share}
+
+
+def format_numa_report(nodes: Dict[int, List[int]], places: str, proc_bind: str,
+                       original=None, refactored=None) -> str:
+    lines = ["=== NUMA Placement ===",
+             f"{len(nodes)} node(s): " + "; ".join(f"node {n}: CPUs {_ranges(c)}" for n, c in nodes.items()),
+             f"Runs used OMP_PLACES={places} OMP_PROC_BIND={proc_bind} (proc_bind clauses in the code take precedence)"]
+    for label, counters in (("Original", original), ("Refactored", refactored)):
+        traffic = remote_traffic(counters) if counters is not None else None
+        if traffic is not None:
+            lines.append(f"{label + ':':<12}local {traffic['local_bytes_per_s'] / 1e9:.2f} GB/s, remote "
+                         f"{traffic['remote_bytes_per_s'] / 1e9:.2f} GB/s ({traffic['remote_share']:.0%} of node loads)")
+    return "\n".join(lines) + "\n"
@@ -0,0 +1,690 @@
+"""
+GPU offload planning and transfer accounting for C kernels (`omp target`).
+Analysis side: a function called from elsewhere whose loop nest (depth 2+)
+carries at least OFFLOAD_MIN_WORK_NS of host work is an offload kernel. Its
+arrays get map clauses: read-only ones `to`, write-only ones `from`, read and
+written ones `tofrom`, and temporaries allocated inside the kernel `alloc`. A temporary that more than one
+of the kernel's loops uses is mapped once by a `target data` around all of them:
+each target construct's own map(alloc:) would hand the next loop a fresh,
+uninitialized device buffer. Lengths come from the
+malloc/calloc of the caller's arrays. When a loop in the caller repeats the
+kernel (a time-step loop, not the harness repetition loop), the arrays can
+stay resident on the device in a `target data` region around that loop. The
+plan counts host<->device transfers both ways, with maps on every call and
+with the arrays resident.
+
+Validation side: the refactored code's target directives (data, enter/exit
+data, update and the target constructs' own maps) are replayed over the call
+graph and loop trip counts. The result is the number of transfers and bytes
+per timed repetition, plus warnings for pointers a target region uses without
+mapping. When the offload runtime writes a profile (LLVM libomptarget's
+LIBOMPTARGET_PROFILE) or debug trace (libgomp's GOMP_DEBUG), the measured
+transfers and their times are reported separately from kernel time.
+"""
+
+import json
+import os
+import re
+import subprocess
+import tempfile
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Set, Tuple
+
+from pycparser import c_ast, c_parser
+
+from agents.c_ast_helpers import (CHEAP_MATH, HARNESS_CALLS, LIBM, Renamer, array_base, balanced_parens,
+                                  collect_accesses, id_names, is_harness_loop, parse_with_pragmas, top_level_loops,
+                                  walk_nodes)
+from agents.c_cost_model import DEFAULT_OVERHEADS, Overheads, Unresolved
+from agents.c_roofline import IntensityEstimator
+from agents.c_validation_engine import CValidationConfig, compile_command, offload_flags, run_environment
+
+# Host work below which a kernel cannot pay for a launch plus its transfers
+OFFLOAD_MIN_WORK_NS = 1e6
+# Host<->device bandwidth assumed for transfer estimates (PCIe 4.0 x16, sustained)
+LINK_GBS = 12.0
+PROFILE_FILE = "offload_profile.json"
+_ALLOCATORS = {"malloc": 0, "calloc": None, "aligned_alloc": 1}
+_TARGET = re.compile(r"^\s*omp\s+target\b(.*)$", re.DOTALL)
+
+_toolchain_checked: Dict[Tuple[str, str], Optional[str]] = {}
+
+
+@dataclass
+class DeviceArray:
+    name: str
+    direction: str                        # "to", "from", "tofrom" or "alloc"
+    extent: Optional[str]                 # element count, e.g. "n * n"
+    bytes: Optional[float]
+
+    def section(self) -> str:
+        return f"{self.name}[0:{self.extent}]" if self.extent else self.name
+
+
+def map_clauses(arrays: List[DeviceArray]) -> List[str]:
+    """One map clause per direction: map(to: a[0:n], b[0:n]) map(from: c[0:n])."""
+    clauses = []
+    for direction in ("to", "from", "tofrom", "alloc"):
+        sections = [a.section() for a in arrays if a.direction == direction]
+        if sections:
+            clauses.append(f"map({direction}: {', '.join(sections)})")
+    return clauses
+
+
+@dataclass
+class OffloadKernel:
+    function: str
+    loops: List[int]                      # top-level loops that run on the device
+    arrays: List[DeviceArray]             # parameter names; lengths in the kernel's terms
+    work_ns: float
+    shared: List[str] = field(default_factory=list)   # alloc temporaries used by more than one loop
+
+    def pragma(self) -> str:
+        own = [a for a in self.arrays if a.name not in self.shared]
+        return " ".join(["#pragma omp target teams distribute parallel for", *map_clauses(own)])
+
+    def data_pragma(self) -> Optional[str]:
+        """The target data region around all of the kernel's loops that keeps shared temporaries alive."""
+        shared = [a for a in self.arrays if a.name in self.shared]
+        return " ".join(["#pragma omp target data", *map_clauses(shared)]) if shared else None
+
+
+@dataclass
+class Transfers:
+    to_device: int = 0
+    to_host: int = 0
+    bytes: float = 0.0
+    exact: bool = True                    # False when a length or trip count could not be resolved
+
+    def add(self, direction: str, nbytes: Optional[float], times: float = 1.0) -> None:
+        if direction in ("to", "tofrom"):
+            self.to_device += int(times)
+        if direction in ("from", "tofrom"):
+            self.to_host += int(times)
+        copies = {"to": 1, "from": 1, "tofrom": 2}.get(direction, 0)
+        if nbytes is None:
+            self.exact = self.exact and copies == 0
+        else:
+            self.bytes += copies * nbytes * times
+
+    def describe(self) -> str:
+        approx = "" if self.exact else "~"
+        return (f"{self.to_device} H->D + {self.to_host} D->H ({approx}{self.bytes / 1e6:.3g} MB, "
+                f"~{self.bytes / (LINK_GBS * 1e9) * 1e3:.2g} ms at {LINK_GBS:.0f} GB/s)")
+
+
+@dataclass
+class ResidencyRegion:
+    function: str
+    line: int                             # the loop that repeats the kernel calls
+    trips: Optional[float]
+    kernels: List[str]
+    arrays: List[DeviceArray]             # caller names and lengths
+    swapped: List[str]                    # pointers exchanged inside the loop
+    host_accesses: List[str]              # arrays the host touches between the kernel calls
+    per_call: Transfers = field(default_factory=Transfers)
+    resident: Transfers = field(default_factory=Transfers)
+
+    def pragma(self) -> str:
+        return " ".join(["#pragma omp target data", *map_clauses(self.arrays)])
+
+
+@dataclass
+class OffloadPlan:
+    kernels: Dict[str, OffloadKernel] = field(default_factory=dict)
+    regions: List[ResidencyRegion] = field(default_factory=list)
+    single_calls: Dict[str, Transfers] = field(default_factory=dict)   # kernels called outside a repeating loop
+
+
+def _strip_cast(node):
+    while isinstance(node, c_ast.Cast):
+        node = node.expr
+    return node
+
+
+def _allocation(fn: c_ast.FuncDef, var: str) -> Optional[c_ast.Node]:
+    """Element-count expression of `var = malloc(count * sizeof(T))` (or calloc(count, size)) in fn."""
+    found = []
+
+    def walk(n):
+        value = None
+        if isinstance(n, c_ast.Decl) and n.name == var and n.init is not None:
+            value = n.init
+        elif isinstance(n, c_ast.Assignment) and isinstance(n.lvalue, c_ast.ID) and n.lvalue.name == var:
+            value = n.rvalue
+        call = _strip_cast(value) if value is not None else None
+        if isinstance(call, c_ast.FuncCall) and isinstance(call.name, c_ast.ID) and call.name.name in _ALLOCATORS:
+            args = call.args.exprs if call.args else []
+            index = _ALLOCATORS[call.name.name]
+            if index is None and len(args) == 2:
+                found.append(args[0])
+            elif index is not None and index < len(args):
+                size = args[index]
+                if isinstance(size, c_ast.BinaryOp) and size.op == "*":
+                    for count, other in ((size.left, size.right), (size.right, size.left)):
+                        if isinstance(other, c_ast.UnaryOp) and other.op == "sizeof":
+                            found.append(count)
+        for _, child in n.children():
+            walk(child)
+    walk(fn.body)
+    return found[0] if len(found) == 1 else None
+
+
+def _nest_depth(loop: c_ast.For) -> int:
+    depth = 0
+
+    def walk(n, d):
+        nonlocal depth
+        if isinstance(n, c_ast.For):
+            d += 1
+            depth = max(depth, d)
+        for _, child in n.children():
+            walk(child, d)
+    walk(loop, 0)
+    return depth
+
+
+def _direction(array: str, read: Set[str], written: Set[str]) -> str:
+    """Write-only arrays need no copy to the device, read-only ones none back."""
+    if array not in written:
+        return "to"
+    return "tofrom" if array in read else "from"
+
+
+def _merge(a: str, b: str) -> str:
+    """The direction covering both kernels' maps of one array."""
+    return a if a == b else "tofrom"
+
+
+def _opaque_calls(node) -> bool:
+    """Calls a device cannot make (anything but libm)."""
+    if isinstance(node, c_ast.FuncCall):
+        if not (isinstance(node.name, c_ast.ID) and node.name.name in LIBM | CHEAP_MATH):
+            return True
+    return any(_opaque_calls(child) for _, child in node.children())
+
+
+class _Planner:
+    def __init__(self, ast: c_ast.FileAST, overheads: Overheads):
+        self.estimator = IntensityEstimator(ast)
+        self.functions = self.estimator.functions
+        self.overheads = overheads
+
+    def _bytes(self, count, function: str, name: str) -> Optional[float]:
+        try:
+            value, _ = self.estimator.value(count, function, {})
+        except (Unresolved, ValueError, OverflowError):
+            return None
+        return value * self.estimator.element_size(c_ast.ID(name), function)
+
+    def kernel(self, name: str) -> Optional[OffloadKernel]:
+        fn = self.functions[name]
+        loops = [loop for loop, _ in top_level_loops(fn)]
+        costs = [self.estimator.loop_cost(loop, name, self.overheads) for loop in loops]
+        heavy = [c for loop, c in zip(loops, costs)
+                 if _nest_depth(loop) >= 2 and c.work_ns and c.work_ns >= OFFLOAD_MIN_WORK_NS]
+        if not heavy or any(_opaque_calls(loop) for loop in loops):
+            return None
+        read, written = set(), set()
+        users: Dict[str, int] = {}
+        for loop in loops:
+            loop_read, loop_written = set(), set()
+            collect_accesses(loop, loop_read, loop_written)
+            for array in loop_read | loop_written:
+                users[array] = users.get(array, 0) + 1
+            read |= loop_read
+            written |= loop_written
+        params = self.estimator.params(name)
+        caller, args = self.estimator.calls[name][0]
+        arg_of = dict(zip(params, args))
+        # Caller variable -> parameter, to state the caller's allocation lengths in the kernel's terms
+        renames = {a.name: p for p, a in arg_of.items() if isinstance(a, c_ast.ID)}
+        arrays = []
+        for array in sorted(read | written, key=lambda a: (a not in params, a)):
+            local = _allocation(fn, array)
+            if array in params:
+                arg = arg_of.get(array)
+                count = _allocation(self.functions[caller], arg.name) if isinstance(arg, c_ast.ID) else None
+                extent = None
+                if count is not None and id_names(count) <= set(renames):
+                    extent = Renamer(renames).visit(count)
+                nbytes = self._bytes(count, caller, arg.name) if count is not None else None
+                arrays.append(DeviceArray(array, _direction(array, read, written), extent, nbytes))
+            elif local is not None:
+                arrays.append(DeviceArray(array, "alloc", self.estimator.generator.visit(local),
+                                          self._bytes(local, name, array)))
+            elif not _is_pointer(self.estimator, name, array):
+                # File-scope arrays map whole, without a section
+                arrays.append(DeviceArray(array, _direction(array, read, written), None, None))
+        shared = [a.name for a in arrays if a.direction == "alloc" and users.get(a.name, 0) > 1]
+        return OffloadKernel(name, [loop.coord.line for loop in loops], arrays, sum(c.work_ns or 0 for c in costs),
+                             shared)
+
+    def regions(self, kernels: Dict[str, OffloadKernel]) -> Tuple[List[ResidencyRegion], Dict[str, Transfers]]:
+        regions, single = {}, {}
+        for caller, fn in self.functions.items():
+            for call, stack in _calls_with_loops(fn.body):
+                name = call.name.name
+                if name not in kernels:
+                    continue
+                loop = stack[-1] if stack and not is_harness_loop(stack[-1]) else None
+                if loop is None:
+                    transfers = single.setdefault(name, Transfers())
+                    for array in kernels[name].arrays:
+                        transfers.add(array.direction, array.bytes)
+                    continue
+                regions.setdefault(id(loop), (caller, loop, []))[2].append(call)
+        return [self._region(caller, loop, calls, kernels) for caller, loop, calls in regions.values()], single
+
+    def _region(self, caller: str, loop: c_ast.For, calls, kernels) -> ResidencyRegion:
+        fn = self.functions[caller]
+        try:
+            trips, _, _ = self.estimator.trips(loop, caller, {})
+        except (Unresolved, ValueError, OverflowError):
+            trips = None
+        arrays: Dict[str, DeviceArray] = {}
+        per_call = Transfers()
+        for call in calls:
+            kernel = kernels[call.name.name]
+            args = dict(zip(self.estimator.params(kernel.function), call.args.exprs if call.args else []))
+            for array in kernel.arrays:
+                per_call.add(array.direction, array.bytes, trips or 1)
+                arg = args.get(array.name)
+                if array.direction == "alloc" or not isinstance(arg, c_ast.ID):
+                    continue
+                count = _allocation(fn, arg.name)
+                mine = arrays.get(arg.name)
+                direction = _merge(mine.direction, array.direction) if mine else array.direction
+                arrays[arg.name] = DeviceArray(arg.name, direction,
+                                               self.estimator.generator.visit(count) if count is not None else None,
+                                               array.bytes)
+        if trips is None:
+            per_call.exact = False
+        # Pointers exchanged between steps (ping-pong buffers) swap roles: both must come back to the host
+        swapped = sorted({n.lvalue.name for n in walk_nodes(loop.stmt) if isinstance(n, c_ast.Assignment)
+                          and isinstance(n.lvalue, c_ast.ID) and n.lvalue.name in arrays})
+        for name in swapped:
+            arrays[name].direction = "tofrom"
+        kernel_calls = {id(c) for c in calls}
+        host = set()
+        for node in walk_nodes(loop.stmt, skip=kernel_calls):
+            if isinstance(node, c_ast.ArrayRef) and array_base(node) in arrays:
+                host.add(array_base(node))
+            elif isinstance(node, c_ast.FuncCall) and node.args and isinstance(node.name, c_ast.ID) \
+                    and node.name.name not in HARNESS_CALLS:
+                host |= {a.name for a in node.args.exprs if isinstance(a, c_ast.ID) and a.name in arrays}
+        resident = Transfers()
+        for array in arrays.values():
+            resident.add(array.direction, array.bytes)
+        for name in host:
+            resident.add("from", arrays[name].bytes, trips or 1)
+        return ResidencyRegion(caller, loop.coord.line, trips, sorted({c.name.name for c in calls}),
+                               sorted(arrays.values(), key=lambda a: a.name), swapped, sorted(host),
+                               per_call, resident)
+
+
+def _calls_with_loops(node, stack=()):
+    """(call of a named function, enclosing for loops) for every call under node."""
+    for _, child in node.children():
+        if isinstance(child, c_ast.FuncCall) and isinstance(child.name, c_ast.ID):
+            yield child, stack
+        inner = stack + (child,) if isinstance(child, c_ast.For) else stack
+        yield from _calls_with_loops(child, inner)
+
+
+def offload_plan(ast: c_ast.FileAST, overheads: Optional[Overheads] = None) -> OffloadPlan:
+    planner = _Planner(ast, overheads or DEFAULT_OVERHEADS)
+    plan = OffloadPlan()
+    for name in planner.functions:
+        if name != "main" and planner.estimator.calls.get(name):
+            kernel = planner.kernel(name)
+            if kernel is not None:
+                plan.kernels[name] = kernel
+    plan.regions, plan.single_calls = planner.regions(plan.kernels)
+    return plan
+
+
+def describe_kernel(kernel: OffloadKernel, plan: OffloadPlan) -> str:
+    alloc = [a.name for a in kernel.arrays if a.direction == "alloc"]
+    text = (f"~{kernel.work_ns / 1e6:.3g} ms of host work; candidate type 'offload', recommendation target_teams: "
+            f"`{kernel.pragma()}` on each top-level loop of {kernel.function}")
+    own = [name for name in alloc if name not in kernel.shared]
+    if own:
+        text += f" ({', '.join(own)} allocated per call and used by one loop: map(alloc:) only)"
+    if kernel.shared:
+        text += (f"; {', '.join(kernel.shared)} carry values from one loop to the next: wrap all of "
+                 f"{kernel.function}'s loops in `{kernel.data_pragma()}` (or hoist them into the caller's target "
+                 "data), never map(alloc:) on each loop, which gives every target region a fresh device buffer")
+    unknown = [a.name for a in kernel.arrays if a.extent is None and a.direction != "alloc"]
+    if unknown:
+        text += f"; length of {', '.join(unknown)} not resolved from its allocation, state it in the map clause"
+    single = plan.single_calls.get(kernel.function)
+    if single is not None:
+        text += f"; called once per repetition: {single.describe()} per call"
+    return text
+
+
+def describe_region(region: ResidencyRegion) -> str:
+    trips = f"{region.trips:.0f}" if region.trips else "N"
+    text = (f"the loop repeats {', '.join(region.kernels)} {trips} times; recommendation target_data: wrap it in "
+            f"`{region.pragma()}` so the arrays stay on the device: {region.resident.describe()} per execution "
+            f"instead of {region.per_call.describe()} with maps on every call")
+    if region.swapped:
+        text += f"; {', '.join(region.swapped)} are exchanged inside the loop, so they are mapped tofrom " \
+                "(the device copies follow the host addresses)"
+    if region.host_accesses:
+        text += f"; the host touches {', '.join(region.host_accesses)} between calls: add " \
+                f"`#pragma omp target update from(...)` before that code or move it to the device"
+    return text
+
+
+# ---- transfer accounting on generated code ----------------------------------
+
+
+def _split_top(text: str, sep: str) -> List[str]:
+    parts, depth, current = [], 0, ""
+    for ch in text:
+        depth += ch in "([" and 1 or (ch in ")]" and -1 or 0)
+        if ch == sep and depth == 0:
+            parts.append(current)
+            current = ""
+        else:
+            current += ch
+    return parts + [current]
+
+
+def parse_clauses(directive: str) -> List[Tuple[str, List[str], bool, str]]:
+    """(kind, sections, always, clause) for every map/to/from clause of a target directive."""
+    found = []
+    for match in re.finditer(r"\b(map|to|from)\s*\(", directive):
+        body, _ = balanced_parens(directive, match.end() - 1)
+        clause = match.group(1)
+        kind, always = ("tofrom" if clause == "map" else clause), False
+        head, _, rest = body.partition(":") if ":" in body.split("[")[0] else ("", "", body)
+        if head:
+            words = [w.strip() for w in head.replace(",", " ").split()]
+            always = "always" in words
+            kind = next((w for w in words if w in ("to", "from", "tofrom", "alloc", "release", "delete")), kind)
+        found.append((kind, [s.strip() for s in _split_top(rest, ",") if s.strip()], always, clause))
+    return found
+
+
+@dataclass
+class TransferCount:
+    transfers: Transfers = field(default_factory=Transfers)
+    data_regions: int = 0
+    target_regions: int = 0
+    warnings: List[str] = field(default_factory=list)
+
+
+class _Replay:
+    """Replays target directives over the call graph from main; counts transfers per timed repetition."""
+
+    def __init__(self, ast: c_ast.FileAST):
+        self.estimator = IntensityEstimator(ast)
+        self.parser = c_parser.CParser()
+        self.result = TransferCount()
+        # (function, array) -> line of a target construct that mapped it alloc by itself
+        self.allocated: Dict[Tuple[str, str], object] = {}
+
+    def _section_bytes(self, section: str, function: str) -> Optional[float]:
+        name, _, rest = section.partition("[")
+        length = rest.rstrip("]").split(":")[-1] if ":" in rest else None
+        if not length:
+            return None
+        try:
+            expr = self.parser.parse(f"void __maap_len(void) {{ long __n = {length}; }}").ext[0].body.block_items[0].init
+            value, _ = self.estimator.value(expr, function, {})
+        except Exception:
+            return None
+        return value * self.estimator.element_size(c_ast.ID(name.strip()), function)
+
+    def _unstructured(self, directive: str, function: str, present: Set[str], times: float, phase: str) -> Set[str]:
+        """Transfers of `enter data` (phase "enter"), `exit data` ("exit") and `update` ("update"); returns the names."""
+        mapped = set()
+        for kind, sections, always, clause in parse_clauses(directive):
+            for section in sections:
+                name = section.split("[")[0].strip()
+                mapped.add(name)
+                if phase == "update":
+                    direction = clause
+                elif phase == "enter":
+                    direction = "to" if kind in ("to", "tofrom") and (name not in present or always) else ""
+                else:
+                    direction = "from" if kind in ("from", "tofrom") else ""
+                if direction:
+                    self.result.transfers.add(direction, self._section_bytes(section, function), times)
+        return mapped
+
+    def function(self, name: str, present: Set[str], times: float, stack=()):
+        fn = self.estimator.functions.get(name)
+        if fn is None or name in stack:
+            return
+        self.statement(fn.body, name, set(present), times, stack + (name,))
+
+    def statement(self, node, function: str, present: Set[str], times: float, stack):
+        if node is None:
+            return
+        if isinstance(node, c_ast.Compound):
+            items = node.block_items or []
+            i = 0
+            while i < len(items):
+                item = items[i]
+                match = _TARGET.match(item.string) if isinstance(item, c_ast.Pragma) else None
+                if match:
+                    directive = match.group(1)
+                    following = items[i + 1] if i + 1 < len(items) else None
+                    i += self.directive(directive, following, function, present, times, stack)
+                else:
+                    self.statement(item, function, present, times, stack)
+                i += 1
+            return
+        if isinstance(node, c_ast.For):
+            multiplier = 1.0
+            if not is_harness_loop(node):
+                try:
+                    multiplier, _, _ = self.estimator.trips(node, function, {})
+                except (Unresolved, ValueError, OverflowError, AttributeError):
+                    self.result.transfers.exact = False
+            self.statement(node.stmt, function, present, times * multiplier, stack)
+            return
+        if isinstance(node, c_ast.FuncCall) and isinstance(node.name, c_ast.ID):
+            callee = node.name.name
+            if callee in self.estimator.functions:
+                params = self.estimator.params(callee)
+                args = node.args.exprs if node.args else []
+                inner = {p for p, a in zip(params, args) if isinstance(a, c_ast.ID) and a.name in present}
+                self.function(callee, inner, times, stack)
+            return
+        for _, child in node.children():
+            self.statement(child, function, present, times, stack)
+
+    def directive(self, directive: str, following, function: str, present: Set[str], times: float, stack) -> int:
+        """Handles one target directive; returns 1 when it consumed the following statement."""
+        kind = directive.strip().split("(")[0].split()
+        if kind[:2] == ["enter", "data"]:
+            present |= self._unstructured(directive, function, present, times, "enter")
+            return 0
+        if kind[:2] == ["exit", "data"]:
+            present -= self._unstructured(directive, function, present, times, "exit")
+            return 0
+        if kind[:1] == ["update"]:
+            self._unstructured(directive, function, present, times, "update")
+            return 0
+        if kind[:1] == ["data"]:
+            self.result.data_regions += 1
+            mapped = self._entry_exit(directive, function, present, times)
+            self.statement(following, function, present | mapped, times, stack)
+            return 1
+        # A target construct: its maps, then the statement runs on the device
+        self.result.target_regions += 1
+        mapped = self._entry_exit(directive, function, present, times)
+        if following is not None:
+            read, written = set(), set()
+            collect_accesses(following, read, written)
+            pointers = {n for n in read | written if _is_pointer(self.estimator, function, n)}
+            missing = sorted(pointers - mapped - present)
+            line = following.coord.line if following.coord else "?"
+            if missing:
+                self.result.warnings.append(
+                    f"line {line} ({function}): {', '.join(missing)} used in a target region without a map clause "
+                    f"or an enclosing target data; the device sees a zero-length section")
+            for kind, sections, _, _ in parse_clauses(directive):
+                for name in (section.split("[")[0].strip() for section in sections):
+                    if kind != "alloc" or name in present:
+                        continue
+                    earlier = self.allocated.get((function, name))
+                    if earlier is not None and name in read:
+                        self.result.warnings.append(
+                            f"line {line} ({function}): {name} is map(alloc:) here and in the target region at line "
+                            f"{earlier}; its device buffer does not outlive a region, so this one reads uninitialized "
+                            f"memory: map it once in a target data around both")
+                    self.allocated[(function, name)] = line
+        return 1
+
+    def _entry_exit(self, directive: str, function: str, present: Set[str], times: float) -> Set[str]:
+        """Structured mapping: to-transfers on entry and from-transfers on exit for arrays not yet present."""
+        mapped = set()
+        for kind, sections, always, _ in parse_clauses(directive):
+            for section in sections:
+                name = section.split("[")[0].strip()
+                mapped.add(name)
+                if name in present and not always:
+                    continue
+                self.result.transfers.add(kind, self._section_bytes(section, function), times)
+        return mapped
+
+
+def _is_pointer(estimator: IntensityEstimator, function: str, name: str) -> bool:
+    fn = estimator.functions[function]
+    for node in walk_nodes(fn):
+        if isinstance(node, c_ast.Decl) and node.name == name:
+            return isinstance(node.type, c_ast.PtrDecl)
+    return False
+
+
+def count_transfers(code: str) -> Optional[TransferCount]:
+    """Host<->device transfers per timed repetition of the code's target directives; None when it does not parse."""
+    try:
+        ast = parse_with_pragmas(code)
+    except Exception:
+        return None
+    replay = _Replay(ast)
+    roots = ["main"] if "main" in replay.estimator.functions else \
+        [n for n in replay.estimator.functions if not replay.estimator.calls.get(n)]
+    for root in roots:
+        replay.function(root, set(), 1.0)
+    return replay.result
+
+
+# ---- toolchain and runtime profile ------------------------------------------
+
+def offload_toolchain(config: CValidationConfig) -> Optional[str]:
+    """None when `config.offload` code can be built here; otherwise the compiler's complaint (checked once)."""
+    key = (config.compiler, config.offload or "")
+    if not config.offload or config.offload == "host":
+        return None
+    if key not in _toolchain_checked:
+        with tempfile.TemporaryDirectory() as work_dir:
+            probe = os.path.join(work_dir, "offload_probe.c")
+            with open(probe, "w", encoding="utf-8") as f:
+                f.write("int main(void) { int x = 0;\n#pragma omp target map(tofrom: x)\nx = 1; return x - 1; }\n")
+            cmd = compile_command(config, probe, os.path.join(work_dir, "offload_probe"), openmp=True)
+            try:
+                proc = subprocess.run(cmd, capture_output=True, text=True, timeout=config.compile_timeout)
+                complaint = None if proc.returncode == 0 else (proc.stderr.strip().splitlines() or ["failed"])[0]
+            except (OSError, subprocess.SubprocessError) as e:
+                complaint = str(e)
+        _toolchain_checked[key] = complaint
+    return _toolchain_checked[key]
+
+
+@dataclass
+class MeasuredTransfers:
+    source: str                           # "libomptarget profile" or "GOMP_DEBUG"
+    to_device: int = 0
+    to_host: int = 0
+    to_device_s: Optional[float] = None
+    to_host_s: Optional[float] = None
+    kernel_s: Optional[float] = None
+    runs: int = 1                         # program repetitions the counts cover (warmup + repeats)
+
+
+def parse_profile(text: str, runs: int) -> Optional[MeasuredTransfers]:
+    """libomptarget's Chrome-trace profile: HostToDev/DevToHost events and kernel launches with durations (us)."""
+    try:
+        events = json.loads(text).get("traceEvents", [])
+    except (json.JSONDecodeError, AttributeError):
+        return None
+    result = MeasuredTransfers("libomptarget profile", to_device_s=0.0, to_host_s=0.0, kernel_s=0.0, runs=runs)
+    for event in events:
+        name, seconds = str(event.get("name", "")), float(event.get("dur", 0)) / 1e6
+        if "HostToDev" in name:
+            result.to_device += 1
+            result.to_device_s += seconds
+        elif "DevToHost" in name:
+            result.to_host += 1
+            result.to_host_s += seconds
+        elif name.startswith("Kernel") or "target exe" in name.lower():
+            result.kernel_s += seconds
+    return result if result.to_device or result.to_host or result.kernel_s else None
+
+
+def parse_gomp_debug(text: str, runs: int) -> Optional[MeasuredTransfers]:
+    """libgomp plugin trace lines (GOMP_DEBUG=1): counts host2dev/dev2host copies, no times."""
+    result = MeasuredTransfers("GOMP_DEBUG", runs=runs)
+    for line in text.splitlines():
+        lower = line.lower()
+        if "host2dev" in lower:
+            result.to_device += 1
+        elif "dev2host" in lower:
+            result.to_host += 1
+    return result if result.to_device or result.to_host else None
+
+
+def measure_transfers(work_dir: str, exe: str, config: CValidationConfig) -> Optional[MeasuredTransfers]:
+    """One profiled run of exe; None when the runtime offloaded nothing (host fallback)."""
+    env = run_environment(config)
+    profile = os.path.join(work_dir, PROFILE_FILE)
+    env.update({"LIBOMPTARGET_PROFILE": profile, "GOMP_DEBUG": "1"})
+    if os.path.exists(profile):
+        os.remove(profile)
+    try:
+        proc = subprocess.run([os.path.join(".", exe)], cwd=work_dir, env=env, capture_output=True, text=True,
+                              timeout=config.run_timeout)
+    except (OSError, subprocess.SubprocessError):
+        return None
+    runs = config.warmup + config.repeats
+    if os.path.exists(profile):
+        with open(profile, encoding="utf-8") as f:
+            measured = parse_profile(f.read(), runs)
+        if measured is not None:
+            return measured
+    return parse_gomp_debug(proc.stderr, runs)
+
+
+def format_offload_report(config: CValidationConfig, fallback: Optional[str], counted: Optional[TransferCount],
+                          measured: Optional[MeasuredTransfers]) -> str:
+    lines = ["=== Offload ==="]
+    target = config.offload
+    if fallback:
+        lines.append(f"Target {target}: toolchain not available ({fallback}); target regions were built and timed "
+                     f"as host fallback")
+    else:
+        lines.append(f"Target {target}: built with -fopenmp {' '.join(offload_flags(config.compiler, target))}")
+    if counted is not None:
+        lines.append(f"Directives: {counted.target_regions} target region(s), {counted.data_regions} target data "
+                     f"region(s)")
+        lines.append(f"Transfers per timed repetition (from the directives): {counted.transfers.describe()}")
+        lines += [f"WARNING: {w}" for w in counted.warnings]
+    if measured is not None:
+        per = max(measured.runs, 1)
+        lines.append(f"Measured ({measured.source}, per repetition): {measured.to_device / per:.0f} H->D, "
+                     f"{measured.to_host / per:.0f} D->H")
+        if measured.kernel_s is not None:
+            lines.append(f"  transfer time {(measured.to_device_s + measured.to_host_s) / per * 1e3:.3f} ms "
+                         f"(H->D {measured.to_device_s / per * 1e3:.3f}, D->H {measured.to_host_s / per * 1e3:.3f}), "
+                         f"kernel time {measured.kernel_s / per * 1e3:.3f} ms")
+    elif not fallback:
+        lines.append("Measured: no device activity recorded (no profile from the runtime, or no device present)")
+    return "\n".join(lines) + "\n"
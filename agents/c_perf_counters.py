@@ -0,0 +1,206 @@
+"""
+Hardware performance counters for validated C binaries.
+Runs the original and refactored binaries once more under `perf stat` and
+collects cycles, instructions, cache and LLC misses, context switches and CPU
+migrations, and the node-* events that split DRAM loads into local and remote
+nodes. Memory traffic is estimated from LLC misses (one 64-byte line
+each), so it needs no uncore events. The two counter sets are compared into a
+short diagnosis ("memory-bound, 90% LLC miss rate") that goes to report.txt
+and, on a retry, to the implementer.
+
+perf is optional: when it is missing or perf_event_paranoid forbids the
+events, no counters are reported and validation is unaffected.
+"""
+
+import shutil
+import subprocess
+import time
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional
+
+from agents.c_validation_engine import CValidationConfig, pinned, run_environment
+
+PERF_EVENTS = ["cycles", "instructions", "cache-references", "cache-misses", "LLC-loads", "LLC-load-misses",
+               "LLC-stores", "LLC-store-misses", "node-loads", "node-load-misses", "context-switches",
+               "cpu-migrations", "task-clock"]
+CACHE_LINE = 64
+
+# Diagnosis thresholds
+MEMORY_BOUND_MISS_RATE = 0.5
+MEMORY_BOUND_MPKI = 10.0
+INSTRUCTION_OVERHEAD = 1.3
+LOW_UTILIZATION = 0.6
+REMOTE_LOADS = 0.25
+
+
+@dataclass
+class CounterSet:
+    counts: Dict[str, float] = field(default_factory=dict)
+    unsupported: List[str] = field(default_factory=list)
+    elapsed: float = 0.0                  # wall time of the counted run (warmup + repeats), seconds
+    threads: int = 1
+
+    def get(self, event: str) -> Optional[float]:
+        return self.counts.get(event)
+
+    @property
+    def ipc(self) -> Optional[float]:
+        cycles, instructions = self.get("cycles"), self.get("instructions")
+        return instructions / cycles if cycles and instructions is not None else None
+
+    @property
+    def llc_miss_rate(self) -> Optional[float]:
+        loads, misses = self.get("LLC-loads"), self.get("LLC-load-misses")
+        if not loads or misses is None:
+            loads, misses = self.get("cache-references"), self.get("cache-misses")
+        return misses / loads if loads and misses is not None else None
+
+    @property
+    def mpki(self) -> Optional[float]:
+        """LLC misses per thousand instructions."""
+        misses = self.get("LLC-load-misses") if self.get("LLC-load-misses") is not None else self.get("cache-misses")
+        instructions = self.get("instructions")
+        return misses * 1000.0 / instructions if instructions and misses is not None else None
+
+    @property
+    def bandwidth(self) -> Optional[float]:
+        """Estimated DRAM traffic in bytes/s: LLC load + store misses x one cache line."""
+        misses = [self.get(e) for e in ("LLC-load-misses", "LLC-store-misses") if self.get(e) is not None]
+        if not misses and self.get("cache-misses") is not None:
+            misses = [self.get("cache-misses")]
+        return sum(misses) * CACHE_LINE / self.elapsed if misses and self.elapsed > 0 else None
+
+    @property
+    def remote_share(self) -> Optional[float]:
+        """Share of node-level loads served by another NUMA node."""
+        loads, remote = self.get("node-loads"), self.get("node-load-misses")
+        return min(remote / loads, 1.0) if loads and remote is not None else None
+
+    @property
+    def cpus_busy(self) -> Optional[float]:
+        """Average number of CPUs running the program (task-clock / wall time)."""
+        task_ms = self.get("task-clock")
+        return task_ms / 1000.0 / self.elapsed if task_ms is not None and self.elapsed > 0 else None
+
+    def summary(self) -> dict:
+        return {**self.counts, "unsupported": self.unsupported, "elapsed": self.elapsed, "ipc": self.ipc,
+                "llc_miss_rate": self.llc_miss_rate, "mpki": self.mpki, "bandwidth_bytes_per_s": self.bandwidth,
+                "remote_share": self.remote_share, "cpus_busy": self.cpus_busy}
+
+
+def perf_available() -> bool:
+    return shutil.which("perf") is not None
+
+
+def parse_perf_csv(text: str) -> CounterSet:
+    """
+    Parses `perf stat -x,` output: value,unit,event,run-time,percent[,metric,unit].
+    Event modifiers (cycles:u) are dropped; "<not supported>"/"<not counted>" go to unsupported.
+    """
+    result = CounterSet()
+    for line in text.splitlines():
+        fields = line.strip().split(",")
+        if len(fields) < 3 or not fields[2]:
+            continue
+        value, event = fields[0].strip(), fields[2].split(":")[0].strip()
+        if event not in PERF_EVENTS:
+            continue
+        try:
+            result.counts[event] = float(value)
+        except ValueError:
+            result.unsupported.append(event)
+    return result
+
+
+def collect_counters(work_dir: str, exe: str, config: CValidationConfig, threads: Optional[int] = None,
+                     events: Optional[List[str]] = None) -> Optional[CounterSet]:
+    """One counted run of exe (same environment and CPU set as the timed runs); None without perf."""
+    if not perf_available():
+        return None
+    out = "perf_counters.csv"
+    cmd = ["perf", "stat", "-x,", "-o", out, "-e", ",".join(events or PERF_EVENTS), "--", f"./{exe}"]
+    start = time.perf_counter()
+    try:
+        proc = subprocess.run(pinned(cmd, config.cpus), cwd=work_dir, env=run_environment(config, threads),
+                              capture_output=True, text=True, timeout=config.run_timeout)
+        elapsed = time.perf_counter() - start
+        with open(f"{work_dir}/{out}", encoding="utf-8") as f:
+            text = f.read()
+    except (OSError, subprocess.SubprocessError):
+        return None
+    if proc.returncode != 0:
+        return None
+    counters = parse_perf_csv(text)
+    if not counters.counts:
+        return None
+    # Counts cover the whole process, so rates use the process wall time rather than the harness median
+    counters.elapsed = elapsed
+    counters.threads = threads or config.threads()
+    return counters
+
+
+def diagnose(original: CounterSet, refactored: CounterSet, speedup: Optional[float]) -> List[str]:
+    """Short causes for a weak or negative speedup, most specific first."""
+    notes = []
+    rate, mpki = refactored.llc_miss_rate, refactored.mpki
+    if rate is not None and mpki is not None and rate >= MEMORY_BOUND_MISS_RATE and mpki >= MEMORY_BOUND_MPKI:
+        bandwidth = refactored.bandwidth
+        traffic = f", ~{bandwidth / 1e9:.1f} GB/s from DRAM" if bandwidth else ""
+        notes.append(f"memory-bound: {rate:.0%} LLC miss rate, {mpki:.1f} misses per 1000 instructions{traffic}; "
+                     f"more threads cannot help, reduce traffic (tiling, fusion, smaller types)")
+    remote = refactored.remote_share
+    if remote is not None and remote >= REMOTE_LOADS:
+        notes.append(f"NUMA: {remote:.0%} of DRAM loads come from a remote node; initialize the arrays in parallel "
+                     f"with the consumer loop's static schedule (first touch) and bind threads with proc_bind")
+    if original.get("instructions") and refactored.get("instructions"):
+        growth = refactored.get("instructions") / original.get("instructions")
+        if growth >= INSTRUCTION_OVERHEAD:
+            notes.append(f"parallel overhead: {growth:.1f}x the instructions of the original "
+                         f"(spin-waiting at barriers, scheduling or redundant work)")
+    busy = refactored.cpus_busy
+    if busy is not None and refactored.threads > 1 and busy < LOW_UTILIZATION * refactored.threads:
+        notes.append(f"only {busy:.1f} of {refactored.threads} CPUs busy on average: serial sections, "
+                     f"load imbalance or a region too small to use every thread")
+    if original.ipc and refactored.ipc and refactored.ipc < 0.6 * original.ipc:
+        notes.append(f"IPC fell from {original.ipc:.2f} to {refactored.ipc:.2f}: threads stall on memory or "
+                     f"contended cache lines (false sharing, shared accumulators)")
+    migrations = refactored.get("cpu-migrations")
+    if migrations and migrations > 10 * max(refactored.threads, 1):
+        notes.append(f"{migrations:.0f} CPU migrations: threads are not staying on their cores")
+    if not notes and speedup is not None and speedup < 1.0:
+        notes.append("counters show no memory or utilization limit; the parallel region likely costs more than "
+                     "the work it splits")
+    return notes
+
+
+def _count(value: Optional[float]) -> str:
+    if value is None:
+        return "-"
+    for unit, scale in (("G", 1e9), ("M", 1e6), ("K", 1e3)):
+        if abs(value) >= scale:
+            return f"{value / scale:.2f}{unit}"
+    return f"{value:.0f}"
+
+
+def format_counter_report(original: CounterSet, refactored: CounterSet, diagnosis: List[str]) -> str:
+    rows = [
+        ("cycles", _count(original.get("cycles")), _count(refactored.get("cycles"))),
+        ("instructions", _count(original.get("instructions")), _count(refactored.get("instructions"))),
+        ("IPC", *(f"{c.ipc:.2f}" if c.ipc else "-" for c in (original, refactored))),
+        ("LLC miss rate", *(f"{c.llc_miss_rate:.1%}" if c.llc_miss_rate is not None else "-"
+                            for c in (original, refactored))),
+        ("LLC MPKI", *(f"{c.mpki:.1f}" if c.mpki is not None else "-" for c in (original, refactored))),
+        ("DRAM GB/s (est.)", *(f"{c.bandwidth / 1e9:.2f}" if c.bandwidth else "-" for c in (original, refactored))),
+        ("Remote node loads", *(f"{c.remote_share:.1%}" if c.remote_share is not None else "-"
+                                for c in (original, refactored))),
+        ("CPUs busy", *(f"{c.cpus_busy:.2f}" if c.cpus_busy is not None else "-" for c in (original, refactored))),
+        ("context switches", _count(original.get("context-switches")), _count(refactored.get("context-switches"))),
+        ("CPU migrations", _count(original.get("cpu-migrations")), _count(refactored.get("cpu-migrations"))),
+    ]
+    lines = ["=== Hardware Counters (perf stat) ===", f"{'':<18} {'Original':>12} {'Refactored':>12}"]
+    lines += [f"{name:<18} {a:>12} {b:>12}" for name, a, b in rows]
+    unsupported = sorted(set(original.unsupported) | set(refactored.unsupported))
+    if unsupported:
+        lines.append(f"Not supported here: {', '.join(unsupported)}")
+    lines += [f"Diagnosis: {note}" for note in diagnosis]
+    return "\n".join(lines) + "\n"
@@ -0,0 +1,254 @@
+"""
+Streaming loops that read a block, process it and write it out on every
+iteration. Each iteration starts by waiting for its read and ends by waiting
+for its write, so the compute stage never overlaps I/O. The iterations are
+not independent either: the read stage carries the stream position (often a
+partial-line remainder too) into the next iteration, and the writes must
+keep their order. A parallel for therefore does not apply. These loops are
+turned into a pipeline of tasks:
+  - read: depend(inout: the reader state) depend(out: slot), so reads stay in order;
+  - process: depend(inout: slot), free to run next to the reads and writes of other slots;
+  - write: depend(in: slot) depend(inout: the writer state), so output stays in input order.
+The block buffers become a ring of two or more slots (double buffering). This
+module finds the stages, the state carried between iterations, and the
+buffers each slot needs its own copy of.
+"""
+
+from dataclasses import dataclass, field
+from typing import List, Optional, Set
+
+from pycparser import c_ast, c_generator
+
+from agents.c_ast_helpers import id_names, indexed_arrays, node_end_line, node_line
+
+INPUT_CALLS = {"fread", "read", "pread", "fgets", "getline", "getdelim", "fscanf", "recv"}
+OUTPUT_CALLS = {"fwrite", "write", "pwrite", "fputs", "fprintf", "fputc", "send"}
+# Buffer bookkeeping between stages (carrying a remainder over), not a stage of its own
+_BOOKKEEPING = {"memmove", "memcpy", "memset"}
+
+
+@dataclass
+class PipelineStage:
+    kind: str                             # read | process | write
+    line: int
+    end_line: int
+    calls: List[str] = field(default_factory=list)
+
+    def describe(self) -> str:
+        lines = f"line {self.line}" if self.end_line == self.line else f"lines {self.line}-{self.end_line}"
+        return f"{self.kind} {lines}" + (f" ({', '.join(self.calls)})" if self.calls else "")
+
+
+@dataclass
+class Pipeline:
+    line: int
+    end_line: int
+    function: str
+    stages: List[PipelineStage]
+    streams: List[str]                    # handles the reads and writes go through
+    carried: List[str]                    # written in one iteration, read by the next one's read stage
+    buffers: List[str]                    # filled by one stage, consumed by a later one: one copy per slot
+    scratch: List[str]                    # local arrays only the process stage uses: one copy per slot too
+    accumulated: List[str]                # running totals of the later stages
+
+    def describe(self) -> str:
+        return " -> ".join(stage.describe() for stage in self.stages)
+
+
+def _calls(node) -> List[str]:
+    found = []
+
+    def walk(n):
+        if isinstance(n, c_ast.FuncCall) and isinstance(n.name, c_ast.ID) and n.name.name not in found:
+            found.append(n.name.name)
+        for _, child in n.children():
+            walk(child)
+    walk(node)
+    return found
+
+
+def _has_loop(node) -> bool:
+    if isinstance(node, (c_ast.For, c_ast.While, c_ast.DoWhile)):
+        return True
+    return any(_has_loop(child) for _, child in node.children())
+
+
+def _kind(statement) -> Optional[str]:
+    """read, write or process; None for bookkeeping (declarations, counters, remainder moves, exits)."""
+    calls = set(_calls(statement))
+    if calls & INPUT_CALLS:
+        return "read"
+    if calls & OUTPUT_CALLS:
+        return "write"
+    if _has_loop(statement) or calls - _BOOKKEEPING:
+        return "process"
+    return None
+
+
+def _written(node) -> Set[str]:
+    """Scalars assigned (through a pointer too) and buffers filled by a call such as memmove(buf, ...)."""
+    names = set()
+
+    def target(n):
+        while isinstance(n, (c_ast.UnaryOp, c_ast.ArrayRef, c_ast.StructRef)):
+            n = n.expr if isinstance(n, c_ast.UnaryOp) else n.name
+        if isinstance(n, c_ast.ID):
+            names.add(n.name)
+
+    def walk(n):
+        if isinstance(n, c_ast.Assignment):
+            target(n.lvalue)
+        elif isinstance(n, c_ast.UnaryOp) and n.op in ('++', '--', 'p++', 'p--'):
+            target(n.expr)
+        elif isinstance(n, c_ast.Decl) and n.name and n.init is not None:
+            names.add(n.name)
+        elif isinstance(n, c_ast.FuncCall) and isinstance(n.name, c_ast.ID) \
+                and n.name.name in _BOOKKEEPING | {"fread", "read", "pread"} and n.args and n.args.exprs:
+            first = n.args.exprs[0]
+            while isinstance(first, c_ast.BinaryOp):
+                first = first.left
+            target(first)
+        for _, child in n.children():
+            walk(child)
+    walk(node)
+    return names
+
+
+def _accumulated(node) -> Set[str]:
+    names = set()
+
+    def walk(n):
+        if isinstance(n, c_ast.Assignment) and n.op in ('+=', '-='):
+            lvalue = n.lvalue.expr if isinstance(n.lvalue, c_ast.UnaryOp) and n.lvalue.op == '*' else n.lvalue
+            if isinstance(lvalue, c_ast.ID):
+                names.add(lvalue.name)
+        for _, child in n.children():
+            walk(child)
+    walk(node)
+    return names
+
+
+def _pointers(fn: c_ast.FuncDef) -> Set[str]:
+    names = set()
+
+    def walk(n):
+        if isinstance(n, c_ast.Decl) and n.name and isinstance(n.type, (c_ast.PtrDecl, c_ast.ArrayDecl)):
+            names.add(n.name)
+        for _, child in n.children():
+            walk(child)
+    walk(fn.decl)
+    walk(fn.body)
+    return names
+
+
+def _streams(statements, calls) -> List[str]:
+    """Handle arguments of the I/O calls: the FILE* or descriptor (last for fread/fwrite, first for read/write)."""
+    generator = c_generator.CGenerator()
+    found = []
+
+    def walk(n):
+        if isinstance(n, c_ast.FuncCall) and isinstance(n.name, c_ast.ID) and n.name.name in calls and n.args:
+            args = n.args.exprs
+            handle = args[-1] if n.name.name in ("fread", "fwrite", "fgets", "fputs", "fputc") else args[0]
+            text = generator.visit(handle)
+            if text not in found:
+                found.append(text)
+        for _, child in n.children():
+            walk(child)
+    for statement in statements:
+        walk(statement)
+    return found
+
+
+def _pipeline(loop, function: c_ast.FuncDef) -> Optional[Pipeline]:
+    body = loop.stmt
+    statements = (body.block_items or []) if isinstance(body, c_ast.Compound) else [body]
+    stages: List[PipelineStage] = []
+    members: List[list] = []
+    for statement in statements:
+        kind = _kind(statement)
+        if kind is None:
+            continue
+        if stages and stages[-1].kind == kind:
+            stages[-1].end_line = node_end_line(statement)
+            stages[-1].calls += [c for c in _calls(statement) if c not in stages[-1].calls]
+            members[-1].append(statement)
+        else:
+            stages.append(PipelineStage(kind, node_line(statement), node_end_line(statement), _calls(statement)))
+            members.append([statement])
+    kinds = [s.kind for s in stages]
+    if "read" not in kinds or "write" not in kinds:
+        return None
+    first_read, last_write = kinds.index("read"), len(kinds) - 1 - kinds[::-1].index("write")
+    if "process" not in kinds[first_read:last_write]:
+        return None
+    for stage in stages:
+        stage.calls = [c for c in stage.calls if c not in _BOOKKEEPING]
+
+    pointers = _pointers(function)
+    written = set().union(*(_written(s) for s in statements))
+    read_ids = set().union(*(id_names(s) for s in members[first_read]))
+    streams = _streams(statements, INPUT_CALLS | OUTPUT_CALLS)
+    carried = sorted((written & read_ids) - set(streams))
+    used_by = []
+    for group in members:
+        used = set()
+        for statement in group:
+            used |= indexed_arrays(statement) | (id_names(statement) & pointers)
+        used_by.append(used)
+    buffers = sorted({name for k, used in enumerate(used_by) for name in used
+                      if any(name in later for later in used_by[k + 1:])} - set(streams))
+    params = {p.name for p in (function.decl.type.args.params if function.decl.type.args else [])
+              if isinstance(p, c_ast.Decl)}
+    scratch = sorted(set().union(*(used for stage, used in zip(stages, used_by) if stage.kind == "process"))
+                     - set(buffers) - params)
+    later = [s for group in members[first_read + 1:] for s in group]
+    tail = [s for s in statements if _kind(s) is None and node_line(s) > stages[first_read].end_line]
+    accumulated = sorted(set().union(*(_accumulated(s) for s in later + tail)) - read_ids)
+    return Pipeline(node_line(loop), node_end_line(loop), function.decl.name, stages, streams, carried, buffers, scratch,
+                    accumulated)
+
+
+def streaming_pipelines(ast: c_ast.FileAST) -> List[Pipeline]:
+    """Loops (for, while, do) whose body reads, then processes, then writes, outermost first."""
+    found = []
+
+    def walk(node, function):
+        if isinstance(node, (c_ast.For, c_ast.While, c_ast.DoWhile)):
+            pipeline = _pipeline(node, function)
+            if pipeline is not None:
+                found.append(pipeline)
+                return
+        for _, child in node.children():
+            walk(child, function)
+    for ext in ast.ext:
+        if isinstance(ext, c_ast.FuncDef):
+            walk(ext.body, ext)
+    return found
+
+
+def format_pipelines(pipelines: List[Pipeline]) -> str:
+    if not pipelines:
+        return ""
+    report = f"Found {len(pipelines)} streaming pipeline loop(s) (read -> process -> write per iteration, " \
+             "I/O never overlaps compute):\n\n"
+    for i, p in enumerate(pipelines, 1):
+        streams = ", ".join(p.streams) or "the I/O handles"
+        report += f"--- Pipeline {i} ---\n"
+        report += f"  Lines: {p.line} to {p.end_line} ({p.function})\n"
+        report += f"  Stages: {p.describe()}\n"
+        report += f"  Streams: {streams} (reads and writes stay in iteration order)\n"
+        if p.carried:
+            report += f"  Carried State: {', '.join(p.carried)} (the next read needs them: keep in the reader task)\n"
+        if p.buffers:
+            report += f"  Stage Buffers: {', '.join(p.buffers)} (one copy per ring slot)\n"
+        if p.scratch:
+            report += f"  Process Scratch: {', '.join(p.scratch)} (one copy per ring slot, so slots compute at once)\n"
+        if p.accumulated:
+            report += f"  Accumulated: {', '.join(p.accumulated)} (sum in the ordered writer task or per slot)\n"
+        report += "  Candidate type 'pipeline'. Suggested OpenMP structure (NBUF >= 2 slots):\n"
+        report += "    #pragma omp parallel + #pragma omp single around the loop\n"
+        report += "    #pragma omp task depend(inout: reader) depend(out: slot[k % NBUF])   /* read */\n"
+        report += "    #pragma omp task depend(inout: slot[k % NBUF])                       /* process */\n"
+        report += "    #pragma omp task depend(in: slot[k % NBUF]) depend(inout: writer)    /* write */\n\n"
+    return report
@@ -0,0 +1,264 @@
+"""
+Runtime profile of the original C program, taken before the analyzer runs.
+The static report weighs every loop the same. An initialization loop in
+main or a sortedness check then gets as much LLM attention as the kernel,
+and as many validation retries. This stage builds the original with
+instrumentation and runs it once, with the harness settings the validator
+times it under. Each line's weight is collected in one of two ways:
+  - perf sampling (`perf record`, lines from the -g debug info) when perf is
+    allowed to sample here;
+  - otherwise, gcov line execution counts (`--coverage`, `gcov --json-format`).
+Weights are summed over each loop's line range. The code of functions called
+from inside a loop counts toward that loop, split across call sites by how
+often each site runs. A loop's share of the runtime p bounds what
+parallelizing it alone can gain (Amdahl: 1 / ((1 - p) + p / N) on N
+threads). Loops under COLD_SHARE are reported as cold, and the analyzer's
+candidates that only cover cold loops are dropped.
+"""
+
+import glob
+import json
+import os
+import re
+import shutil
+import subprocess
+import time
+from dataclasses import asdict, dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+from pycparser import c_ast
+
+from agents.c_ast_helpers import for_loops, is_harness_loop, node_end_line, node_line
+from agents.c_perf_counters import perf_available
+from agents.c_validation_engine import CValidationConfig, compile_c, exe_name, pinned, run_binary, run_environment
+
+PROFILE_DIR = "profile"
+PROFILED = "profiled.c"
+GCOV_FLAGS = ["-O1", "-g", "--coverage", "-fno-inline"]
+PERF_FLAGS = ["-O2", "-g", "-fno-omit-frame-pointer", "-fno-inline"]
+PERF_FREQUENCY = 1999                 # samples per second
+COLD_SHARE = 0.02                     # loops below this share of the runtime are left alone
+TOP_LOOPS = 8                         # loops listed in the report's profile block
+_SRCLINE = re.compile(r"^\s*([\d.]+)%\s+(\S+?):(\d+)\b")
+
+
+@dataclass
+class LoopShare:
+    line: int
+    end_line: int
+    function: str
+    depth: int                            # 0 for an outermost loop
+    share: float                          # of the profiled run, callees included
+    amdahl: float                         # speedup bound when only this loop runs in parallel
+
+
+@dataclass
+class Profile:
+    method: str                           # "perf" (sampled time) or "gcov" (line execution counts)
+    threads: int                          # N of the Amdahl bounds
+    seconds: float                        # wall time of the profiled run
+    loops: List[LoopShare] = field(default_factory=list)
+    functions: Dict[str, float] = field(default_factory=dict)   # function -> share of its own lines
+
+    @classmethod
+    def from_dict(cls, d: dict) -> "Profile":
+        return cls(**{**d, "loops": [LoopShare(**l) for l in d.get("loops", [])]})
+
+    def at(self, line: int) -> Optional[LoopShare]:
+        return next((l for l in self.loops if l.line == line), None)
+
+    def remapped(self, line_map: List[int]) -> "Profile":
+        """The same profile in the line numbers of a view (line_map: view line - 1 -> source line)."""
+        view_line = {source: i for i, source in enumerate(line_map, 1)}
+        loops = [LoopShare(**{**asdict(l), "line": view_line[l.line],
+                              "end_line": view_line.get(l.end_line, view_line[l.line])})
+                 for l in self.loops if l.line in view_line]
+        return Profile(self.method, self.threads, self.seconds, loops, dict(self.functions))
+
+
+def amdahl(share: float, threads: int) -> float:
+    return 1.0 / ((1.0 - share) + share / max(threads, 1))
+
+
+def _gcov_weights(work_dir: str) -> Dict[str, Dict[int, float]]:
+    """file -> line -> execution count, from every .gcda in work_dir."""
+    weights = {}
+    for gcda in glob.glob(os.path.join(work_dir, "*.gcda")):
+        proc = subprocess.run(["gcov", "--json-format", "--stdout", os.path.basename(gcda)], cwd=work_dir,
+                              capture_output=True, text=True, timeout=120)
+        if proc.returncode != 0:
+            continue
+        for text in proc.stdout.splitlines():
+            try:
+                data = json.loads(text)
+            except json.JSONDecodeError:
+                continue
+            for entry in data.get("files", []):
+                lines = weights.setdefault(os.path.basename(entry["file"]), {})
+                for line in entry.get("lines", []):
+                    lines[line["line_number"]] = lines.get(line["line_number"], 0.0) + float(line["count"])
+    return weights
+
+
+def _perf_weights(work_dir: str, exe: str, config: CValidationConfig, env) -> Optional[Dict[str, Dict[int, float]]]:
+    """file -> line -> percent of the samples; None when perf cannot sample here."""
+    record = ["perf", "record", "-q", "-F", str(PERF_FREQUENCY), "-o", "perf.data", "--", f"./{exe}"]
+    try:
+        proc = subprocess.run(pinned(record, config.cpus), cwd=work_dir, env=env, capture_output=True, text=True,
+                              timeout=config.run_timeout)
+        if proc.returncode != 0:
+            return None
+        report = subprocess.run(["perf", "report", "-i", "perf.data", "--stdio", "-q", "--no-children",
+                                 "--sort", "srcline"], cwd=work_dir, capture_output=True, text=True, timeout=300)
+    except (OSError, subprocess.SubprocessError):
+        return None
+    weights = {}
+    for text in report.stdout.splitlines():
+        match = _SRCLINE.match(text)
+        if match:
+            lines = weights.setdefault(os.path.basename(match.group(2)), {})
+            line = int(match.group(3))
+            lines[line] = lines.get(line, 0.0) + float(match.group(1))
+    return weights or None
+
+
+def _calls(fn: c_ast.FuncDef, functions) -> List[Tuple[int, str]]:
+    sites = []
+
+    def walk(node):
+        if isinstance(node, c_ast.FuncCall) and isinstance(node.name, c_ast.ID) and node.name.name in functions:
+            sites.append((node_line(node), node.name.name))
+        for _, child in node.children():
+            walk(child)
+    walk(fn.body)
+    return sites
+
+
+def attribute(ast: c_ast.FileAST, lines: Dict[int, float], total: float, counted: bool,
+              method: str, threads: int, seconds: float) -> Profile:
+    """
+    Loop and function shares from per-line weights of the source file. With
+    execution counts (counted), a callee's time is split across its call sites in
+    proportion to how often each ran; with samples, evenly. The harness repetition
+    loop gets no share; the loops inside it count as outermost.
+    """
+    functions = {ext.decl.name: ext for ext in ast.ext if isinstance(ext, c_ast.FuncDef)}
+    spans = {name: (node_line(fn), node_end_line(fn)) for name, fn in functions.items()}
+    span_weight = lambda lo, hi: sum(w for l, w in lines.items() if lo <= l <= hi)
+    sites = {name: _calls(fn, functions) for name, fn in functions.items()}
+    site_weight = lambda line: lines.get(line, 0.0) if counted else 1.0
+    # Recursive calls stay inside the callee's own lines; only calls from elsewhere share out its time
+    incoming = {}
+    for caller, calls in sites.items():
+        for line, callee in calls:
+            if callee != caller:
+                incoming[callee] = incoming.get(callee, 0.0) + site_weight(line)
+    inclusive = {}
+
+    def weight_of(name: str, stack=()) -> float:
+        if name in inclusive:
+            return inclusive[name]
+        lo, hi = spans[name]
+        value = span_weight(lo, hi) + _callee_weight(name, lo, hi, stack + (name,))
+        if not stack:
+            inclusive[name] = value
+        return value
+
+    def _callee_weight(name: str, lo: int, hi: int, stack) -> float:
+        value = 0.0
+        for line, callee in sites[name]:
+            if lo <= line <= hi and callee != name and callee not in stack and incoming.get(callee):
+                value += weight_of(callee, stack) * site_weight(line) / incoming[callee]
+        return value
+
+    loops = []
+    total = total or 1.0
+    for name, fn in functions.items():
+        for loop, within in for_loops(fn.body):
+            if is_harness_loop(loop):
+                continue
+            lo, hi = node_line(loop), node_end_line(loop)
+            share = min((span_weight(lo, hi) + _callee_weight(name, lo, hi, (name,))) / total, 1.0)
+            depth = sum(not is_harness_loop(outer) for outer in within)
+            loops.append(LoopShare(lo, hi, name, depth, share, amdahl(share, threads)))
+    loops.sort(key=lambda l: (-l.share, l.line))
+    shares = {name: span_weight(*spans[name]) / total for name in functions}
+    return Profile(method, threads, seconds, loops, shares)
+
+
+def profile_original(work_dir: str, config: CValidationConfig, code: str, ast: c_ast.FileAST) -> Optional[Profile]:
+    """
+    Builds and runs the original once under perf sampling, or with gcov counters
+    when perf is unavailable; None when neither build runs. `ast` is the parsed
+    original (agents.c_frontend.parse_unit), in its source line numbers.
+    """
+    directory = os.path.join(work_dir, PROFILE_DIR)
+    shutil.rmtree(directory, ignore_errors=True)
+    os.makedirs(directory)
+    with open(os.path.join(directory, PROFILED), "w", encoding="utf-8") as f:
+        f.write(code)
+    exe = exe_name("profiled")
+    env = run_environment(config, threads=1)
+    if perf_available():
+        perf_config = CValidationConfig(**{**asdict(config), "opt_flags": PERF_FLAGS})
+        ok, _ = compile_c(perf_config, directory, PROFILED, exe, openmp=False)
+        start = time.perf_counter()
+        weights = _perf_weights(directory, exe, config, env) if ok else None
+        if weights:
+            return attribute(ast, weights.get(PROFILED, {}), sum(sum(w.values()) for w in weights.values()),
+                             False, "perf", config.threads(), time.perf_counter() - start)
+    gcov_config = CValidationConfig(**{**asdict(config), "opt_flags": GCOV_FLAGS, "ldflags": [*config.ldflags, "--coverage"]})
+    ok, _ = compile_c(gcov_config, directory, PROFILED, exe, openmp=False)
+    if not ok or shutil.which("gcov") is None:
+        return None
+    try:
+        proc, seconds = run_binary(directory, exe, env, config.run_timeout, cpus=config.cpus)
+    except (OSError, subprocess.SubprocessError):
+        return None
+    if proc.returncode != 0:
+        return None
+    weights = _gcov_weights(directory)
+    if not weights.get(PROFILED):
+        return None
+    return attribute(ast, weights[PROFILED], sum(sum(w.values()) for w in weights.values()), True, "gcov",
+                     config.threads(), seconds)
+
+
+def cold_candidates(candidates, profile: Profile, source_line=lambda line: line) -> List[Tuple[object, float]]:
+    """
+    Candidates whose loops are all cold, with the largest share among them.
+    Candidates without a profiled loop (sections, recursion) and first-touch
+    candidates (cheap loops that place pages for a hot one) are kept.
+    """
+    cold = []
+    for cand in candidates:
+        if cand.type == "first_touch":
+            continue
+        lo, hi = source_line(cand.start_line), source_line(cand.end_line)
+        shares = [l.share for l in profile.loops if lo <= l.line <= hi]
+        if shares and max(shares) < COLD_SHARE:
+            cold.append((cand, max(shares)))
+    return cold
+
+
+def describe_share(loop: LoopShare) -> str:
+    if loop.share < COLD_SHARE:
+        return f"{loop.share:.1%} of the profiled runtime (cold: leave it sequential)"
+    return f"{loop.share:.1%} of the profiled runtime; parallelizing it alone gives at most {loop.amdahl:.2f}x"
+
+
+def format_profile(profile: Profile) -> str:
+    method = "perf samples" if profile.method == "perf" else "gcov line counts"
+    outer = [l for l in profile.loops if l.depth == 0]
+    lines = [f"Runtime Profile ({method}, original on 1 thread, {profile.seconds:.2f}s; "
+             f"Amdahl bounds for {profile.threads} thread(s)):"]
+    for loop in outer[:TOP_LOOPS]:
+        if loop.share < COLD_SHARE:
+            break
+        lines.append(f"  - line {loop.line} ({loop.function}): {loop.share:.1%} of runtime, "
+                     f"at most {loop.amdahl:.2f}x if parallelized alone")
+    cold = [l for l in outer if l.share < COLD_SHARE]
+    if cold:
+        lines.append(f"  - {len(cold)} cold loop(s) under {COLD_SHARE:.0%} each (lines "
+                     f"{', '.join(str(l.line) for l in sorted(cold, key=lambda l: l.line))}): no candidates")
+    return "\n".join(lines) + "\n"
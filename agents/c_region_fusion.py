@@ -0,0 +1,752 @@
+"""
+Parallel-region fusion for OpenMP C code.
+Every `#pragma omp parallel for` forks a team and joins it at an implicit
+barrier. Consecutive parallel loops in one block each pay a fork/join, and so
+does a parallelized kernel on every call from a sequential time-step loop.
+This pass rewrites such loops into one `#pragma omp parallel` region of
+`#pragma omp for` loops. A loop gets `nowait` when the loops that may still be
+running alongside the next one touch none of its data. Otherwise the loop
+keeps its implicit barrier. Adjacent loops over the same iteration space are
+fused into one loop when the dependence analysis (agents.c_dependence) shows
+that the fused loop carries no dependence, so each element is reused while it
+is in cache. Both treat two differently named arrays as one unless the alias
+analysis (agents.c_alias) proves them distinct objects or one of them is a
+restrict-safe parameter.
+
+A void kernel whose body is nothing but parallel loops, called only from one
+sequential loop, is hoisted instead. The region opens around the caller's
+loop, the kernel's loops become orphaned `omp for` constructs, and the
+caller's other statements run in `omp single`.
+
+The rewrite is text-based, so comments and layout survive. The validator
+times the fused program against the validated one and keeps it only when it
+is correct and the speedup gate (agents.speedup_gate) shows it faster.
+"""
+
+import copy
+import re
+import subprocess
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Set, Tuple
+
+from pycparser import c_ast, c_generator
+
+from agents.c_ast_helpers import (balanced_parens, collect_accesses, id_names, is_harness_loop, loop_var,
+                                  parse_with_pragmas, walk_nodes)
+from agents.c_alias import AliasAnalysis
+from agents.c_dependence import PURE_FUNCTIONS, analyze_nest
+from agents.c_validation_engine import (CValidationConfig, compare_outputs, compile_c, exe_name, measure,
+                                        run_binary, run_environment, with_output_order, with_rng_tolerance)
+
+_PARALLEL_FOR = re.compile(r"^\s*#\s*pragma\s+omp\s+parallel\s+for\b(\s+simd\b)?(.*)$", re.DOTALL)
+# Clauses of a combined `parallel for` that belong to the parallel construct once it is split
+_REGION_CLAUSES = {"num_threads", "if", "proc_bind", "default", "shared", "copyin"}
+# Worksharing clauses a fused loop can carry over from its parts
+_FUSABLE_CLAUSES = {"schedule", "reduction", "private", "firstprivate"}
+INDENT = "    "
+
+
+@dataclass
+class FusedRegion:
+    function: str
+    line: int                             # first line of the rewritten code in the input
+    loops: int                            # parallel loops that now share one region
+    fused: int = 0                        # loops whose body was merged into the preceding loop
+    nowait: int = 0
+    barriers: int = 0                     # implicit barriers kept between loops for a dependence
+    hoisted: Optional[str] = None         # kernels whose region moved out to the caller's loop
+
+    def describe(self) -> str:
+        where = f"line {self.line} ({self.function})"
+        if self.hoisted:
+            text = (f"{where}: one parallel region around the loop that calls {self.hoisted}; its {self.loops} "
+                    f"loop(s) run as orphaned omp for, the rest of the loop body in omp single")
+        else:
+            text = f"{where}: {self.loops} parallel loops share one parallel region"
+        details = []
+        if self.fused:
+            details.append(f"{self.fused} loop(s) fused into the preceding loop")
+        if self.nowait:
+            details.append(f"{self.nowait} nowait")
+        if self.barriers:
+            details.append(f"{self.barriers} barrier(s) kept for dependences")
+        return text + (f" ({', '.join(details)})" if details else "")
+
+
+def _clauses(text: str) -> List[Tuple[str, str]]:
+    """(name, clause) for every clause of a directive tail, e.g. ("reduction", "reduction(+: sum)")."""
+    found, i = [], 0
+    word = re.compile(r"[\s,]*(\w+)")
+    while True:
+        match = word.match(text, i)
+        if not match:
+            return found
+        name, i = match.group(1), match.end()
+        paren = re.compile(r"\s*\(").match(text, i)
+        if paren:
+            body, i = balanced_parens(text, paren.end() - 1)
+            found.append((name, f"{name}({body.strip()})"))
+        else:
+            found.append((name, name))
+
+
+def _clause_vars(clause: str) -> List[str]:
+    body = clause[clause.index("(") + 1:-1] if "(" in clause else ""
+    if ":" in body:
+        body = body.split(":", 1)[1]
+    return [v.strip() for v in body.split(",") if v.strip()]
+
+
+def _code_chars(text: str, i: int):
+    """(index, char) from text[i:], skipping comments and string and character literals."""
+    n = len(text)
+    while i < n:
+        if text.startswith("//", i):
+            i = text.find("\n", i)
+            i = n if i < 0 else i
+            continue
+        if text.startswith("/*", i):
+            j = text.find("*/", i + 2)
+            i = n if j < 0 else j + 2
+            continue
+        ch = text[i]
+        if ch in "\"'":
+            j = i + 1
+            while j < n and text[j] != ch:
+                j += 2 if text[j] == "\\" else 1
+            i = j + 1
+            continue
+        yield i, ch
+        i += 1
+
+
+def _skip_blank(text: str, i: int) -> int:
+    while i < len(text):
+        if text[i].isspace():
+            i += 1
+        elif text.startswith("//", i):
+            j = text.find("\n", i)
+            i = len(text) if j < 0 else j
+        elif text.startswith("/*", i):
+            j = text.find("*/", i + 2)
+            i = len(text) if j < 0 else j + 2
+        else:
+            break
+    return i
+
+
+def _matching(text: str, i: int) -> Optional[int]:
+    """Index just past the bracket that closes text[i]."""
+    opening, closing = text[i], {"(": ")", "{": "}"}[text[i]]
+    depth = 0
+    for j, ch in _code_chars(text, i):
+        if ch == opening:
+            depth += 1
+        elif ch == closing:
+            depth -= 1
+            if depth == 0:
+                return j + 1
+    return None
+
+
+def _statement_end(text: str, i: int) -> Optional[int]:
+    """Index just past the statement that starts at (or after blanks from) text[i]; None for do/while."""
+    i = _skip_blank(text, i)
+    if i >= len(text):
+        return None
+    if text[i] == "{":
+        return _matching(text, i)
+    keyword = re.compile(r"(for|while|if|switch)\b").match(text, i)
+    if keyword:
+        j = _skip_blank(text, keyword.end())
+        if j >= len(text) or text[j] != "(":
+            return None
+        end = _matching(text, j)
+        end = _statement_end(text, end) if end is not None else None
+        if end is not None and keyword.group(1) == "if":
+            k = _skip_blank(text, end)
+            if re.compile(r"else\b").match(text, k):
+                return _statement_end(text, k + 4)
+        return end
+    if re.compile(r"do\b").match(text, i):
+        return None
+    depth = 0
+    for j, ch in _code_chars(text, i):
+        if ch in "([{":
+            depth += 1
+        elif ch in ")]}":
+            depth -= 1
+        elif ch == ";" and depth == 0:
+            return j + 1
+    return None
+
+
+class _Source:
+    """The code as lines (1-based) with statement extents found by bracket matching."""
+
+    def __init__(self, code: str):
+        self.code = code
+        self.lines = code.split("\n")
+        self.starts = [0]
+        for line in self.lines:
+            self.starts.append(self.starts[-1] + len(line) + 1)
+
+    def line_of(self, index: int) -> int:
+        lo, hi = 0, len(self.lines) - 1
+        while lo < hi:
+            mid = (lo + hi + 1) // 2
+            if self.starts[mid] <= index:
+                lo = mid
+            else:
+                hi = mid - 1
+        return lo + 1
+
+    def end_line(self, line: int) -> Optional[int]:
+        """Last line of the statement that begins the given line; None unless it ends its line."""
+        start = self.starts[line - 1] + len(self.lines[line - 1]) - len(self.lines[line - 1].lstrip())
+        end = _statement_end(self.code, start)
+        if end is None:
+            return None
+        last = self.line_of(end - 1)
+        after = _skip_blank(self.code, end)
+        return last if after >= len(self.code) or self.line_of(after) > last else None
+
+    def pragma_end(self, line: int) -> int:
+        while line < len(self.lines) and self.lines[line - 1].rstrip().endswith("\\"):
+            line += 1
+        return line
+
+    def directive(self, line: int, end: int) -> str:
+        return " ".join(l.rstrip().rstrip("\\").strip() for l in self.lines[line - 1:end])
+
+    def blank(self, first: int, last: int) -> bool:
+        """Lines first..last hold only whitespace and comments."""
+        if first > last:
+            return True
+        start, stop = self.starts[first - 1], self.starts[last]
+        return _skip_blank(self.code[:stop], start) >= stop - 1
+
+    def indent(self, line: int) -> str:
+        text = self.lines[line - 1]
+        return text[:len(text) - len(text.lstrip())]
+
+
+def _shift(lines: List[str], pad: str) -> List[str]:
+    return [pad + l if l.strip() else l for l in lines]
+
+
+@dataclass
+class _Loop:
+    node: c_ast.For
+    pragma_line: int
+    pragma_end: int
+    line: int
+    end_line: int
+    simd: bool
+    region: List[str]                     # clauses for the parallel construct
+    clauses: List[Tuple[str, str]]        # worksharing clauses
+
+
+class _Overlap:
+    """Whether two differently named arrays of one function may be the same object."""
+
+    def __init__(self, ast: c_ast.FileAST):
+        self.analysis = AliasAnalysis(ast)
+        self.safe: Dict[str, Set[str]] = {}
+
+    def __call__(self, function: str, a: str, b: str) -> bool:
+        if a == b:
+            return False
+        info = self.analysis.functions.get(function)
+        if info is None:
+            return True
+        if function not in self.safe:
+            self.safe[function] = set(self.analysis.verdict(function).restrict_safe)
+        if {a, b} <= set(info.pointer_params) and self.safe[function] & {a, b}:
+            return False
+        return not self.analysis.distinct(function, a, b)
+
+
+@dataclass
+class _Footprint:
+    reads: Set[str] = field(default_factory=set)
+    writes: Set[str] = field(default_factory=set)
+    arrays: Set[str] = field(default_factory=set)          # arrays and pointers accessed through
+    array_writes: Set[str] = field(default_factory=set)
+    opaque: bool = False                  # calls a function whose effects are unknown
+
+    def __or__(self, other: "_Footprint") -> "_Footprint":
+        return _Footprint(self.reads | other.reads, self.writes | other.writes, self.arrays | other.arrays,
+                          self.array_writes | other.array_writes, self.opaque or other.opaque)
+
+    def overlaps(self, later: "_Footprint", may_alias) -> bool:
+        """A differently named array of one side, written by either, may be the same object."""
+        return any(may_alias(a, b) for a in self.array_writes for b in later.arrays) \
+            or any(may_alias(a, b) for a in self.arrays for b in later.array_writes)
+
+    def conflicts(self, later: "_Footprint", may_alias) -> bool:
+        return self.opaque or later.opaque or bool(self.writes & (later.reads | later.writes)
+                                                   or self.reads & later.writes) \
+            or self.overlaps(later, may_alias)
+
+
+def _calls(node) -> List[str]:
+    return [n.name.name for n in walk_nodes(node) if isinstance(n, c_ast.FuncCall) and isinstance(n.name, c_ast.ID)]
+
+
+def _pointer_base(lvalue) -> Optional[str]:
+    """The pointer a store through *(p + i), *p++ or p->f goes through."""
+    node = lvalue
+    while not isinstance(node, c_ast.ID):
+        if isinstance(node, c_ast.StructRef) and node.type == "." and isinstance(node.name, c_ast.ID):
+            return None
+        if isinstance(node, c_ast.UnaryOp):
+            node = node.expr
+        elif isinstance(node, c_ast.BinaryOp):
+            node = node.left if not isinstance(node.left, c_ast.Constant) else node.right
+        elif isinstance(node, (c_ast.StructRef, c_ast.ArrayRef, c_ast.Cast)):
+            node = node.name if not isinstance(node, c_ast.Cast) else node.expr
+        else:
+            return None
+    return node.name if node is not lvalue else None
+
+
+def _footprint(loop: _Loop) -> _Footprint:
+    """Shared variables and arrays the loop reads and writes; differently named arrays are told apart by _Overlap."""
+    node = loop.node
+    arrays, array_writes = set(), set()
+    collect_accesses(node, arrays, array_writes)
+    reads, writes = set(arrays), set(array_writes)
+    declared = {n.name for n in walk_nodes(node) if isinstance(n, c_ast.Decl)}
+    for n in walk_nodes(node):
+        target = n.lvalue if isinstance(n, c_ast.Assignment) else \
+            n.expr if isinstance(n, c_ast.UnaryOp) and n.op in ("++", "--", "p++", "p--") else None
+        if isinstance(target, c_ast.ID):
+            writes.add(target.name)
+        elif target is not None and not isinstance(target, c_ast.ArrayRef):
+            base = _pointer_base(target)
+            if base:
+                arrays.add(base)
+                array_writes.add(base)
+                writes.add(base)
+    calls = _calls(node)
+    reads |= id_names(node) - set(calls)
+    for name, clause in loop.clauses:
+        if name in ("private", "firstprivate"):
+            writes -= set(_clause_vars(clause))
+            if name == "private":
+                reads -= set(_clause_vars(clause))
+    return _Footprint(reads - declared, writes - declared, arrays - declared, array_writes - declared,
+                      any(c not in PURE_FUNCTIONS for c in calls))
+
+
+@dataclass
+class _Group:
+    """One worksharing loop of the rewritten region: a loop and the loops fused into it."""
+    loops: List[_Loop]
+    node: c_ast.For                       # the fused nest, for the dependence test
+    clauses: List[Tuple[str, str]]
+    bodies: List[List[str]] = field(default_factory=list)   # renamed body lines of the fused loops
+    footprint: _Footprint = field(default_factory=_Footprint)
+
+    @classmethod
+    def of(cls, loop: _Loop) -> "_Group":
+        return cls([loop], loop.node, [c for c in loop.clauses if c[0] != "nowait"], footprint=_footprint(loop))
+
+
+def _header(loop: c_ast.For, generator) -> str:
+    return " ; ".join(generator.visit(part) if part is not None else "" for part in (loop.init, loop.cond, loop.next))
+
+
+def _top_decls(stmt) -> Set[str]:
+    items = (stmt.block_items or []) if isinstance(stmt, c_ast.Compound) else []
+    return {item.name for item in items if isinstance(item, c_ast.Decl)}
+
+
+def _fuse(group: _Group, loop: _Loop, source: _Source, may_alias) -> bool:
+    """
+    Merges loop's body into group when the iteration spaces match and the fused loop
+    stays parallel. The dependence test tells arrays apart by name, so an array of the
+    group and one of the loop that may be the same object block the fusion.
+    """
+    head = group.loops[0]
+    names = [n for n, _ in group.clauses] + [n for n, _ in loop.clauses if n != "nowait"]
+    if head.simd != loop.simd or any(n not in _FUSABLE_CLAUSES for n in names):
+        return False
+    schedules = {c for n, c in group.clauses + loop.clauses if n == "schedule"}
+    if len(schedules) > 1 or (schedules and not all(any(n == "schedule" for n, _ in l.clauses)
+                                                    for l in group.loops + [loop])):
+        return False
+    var, other = loop_var(head.node), loop_var(loop.node)
+    if var is None or other is None or not isinstance(head.node.init, c_ast.DeclList) \
+            or not isinstance(loop.node.init, c_ast.DeclList):
+        return False
+    generator = c_generator.CGenerator()
+    if _header(head.node, generator) != re.sub(rf"\b{re.escape(other)}\b", var, _header(loop.node, generator)):
+        return False
+    # Line layout the text rewrite relies on: `for (...) {` ... `}`
+    for l in (head, loop):
+        if not source.lines[l.line - 1].rstrip().endswith("{") or source.lines[l.end_line - 1].strip() != "}" \
+                or l.end_line <= l.line:
+            return False
+    if (var != other and var in id_names(loop.node.stmt)) or any(_top_decls(l.node.stmt) & _top_decls(loop.node.stmt)
+                                                             for l in group.loops):
+        return False
+    reductions = lambda clauses: {v for n, c in clauses if n == "reduction" for v in _clause_vars(c)}
+    if reductions(group.clauses) & id_names(loop.node.stmt) or reductions(loop.clauses) & id_names(group.node.stmt):
+        return False
+    footprint = _footprint(loop)
+    if group.footprint.overlaps(footprint, may_alias):
+        return False
+
+    body = copy.deepcopy(loop.node.stmt)
+    for n in walk_nodes(body):
+        if isinstance(n, c_ast.ID) and n.name == other:
+            n.name = var
+    parts = group.node.stmt.block_items if len(group.loops) > 1 else [group.node.stmt]
+    fused = c_ast.For(head.node.init, head.node.cond, head.node.next, c_ast.Compound(parts + [body]),
+                      head.node.coord)
+    result = analyze_nest(fused)
+    private = {v for n, c in group.clauses + loop.clauses if n in _FUSABLE_CLAUSES - {"schedule"}
+               for v in _clause_vars(c)}
+    if result.array_carried_at(0) or any(0 in levels for levels in result.calls.values()) \
+            or any(result.scalar_kind(name, 0) and name not in private for name in result.scalars) \
+            or any(result.iterator_level(name) == 0 for name in result.shared_iterators):
+        return False
+
+    lines = source.lines[loop.line:loop.end_line - 1]
+    if var != other:
+        lines = [re.sub(rf"\b{re.escape(other)}\b", var, l) for l in lines]
+    # Comments above the fused loop move into the body, at its indentation
+    between = [l.strip() for l in source.lines[group.loops[-1].end_line:loop.pragma_line - 1] if l.strip()]
+    inner = next((l[:len(l) - len(l.lstrip())] for l in lines if l.strip()), source.indent(loop.line) + INDENT)
+    group.bodies.append([inner + l for l in between] + lines)
+    group.loops.append(loop)
+    group.node = fused
+    group.clauses += [c for c in loop.clauses if c[0] != "nowait" and c not in group.clauses]
+    group.footprint = group.footprint | footprint
+    return True
+
+
+def _groups(loops: List[_Loop], source: _Source, may_alias) -> List[_Group]:
+    groups = [_Group.of(loops[0])]
+    for loop in loops[1:]:
+        if not _fuse(groups[-1], loop, source, may_alias):
+            groups.append(_Group.of(loop))
+    return groups
+
+
+def _schedule_barriers(groups: List[_Group], may_alias) -> List[bool]:
+    """
+    nowait after each group but the last: no loop that may still run alongside the next
+    one conflicts with it, by name or through arrays that may be the same object.
+    """
+    nowait, pending = [], []
+    for k in range(len(groups) - 1):
+        pending.append(groups[k].footprint)
+        independent = not any(f.conflicts(groups[k + 1].footprint, may_alias) for f in pending)
+        nowait.append(independent)
+        if not independent:
+            pending = []
+    return nowait + [False]
+
+
+def _emit(groups: List[_Group], nowait: List[bool], source: _Source, pad: str) -> List[str]:
+    """The groups as `omp for` loops, shifted right by pad; the lines between them are kept."""
+    out = []
+    for k, group in enumerate(groups):
+        head = group.loops[0]
+        if k > 0:
+            out += _shift(source.lines[groups[k - 1].loops[-1].end_line:head.pragma_line - 1], pad)
+        clauses = "".join(" " + c for _, c in group.clauses) + (" nowait" if nowait[k] else "")
+        out.append(f"{pad}{source.indent(head.pragma_line)}#pragma omp for{' simd' if head.simd else ''}{clauses}")
+        if len(group.loops) == 1:
+            out += _shift(source.lines[head.line - 1:head.end_line], pad)
+        else:
+            out += _shift(source.lines[head.line - 1:head.end_line - 1], pad)
+            for body in group.bodies:
+                out += _shift(body, pad)
+            out += _shift([source.lines[head.end_line - 1]], pad)
+    return out
+
+
+def _region(groups: List[_Group], nowait: List[bool], function: str, line: int, hoisted=None) -> FusedRegion:
+    stops = nowait[:-1]
+    return FusedRegion(function, line, sum(len(g.loops) for g in groups), sum(len(g.loops) - 1 for g in groups),
+                       sum(stops), len(stops) - sum(stops), hoisted)
+
+
+class _Fuser:
+    def __init__(self, code: str, ast: c_ast.FileAST):
+        self.source = _Source(code)
+        self.ast = ast
+        self.functions = {ext.decl.name: ext for ext in ast.ext if isinstance(ext, c_ast.FuncDef)}
+        self.overlap = _Overlap(ast)
+        self.call_counts: Dict[str, int] = {}
+        for name in _calls(ast):
+            self.call_counts[name] = self.call_counts.get(name, 0) + 1
+        self.edits: List[Tuple[int, int, List[str]]] = []
+        self.regions: List[FusedRegion] = []
+
+    def loop(self, pragma: c_ast.Node, node: c_ast.Node) -> Optional[_Loop]:
+        if not isinstance(pragma, c_ast.Pragma) or not isinstance(node, c_ast.For) or not pragma.coord \
+                or not node.coord:
+            return None
+        start = pragma.coord.line
+        end = self.source.pragma_end(start)
+        match = _PARALLEL_FOR.match(self.source.directive(start, end))
+        if not match or self.source.lines[node.coord.line - 1].strip()[:3] != "for":
+            return None
+        last = self.source.end_line(node.coord.line)
+        if last is None:
+            return None
+        clauses = _clauses(match.group(2))
+        region = sorted(c for n, c in clauses if n in _REGION_CLAUSES)
+        return _Loop(node, start, end, node.coord.line, last, bool(match.group(1)), region,
+                     [(n, c) for n, c in clauses if n not in _REGION_CLAUSES])
+
+    def runs(self, items) -> List[List[_Loop]]:
+        """Maximal runs of adjacent parallel loops with the same region clauses."""
+        runs, current = [], []
+        k = 0
+        while k < len(items):
+            loop = self.loop(items[k], items[k + 1]) if k + 1 < len(items) else None
+            if loop is None:
+                runs.append(current)
+                current = []
+                k += 1
+                continue
+            if current and (loop.region != current[-1].region
+                            or not self.source.blank(current[-1].end_line + 1, loop.pragma_line - 1)):
+                runs.append(current)
+                current = []
+            current.append(loop)
+            k += 2
+        return [r for r in runs + [current] if len(r) > 1]
+
+    def kernel(self, name: str) -> Optional[List[_Loop]]:
+        """The loops of a void function whose body is only parallel loops with the same region clauses."""
+        fn = self.functions.get(name)
+        if fn is None or not isinstance(fn.decl.type.type, c_ast.TypeDecl) \
+                or getattr(fn.decl.type.type.type, "names", None) != ["void"] or name in _calls(fn.body):
+            return None
+        items = fn.body.block_items or []
+        if not items or len(items) % 2:
+            return None
+        loops = [self.loop(items[k], items[k + 1]) for k in range(0, len(items), 2)]
+        if any(l is None for l in loops) or len({tuple(l.region) for l in loops}) != 1:
+            return None
+        return loops
+
+    def may_alias(self, function: str):
+        return lambda a, b: self.overlap(function, a, b)
+
+    def merge(self, function: str, loops: List[_Loop]):
+        groups = _groups(loops, self.source, self.may_alias(function))
+        nowait = _schedule_barriers(groups, self.may_alias(function))
+        pad = self.source.indent(loops[0].pragma_line)
+        region = "".join(" " + c for c in loops[0].region)
+        lines = [f"{pad}#pragma omp parallel{region}", pad + "{", *_emit(groups, nowait, self.source, INDENT),
+                 pad + "}"]
+        self.edits.append((loops[0].pragma_line, loops[-1].end_line, lines))
+        self.regions.append(_region(groups, nowait, function, loops[0].pragma_line))
+
+    def hoist(self, function: str, caller: c_ast.For) -> bool:
+        """Opens one region around a sequential loop whose kernel calls are the only parallel work in it."""
+        source = self.source
+        if not isinstance(caller.init, c_ast.DeclList) or not isinstance(caller.stmt, c_ast.Compound) \
+                or is_harness_loop(caller) or not caller.coord:
+            return False
+        line = caller.coord.line
+        last = source.end_line(line)
+        if last is None or last <= line or not source.lines[line - 1].rstrip().endswith("{") \
+                or source.lines[last - 1].strip() != "}":
+            return False
+        items = caller.stmt.block_items or []
+        if any(isinstance(n, (c_ast.Pragma, c_ast.Break, c_ast.Continue, c_ast.Return, c_ast.Goto, c_ast.Label))
+               for n in walk_nodes(caller.stmt)):
+            return False
+        omp_functions = {n for n, fn in self.functions.items() if any(isinstance(p, c_ast.Pragma) for p in walk_nodes(fn))}
+
+        kernels, calls, others = {}, [], []
+        for item in items:
+            name = item.name.name if isinstance(item, c_ast.FuncCall) and isinstance(item.name, c_ast.ID) else None
+            if name in omp_functions:
+                loops = kernels.get(name) or self.kernel(name)
+                if loops is None or not item.coord:
+                    return False
+                kernels[name] = loops
+                calls.append(item)
+            elif set(_calls(item)) & omp_functions:
+                return False
+            else:
+                others.append(item)
+        if not calls or any(self.call_counts.get(name, 0) != sum(c.name.name == name for c in calls)
+                            for name in kernels):
+            return False
+
+        # Every thread evaluates the loop header and the call arguments; only the `single` statements write
+        var = loop_var(caller)
+        written = set()
+        for item in others:
+            for n in walk_nodes(item):
+                if isinstance(n, c_ast.Assignment) and isinstance(n.lvalue, c_ast.ID):
+                    written.add(n.lvalue.name)
+                elif isinstance(n, c_ast.UnaryOp) and n.op in ("++", "--", "p++", "p--") \
+                        and isinstance(n.expr, c_ast.ID):
+                    written.add(n.expr.name)
+        header = id_names(caller.cond) | id_names(caller.next) if caller.cond is not None and caller.next is not None else None
+        if header is None or var in written or written & header:
+            return False
+        for call in calls:
+            args = call.args.exprs if call.args else []
+            if any(isinstance(n, (c_ast.Assignment, c_ast.FuncCall)) or
+                   (isinstance(n, c_ast.UnaryOp) and n.op in ("++", "--", "p++", "p--"))
+                   for a in args for n in walk_nodes(a)):
+                return False
+            text = source.lines[call.coord.line - 1].strip()
+            if not (text.startswith(call.name.name) and text.endswith(");")):
+                return False
+
+        # Statements between calls become one `single` each; their declarations must not be used outside it
+        call_lines = {c.coord.line for c in calls}
+        segments, current = [], []
+        for item in items:
+            if item in calls:
+                segments.append(current)
+                current = []
+            else:
+                current.append(item)
+        segments.append(current)
+        for k, segment in enumerate(segments):
+            declared = {n.name for item in segment for n in walk_nodes(item) if isinstance(n, c_ast.Decl)}
+            declared |= {item.name for item in segment if isinstance(item, c_ast.Decl)}
+            elsewhere = set().union(*(id_names(i) for s in segments[:k] + segments[k + 1:] for i in s),
+                                    *(id_names(c) for c in calls))
+            if declared & elsewhere:
+                return False
+
+        # Region clauses of the kernels, with each kernel's parameters replaced by the call's arguments
+        generator = c_generator.CGenerator()
+        region = set()
+        for call in calls:
+            fn = self.functions[call.name.name]
+            params = [p.name for p in fn.decl.type.args.params if isinstance(p, c_ast.Decl)] if fn.decl.type.args else []
+            args = [generator.visit(a) for a in (call.args.exprs if call.args else [])]
+            clauses = []
+            for clause in kernels[call.name.name][0].region:
+                for param, arg in zip(params, args):
+                    simple = re.fullmatch(r"\w+", arg)
+                    clause = re.sub(rf"\b{re.escape(param)}\b", arg if simple else f"({arg})", clause)
+                clauses.append(clause)
+            region.add(tuple(clauses))
+        if len(region) != 1:
+            return False
+
+        pad = source.indent(line)
+        body = source.lines[line:last - 1]
+        inner = next((source.indent(line + 1 + k) for k, l in enumerate(body) if l.strip()), pad + INDENT)
+        lines = [f"{pad}#pragma omp parallel{''.join(' ' + c for c in region.pop())}", pad + "{",
+                 *_shift([source.lines[line - 1]], INDENT)]
+        pending = []                      # (line, text) of the statements since the last call
+
+        def flush():
+            while pending and not pending[-1][1].strip():
+                lines.append(pending.pop()[1])
+            text = [t for _, t in pending]
+            if any(not source.blank(n, n) for n, _ in pending):
+                lines.extend([f"{INDENT}{inner}#pragma omp single", INDENT + inner + "{",
+                              *_shift(text, INDENT * 2), INDENT + inner + "}"])
+            else:
+                lines.extend(_shift(text, INDENT))
+            pending.clear()
+
+        for k, text in enumerate(body):
+            if line + 1 + k in call_lines:
+                flush()
+                lines.append(INDENT + text if text.strip() else text)
+            elif text.strip() or pending:
+                pending.append((line + 1 + k, text))
+        flush()
+        lines += [INDENT + source.lines[last - 1], pad + "}"]
+        self.edits.append((line, last, lines))
+
+        hoisted = []
+        for name, loops in kernels.items():
+            groups = _groups(loops, source, self.may_alias(name))
+            nowait = _schedule_barriers(groups, self.may_alias(name))
+            self.edits.append((loops[0].pragma_line, loops[-1].end_line, _emit(groups, nowait, source, "")))
+            hoisted.append(_region(groups, nowait, function, line, name))
+        self.regions.append(FusedRegion(function, line, sum(r.loops for r in hoisted), sum(r.fused for r in hoisted),
+                                        sum(r.nowait for r in hoisted), sum(r.barriers for r in hoisted),
+                                        ", ".join(kernels)))
+        return True
+
+    def run(self) -> Tuple[str, List[FusedRegion]]:
+        # Innermost sequential loops only: a kernel is called from one loop, so it is hoisted at most once
+        hoisted = set()
+        for name, fn in self.functions.items():
+            for node in walk_nodes(fn.body):
+                if isinstance(node, c_ast.For) and not any(isinstance(n, c_ast.For) for n in walk_nodes(node.stmt)) \
+                        and self.hoist(name, node):
+                    hoisted.update(self.regions[-1].hoisted.split(", "))
+        for name, fn in self.functions.items():
+            if name in hoisted:
+                continue
+            for node in walk_nodes(fn):
+                if isinstance(node, c_ast.Compound):
+                    for loops in self.runs(node.block_items or []):
+                        self.merge(name, loops)
+        lines = list(self.source.lines)
+        for start, end, replacement in sorted(self.edits, key=lambda e: e[0], reverse=True):
+            lines[start - 1:end] = replacement
+        self.regions.sort(key=lambda r: r.line)
+        return "\n".join(lines), self.regions
+
+
+def fuse_parallel_regions(code: str) -> Tuple[str, List[FusedRegion]]:
+    """The code with adjacent parallel loops in shared regions and the regions rewritten ([] when none)."""
+    try:
+        ast = parse_with_pragmas(code)
+    except Exception:
+        return code, []
+    return _Fuser(code, ast).run()
+
+
+@dataclass
+class FusionTrial:
+    time: Optional[float]
+    error: Optional[str] = None
+    samples: List[float] = field(default_factory=list)
+
+
+def time_fused(work_dir: str, config: CValidationConfig, code: str, original_exe: str = exe_name("original"),
+               source: str = "fused.c") -> FusionTrial:
+    """Builds and times the fused program; its output must match the original program's."""
+    config = with_rng_tolerance(with_output_order(config, code), code)
+    with open(f"{work_dir}/{source}", "w", encoding="utf-8") as f:
+        f.write(code)
+    ok, log = compile_c(config, work_dir, source, exe_name("fused"), openmp=True)
+    if not ok:
+        return FusionTrial(None, f"compile failed: {log.splitlines()[-1] if log else ''}")
+    env = run_environment(config)
+    expected, _ = run_binary(work_dir, original_exe, env, config.run_timeout, cpus=config.cpus)
+    try:
+        run = measure(config, work_dir, exe_name("fused"), env)
+    except (RuntimeError, subprocess.TimeoutExpired) as e:
+        return FusionTrial(None, str(e).splitlines()[0])
+    mismatch = compare_outputs(expected.stdout, run.stdout, config)
+    return FusionTrial(None, f"output differs ({mismatch})") if mismatch else FusionTrial(run.time, samples=run.samples)
+
+
+def format_fusion_report(regions: List[FusedRegion], trial: FusionTrial, validated_time: Optional[float],
+                         kept: bool = False, verdict: str = "") -> str:
+    """`verdict` is the speedup gate's judgement of the fused build against the validated one."""
+    lines = ["=== Parallel Region Fusion ==="] + [region.describe() for region in regions]
+    if trial.time is None:
+        lines.append(f"Fused version failed ({trial.error}); the validated code is kept")
+    else:
+        judged = f" ({verdict})" if verdict else ""
+        lines.append(f"Fused: {trial.time:.4f}s vs {validated_time or 0:.4f}s validated{judged}; "
+                     + ("fused code kept" if kept else "no significant gain, validated code kept"))
+    return "\n".join(lines) + "\n"
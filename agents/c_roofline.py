@@ -0,0 +1,400 @@
+"""
+Roofline analysis for C kernels.
+The machine side comes from benchmarks/c/tools/roofline.c, run once per host
+and thread count: STREAM triad bandwidth and a multiply-add peak. The kernel
+side is estimated from the AST. Floating-point operations are counted per
+loop, along with two byte counts:
+
+  streamed    every distinct array reference in an iteration moves its element
+              (no reuse across iterations: the traffic of an untiled sweep)
+  compulsory  every array element touched is moved once (perfect cache reuse)
+
+Their ratios bound the arithmetic intensity (flop/B). Below the ridge point
+(peak / bandwidth) even perfect reuse leaves a kernel bandwidth-bound. Above
+it, the kernel is compute-bound once its data is reused from cache. After
+validation, the timed region's flops and bytes over the measured time give
+the achieved GFLOP/s and GB/s, compared with the roof.
+"""
+
+from dataclasses import dataclass, field
+from typing import Dict, FrozenSet, List, Optional, Tuple
+
+from pycparser import c_ast
+
+from agents.c_ast_helpers import CHEAP_MATH, LIBM, TYPE_SIZES, top_level_loops
+from agents.c_cost_model import CACHE_DIR, CostEstimator, Unresolved, run_calibration
+from agents.c_validation_engine import CValidationConfig
+
+# Share of the triad bandwidth or FMA peak at which a kernel counts as "at the roof"
+AT_ROOF = 0.7
+# Loops this short that index next to a longer loop are neighbourhood offsets (stencils): they re-touch
+# the same elements, so they do not multiply an array's footprint
+SMALL_TRIPS = 16
+_FLOAT_TYPES = {"double", "float"}
+
+
+@dataclass
+class Machine:
+    threads: int
+    triad_gbs: float
+    triad_gbs_1t: float
+    peak_gflops: float
+    peak_gflops_1t: float
+
+    @property
+    def ridge(self) -> float:
+        """Arithmetic intensity (flop/B) where the bandwidth and compute roofs meet."""
+        return self.peak_gflops / self.triad_gbs if self.triad_gbs > 0 else float("inf")
+
+
+def calibrate_roofline(config: Optional[CValidationConfig] = None, cache_dir: str = CACHE_DIR) -> Optional[Machine]:
+    """Triad bandwidth and FMA peak for this host and thread count; None when the tool cannot run."""
+    measured = run_calibration("roofline", ["-O3", "-march=native"], config or CValidationConfig(), cache_dir)
+    try:
+        return Machine(**measured)
+    except TypeError:
+        return None
+
+
+@dataclass
+class Work:
+    flops: float = 0.0
+    streamed: float = 0.0                 # bytes moved by loops already closed
+    # References of the current iteration, deduplicated: (text, role) -> bytes
+    local: Dict[Tuple[str, str], float] = field(default_factory=dict)
+    # (array, reference text) -> [trip counts of the loops indexing it, loop variables still free, element size]
+    refs: Dict[Tuple[str, str], list] = field(default_factory=dict)
+
+    def add(self, other: "Work") -> "Work":
+        self.flops += other.flops
+        self.streamed += other.streamed
+        self.local.update(other.local)
+        for key, (trips, free, size) in other.refs.items():
+            mine = self.refs.get(key)
+            if mine is None or _distinct(trips) > _distinct(mine[0]):
+                self.refs[key] = [trips, free, size]
+        return self
+
+    @property
+    def streamed_bytes(self) -> float:
+        return self.streamed + sum(self.local.values())
+
+    @property
+    def compulsory_bytes(self) -> float:
+        per_array: Dict[str, float] = {}
+        for (array, _), (trips, _, size) in self.refs.items():
+            per_array[array] = max(per_array.get(array, 0.0), _distinct(trips) * size)
+        return sum(per_array.values())
+
+    @property
+    def ai_streamed(self) -> Optional[float]:
+        return self.flops / self.streamed_bytes if self.streamed_bytes else None
+
+    @property
+    def ai_compulsory(self) -> Optional[float]:
+        return self.flops / self.compulsory_bytes if self.compulsory_bytes else None
+
+
+def _distinct(trips: Tuple[float, ...]) -> float:
+    """Distinct elements a reference touches, from the trip counts of the loops in its subscript."""
+    large = [t for t in trips if t > SMALL_TRIPS]
+    product = 1.0
+    for t in large or trips:
+        product *= t
+    return product
+
+
+def _base(ref: c_ast.ArrayRef):
+    node, subscripts = ref, []
+    while isinstance(node, c_ast.ArrayRef):
+        subscripts.append(node.subscript)
+        node = node.name
+    return node, subscripts
+
+
+def _ids(node) -> FrozenSet[str]:
+    found = set()
+
+    def walk(n):
+        if isinstance(n, c_ast.ID):
+            found.add(n.name)
+        for _, child in n.children():
+            walk(child)
+    walk(node)
+    return frozenset(found)
+
+
+def _type_names(node) -> List[str]:
+    while node is not None and not isinstance(node, c_ast.IdentifierType):
+        node = getattr(node, "type", None)
+    return node.names if node is not None else []
+
+
+class IntensityEstimator(CostEstimator):
+    """Counts floating-point operations and array traffic, reusing the cost model's bound resolution."""
+
+    def __init__(self, ast: c_ast.FileAST):
+        super().__init__(ast)
+        self.generator_cache: Dict[int, str] = {}
+        globals_ = {}
+        for ext in ast.ext:
+            if isinstance(ext, c_ast.Decl) and ext.name:
+                globals_[ext.name] = _type_names(ext.type)
+        self.types: Dict[str, Dict[str, List[str]]] = {}
+        for name, fn in self.functions.items():
+            types = dict(globals_)
+            args = fn.decl.type.args
+            for p in (args.params if args else []):
+                if isinstance(p, c_ast.Decl) and p.name:
+                    types[p.name] = _type_names(p.type)
+
+            def walk(n):
+                if isinstance(n, c_ast.Decl) and n.name:
+                    types[n.name] = _type_names(n.type)
+                for _, child in n.children():
+                    walk(child)
+            walk(fn.body)
+            self.types[name] = types
+
+    def _text(self, node) -> str:
+        key = id(node)
+        if key not in self.generator_cache:
+            self.generator_cache[key] = self.generator.visit(node)
+        return self.generator_cache[key]
+
+    def _is_float(self, expr, function: str) -> bool:
+        if isinstance(expr, c_ast.Constant):
+            return expr.type in _FLOAT_TYPES
+        if isinstance(expr, c_ast.ID):
+            return bool(_FLOAT_TYPES & set(self.types[function].get(expr.name, [])))
+        if isinstance(expr, c_ast.ArrayRef):
+            base, _ = _base(expr)
+            return isinstance(base, c_ast.ID) and self._is_float(base, function)
+        if isinstance(expr, c_ast.Cast):
+            return bool(_FLOAT_TYPES & set(_type_names(expr.to_type)))
+        if isinstance(expr, c_ast.BinaryOp):
+            return self._is_float(expr.left, function) or self._is_float(expr.right, function)
+        if isinstance(expr, c_ast.UnaryOp):
+            return self._is_float(expr.expr, function)
+        if isinstance(expr, c_ast.FuncCall) and isinstance(expr.name, c_ast.ID):
+            return expr.name.name in LIBM or expr.name.name in CHEAP_MATH
+        return False
+
+    def element_size(self, base, function: str) -> int:
+        names = self.types[function].get(base.name, []) if isinstance(base, c_ast.ID) else []
+        return next((TYPE_SIZES[n] for n in reversed(names) if n in TYPE_SIZES), 8)
+
+    def work(self, node, function: str, env: Dict[str, float], stack=(), role: str = "load",
+             rename: Optional[Dict[str, str]] = None) -> Work:
+        """Flops and array traffic of executing `node` once; raises Unresolved for unresolved loops."""
+        rename = rename or {}
+        result = Work()
+        if node is None:
+            return result
+        if isinstance(node, c_ast.For):
+            trips, _, var = self.trips(node, function, env)
+            lo, _ = self.value(node.init.decls[0].init if isinstance(node.init, c_ast.DeclList)
+                               else node.init.rvalue, function, env)
+            body = self.work(node.stmt, function, dict(env, **{var: lo + trips / 2}), stack, rename=rename)
+            result.flops = trips * body.flops
+            result.streamed = trips * body.streamed_bytes
+            for key, (counts, free, size) in body.refs.items():
+                result.refs[key] = [counts + (trips,), free - {var}, size] if var in free else [counts, free, size]
+            return result
+        if isinstance(node, (c_ast.While, c_ast.DoWhile)):
+            raise Unresolved()
+        if isinstance(node, c_ast.ArrayRef):
+            base, subscripts = _base(node)
+            size = self.element_size(base, function)
+            text, array = self._text(node), rename.get(getattr(base, "name", ""), getattr(base, "name", "?"))
+            result.local[(f"{array}:{text}", role)] = float(size)
+            free = frozenset().union(*(_ids(s) for s in subscripts))
+            result.refs[(array, text)] = [(), free, size]
+            for s in subscripts:
+                result.add(self.work(s, function, env, stack, rename=rename))
+            return result
+        if isinstance(node, c_ast.Assignment):
+            result.add(self.work(node.rvalue, function, env, stack, rename=rename))
+            if node.op != "=":
+                result.add(self.work(node.lvalue, function, env, stack, "load", rename))
+                result.flops += 1 if self._is_float(node.lvalue, function) else 0
+            result.add(self.work(node.lvalue, function, env, stack, "store", rename))
+            return result
+        if isinstance(node, c_ast.BinaryOp):
+            if node.op in ("+", "-", "*", "/") and self._is_float(node, function):
+                result.flops += 1
+        elif isinstance(node, c_ast.If):
+            result.add(self.work(node.cond, function, env, stack, rename=rename))
+            then = self.work(node.iftrue, function, env, stack, rename=rename)
+            other = self.work(node.iffalse, function, env, stack, rename=rename)
+            heavier, lighter = (then, other) if then.flops >= other.flops else (other, then)
+            lighter.flops = 0.0
+            return result.add(lighter).add(heavier)
+        elif isinstance(node, c_ast.FuncCall) and isinstance(node.name, c_ast.ID):
+            name = node.name.name
+            args = node.args.exprs if node.args else []
+            for a in args:
+                result.add(self.work(a, function, env, stack, rename=rename))
+            if name in LIBM or name in CHEAP_MATH:
+                result.flops += 1
+            elif name in self.functions and name not in stack:
+                callee_env, callee_names = {}, {}
+                for p, a in zip(self.params(name), args):
+                    if isinstance(a, c_ast.ID):
+                        callee_names[p] = rename.get(a.name, a.name)
+                    try:
+                        callee_env[p], _ = self.value(a, function, env)
+                    except Unresolved:
+                        pass
+                result.add(self.work(self.functions[name].body, name, callee_env, stack + (name,),
+                                     rename=callee_names))
+            return result
+        for _, child in node.children():
+            result.add(self.work(child, function, env, stack, rename=rename))
+        return result
+
+    def loop_work(self, loop: c_ast.For, function: str) -> Optional[Work]:
+        try:
+            return self.work(loop, function, {}, (function,))
+        except (Unresolved, AttributeError, ValueError, OverflowError):
+            return None
+
+
+def _is_call(node, name: str) -> bool:
+    found = []
+
+    def walk(n):
+        if isinstance(n, c_ast.FuncCall) and isinstance(n.name, c_ast.ID) and n.name.name == name:
+            found.append(n)
+        for _, child in n.children():
+            walk(child)
+    walk(node)
+    return bool(found)
+
+
+def timed_region(ast: c_ast.FileAST) -> Optional[Tuple[str, List[c_ast.Node]]]:
+    """(function, statements) between `start = bench_now()` and `bench_record(...)` of the harness loop."""
+    def search(node, function):
+        if isinstance(node, c_ast.Compound) and node.block_items:
+            items = node.block_items
+            start = next((i for i, s in enumerate(items) if _is_call(s, "bench_now")
+                          and not _is_call(s, "bench_record")), None)
+            end = next((i for i, s in enumerate(items) if _is_call(s, "bench_record")), None)
+            if start is not None and end is not None and start < end:
+                return function, items[start + 1:end]
+        for _, child in node.children():
+            found = search(child, function)
+            if found:
+                return found
+        return None
+
+    for ext in ast.ext:
+        if isinstance(ext, c_ast.FuncDef):
+            found = search(ext.body, ext.decl.name)
+            if found:
+                return found
+    return None
+
+
+def estimate_intensity(ast: c_ast.FileAST) -> Dict[int, Work]:
+    """Flops and bytes of every outermost for-loop, keyed by its line."""
+    estimator = IntensityEstimator(ast)
+    found = {}
+    for loop, function in top_level_loops(ast):
+        work = estimator.loop_work(loop, function)
+        if work is not None and work.flops > 0 and loop.coord:
+            found[loop.coord.line] = work
+    return found
+
+
+def timed_work(ast: c_ast.FileAST) -> Optional[Work]:
+    """Flops and bytes of one repetition of the harness-timed region."""
+    region = timed_region(ast)
+    if region is None:
+        return None
+    function, statements = region
+    estimator = IntensityEstimator(ast)
+    total = Work()
+    try:
+        for stmt in statements:
+            total.add(estimator.work(stmt, function, {}, (function,)))
+    except (Unresolved, AttributeError, ValueError, OverflowError):
+        return None
+    return total if total.flops > 0 else None
+
+
+def classify(work: Work, machine: Machine) -> str:
+    ridge = machine.ridge
+    ai_c, ai_s = work.ai_compulsory, work.ai_streamed
+    if ai_c is None or ai_s is None:
+        return "no array traffic"
+    if ai_c < ridge:
+        return "bandwidth-bound even with perfect cache reuse"
+    if ai_s >= ridge:
+        return "compute-bound"
+    return "bandwidth-bound as streamed, compute-bound with cache reuse (blocking pays off)"
+
+
+def describe_intensity(work: Work, machine: Optional[Machine]) -> str:
+    text = (f"{work.flops:.3g} flops, {work.ai_streamed or 0:.3g} flop/B streamed, "
+            f"{work.ai_compulsory or 0:.3g} flop/B compulsory")
+    if machine is None:
+        return text
+    return text + f" (ridge {machine.ridge:.2g} flop/B) -> {classify(work, machine)}"
+
+
+@dataclass
+class RooflinePoint:
+    gflops: float
+    gbs: float                            # achieved traffic estimate
+    gbs_source: str                       # "perf" or "compulsory"
+    roof_gflops: float                    # attainable at the kernel's intensity
+    bound: str                            # "bandwidth" or "compute"
+    verdict: str
+
+
+def roofline_point(work: Work, time: float, machine: Machine, measured_bandwidth: Optional[float] = None) -> RooflinePoint:
+    """Achieved performance of one repetition taking `time` seconds, against the roof."""
+    gflops = work.flops / time / 1e9
+    if measured_bandwidth:
+        gbs, source = measured_bandwidth / 1e9, "perf"
+    else:
+        gbs, source = work.compulsory_bytes / time / 1e9, "compulsory"
+    ai = work.ai_compulsory if work.compulsory_bytes else float("inf")
+    roof = min(machine.peak_gflops, ai * machine.triad_gbs)
+    if ai < machine.ridge:
+        share = gbs / machine.triad_gbs if machine.triad_gbs else 0.0
+        if share >= AT_ROOF:
+            verdict = (f"at the bandwidth ceiling ({gbs:.1f} of {machine.triad_gbs:.1f} GB/s); more threads will not "
+                       f"help, only moving fewer bytes: fuse loops over the same arrays or shrink/restructure the data")
+        else:
+            verdict = (f"bandwidth-bound at {share:.0%} of the triad bandwidth; headroom left from more threads, "
+                       f"unit-stride access or parallel first touch")
+        return RooflinePoint(gflops, gbs, source, roof, "bandwidth", verdict)
+    share = gflops / machine.peak_gflops if machine.peak_gflops else 0.0
+    if share >= AT_ROOF:
+        verdict = f"near the compute peak ({gflops:.1f} of {machine.peak_gflops:.1f} GFLOP/s)"
+    else:
+        verdict = (f"compute headroom left: {gflops:.2f} of {machine.peak_gflops:.1f} GFLOP/s ({share:.0%} of peak); "
+                   f"vectorize the inner loop, block for cache reuse or parallelize further")
+    return RooflinePoint(gflops, gbs, source, roof, "compute", verdict)
+
+
+def format_machine(machine: Machine) -> str:
+    return (f"Roofline (benchmarks/c/tools/roofline.c, {machine.threads} threads): triad {machine.triad_gbs:.1f} GB/s "
+            f"({machine.triad_gbs_1t:.1f} on one thread), peak {machine.peak_gflops:.1f} GFLOP/s "
+            f"({machine.peak_gflops_1t:.1f} on one thread), ridge {machine.ridge:.2g} flop/B\n")
+
+
+def format_roofline_report(work: Work, original: Optional[RooflinePoint], refactored: RooflinePoint,
+                           machine: Machine) -> str:
+    lines = ["=== Roofline ===", format_machine(machine).rstrip(),
+             f"Timed region: {work.flops:.3g} flops, {work.streamed_bytes / 1e6:.3g} MB streamed, "
+             f"{work.compulsory_bytes / 1e6:.3g} MB compulsory per repetition; "
+             f"{work.ai_compulsory or 0:.3g} flop/B -> {classify(work, machine)}"]
+    for label, point in (("Original", original), ("Refactored", refactored)):
+        if point is not None:
+            lines.append(f"{label + ':':<12}{point.gflops:8.2f} GFLOP/s {point.gbs:8.2f} GB/s ({point.gbs_source}), "
+                         f"roof {point.roof_gflops:.1f} GFLOP/s")
+    lines.append(f"Verdict: {refactored.verdict}")
+    return "\n".join(lines) + "\n"
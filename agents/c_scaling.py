@@ -0,0 +1,111 @@
+"""
+Thread-count scaling sweep for validated OpenMP binaries.
+Reruns the refactored binary at 1, 2, 4, ... N threads and reports speedup
+and parallel efficiency per thread count, in strong-scaling mode (fixed
+problem size) or weak-scaling mode (problem size grows with the thread
+count through an environment variable read by the benchmark).
+"""
+
+import os
+from dataclasses import dataclass
+from typing import List, Optional
+
+from agents.c_validation_engine import CValidationConfig, measure, run_environment
+
+
+@dataclass
+class ScalingPoint:
+    threads: int
+    time: float
+    speedup: float
+    efficiency: float
+
+
+def default_thread_counts(max_threads: Optional[int] = None, cpus: Optional[List[int]] = None) -> List[int]:
+    """
+    Powers of two up to max_threads, always ending at max_threads itself. A run pinned
+    to a CPU subset (a batch lease) never goes past the CPUs it holds.
+    """
+    max_threads = max_threads or os.cpu_count() or 1
+    if cpus:
+        max_threads = min(max_threads, len(cpus))
+    counts, p = [], 1
+    while p < max_threads:
+        counts.append(p)
+        p *= 2
+    counts.append(max_threads)
+    return counts
+
+
+def run_scaling_sweep(work_dir: str, exe: str, config: CValidationConfig, baseline_time: float,
+                      thread_counts: Optional[List[int]] = None, weak_var: Optional[str] = None,
+                      weak_base: Optional[int] = None) -> List[ScalingPoint]:
+    """
+    Strong scaling (weak_var is None): speedup = baseline_time / T(p), where
+    baseline_time is the sequential original; efficiency = speedup / p.
+
+    Weak scaling: weak_var is set to weak_base * p for each run and the
+    reference is the refactored binary at one thread; efficiency = T(1) / T(p),
+    scaled speedup = p * efficiency.
+    """
+    points = []
+    reference = baseline_time
+    counts = thread_counts or default_thread_counts(config.num_threads, config.cpus)
+    if config.cpus:
+        counts = sorted({min(t, len(config.cpus)) for t in counts})
+    for threads in counts:
+        env = run_environment(config, threads)
+        if weak_var:
+            env[weak_var] = str(weak_base * threads)
+        run = measure(config, work_dir, exe, env)
+        if weak_var:
+            if not points:
+                reference = run.time
+            efficiency = reference / run.time if run.time > 0 else 0.0
+            speedup = threads * efficiency
+        else:
+            speedup = reference / run.time if run.time > 0 else 0.0
+            efficiency = speedup / threads
+        points.append(ScalingPoint(threads, run.time, speedup, efficiency))
+    return points
+
+
+def efficiency_knee(points: List[ScalingPoint], threshold: float) -> Optional[ScalingPoint]:
+    """First thread count (above 1) whose parallel efficiency falls below threshold."""
+    for point in points:
+        if point.threads > 1 and point.efficiency < threshold:
+            return point
+    return None
+
+
+def thread_recommendation(points: List[ScalingPoint], threshold: float) -> str:
+    knee = efficiency_knee(points, threshold)
+    if knee is None:
+        return f"Efficiency stays >= {threshold:.0%} up to {points[-1].threads} threads; no num_threads limit needed."
+    below = [p for p in points if p.threads < knee.threads and p.threads > 1]
+    if not below:
+        return (f"Efficiency is {knee.efficiency:.0%} already at {knee.threads} threads (< {threshold:.0%}): "
+                f"the region does not scale; consider not parallelizing it.")
+    best = below[-1]
+    return (f"Efficiency drops below {threshold:.0%} at {knee.threads} threads ({knee.efficiency:.0%}); "
+            f"emit num_threads({best.threads}) on the parallel region.")
+
+
+def format_scaling_report(points: List[ScalingPoint], threshold: float, weak: bool = False) -> str:
+    """Scaling table plus a text speedup curve, ready for report.txt."""
+    lines = [f"=== {'Weak' if weak else 'Strong'} Scaling ===",
+             f"{'Threads':>7}  {'Time (s)':>10}  {'Speedup':>8}  {'Efficiency':>10}"]
+    for p in points:
+        flag = "  < threshold" if p.threads > 1 and p.efficiency < threshold else ""
+        lines.append(f"{p.threads:>7}  {p.time:>10.4f}  {p.speedup:>7.2f}x  {p.efficiency:>9.0%}{flag}")
+
+    lines.append("")
+    lines.append("Speedup curve:")
+    peak = max(max(p.speedup for p in points), 1e-9)
+    for p in points:
+        bar = "#" * max(1, round(40 * p.speedup / peak))
+        lines.append(f"{p.threads:>7} | {bar} {p.speedup:.2f}x")
+
+    lines.append("")
+    lines.append(f"Recommendation: {thread_recommendation(points, threshold)}")
+    return "\n".join(lines) + "\n"
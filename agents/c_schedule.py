@@ -0,0 +1,88 @@
+"""
+Schedule-clause selection for OpenMP loops with `schedule(runtime)`.
+The refactored binary is rerun with each OMP_SCHEDULE candidate, the fastest
+schedule whose output matches the original program's wins, and the clause in the
+source is rewritten to that schedule so the saved code does not depend on
+the environment.
+"""
+
+import re
+import subprocess
+from dataclasses import dataclass, field
+from typing import List, Optional
+
+from agents.c_validation_engine import CValidationConfig, compare_outputs, measure, run_environment
+
+# OMP_SCHEDULE syntax: kind[,chunk]
+DEFAULT_SCHEDULES = ["static", "static,16", "dynamic,1", "dynamic,16", "dynamic,64", "dynamic,256",
+                     "guided", "guided,16"]
+
+_RUNTIME_CLAUSE = re.compile(r"schedule\s*\(\s*runtime\s*\)")
+
+
+@dataclass
+class ScheduleTrial:
+    schedule: str
+    time: Optional[float]
+    error: Optional[str] = None
+    samples: List[float] = field(default_factory=list)
+
+
+def uses_runtime_schedule(source: str) -> bool:
+    return bool(_RUNTIME_CLAUSE.search(source))
+
+
+def schedule_clause(schedule: str) -> str:
+    """"dynamic,64" -> "schedule(dynamic, 64)"."""
+    kind, _, chunk = schedule.partition(",")
+    return f"schedule({kind.strip()}, {chunk.strip()})" if chunk.strip() else f"schedule({kind.strip()})"
+
+
+def apply_schedule(source: str, schedule: str) -> str:
+    """Replaces every schedule(runtime) clause with the chosen schedule."""
+    return _RUNTIME_CLAUSE.sub(schedule_clause(schedule), source)
+
+
+def run_schedule_sweep(work_dir: str, exe: str, config: CValidationConfig, expected: str,
+                       schedules: Optional[List[str]] = None) -> List[ScheduleTrial]:
+    """
+    Times exe under each OMP_SCHEDULE value at the configured thread count.
+    Every trial's output is compared with `expected`, the original program's
+    stdout, so a schedule that changes results (e.g. a float reduction beyond
+    tolerance) is rejected rather than chosen.
+    """
+    trials = []
+    for schedule in schedules or config.schedules or DEFAULT_SCHEDULES:
+        env = run_environment(config)
+        env["OMP_SCHEDULE"] = schedule
+        try:
+            run = measure(config, work_dir, exe, env)
+        except (RuntimeError, subprocess.TimeoutExpired) as e:
+            trials.append(ScheduleTrial(schedule, None, str(e)))
+            continue
+        mismatch = compare_outputs(expected, run.stdout, config)
+        if mismatch:
+            trials.append(ScheduleTrial(schedule, None, f"output differs ({mismatch})"))
+            continue
+        trials.append(ScheduleTrial(schedule, run.time, samples=run.samples))
+    return trials
+
+
+def best_schedule(trials: List[ScheduleTrial]) -> Optional[ScheduleTrial]:
+    timed = [t for t in trials if t.time is not None]
+    return min(timed, key=lambda t: t.time) if timed else None
+
+
+def format_schedule_report(trials: List[ScheduleTrial]) -> str:
+    best = best_schedule(trials)
+    lines = ["=== Schedule Selection (OMP_SCHEDULE) ===",
+             f"{'Schedule':>12}  {'Time (s)':>10}"]
+    for t in trials:
+        if t.time is None:
+            lines.append(f"{t.schedule:>12}  {'failed':>10}  {t.error}")
+        else:
+            mark = "  <- selected" if t is best else ""
+            lines.append(f"{t.schedule:>12}  {t.time:>10.4f}{mark}")
+    if best:
+        lines.append(f"schedule(runtime) rewritten to {schedule_clause(best.schedule)}")
+    return "\n".join(lines) + "\n"
@@ -0,0 +1,390 @@
+"""
+Deterministic C validation engine.
+Compiles original.c and refactored.c with fixed commands, runs both under a
+controlled OpenMP environment, compares outputs with numeric tolerance and
+times them with repeated runs. Produces the same metrics dict that the
+LLM-generated validation scripts print, without an LLM round-trip.
+"""
+
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import time
+from dataclasses import dataclass, field, replace
+from typing import Dict, List, Optional, Tuple
+
+from agents.bench_utils import BENCH_INCLUDE_DIR, parse_bench_lines, strip_bench_lines
+
+
+@dataclass
+class CValidationConfig:
+    compiler: str = "gcc"
+    opt_flags: List[str] = field(default_factory=lambda: ["-O2"])
+    extra_cflags: List[str] = field(default_factory=list)
+    ldflags: List[str] = field(default_factory=lambda: ["-lm"])
+    include_dirs: List[str] = field(default_factory=lambda: [BENCH_INCLUDE_DIR])
+    num_threads: Optional[int] = None      # None -> all online CPUs
+    proc_bind: str = "close"
+    places: str = "cores"
+    warmup: int = 1
+    repeats: int = 5
+    rel_tol: float = 1e-6
+    abs_tol: float = 1e-9
+    # Compare output lines as a multiset; None -> only when the refactored code has sections or tasks,
+    # which may reorder them (with_output_order)
+    ignore_order: Optional[bool] = None
+    compile_timeout: int = 120
+    run_timeout: int = 300
+    # Extra problem sizes to measure after the default-size run, each a set of env
+    # overrides read by bench.h, e.g. {"BENCH_N": "4000000"} or {"BENCH_SIZE_CLASS": "dram"}
+    size_sets: List[Dict[str, str]] = field(default_factory=list)
+    # Hand-optimized variant (e.g. benchmarks/c/reference/*.c) to measure the generated code against
+    reference_source: Optional[str] = None
+    # OMP_SCHEDULE candidates ("kind[,chunk]") tried when the refactored code uses schedule(runtime);
+    # empty -> agents.c_schedule.DEFAULT_SCHEDULES
+    schedules: List[str] = field(default_factory=list)
+    omp_schedule: Optional[str] = None    # OMP_SCHEDULE for every run, once a schedule has been selected
+    vec_report: bool = True               # recompile with vectorization remarks (agents.c_vectorization)
+    counters: bool = True                 # rerun both binaries under perf stat (agents.c_perf_counters)
+    memory: bool = True                   # peak RSS and allocation counts of both binaries (agents.c_memory)
+    roofline: bool = True                 # place the timed region on the measured roofline (agents.c_roofline)
+    region_fusion: bool = True            # merge adjacent parallel loops into one region (agents.c_region_fusion)
+    profile: bool = True                  # rank loops by a profiled run of the original first (agents.c_profiler)
+    cpus: List[int] = field(default_factory=list)  # pin every run to these CPUs (batch mode); empty -> unpinned
+    # Device for `omp target` regions: "nvptx-none", "amdgcn-amdhsa", or "host" (host fallback only); None -> no
+    # offload flags (agents.c_offload)
+    offload: Optional[str] = None
+
+    def threads(self) -> int:
+        return self.num_threads or os.cpu_count() or 1
+
+
+def exe_name(base: str) -> str:
+    return base + ".exe" if sys.platform == "win32" else base
+
+
+# Clang names the offload targets by triple
+_CLANG_TARGETS = {"nvptx-none": "nvptx64-nvidia-cuda", "amdgcn-amdhsa": "amdgcn-amd-amdhsa"}
+
+
+def offload_flags(compiler: str, target: Optional[str]) -> List[str]:
+    """Compiler flags that build `omp target` regions for `target` (libm is linked on the device too)."""
+    if not target:
+        return []
+    if "clang" in os.path.basename(compiler):
+        return [] if target == "host" else [f"-fopenmp-targets={_CLANG_TARGETS.get(target, target)}"]
+    if target == "host":
+        return ["-foffload=disable"]
+    return [f"-foffload={target}", "-foffload-options=-lm", "-fno-stack-protector"]
+
+
+def compile_command(config: CValidationConfig, source: str, exe: str, openmp: bool) -> List[str]:
+    cmd = [config.compiler, *config.opt_flags]
+    if openmp:
+        cmd.append("-fopenmp")
+        cmd += offload_flags(config.compiler, config.offload)
+    cmd += [f"-I{d}" for d in config.include_dirs]
+    cmd += [*config.extra_cflags, "-o", exe, source, *config.ldflags]
+    return cmd
+
+
+def compile_c(config: CValidationConfig, work_dir: str, source: str, exe: str, openmp: bool) -> Tuple[bool, str]:
+    """Compiles `source` into `exe` inside work_dir. Returns (ok, compiler log)."""
+    cmd = compile_command(config, source, exe, openmp)
+    try:
+        proc = subprocess.run(cmd, cwd=work_dir, capture_output=True, text=True, timeout=config.compile_timeout)
+    except FileNotFoundError:
+        return False, f"Compiler '{config.compiler}' not found."
+    except subprocess.TimeoutExpired:
+        return False, f"Compilation timed out: {' '.join(cmd)}"
+    log = (proc.stdout + proc.stderr).strip()
+    if proc.returncode != 0:
+        return False, f"Compilation failed: {' '.join(cmd)}\n{log}"
+    return True, log
+
+
+def run_environment(config: CValidationConfig, threads: Optional[int] = None) -> Dict[str, str]:
+    env = dict(os.environ)
+    env["OMP_NUM_THREADS"] = str(threads or config.threads())
+    env["OMP_PROC_BIND"] = config.proc_bind
+    env["OMP_PLACES"] = config.places
+    env["BENCH_WARMUP"] = str(config.warmup)
+    env["BENCH_REPEATS"] = str(config.repeats)
+    if config.omp_schedule:
+        env["OMP_SCHEDULE"] = config.omp_schedule
+    return env
+
+
+def pinned(cmd: List[str], cpus: Optional[List[int]]) -> List[str]:
+    """Prefixes cmd with taskset when a CPU set is given (no-op where taskset is missing)."""
+    if not cpus or shutil.which("taskset") is None:
+        return cmd
+    return ["taskset", "-c", ",".join(str(c) for c in cpus), *cmd]
+
+
+def run_binary(work_dir: str, exe: str, env: Dict[str, str], timeout: int,
+               args: Optional[List[str]] = None, cpus: Optional[List[int]] = None) -> Tuple[subprocess.CompletedProcess, float]:
+    """Runs one binary (pinned to cpus, if given) and returns (completed process, external wall time)."""
+    path = exe if os.path.isabs(exe) else os.path.join(".", exe)
+    start = time.perf_counter()
+    proc = subprocess.run(pinned([path, *(args or [])], cpus), cwd=work_dir, env=env,
+                          capture_output=True, text=True, timeout=timeout)
+    return proc, time.perf_counter() - start
+
+
+@dataclass
+class TimedRun:
+    stdout: str
+    time: float
+    samples: List[float]
+    source: str            # "harness" (bench.h JSON line) or "external"
+
+
+def measure(config: CValidationConfig, work_dir: str, exe: str, env: Dict[str, str],
+            args: Optional[List[str]] = None) -> TimedRun:
+    """
+    Times a binary. Harness-driven programs repeat internally and report their own
+    samples; for any other program the binary is re-run warmup + repeats times.
+    Raises RuntimeError when the program exits with a non-zero status.
+    """
+    def checked_run():
+        proc, elapsed = run_binary(work_dir, exe, env, config.run_timeout, args, config.cpus)
+        if proc.returncode != 0:
+            raise RuntimeError(f"{exe} exited with status {proc.returncode}\n{proc.stderr.strip()}")
+        return proc, elapsed
+
+    proc, elapsed = checked_run()
+    records = parse_bench_lines(proc.stdout)
+    if records and "median" in records[-1]:
+        record = records[-1]
+        return TimedRun(proc.stdout, float(record["median"]), [float(s) for s in record.get("samples", [])], "harness")
+
+    samples = []
+    for run in range(config.warmup + config.repeats):
+        if run == 0:
+            sample = elapsed
+        else:
+            _, sample = checked_run()
+        if run >= config.warmup:
+            samples.append(sample)
+    return TimedRun(proc.stdout, statistics.median(samples), samples, "external")
+
+
+_NUMBER = re.compile(r"[-+]?(?:\d+\.\d*|\.\d+|\d+)(?:[eE][-+]?\d+)?|[-+]?(?:inf|nan)", re.IGNORECASE)
+
+
+def _split_numbers(line: str) -> Tuple[List[str], List[float]]:
+    return _NUMBER.split(line), [float(n) for n in _NUMBER.findall(line)]
+
+
+def _lines_match(expected: str, actual: str, rel_tol: float, abs_tol: float) -> bool:
+    exp_text, exp_nums = _split_numbers(expected)
+    act_text, act_nums = _split_numbers(actual)
+    if exp_text != act_text or len(exp_nums) != len(act_nums):
+        return False
+    for e, a in zip(exp_nums, act_nums):
+        if e != e and a != a:  # both NaN
+            continue
+        if abs(e - a) > max(abs_tol, rel_tol * max(abs(e), abs(a))):
+            return False
+    return True
+
+
+def _first_mismatch(expected: List[str], actual: List[str], rel_tol: float, abs_tol: float) -> Optional[str]:
+    if len(expected) != len(actual):
+        return f"line count differs: original has {len(expected)}, refactored has {len(actual)}"
+    for lineno, (e, a) in enumerate(zip(expected, actual), 1):
+        if not _lines_match(e, a, rel_tol, abs_tol):
+            return f"line {lineno}: expected {e!r}, got {a!r}"
+    return None
+
+
+_REORDERING = re.compile(r"#\s*pragma\s+omp\s+(?:parallel\s+)?(?:sections|section|task|taskloop)\b")
+
+
+def with_output_order(config: CValidationConfig, code: str) -> CValidationConfig:
+    """config with ignore_order resolved for `code`: order-insensitive only when sections or tasks may print."""
+    if config.ignore_order is not None:
+        return config
+    return replace(config, ignore_order=bool(_REORDERING.search(code)))
+
+
+# Relative tolerance for code moved from rand() onto maap_rng.h streams: a different sample stream moves a
+# Monte Carlo estimate by its sampling error (~1e-4 relative for 05's 1e7 samples), never by 1e-3
+RNG_REL_TOL = 1e-3
+_MAAP_RNG = re.compile(r"\bmaap_rng_\w+\s*\(")
+_RAND = re.compile(r"\b(?:rand|srand)\s*\(")
+
+
+def with_rng_tolerance(config: CValidationConfig, code: str, original: Optional[str] = None) -> CValidationConfig:
+    """
+    config with a statistical rel_tol when `code` draws from maap_rng streams that the
+    original (when given) did not use, in place of its rand() calls.
+    """
+    if not _MAAP_RNG.search(code) or config.rel_tol >= RNG_REL_TOL:
+        return config
+    if original is not None and (_MAAP_RNG.search(original) or not _RAND.search(original)):
+        return config
+    return replace(config, rel_tol=RNG_REL_TOL)
+
+
+def compare_outputs(expected: str, actual: str, config: CValidationConfig) -> Optional[str]:
+    """
+    Compares program outputs line by line; numbers compare within rel_tol/abs_tol.
+    Harness timing lines are ignored. Returns None on match, else a description.
+    """
+    exp_lines = [l.rstrip() for l in strip_bench_lines(expected).strip().splitlines()]
+    act_lines = [l.rstrip() for l in strip_bench_lines(actual).strip().splitlines()]
+
+    mismatch = _first_mismatch(exp_lines, act_lines, config.rel_tol, config.abs_tol)
+    if mismatch and config.ignore_order:
+        if _first_mismatch(sorted(exp_lines), sorted(act_lines), config.rel_tol, config.abs_tol) is None:
+            return None
+    return mismatch
+
+
+def size_label(size_set: Dict[str, str]) -> str:
+    """{"BENCH_N": "4000"} -> "n=4000"; {"BENCH_SIZE_CLASS": "llc"} -> "size-class=llc"."""
+    parts = []
+    for var, value in size_set.items():
+        name = var[len("BENCH_"):] if var.startswith("BENCH_") else var
+        parts.append(f"{name.lower().replace('_', '-')}={value}")
+    return ",".join(parts)
+
+
+def run_size_sweep(config: CValidationConfig, work_dir: str, original_exe: str, refactored_exe: str) -> List[dict]:
+    """Measures both binaries at every entry of config.size_sets, checking outputs at each size."""
+    rows = []
+    for size_set in config.size_sets:
+        env = run_environment(config)
+        env.update(size_set)
+        row = {"size": size_label(size_set), "original_time": None, "refactored_time": None,
+               "speedup": None, "is_correct": False, "error": None}
+        try:
+            orig = measure(config, work_dir, original_exe, env)
+            par = measure(config, work_dir, refactored_exe, env)
+        except (RuntimeError, subprocess.TimeoutExpired) as e:
+            row["error"] = str(e).splitlines()[0]
+            rows.append(row)
+            continue
+        mismatch = compare_outputs(orig.stdout, par.stdout, config)
+        row.update({
+            "original_time": orig.time,
+            "refactored_time": par.time,
+            "speedup": orig.time / par.time if par.time > 0 else None,
+            "is_correct": mismatch is None,
+            "error": f"Output mismatch ({mismatch})" if mismatch else None,
+        })
+        rows.append(row)
+    return rows
+
+
+def format_size_sweep(rows: List[dict]) -> str:
+    lines = ["=== Problem Size Sweep ===",
+             f"{'Size':<24}  {'Original (s)':>12}  {'Refactored (s)':>14}  {'Speedup':>8}  Correct"]
+    for row in rows:
+        if row["original_time"] is None:
+            lines.append(f"{row['size']:<24}  failed: {row['error']}")
+            continue
+        speedup = f"{row['speedup']:.2f}x" if row["speedup"] is not None else "N/A"
+        lines.append(f"{row['size']:<24}  {row['original_time']:>12.4f}  {row['refactored_time']:>14.4f}  "
+                     f"{speedup:>8}  {'yes' if row['is_correct'] else 'NO: ' + row['error']}")
+    return "\n".join(lines) + "\n"
+
+
+def measure_reference(config: CValidationConfig, work_dir: str, env: Dict[str, str],
+                      original_time: float, speedup: Optional[float]) -> dict:
+    """Builds and times the reference variant; reports how close the generated speedup gets."""
+    exe = exe_name("reference")
+    ok, log = compile_c(config, work_dir, os.path.abspath(config.reference_source), exe, openmp=True)
+    if not ok:
+        return {"reference_error": log}
+    try:
+        ref = measure(config, work_dir, exe, env)
+    except (RuntimeError, subprocess.TimeoutExpired) as e:
+        return {"reference_error": str(e)}
+    reference_speedup = original_time / ref.time if ref.time > 0 else None
+    return {
+        "reference_time": ref.time,
+        "reference_speedup": reference_speedup,
+        "reference_fraction": speedup / reference_speedup if speedup and reference_speedup else None,
+    }
+
+
+def validate_c_sources(work_dir: str, config: Optional[CValidationConfig] = None,
+                       original: str = "original.c", refactored: str = "refactored.c") -> dict:
+    """
+    Compiles and runs original/refactored sources found in work_dir.
+    Returns {"is_correct", "original_time", "refactored_time", "speedup", "error", ...}.
+    """
+    config = config or CValidationConfig()
+    try:
+        with open(os.path.join(work_dir, refactored), encoding="utf-8") as f:
+            code = f.read()
+        with open(os.path.join(work_dir, original), encoding="utf-8") as f:
+            config = with_rng_tolerance(with_output_order(config, code), code, f.read())
+    except OSError:
+        pass
+    metrics = {
+        "is_correct": False,
+        "original_time": None,
+        "refactored_time": None,
+        "speedup": None,
+        "error": None,
+        "threads": config.threads(),
+        "compile_original": " ".join(compile_command(config, original, exe_name("original"), openmp=False)),
+        "compile_refactored": " ".join(compile_command(config, refactored, exe_name("parallel"), openmp=True)),
+    }
+
+    ok, log = compile_c(config, work_dir, original, exe_name("original"), openmp=False)
+    if not ok:
+        metrics["error"] = f"Original code does not compile.\n{log}"
+        return metrics
+    ok, log = compile_c(config, work_dir, refactored, exe_name("parallel"), openmp=True)
+    if not ok:
+        metrics["error"] = log
+        return metrics
+
+    env = run_environment(config)
+    try:
+        orig = measure(config, work_dir, exe_name("original"), env)
+    except (RuntimeError, subprocess.TimeoutExpired) as e:
+        metrics["error"] = f"Original program failed: {e}"
+        return metrics
+    try:
+        par = measure(config, work_dir, exe_name("parallel"), env)
+    except subprocess.TimeoutExpired:
+        metrics["error"] = f"Refactored program timed out after {config.run_timeout}s"
+        return metrics
+    except RuntimeError as e:
+        metrics["error"] = f"Refactored program failed: {e}"
+        return metrics
+
+    metrics.update({
+        "original_time": orig.time,
+        "refactored_time": par.time,
+        "original_samples": orig.samples,
+        "refactored_samples": par.samples,
+        "timing_source": par.source,
+        "speedup": orig.time / par.time if par.time > 0 else None,
+    })
+
+    mismatch = compare_outputs(orig.stdout, par.stdout, config)
+    if mismatch:
+        metrics["error"] = f"Output mismatch ({mismatch})"
+        return metrics
+    metrics["is_correct"] = True
+
+    if config.reference_source:
+        metrics.update(measure_reference(config, work_dir, env, orig.time, metrics["speedup"]))
+
+    if config.size_sets:
+        metrics["sizes"] = run_size_sweep(config, work_dir, exe_name("original"), exe_name("parallel"))
+        failed = [row for row in metrics["sizes"] if not row["is_correct"]]
+        if failed:
+            metrics["is_correct"] = False
+            metrics["error"] = f"At size {failed[0]['size']}: {failed[0]['error']}"
+    return metrics
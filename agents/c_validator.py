@@ -1,6 +1,8 @@
 """
 C Code Validator Agent for OpenMP parallelization.
 Creates validation scripts to verify that parallelized C code produces correct results.
+Optional fallback (`main.py --c-validator llm`); the default C path is the
+deterministic engine in agents/c_validation_engine.py.
 """
 
 from LLMs.llms import llm
@@ -11,8 +13,8 @@ from pydantic import Field, BaseModel
 class CValidatorOutput(BaseModel):
     validation_script_code: str = Field(..., description="A Python script that compiles and runs both C versions, then compares results.")
     explanation: str = Field(..., description="Explanation of the validation strategy.")
-    compile_flags_original: str = Field(default="gcc -o original original.c", description="Compilation command for original code.")
-    compile_flags_parallel: str = Field(default="gcc -fopenmp -o parallel refactored.c", description="Compilation command for parallel code.")
+    compile_flags_original: str = Field(default="gcc -O2 -o original original.c -lm", description="Compilation command for original code.")
+    compile_flags_parallel: str = Field(default="gcc -O2 -fopenmp -o parallel refactored.c -lm", description="Compilation command for parallel code.")
 
 
 system_prompt = r"""You are a C/OpenMP Code Validation Specialist.
@@ -45,6 +47,10 @@ Do NOT do a simple string comparison if the order might be non-deterministic.
    ALWAYS print valid JSON at the very end (even on error):
    `{{"is_correct": bool, "original_time": float, "refactored_time": float, "speedup": float, "error": "string or null"}}`
    Use `time.perf_counter()` to measure the wall-clock execution time of the executables.
+   Programs built on the shared benchmark harness (`#include "bench.h"`, already present in CWD) print one
+   JSON line containing a "bench" key, e.g. `{{"bench": "kernel", "clock": "wall", "median": 0.08, ...}}`.
+   When both programs print it, use its "median" field (seconds) as original_time / refactored_time instead of
+   your own measurement, and exclude that line from the output comparison (its timings always differ).
    If "is_correct" is false, provide a brief error message in "error".
 6. Wrap ALL execution (including compilation subprocess calls) in try/except blocks. Specifically handle `FileNotFoundError` if `gcc` is missing. If compilation fails, return metrics with `is_correct: false` and `error: "Compilation failed..."`.
 
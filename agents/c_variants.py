@@ -0,0 +1,146 @@
+"""
+Several alternative transformations per implementer run, validated side by side.
+One implementer call commits to one strategy, and the serial retry loop only
+replaces it when it fails. A correct but slow choice (collapse where the outer
+loop alone was enough, a static schedule on an imbalanced loop) is kept. With
+--variants K, the implementer is asked for K transformations, each following
+one strategy directive. The variants are validated concurrently, each in its own
+sandbox directory and on its own disjoint CPU set, and ranked by speedup
+against the original timed on the same CPUs (by the lower bound of its
+confidence interval, agents.speedup_gate). The fastest correct variant then
+goes through the full validation on all of the pipeline's CPUs.
+"""
+
+import os
+import shutil
+import time
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import asdict, dataclass, field
+from typing import List, Optional
+
+from agents.batch import CpuSetAllocator
+from agents.c_validation_engine import CValidationConfig, validate_c_sources
+
+# (name, directive) in the order variants are requested; the first one is the analysis as given
+STRATEGIES = [
+    ("recommended", "Apply the analysis report's recommendations as given."),
+    ("outer_only", "Parallelize only the outermost loop of each nest with schedule(static) and no collapse; "
+                   "inner loops stay sequential (simd at most)."),
+    ("collapse", "Collapse every perfectly nested parallel loop nest as deep as the dependence analysis allows."),
+    ("runtime_schedule", "Put schedule(runtime) on every parallel loop so the validator picks OMP_SCHEDULE, "
+                         "and parallelize the coarsest legal loop of each nest."),
+    ("tiling", "Tile the loop nests over arrays with tile-size macros (record them as tunables) and parallelize "
+               "the loop over tiles; other loops follow the recommendations."),
+    ("coarse_regions", "Make parallel regions as coarse as possible: one #pragma omp parallel around adjacent "
+                       "loops with #pragma omp for inside, nowait only where no dependence crosses the loops."),
+]
+VARIANT_DIR = "variant_{}"
+
+
+@dataclass
+class Variant:
+    index: int
+    strategy: str
+    code: str
+    changes: List[dict] = field(default_factory=list)
+    metrics: Optional[dict] = None
+    cpus: List[int] = field(default_factory=list)
+    seconds: float = 0.0
+
+    @property
+    def correct(self) -> bool:
+        return bool(self.metrics and self.metrics.get("is_correct"))
+
+    @property
+    def speedup(self) -> Optional[float]:
+        return (self.metrics or {}).get("speedup")
+
+
+def strategies(count: int) -> List[tuple]:
+    """The first `count` strategies (at most all of them)."""
+    return STRATEGIES[:max(1, min(count, len(STRATEGIES)))]
+
+
+def variant_directive(index: int, count: int, strategy: str) -> str:
+    directive = dict(STRATEGIES)[strategy]
+    return (f"VARIANT {index + 1} of {count} ({strategy}): {directive} The other variants explore other "
+            "strategies and are timed against this one; the correctness rules above still apply.")
+
+
+def validate_variants(work_dir: str, config: CValidationConfig, original: str, variants: List[Variant],
+                      cpus: List[int]) -> List[Variant]:
+    """
+    Validates every variant in work_dir/variant_<i>, at most one per disjoint CPU set
+    of len(cpus) // len(variants) CPUs (variants wait for a free set when there are
+    more variants than CPUs). Extra size sets and the reference variant wait for the
+    final validation of the winner. Returns the variants ranked, fastest correct first.
+    """
+    allocator = CpuSetAllocator(cpus, max(1, len(cpus) // max(len(variants), 1)))
+
+    def run(variant: Variant):
+        sandbox = os.path.join(work_dir, VARIANT_DIR.format(variant.index))
+        shutil.rmtree(sandbox, ignore_errors=True)
+        os.makedirs(sandbox)
+        for name, text in (("original.c", original), ("refactored.c", variant.code)):
+            with open(os.path.join(sandbox, name), "w", encoding="utf-8") as f:
+                f.write(text)
+        with allocator.lease() as slot:
+            variant_config = CValidationConfig(**{**asdict(config), "cpus": slot, "num_threads": len(slot),
+                                                  "size_sets": [], "reference_source": None})
+            start = time.perf_counter()
+            try:
+                variant.metrics = validate_c_sources(sandbox, variant_config)
+            except Exception as e:
+                variant.metrics = {"is_correct": False, "error": f"Validation failed: {e}"}
+            variant.cpus, variant.seconds = slot, time.perf_counter() - start
+
+    with ThreadPoolExecutor(max_workers=len(allocator.slots)) as pool:
+        list(pool.map(run, variants))
+    return rank_variants(variants)
+
+
+def rank_variants(variants: List[Variant]) -> List[Variant]:
+    """
+    Correct variants by the lower bound of their speedup interval (the point speedup
+    without one), so a fast but noisy variant does not beat a reliably fast one;
+    then the failed ones in request order.
+    """
+    def bound(v: Variant) -> float:
+        interval = (v.metrics or {}).get("speedup_ci")
+        return interval["low"] if interval else v.speedup or 0.0
+    return sorted(variants, key=lambda v: (not v.correct, -bound(v) if v.correct else v.index))
+
+
+def variant_summary(ranked: List[Variant]) -> List[dict]:
+    """The ranking for metrics.json (codes left out)."""
+    return [{"rank": rank, "strategy": v.strategy, "correct": v.correct, "speedup": v.speedup,
+             "original_time": (v.metrics or {}).get("original_time"),
+             "refactored_time": (v.metrics or {}).get("refactored_time"),
+             "cpus": v.cpus, "seconds": v.seconds, "error": None if v.correct else (v.metrics or {}).get("error"),
+             "changes": v.changes}
+            for rank, v in enumerate(ranked, 1)]
+
+
+def format_variant_report(ranked: List[Variant], wall_time: float) -> str:
+    chosen = ranked[0]
+    serial = sum(v.seconds for v in ranked)
+    sets = len({tuple(v.cpus) for v in ranked if v.cpus})
+    lines = [f"=== Variant Ranking ({len(ranked)} variants on {sets} concurrent CPU set(s): {wall_time:.1f}s, "
+             f"{serial:.1f}s of validation) ==="]
+    lines.append(f"{'Rank':<5} {'Strategy':<18} {'CPUs':>5} {'Original':>9} {'Variant':>9} {'Speedup':>8} "
+                 f"{'CI':>15}  Status")
+    for rank, v in enumerate(ranked, 1):
+        metrics = v.metrics or {}
+        orig = f"{metrics['original_time']:.4f}" if metrics.get("original_time") is not None else "-"
+        ref = f"{metrics['refactored_time']:.4f}" if metrics.get("refactored_time") is not None else "-"
+        speedup = f"{v.speedup:.2f}x" if v.speedup is not None else "-"
+        interval = metrics.get("speedup_ci")
+        ci = f"[{interval['low']:.2f}, {interval['high']:.2f}]" if interval else "-"
+        status = "passed" if v.correct else "FAILED: " + (metrics.get("error") or "unknown error").splitlines()[0][:80]
+        lines.append(f"{rank:<5} {v.strategy:<18} {len(v.cpus):>5} {orig:>9} {ref:>9} {speedup:>8} {ci:>15}  {status}")
+    if chosen.correct:
+        lines.append(f"Selected: {chosen.strategy}. Speedups were measured on {len(chosen.cpus)} CPU(s) per variant; "
+                     "the selected variant is validated below on the full CPU set.")
+    else:
+        lines.append(f"No variant passed; {chosen.strategy} is validated below and its error goes to the retry.")
+    return "\n".join(lines) + "\n"
@@ -0,0 +1,159 @@
+"""
+Compiler vectorization feedback for refactored C code.
+Recompiles the refactored source with the validator's flags plus optimization
+remarks (GCC -fopt-info-vec, Clang -Rpass=loop-vectorize), parses which loops
+were vectorized or missed and why, and maps them back to the analyzer's
+candidate line ranges. The report is appended to the validation output, so on
+a retry the implementer sees whether its `#pragma omp simd` took effect.
+"""
+
+import difflib
+import os
+import re
+import subprocess
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional
+
+from agents.c_validation_engine import CValidationConfig, compile_command
+
+# file:line:col: kind: message   (GCC kinds: optimized/missed/note; Clang: remark/warning)
+_REMARK = re.compile(r"^(?P<file>[^:\s]+):(?P<line>\d+):(?P<col>\d+):\s+(?P<kind>optimized|missed|remark|warning):\s+"
+                     r"(?P<msg>.*?)\s*(?:\[-(?P<flag>[\w=-]+)\])?$")
+_SIMD_PRAGMA = re.compile(r"^\s*#\s*pragma\s+omp\b.*\bsimd\b")
+_FOR = re.compile(r"\bfor\s*\(")
+
+_GCC_LOOP_DONE = re.compile(r"loop vectorized(?: using (?P<width>\d+ byte vectors))?")
+_CLANG_LOOP_DONE = re.compile(r"vectorized loop \((?P<width>vectorization width: \d+)")
+
+
+@dataclass
+class LoopRemark:
+    line: int                          # line of the loop in the refactored source
+    vectorized: bool = False
+    width: Optional[str] = None
+    reasons: List[str] = field(default_factory=list)
+    simd_requested: bool = False
+    original_line: Optional[int] = None
+    candidate: Optional[str] = None
+
+
+def remark_flags(compiler: str) -> List[str]:
+    if "clang" in os.path.basename(compiler):
+        return ["-Rpass=loop-vectorize", "-Rpass-missed=loop-vectorize", "-Rpass-analysis=loop-vectorize"]
+    return ["-fopt-info-vec-optimized", "-fopt-info-vec-missed"]
+
+
+def parse_remarks(log: str, source: str) -> Dict[int, LoopRemark]:
+    """
+    Loop verdicts by line from a GCC or Clang remark log. Reason remarks ("not
+    vectorized: ...") are attached to the closest loop at or above their line.
+    """
+    loops: Dict[int, LoopRemark] = {}
+    reasons = []
+    for raw in log.splitlines():
+        match = _REMARK.match(raw.strip())
+        if not match or os.path.basename(match.group("file")) != os.path.basename(source):
+            continue
+        line, msg = int(match.group("line")), match.group("msg")
+        done = _GCC_LOOP_DONE.match(msg) or _CLANG_LOOP_DONE.match(msg)
+        if done:
+            loop = loops.setdefault(line, LoopRemark(line))
+            loop.vectorized = True
+            loop.width = done.group("width")
+        elif msg in ("couldn't vectorize loop", "loop not vectorized"):
+            loops.setdefault(line, LoopRemark(line))
+        elif "not vectorized" in msg or "unable to perform the requested transformation" in msg:
+            reasons.append((line, msg))
+    for line, msg in reasons:
+        owners = [l for l in loops if l <= line]
+        owner = max(owners) if owners else line
+        loop = loops.setdefault(owner, LoopRemark(owner))
+        msg = re.sub(r"^not vectorized:\s*", "", msg)
+        if not loop.vectorized and msg not in loop.reasons:
+            loop.reasons.append(msg)
+    return loops
+
+
+def simd_loop_lines(code: str) -> List[int]:
+    """Lines of the for-loops that follow a `#pragma omp ... simd` directive."""
+    lines = code.splitlines()
+    found = []
+    for i, text in enumerate(lines):
+        if not _SIMD_PRAGMA.match(text):
+            continue
+        for j in range(i + 1, min(i + 4, len(lines))):
+            if _FOR.search(lines[j]):
+                found.append(j + 1)
+                break
+    return found
+
+
+def map_lines(original: str, refactored: str) -> Dict[int, int]:
+    """Refactored line -> original line (unchanged lines map 1:1, rewritten blocks proportionally)."""
+    a, b = original.splitlines(), refactored.splitlines()
+    mapping = {}
+    for tag, i1, i2, j1, j2 in difflib.SequenceMatcher(None, a, b, autojunk=False).get_opcodes():
+        for j in range(j1, j2):
+            if tag == "equal":
+                mapping[j + 1] = i1 + (j - j1) + 1
+            elif i2 > i1:
+                mapping[j + 1] = i1 + (j - j1) * (i2 - i1) // (j2 - j1) + 1
+            else:
+                mapping[j + 1] = max(i1, 1)     # pure insertion: attribute to the preceding line
+    return mapping
+
+
+def vectorization_remarks(work_dir: str, config: CValidationConfig, original_code: str, refactored_code: str,
+                          candidates: Optional[List[dict]] = None,
+                          source: str = "refactored.c") -> Optional[List[LoopRemark]]:
+    """
+    Compiles `source` (object only) with the validation flags plus remark flags.
+    Returns the loop verdicts mapped to original lines and candidate ids, or None
+    when the compiler cannot produce remarks.
+    """
+    cmd = compile_command(config, source, os.devnull, openmp=True)
+    cmd = [cmd[0], "-c", *remark_flags(config.compiler), *cmd[1:]]
+    try:
+        proc = subprocess.run(cmd, cwd=work_dir, capture_output=True, text=True, timeout=config.compile_timeout)
+    except (FileNotFoundError, subprocess.TimeoutExpired):
+        return None
+    if proc.returncode != 0:
+        return None
+    loops = parse_remarks(proc.stdout + proc.stderr, source)
+    for line in simd_loop_lines(refactored_code):
+        # Remarks point at the for keyword or the loop body; take the first remark within the loop header
+        owner = next((l for l in sorted(loops) if line <= l <= line + 1), None)
+        loops.setdefault(owner or line, LoopRemark(owner or line)).simd_requested = True
+
+    mapping = map_lines(original_code, refactored_code)
+    for loop in loops.values():
+        loop.original_line = mapping.get(loop.line)
+        for cand in candidates or []:
+            if loop.original_line and cand["start_line"] <= loop.original_line <= cand["end_line"]:
+                loop.candidate = cand["id"]
+                break
+    return sorted(loops.values(), key=lambda l: l.line)
+
+
+def format_vectorization_report(loops: List[LoopRemark], candidates: Optional[List[dict]] = None) -> str:
+    """Lists loops inside a candidate range or marked omp simd; setup and harness loops are left out."""
+    ranges = {c["id"]: f"{c['type']}, lines {c['start_line']}-{c['end_line']}" for c in candidates or []}
+    shown = [l for l in loops if l.candidate or l.simd_requested]
+    lines = ["=== Vectorization Report (compiler remarks) ==="]
+    if not shown:
+        return "\n".join(lines + ["No candidate loops reported by the compiler."]) + "\n"
+    missed_simd = 0
+    for loop in shown:
+        where = f"line {loop.original_line}" if loop.original_line else "new code"
+        owner = f"[{loop.candidate}: {ranges.get(loop.candidate, '')}] " if loop.candidate else ""
+        tag = " [omp simd]" if loop.simd_requested else ""
+        if loop.vectorized:
+            width = f" ({loop.width})" if loop.width else ""
+            lines.append(f"  {owner}{where} (refactored {loop.line}){tag}: vectorized{width}")
+        else:
+            why = "; ".join(loop.reasons) or "no reason given"
+            lines.append(f"  {owner}{where} (refactored {loop.line}){tag}: NOT vectorized: {why}")
+            missed_simd += loop.simd_requested
+    if missed_simd:
+        lines.append(f"{missed_simd} loop(s) marked omp simd were not vectorized; fix the reason or drop the pragma.")
+    return "\n".join(lines) + "\n"
@@ -0,0 +1,261 @@
+"""
+Content-addressed cache for pipeline artifacts.
+Every entry is keyed by a SHA-256 digest of everything that determines it:
+source text, AST report, model identity and prompt version for LLM outputs;
+source texts, validation settings, compiler version and harness headers for
+compiled binaries and validation metrics. A changed input changes the key, so
+entries never need to be invalidated explicitly; stale ones are just not found.
+
+The analyzer output is also stored per function, keyed by the function's text
+(independent of where it sits in the file), the text of the functions that
+call it, directly or not, and the file's top-level declarations. The callers
+are included because alias verdicts, if() thresholds and profile shares
+follow the call sites. Editing one function misses its own entry and those of
+the functions it calls; the candidates of the others are reused at their new
+line numbers.
+
+Layout: <root>/<kind>/<key[:2]>/<key>.json (.pickle for parsed ASTs), binaries next to it as <key>.<name>.
+"""
+
+import hashlib
+import json
+import os
+import pickle
+import re
+import shutil
+import subprocess
+import tempfile
+from dataclasses import dataclass
+from typing import Dict, List, Optional
+
+CACHE_DIR = ".maap_cache"
+
+_FUNC_HEAD = re.compile(r"\b([A-Za-z_]\w*)\s*\([^;{}]*\)\s*\{")
+
+
+def digest(*parts) -> str:
+    """Stable hash of strings, numbers and JSON-serializable values."""
+    h = hashlib.sha256()
+    for part in parts:
+        text = part if isinstance(part, str) else json.dumps(part, sort_keys=True, default=str)
+        h.update(text.encode("utf-8"))
+        h.update(b"\0")
+    return h.hexdigest()
+
+
+def model_identity() -> str:
+    """The model the agents are bound to (LLMs/llms.py reads the same variable)."""
+    return os.getenv("model") or "default"
+
+
+def prompt_version(*prompts) -> str:
+    """Short digest of the prompt templates and output schemas an agent is invoked with."""
+    return digest(*prompts)[:16]
+
+
+def source_version(*modules) -> str:
+    """Digest of the given modules' source files, so reports change key when the analysis code does."""
+    texts = []
+    for module in modules:
+        with open(module.__file__, encoding="utf-8") as f:
+            texts.append(f.read())
+    return digest(*texts)[:16]
+
+
+def file_digest(*paths) -> str:
+    texts = []
+    for path in paths:
+        try:
+            with open(path, encoding="utf-8") as f:
+                texts.append(f.read())
+        except (OSError, TypeError):
+            texts.append("")
+    return digest(*texts)
+
+
+def compiler_version(compiler: str) -> str:
+    try:
+        proc = subprocess.run([compiler, "--version"], capture_output=True, text=True, timeout=30)
+    except (OSError, subprocess.SubprocessError):
+        return compiler
+    return proc.stdout.splitlines()[0] if proc.stdout else compiler
+
+
+class ArtifactCache:
+    def __init__(self, root: str = CACHE_DIR):
+        self.root = root
+        self.hits = 0
+        self.misses = 0
+
+    def _path(self, kind: str, key: str, suffix: str = "json") -> str:
+        return os.path.join(self.root, kind, key[:2], f"{key}.{suffix}")
+
+    def get(self, kind: str, key: str):
+        path = self._path(kind, key)
+        try:
+            with open(path, encoding="utf-8") as f:
+                value = json.load(f)
+        except (OSError, json.JSONDecodeError):
+            self.misses += 1
+            return None
+        self.hits += 1
+        return value
+
+    def put(self, kind: str, key: str, value) -> None:
+        path = self._path(kind, key)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        # Write then rename, so a concurrent reader never sees a partial entry
+        fd, tmp = tempfile.mkstemp(dir=os.path.dirname(path), suffix=".tmp")
+        with os.fdopen(fd, "w", encoding="utf-8") as f:
+            json.dump(value, f, indent=1, default=str)
+        os.replace(tmp, path)
+
+    def get_object(self, kind: str, key: str):
+        """A pickled Python object (parsed ASTs); None when absent or unreadable."""
+        try:
+            with open(self._path(kind, key, "pickle"), "rb") as f:
+                value = pickle.load(f)
+        except (OSError, pickle.UnpicklingError, EOFError, AttributeError, ImportError):
+            self.misses += 1
+            return None
+        self.hits += 1
+        return value
+
+    def put_object(self, kind: str, key: str, value) -> None:
+        path = self._path(kind, key, "pickle")
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        fd, tmp = tempfile.mkstemp(dir=os.path.dirname(path), suffix=".tmp")
+        try:
+            with os.fdopen(fd, "wb") as f:
+                pickle.dump(value, f, protocol=pickle.HIGHEST_PROTOCOL)
+        except RecursionError:  # very deep expression trees; the unit is just parsed again next time
+            os.unlink(tmp)
+            return
+        os.replace(tmp, path)
+
+    def put_files(self, kind: str, key: str, work_dir: str, names: List[str]) -> None:
+        for name in names:
+            src = os.path.join(work_dir, name)
+            if os.path.exists(src):
+                dst = self._path(kind, key, name)
+                os.makedirs(os.path.dirname(dst), exist_ok=True)
+                shutil.copy2(src, dst + ".tmp")
+                os.replace(dst + ".tmp", dst)
+
+    def get_files(self, kind: str, key: str, work_dir: str, names: List[str]) -> bool:
+        """Copies every cached file into work_dir; False (nothing copied) unless all are present."""
+        paths = [self._path(kind, key, name) for name in names]
+        if not all(os.path.exists(p) for p in paths):
+            return False
+        for name, path in zip(names, paths):
+            shutil.copy2(path, os.path.join(work_dir, name))
+        return True
+
+
+@dataclass
+class FunctionSpan:
+    name: str
+    start_line: int
+    end_line: int
+    text: str
+
+
+def blank_literals(code: str) -> str:
+    """Comments and string/char literals replaced by spaces (newlines kept), so braces can be matched."""
+    pattern = re.compile(r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\\n])*"|\'(?:\\.|[^\'\\\n])*\'', re.DOTALL)
+    return pattern.sub(lambda m: re.sub(r"[^\n]", " ", m.group(0)), code)
+
+
+def function_spans(code: str) -> List[FunctionSpan]:
+    """Top-level function definitions with their 1-indexed line ranges."""
+    clean = blank_literals(code)
+    clean = re.sub(r"^[ \t]*#.*$", lambda m: " " * len(m.group(0)), clean, flags=re.MULTILINE)
+    lines = code.splitlines()
+    spans = []
+    depth, head, opened = 0, 0, None
+    for pos, ch in enumerate(clean):
+        if ch == "{":
+            if depth == 0:
+                # A top-level brace opens a function body when the text since the last declaration ends in `name(...)`
+                match = _FUNC_HEAD.search(clean[head:pos + 1])
+                opened = (match.group(1), head) if match and match.end() == pos + 1 - head else None
+            depth += 1
+        elif ch == "}":
+            depth -= 1
+            if depth == 0:
+                if opened:
+                    name, start = opened
+                    start += len(clean[start:]) - len(clean[start:].lstrip())
+                    first = clean.count("\n", 0, start) + 1
+                    last = clean.count("\n", 0, pos) + 1
+                    spans.append(FunctionSpan(name, first, last, "\n".join(lines[first - 1:last])))
+                opened = None
+                head = pos + 1
+        elif ch == ";" and depth == 0:
+            head = pos + 1
+    return spans
+
+
+def file_context(code: str, spans: List[FunctionSpan]) -> str:
+    """Everything outside function bodies: includes, macros, globals, prototypes."""
+    # Comments are dropped so re-wording a file banner does not invalidate every function
+    lines = re.sub(r"//[^\n]*|/\*.*?\*/", lambda m: "\n" * m.group(0).count("\n"), code, flags=re.DOTALL).splitlines()
+    inside = {l for s in spans for l in range(s.start_line, s.end_line + 1)}
+    return "\n".join(text.strip() for i, text in enumerate(lines, 1) if i not in inside and text.strip())
+
+
+def _callers(spans: List[FunctionSpan]) -> Dict[str, List[str]]:
+    """Function name -> the functions that call it, directly or through other functions."""
+    calls = {s.name: {t.name for t in spans if t.name != s.name
+                      and re.search(rf"\b{re.escape(t.name)}\s*\(", blank_literals(s.text))} for s in spans}
+    callers = {}
+    for span in spans:
+        found, frontier = set(), [span.name]
+        while frontier:
+            callee = frontier.pop()
+            for caller, callees in calls.items():
+                if callee in callees and caller not in found and caller != span.name:
+                    found.add(caller)
+                    frontier.append(caller)
+        callers[span.name] = sorted(found)
+    return callers
+
+
+def function_keys(code: str, *identity) -> Dict[str, str]:
+    """
+    Function name -> cache key of its analysis: its text, the text of every function
+    that reaches it through calls, the file context and the model/prompt identity.
+    The callers are part of the key because the report's alias verdicts, if()
+    thresholds and profile shares depend on the call sites.
+    """
+    spans = function_spans(code)
+    context = file_context(code, spans)
+    text = {s.name: s.text for s in spans}
+    callers = _callers(spans)
+    return {s.name: digest(s.text, [text[c] for c in callers[s.name]], context, *identity) for s in spans}
+
+
+def split_by_function(candidates: List[dict], spans: List[FunctionSpan]) -> Optional[Dict[str, List[dict]]]:
+    """
+    Candidates grouped by enclosing function, lines made relative to the function
+    start. None when a candidate lies outside every function or spans several.
+    """
+    grouped = {s.name: [] for s in spans}
+    for cand in candidates:
+        owner = next((s for s in spans if s.start_line <= cand["start_line"] and cand["end_line"] <= s.end_line), None)
+        if owner is None:
+            return None
+        grouped[owner.name].append({**cand, "start_line": cand["start_line"] - owner.start_line,
+                                    "end_line": cand["end_line"] - owner.start_line})
+    return grouped
+
+
+def place_candidates(relative: List[dict], span: FunctionSpan) -> List[dict]:
+    return [{**c, "start_line": c["start_line"] + span.start_line, "end_line": c["end_line"] + span.start_line}
+            for c in relative]
+
+
+def renumber(candidates: List[dict]) -> List[dict]:
+    """Sorted by line with fresh C001.. ids, so merged cached and new candidates do not collide."""
+    ordered = sorted(candidates, key=lambda c: (c["start_line"], c["end_line"]))
+    return [{**c, "id": f"C{i:03d}"} for i, c in enumerate(ordered, 1)]
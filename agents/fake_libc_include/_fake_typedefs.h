@@ -0,0 +1,132 @@
+/*
+ * _fake_typedefs.h - types of the C library headers as plain typedefs, so
+ * pycparser can tell type names from identifiers. Layouts are not modelled.
+ */
+#ifndef MAAP_FAKE_TYPEDEFS_H
+#define MAAP_FAKE_TYPEDEFS_H
+
+typedef unsigned long size_t;
+typedef long ssize_t;
+typedef long ptrdiff_t;
+typedef int wchar_t;
+typedef unsigned int wint_t;
+typedef struct { long long a; long double b; } max_align_t;
+
+typedef signed char int8_t;
+typedef short int16_t;
+typedef int int32_t;
+typedef long int64_t;
+typedef unsigned char uint8_t;
+typedef unsigned short uint16_t;
+typedef unsigned int uint32_t;
+typedef unsigned long uint64_t;
+typedef signed char int_least8_t;
+typedef short int_least16_t;
+typedef int int_least32_t;
+typedef long int_least64_t;
+typedef unsigned char uint_least8_t;
+typedef unsigned short uint_least16_t;
+typedef unsigned int uint_least32_t;
+typedef unsigned long uint_least64_t;
+typedef signed char int_fast8_t;
+typedef long int_fast16_t;
+typedef long int_fast32_t;
+typedef long int_fast64_t;
+typedef unsigned char uint_fast8_t;
+typedef unsigned long uint_fast16_t;
+typedef unsigned long uint_fast32_t;
+typedef unsigned long uint_fast64_t;
+typedef long intptr_t;
+typedef unsigned long uintptr_t;
+typedef long intmax_t;
+typedef unsigned long uintmax_t;
+
+typedef float float_t;
+typedef double double_t;
+
+typedef int FILE;
+typedef int fpos_t;
+typedef int va_list;
+typedef int __builtin_va_list;
+typedef int __gnuc_va_list;
+typedef int div_t;
+typedef int ldiv_t;
+typedef int lldiv_t;
+typedef int mbstate_t;
+typedef int locale_t;
+typedef int jmp_buf;
+typedef int sigjmp_buf;
+typedef int sig_atomic_t;
+typedef int sigset_t;
+typedef int DIR;
+typedef int regex_t;
+typedef int regmatch_t;
+
+typedef long time_t;
+typedef long clock_t;
+typedef int clockid_t;
+typedef long suseconds_t;
+typedef unsigned int useconds_t;
+typedef long off_t;
+typedef long off64_t;
+typedef int pid_t;
+typedef unsigned int uid_t;
+typedef unsigned int gid_t;
+typedef unsigned int mode_t;
+typedef unsigned long dev_t;
+typedef unsigned long ino_t;
+typedef unsigned long nlink_t;
+typedef long blksize_t;
+typedef long blkcnt_t;
+typedef unsigned int socklen_t;
+typedef int id_t;
+typedef int key_t;
+typedef int cpu_set_t;
+
+typedef unsigned long pthread_t;
+typedef int pthread_attr_t;
+typedef int pthread_mutex_t;
+typedef int pthread_mutexattr_t;
+typedef int pthread_cond_t;
+typedef int pthread_condattr_t;
+typedef int pthread_barrier_t;
+typedef int pthread_barrierattr_t;
+typedef int pthread_rwlock_t;
+typedef int pthread_spinlock_t;
+typedef int pthread_key_t;
+typedef int pthread_once_t;
+
+typedef int omp_lock_t;
+typedef int omp_nest_lock_t;
+typedef int omp_sched_t;
+typedef int omp_proc_bind_t;
+typedef int omp_lock_hint_t;
+typedef int omp_depend_t;
+typedef int omp_memspace_handle_t;
+typedef int omp_allocator_handle_t;
+
+typedef int atomic_bool;
+typedef int atomic_int;
+typedef int atomic_uint;
+typedef int atomic_long;
+typedef int atomic_ulong;
+typedef int atomic_llong;
+typedef int atomic_ullong;
+typedef int atomic_size_t;
+typedef int atomic_flag;
+typedef int memory_order;
+
+typedef int __m64;
+typedef int __m128;
+typedef int __m128d;
+typedef int __m128i;
+typedef int __m256;
+typedef int __m256d;
+typedef int __m256i;
+typedef int __m512;
+typedef int __m512d;
+typedef int __m512i;
+typedef int __mmask8;
+typedef int __mmask16;
+
+#endif /* MAAP_FAKE_TYPEDEFS_H */
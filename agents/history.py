@@ -0,0 +1,124 @@
+"""
+Append-only store of every validation result, one JSON object per line.
+report.txt and metrics.json describe the last run of one file, and the next
+run overwrites them. Generated code is a moving target: a model upgrade or
+a prompt edit can cost 20% on one kernel without any file failing. Each
+validation (each variant with --variants) appends a record here:
+  - the file, and digests of the source and the generated code;
+  - the variant's strategy and the attempt number;
+  - the model name and the agents' prompt versions;
+  - the machine (host, CPU model, CPUs) and the compiler;
+  - the threads and CPUs used, every timing sample, the point speedup and its interval;
+  - the refactored peak RSS and its growth over the original's, when measured;
+  - whether the gate accepted the result, and the error when it did not.
+`python -m agents.history [output/history.jsonl]` groups the records by file, host
+and model/prompt version and prints the median speedup of each group in time
+order, so a drop after a change stands out.
+"""
+
+import json
+import os
+import platform
+import socket
+import statistics
+import sys
+import threading
+import time
+from collections import OrderedDict
+from functools import lru_cache
+from typing import List, Optional
+
+from agents.cache import compiler_version, digest, model_identity
+
+HISTORY_FILE = os.path.join("output", "history.jsonl")
+_lock = threading.Lock()                 # pipelines of one batch append from several threads
+
+
+@lru_cache(maxsize=None)
+def machine_identity(compiler: str = "gcc") -> dict:
+    model = platform.processor()
+    try:
+        with open("/proc/cpuinfo", encoding="utf-8") as f:
+            model = next((l.split(":", 1)[1].strip() for l in f if l.startswith("model name")), model)
+    except OSError:
+        pass
+    return {"host": socket.gethostname(), "cpu": model, "cpus": os.cpu_count(), "system": platform.system(),
+            "compiler": compiler_version(compiler).splitlines()[0] if compiler else None}
+
+
+def history_record(file: str, source: str, code: str, metrics: dict, accepted: bool, *, variant: Optional[str] = None,
+                   attempt: int = 0, prompts: Optional[dict] = None, compiler: str = "gcc",
+                   cpus: Optional[List[int]] = None) -> dict:
+    return {
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "file": file,
+        "source_digest": digest(source)[:16],
+        "code_digest": digest(code)[:16],
+        "variant": variant,
+        "attempt": attempt,
+        "model": model_identity(),
+        "prompts": prompts or {},
+        "machine": machine_identity(compiler),
+        "threads": metrics.get("threads"),
+        "cpus": cpus or [],
+        "original_time": metrics.get("original_time"),
+        "refactored_time": metrics.get("refactored_time"),
+        "original_samples": metrics.get("original_samples"),
+        "refactored_samples": metrics.get("refactored_samples"),
+        "speedup": metrics.get("speedup"),
+        "speedup_ci": metrics.get("speedup_ci"),
+        "peak_rss": ((metrics.get("memory") or {}).get("refactored") or {}).get("peak_rss"),
+        "rss_growth": (metrics.get("memory") or {}).get("rss_growth"),
+        "accepted": accepted,
+        "error": None if accepted else metrics.get("error"),
+    }
+
+
+def append_history(path: Optional[str], records: List[dict]) -> None:
+    """Appends records to the store; no-op when path is None (--history '')."""
+    if not path or not records:
+        return
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    text = "".join(json.dumps(r, sort_keys=True) + "\n" for r in records)
+    with _lock, open(path, "a", encoding="utf-8") as f:
+        f.write(text)
+
+
+def load_history(path: str = HISTORY_FILE) -> List[dict]:
+    records = []
+    try:
+        with open(path, encoding="utf-8") as f:
+            for line in f:
+                try:
+                    records.append(json.loads(line))
+                except json.JSONDecodeError:
+                    continue
+    except OSError:
+        pass
+    return records
+
+
+def format_history(records: List[dict]) -> str:
+    """Per file, one line per host and model/prompt version in order of first appearance, accepted results only."""
+    groups = OrderedDict()
+    for r in records:
+        if r.get("accepted") and r.get("speedup"):
+            prompts = "/".join(v for _, v in sorted((r.get("prompts") or {}).items()))
+            version = f"{(r.get('machine') or {}).get('host')} {r.get('model')} {prompts}".strip()
+            groups.setdefault(r["file"], OrderedDict()).setdefault(version, []).append(r)
+    lines = ["=== Speedup History ==="]
+    for file, versions in groups.items():
+        lines.append(file)
+        previous = None
+        for version, runs in versions.items():
+            median = statistics.median(r["speedup"] for r in runs)
+            lows = [r["speedup_ci"]["low"] for r in runs if r.get("speedup_ci")]
+            low = f", CI low {min(lows):.2f}x" if lows else ""
+            change = f" ({median / previous - 1:+.0%})" if previous else ""
+            lines.append(f"  {version:<40} {len(runs):>3} run(s)  median {median:.2f}x{low}{change}")
+            previous = median
+    return "\n".join(lines) + "\n"
+
+
+if __name__ == "__main__":
+    print(format_history(load_history(sys.argv[1] if len(sys.argv) > 1 else HISTORY_FILE)), end="")
@@ -6,7 +6,8 @@ from typing import List, Optional, Literal
 class AppliedChange(BaseModel):
     start_line: int = Field(..., description="Loop start line modified")
     end_line: int = Field(..., description="Loop end line modified")
-    backend: Literal["processes", "threads"] = Field(..., description="joblib prefer backend used")
+    backend: Literal["processes", "threads", "pool"] = Field(
+        ..., description="joblib prefer backend used, or pool for the persistent maap_pool process pool")
     note: Optional[str] = Field(None, description="Short explanation of what changed")
 
 class OutputModel(BaseModel):
@@ -21,8 +22,10 @@ Goal:
 Refactor the provided code to parallelize identified safe candidates (loops or independent tasks) to run concurrently.
 
 Supported Backends:
-1. `joblib` (Preferred for loops): `from joblib import Parallel, delayed`
-2. `concurrent.futures` (Preferred for independent task graphs): `from concurrent.futures import ThreadPoolExecutor, ProcessPoolExecutor`
+1. `maap_pool` (Preferred for CPU-bound loops): `import maap_pool` - one process pool for the whole program,
+   inputs in shared memory, adaptive chunking
+2. `joblib` (I/O-bound loops): `from joblib import Parallel, delayed`
+3. `concurrent.futures` (Preferred for independent task graphs): `from concurrent.futures import ThreadPoolExecutor, ProcessPoolExecutor`
 
 You will receive:
 - Original code
@@ -40,8 +43,19 @@ Rules:
       - Use `ThreadPoolExecutor` (for I/O) or `ProcessPoolExecutor` (for CPU).
       - Submit tasks -> `future = executor.submit(func, args)`.
       - Gather results -> `val_a = future_a.result()`.
+   C. Persistent Pool (maap_pool, CPU-bound loops):
+      - Move the loop body to a top-level `def _chunk(lo, hi, *inputs)` that handles iterations lo..hi-1 and
+        returns a list of their results; workers find it by name, so never use lambdas or nested functions.
+      - Pass large inputs (lists, lists of rows, arrays) through `h = maap_pool.share(x)` once, outside any
+        time-step loop; the worker gets an indexable view (`M[i][j]` for a list of rows). When the parent changes
+        x between calls (positions after a step), call `maap_pool.update(h, x)` instead of sharing it again.
+      - `out = maap_pool.map_range(_chunk, n, *inputs)` returns the concatenated lists in iteration order;
+        `maap_pool.reduce_range(_chunk, n, *inputs)` adds up per-chunk partial results (op= for other operators).
+      - Workers must not mutate their inputs; write results back in the parent (e.g. `forces_x[:] = out`).
+      - Keep loops with little work per iteration sequential; the pool is started once and reused, but every
+        task still costs a round trip.
 4) Choosing Backend:
-   - CPU-bound (math, heavy logic) -> Process-based (`n_jobs=-1, prefer="processes"` or `ProcessPoolExecutor`).
+   - CPU-bound (math, heavy logic) -> maap_pool (backend="pool"); `ProcessPoolExecutor` only for task graphs.
    - I/O-bound (network, sleep, disk) -> Thread-based (`n_jobs=4, prefer="threads"` or `ThreadPoolExecutor`).
 5) Safety:
    - No shared mutation without locks (and avoid locks if possible).
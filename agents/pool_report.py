@@ -0,0 +1,57 @@
+"""
+Overhead report for Python code parallelized with maap_pool (benchmarks/python/include).
+The runtime writes its counters to $MAAP_POOL_STATS when the validation
+script exits. This module splits the refactored run into worker spawn,
+pickling and compute, so a weak speedup can be traced to the right cost.
+"""
+
+import json
+import os
+import shutil
+from typing import Optional
+
+from agents.bench_utils import PY_RUNTIME
+
+STATS_FILE = "pool_stats.json"
+
+
+def uses_pool(code: str) -> bool:
+    return "maap_pool" in code
+
+
+def install_runtime(directory: str) -> None:
+    """Copies maap_pool.py next to the code that imports it."""
+    for path in PY_RUNTIME:
+        shutil.copy(path, directory)
+
+
+def read_pool_stats(work_dir: str) -> Optional[dict]:
+    try:
+        with open(os.path.join(work_dir, STATS_FILE), encoding="utf-8") as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+
+def format_pool_report(stats: dict, refactored_time: Optional[float]) -> str:
+    workers = max(stats.get("workers") or 1, 1)
+    spawn, serialize, compute, wall = (stats.get(k, 0.0) for k in ("spawn_s", "serialize_s", "compute_s", "wall_s"))
+    share = lambda t: f" ({t / refactored_time:.0%} of the refactored time)" if refactored_time else ""
+    lines = ["=== Process Pool (maap_pool) ===",
+             f"Workers: {stats.get('workers') or 'inline'}; {stats.get('tasks', 0)} task(s) over "
+             f"{stats.get('items', 0)} iteration(s); {stats.get('shared_bytes', 0) / 1e6:.1f} MB in shared memory, "
+             f"{(stats.get('bytes_sent', 0) + stats.get('bytes_received', 0)) / 1e6:.2f} MB pickled",
+             f"Spawn:         {spawn:.4f}s{share(spawn)}",
+             f"Serialization: {serialize:.4f}s{share(serialize)}",
+             f"Compute:       {compute:.4f}s in workers, {wall:.4f}s in parallel loops"
+             + (f" ({compute / wall / workers:.0%} of {workers} workers busy)" if wall > 0 and stats.get("workers")
+                else "")]
+    for name, loop in (stats.get("loops") or {}).items():
+        lines.append(f"  {name}: {loop['calls']} call(s), {loop['tasks']} task(s), {loop['wall_s']:.4f}s, "
+                     f"smallest chunk {loop['min_chunk'] or '-'}")
+    if refactored_time and spawn + serialize > 0.5 * refactored_time:
+        lines.append("Diagnosis: spawn and pickling dominate; share() large inputs and merge small loops into one "
+                     "map_range call")
+    elif wall > 0 and stats.get("workers") and compute < 0.5 * wall * workers:
+        lines.append("Diagnosis: workers are idle half the time; the loop is too short or its chunks are uneven")
+    return "\n".join(lines) + "\n"
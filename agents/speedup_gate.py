@@ -0,0 +1,123 @@
+"""
+Confidence-interval gate on the measured speedup.
+The validator used to reject a transformation when the point speedup, the
+ratio of two medians, fell below 1.0. On a shared host, run-to-run noise
+easily swings a timing by +/-15%. A real 1.1x gain then fails about as often
+as a 0.95x regression passes. The gate instead takes the per-run samples of
+both binaries and computes a confidence interval on the speedup, in one of two
+ways:
+  - bootstrap: resample each side's runs with replacement, take the ratio of the
+    medians, and read the percentile interval (the default; assumes nothing about
+    the shape of the timing distribution);
+  - welch: Welch's t interval on the difference of mean log-times, exponentiated
+    into a ratio (unequal variances and run counts).
+A transformation passes only when the interval's lower bound clears
+--min-speedup. Without at least two samples per side (an LLM-written
+validation script, for instance), the point speedup is compared with the
+threshold, as before.
+"""
+
+import math
+import random
+import statistics
+from dataclasses import dataclass
+from typing import List, Optional, Tuple
+
+METHODS = ("bootstrap", "welch")
+RESAMPLES = 4000
+MIN_SAMPLES = 2
+
+
+@dataclass
+class SpeedupInterval:
+    estimate: float                       # ratio of the medians (bootstrap) or of the geometric means (welch)
+    low: float
+    high: float
+    method: str
+    confidence: float
+    runs: Tuple[int, int]                 # samples of the original and the refactored program
+
+    def describe(self) -> str:
+        return (f"{self.estimate:.2f}x, {self.confidence:.0%} CI [{self.low:.2f}x, {self.high:.2f}x] "
+                f"({self.method}, {self.runs[0]}+{self.runs[1]} runs)")
+
+
+def bootstrap_interval(original: List[float], refactored: List[float], confidence: float = 0.95,
+                       resamples: int = RESAMPLES, seed: int = 0) -> SpeedupInterval:
+    """Percentile bootstrap of median(original) / median(refactored); seeded, so reruns agree."""
+    rng = random.Random(seed)
+    ratios = []
+    for _ in range(resamples):
+        o = statistics.median(rng.choices(original, k=len(original)))
+        r = statistics.median(rng.choices(refactored, k=len(refactored)))
+        if r > 0:
+            ratios.append(o / r)
+    ratios.sort()
+    tail = (1.0 - confidence) / 2
+    low = ratios[int(tail * (len(ratios) - 1))]
+    high = ratios[int(math.ceil((1.0 - tail) * (len(ratios) - 1)))]
+    estimate = statistics.median(original) / statistics.median(refactored)
+    return SpeedupInterval(estimate, low, high, "bootstrap", confidence, (len(original), len(refactored)))
+
+
+def _t_quantile(p: float, df: float) -> float:
+    """
+    Student t quantile at df rounded down (the wider interval): exact for 1 and 2
+    degrees of freedom, else the Cornish-Fisher expansion around the normal quantile.
+    """
+    df = max(1, math.floor(df))
+    if df == 1:
+        return math.tan(math.pi * (p - 0.5))
+    if df == 2:
+        return (2 * p - 1) / math.sqrt(2 * p * (1 - p))
+    z = statistics.NormalDist().inv_cdf(p)
+    return (z + (z ** 3 + z) / (4 * df) + (5 * z ** 5 + 16 * z ** 3 + 3 * z) / (96 * df ** 2)
+            + (3 * z ** 7 + 19 * z ** 5 + 17 * z ** 3 - 15 * z) / (384 * df ** 3))
+
+
+def welch_interval(original: List[float], refactored: List[float], confidence: float = 0.95) -> SpeedupInterval:
+    """Welch's t interval on mean(log original) - mean(log refactored), as a speedup ratio."""
+    lo, lr = [math.log(t) for t in original], [math.log(t) for t in refactored]
+    mo, mr = statistics.fmean(lo), statistics.fmean(lr)
+    vo, vr = statistics.variance(lo) / len(lo), statistics.variance(lr) / len(lr)
+    se = math.sqrt(vo + vr)
+    if se == 0:
+        ratio = math.exp(mo - mr)
+        return SpeedupInterval(ratio, ratio, ratio, "welch", confidence, (len(lo), len(lr)))
+    df = (vo + vr) ** 2 / (vo ** 2 / (len(lo) - 1) + vr ** 2 / (len(lr) - 1))
+    half = _t_quantile(1.0 - (1.0 - confidence) / 2, df) * se
+    return SpeedupInterval(math.exp(mo - mr), math.exp(mo - mr - half), math.exp(mo - mr + half), "welch",
+                           confidence, (len(lo), len(lr)))
+
+
+def speedup_interval(metrics: dict, method: str = "bootstrap", confidence: float = 0.95) -> Optional[SpeedupInterval]:
+    """The interval from the metrics' timing samples; None without MIN_SAMPLES positive runs per side."""
+    original = [t for t in metrics.get("original_samples") or [] if t and t > 0]
+    refactored = [t for t in metrics.get("refactored_samples") or [] if t and t > 0]
+    if len(original) < MIN_SAMPLES or len(refactored) < MIN_SAMPLES:
+        return None
+    if method == "welch":
+        return welch_interval(original, refactored, confidence)
+    return bootstrap_interval(original, refactored, confidence)
+
+
+def speedup_gate(metrics: dict, threshold: float = 1.0, method: str = "bootstrap",
+                 confidence: float = 0.95) -> Tuple[bool, Optional[SpeedupInterval], str]:
+    """
+    (passes, interval, verdict). Passing needs the interval's lower bound above the
+    threshold, or the point speedup at or above it when there are too few samples.
+    """
+    interval = speedup_interval(metrics, method, confidence)
+    speedup = metrics.get("speedup")
+    if interval is None:
+        if speedup is None:
+            return True, None, ""
+        if speedup < threshold:
+            return False, None, f"Speedup {speedup:.2f}x < {threshold:.2f}x (single measurement, no timing samples)"
+        return True, None, f"Speedup {speedup:.2f}x >= {threshold:.2f}x (single measurement, no timing samples)"
+    if interval.low > threshold:
+        return True, interval, f"Speedup {interval.describe()} clears {threshold:.2f}x"
+    if interval.high < threshold:
+        return False, interval, f"Performance regression: speedup {interval.describe()} is below {threshold:.2f}x"
+    return False, interval, (f"Speedup not significant: {interval.describe()} includes {threshold:.2f}x; "
+                             "the gain cannot be told from run-to-run noise (more --repeats narrow the interval)")
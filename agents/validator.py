@@ -10,7 +10,7 @@ system_prompt = r"""
 You are a Python Validation Engineer.
 Task: Write a python script to validate refactored code against original code.
 
-Input files in CWD: `original.py`, `refactored.py`.
+Input files in CWD: `original.py`, `refactored.py` (plus the `maap_pool.py` runtime it may import).
 
 Requirements:
 1. Use `importlib` to import `original` and `refactored`.
@@ -1,28 +1,38 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
-#include <time.h>
+#include "bench.h"
 
-#define N 100000
-
-void heavy_loop(double *data) {
-    for (int i = 0; i < N; i++) {
+void heavy_loop(double *data, int n, int inner) {
+    for (int i = 0; i < n; i++) {
         double val = sin(i * 0.01) * cos(i * 0.01);
-        for (int j = 0; j < 100; j++) {
+        for (int j = 0; j < inner; j++) {
             val = sqrt(fabs(val) + 1.0);
         }
         data[i] = val;
     }
 }
 
-int main() {
-    static double data[N];
-    clock_t start = clock();
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long ws = bench_class_bytes();
+    int n = (int)bench_param_long("n", ws ? ws / (long)sizeof(double) : 100000);
+    int inner = (int)bench_param_long("inner", 100);
+    double *data = (double*)malloc(n * sizeof(double));
     
     printf("Starting C heavy loop...\n");
-    heavy_loop(data);
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        heavy_loop(data, n, inner);
+        bench_record(bench_now() - start);
+    }
+    
+    double checksum = 0.0;
+    for (int i = 0; i < n; i++) checksum += data[i];
+    printf("data[n-1] = %.6f\n", data[n - 1]);
+    printf("Checksum: %.6e\n", checksum);
+    bench_report("heavy_loop");
     
-    clock_t end = clock();
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
-    printf("Elapsed: %.2fs\n", time_spent);
+    free(data);
     return 0;
 }
@@ -1,26 +1,32 @@
 #include <stdio.h>
-#include <time.h>
+#include <stdlib.h>
+#include "bench.h"
 
-#define N 1000000
-
-double calculate_sum(double *data) {
+double calculate_sum(double *data, int n) {
     double total = 0.0;
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < n; i++) {
         total += data[i];
     }
     return total;
 }
 
-int main() {
-    static double data[N];
-    for(int i=0; i<N; i++) data[i] = 1.0;
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long ws = bench_class_bytes();
+    int n = (int)bench_param_long("n", ws ? ws / (long)sizeof(double) : 1000000);
+    double *data = (double*)malloc(n * sizeof(double));
+    for(int i=0; i<n; i++) data[i] = 1.0;
     
-    clock_t start = clock();
-    double sum = calculate_sum(data);
-    clock_t end = clock();
+    double sum = 0.0;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        sum = calculate_sum(data, n);
+        bench_record(bench_now() - start);
+    }
     
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
     printf("Sum: %.2f\n", sum);
-    printf("Elapsed: %.2fs\n", time_spent);
+    bench_report("calculate_sum");
+    
+    free(data);
     return 0;
 }
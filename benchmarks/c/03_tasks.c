@@ -1,29 +1,32 @@
 #include <stdio.h>
-#include <time.h>
 #include <math.h>
+#include "bench.h"
 
-double task_a() {
+double task_a(int n) {
     double res = 0;
-    for(int i=0; i<100000; i++) res += sin(i);
+    for(int i=0; i<n; i++) res += sin(i);
     return res;
 }
 
-double task_b() {
+double task_b(int n) {
     double res = 0;
-    for(int i=0; i<100000; i++) res += cos(i);
+    for(int i=0; i<n; i++) res += cos(i);
     return res;
 }
 
-int main() {
-    clock_t start = clock();
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    int n = (int)bench_param_long("n", 100000);
     
-    double a = task_a();
-    double b = task_b();
-    
-    clock_t end = clock();
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
+    double a = 0.0, b = 0.0;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        a = task_a(n);
+        b = task_b(n);
+        bench_record(bench_now() - start);
+    }
     
     printf("Result: %.2f\n", a + b);
-    printf("Elapsed: %.2fs\n", time_spent);
+    bench_report("tasks");
     return 0;
 }
@@ -1,6 +1,6 @@
 #include <stdio.h>
-#include <time.h>
 #include <stdlib.h>
+#include "bench.h"
 
 void vector_ops(double *a, double *b, double *c, int n) {
     for(int i=0; i<n; i++) {
@@ -8,8 +8,10 @@ void vector_ops(double *a, double *b, double *c, int n) {
     }
 }
 
-int main() {
-    int n = 1000000;
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long ws = bench_class_bytes();
+    int n = (int)bench_param_long("n", ws ? ws / (3 * (long)sizeof(double)) : 1000000);
     double *a = (double*)malloc(n * sizeof(double));
     double *b = (double*)malloc(n * sizeof(double));
     double *c = (double*)malloc(n * sizeof(double));
@@ -19,13 +21,17 @@ int main() {
         b[i] = (double)(n-i);
     }
     
-    clock_t start = clock();
-    vector_ops(a, b, c, n);
-    clock_t end = clock();
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        vector_ops(a, b, c, n);
+        bench_record(bench_now() - start);
+    }
     
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
+    double checksum = 0.0;
+    for (int i = 0; i < n; i++) checksum += c[i];
     printf("Result[0]: %.2f\n", c[0]);
-    printf("Elapsed: %.2fs\n", time_spent);
+    printf("Checksum: %.6e\n", checksum);
+    bench_report("vector_ops");
     
     free(a); free(b); free(c);
     return 0;
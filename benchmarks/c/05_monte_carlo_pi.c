@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "bench.h"
 
 long monte_carlo_pi_part(long n) {
     long count = 0;
@@ -16,23 +17,29 @@ long monte_carlo_pi_part(long n) {
     return count;
 }
 
-int main() {
-    long total_samples = 10000000;
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long total_samples = bench_param_long("samples", 10000000);
     long count = 0;
     
-    clock_t start = clock();
-    
-    for (long i = 0; i < total_samples; i++) {
-        double x = (double)rand() / RAND_MAX;
-        double y = (double)rand() / RAND_MAX;
-        if (x*x + y*y <= 1.0) count++;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        /* Same sample stream on every run, as for a fresh process. */
+        srand(1);
+        count = 0;
+        double start = bench_now();
+        
+        for (long i = 0; i < total_samples; i++) {
+            double x = (double)rand() / RAND_MAX;
+            double y = (double)rand() / RAND_MAX;
+            if (x*x + y*y <= 1.0) count++;
+        }
+        
+        bench_record(bench_now() - start);
     }
     
-    clock_t end = clock();
     double pi = 4.0 * count / total_samples;
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
     
     printf("Pi Estimate: %.5f\n", pi);
-    printf("Elapsed: %.2fs\n", time_spent);
+    bench_report("monte_carlo_pi");
     return 0;
 }
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <math.h>
+#include "bench.h"
 
 void multiply_matrices(double *A, double *B, double *C, int N) {
     for (int i = 0; i < N; i++) {
@@ -14,8 +15,10 @@ void multiply_matrices(double *A, double *B, double *C, int N) {
     }
 }
 
-int main() {
-    int N = 500;
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long ws = bench_class_bytes();
+    int N = (int)bench_param_long("n", ws ? (long)sqrt(ws / (3.0 * sizeof(double))) : 500);
     double *A = (double*)malloc(N * N * sizeof(double));
     double *B = (double*)malloc(N * N * sizeof(double));
     double *C = (double*)malloc(N * N * sizeof(double));
@@ -25,16 +28,19 @@ int main() {
         B[i] = (double)(i % 100);
     }
     
-    clock_t start = clock();
     printf("Multiplying %dx%d matrices...\n", N, N);
     
-    multiply_matrices(A, B, C, N);
-    
-    clock_t end = clock();
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        multiply_matrices(A, B, C, N);
+        bench_record(bench_now() - start);
+    }
     
-    printf("Elapsed: %.2fs\n", time_spent);
+    double checksum = 0.0;
+    for (int i = 0; i < N * N; i++) checksum += C[i];
     printf("C[0] = %.2f\n", C[0]);
+    printf("Checksum: %.6e\n", checksum);
+    bench_report("multiply_matrices");
     
     free(A); free(B); free(C);
     return 0;
@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include <time.h>
+#include "bench.h"
 
 void nbody_step(double *pos_x, double *pos_y, double *vel_x, double *vel_y, double *mass, double dt, int n) {
     double *forces_x = (double*)malloc(n * sizeof(double));
@@ -35,31 +35,47 @@ void nbody_step(double *pos_x, double *pos_y, double *vel_x, double *vel_y, doub
     free(forces_y);
 }
 
-int main() {
-    int N = 2000;
+void init_bodies(double *pos_x, double *pos_y, double *vel_x, double *vel_y, double *mass, int n, int layout) {
+    for(int i=0; i<n; i++) {
+        /* layout 0 stacks body i on body i+100; layout 1 offsets them so no two coincide */
+        double offset = layout ? (double)(i / 100) * 0.01 : 0.0;
+        pos_x[i] = (double)(i % 100) + offset;
+        pos_y[i] = (double)((i*2) % 100) + offset;
+        vel_x[i] = 0.0;
+        vel_y[i] = 0.0;
+        mass[i] = 1.0;
+    }
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    int N = (int)bench_param_long("n", 2000);
+    int steps = (int)bench_param_long("steps", 5);
+    int layout = (int)bench_param_long("layout", 0);
     double *pos_x = (double*)malloc(N * sizeof(double));
     double *pos_y = (double*)malloc(N * sizeof(double));
     double *vel_x = (double*)malloc(N * sizeof(double));
     double *vel_y = (double*)malloc(N * sizeof(double));
     double *mass = (double*)malloc(N * sizeof(double));
     
-    for(int i=0; i<N; i++) {
-        pos_x[i] = (double)(i % 100);
-        pos_y[i] = (double)((i*2) % 100);
-        vel_x[i] = 0.0;
-        vel_y[i] = 0.0;
-        mass[i] = 1.0;
-    }
-    
     printf("Simulating %d bodies...\n", N);
-    clock_t start = clock();
     
-    for(int s=0; s<5; s++) {
-        nbody_step(pos_x, pos_y, vel_x, vel_y, mass, 0.01, N);
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        init_bodies(pos_x, pos_y, vel_x, vel_y, mass, N, layout);
+        double start = bench_now();
+        
+        for(int s=0; s<steps; s++) {
+            nbody_step(pos_x, pos_y, vel_x, vel_y, mass, 0.01, N);
+        }
+        
+        bench_record(bench_now() - start);
     }
     
-    clock_t end = clock();
-    printf("Elapsed: %.2fs\n", (double)(end - start) / CLOCKS_PER_SEC);
+    double checksum = 0.0;
+    for (int i = 0; i < N; i++) checksum += pos_x[i] + pos_y[i];
+    printf("Body 0: (%.6f, %.6f)\n", pos_x[0], pos_y[0]);
+    printf("Checksum: %.6e\n", checksum);
+    bench_report("nbody_step");
     
     free(pos_x); free(pos_y); free(vel_x); free(vel_y); free(mass);
     return 0;
@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include <time.h>
+#include "bench.h"
 
 void convolution(double *input, double *output, int rows, int cols) {
     for (int r = 1; r < rows - 1; r++) {
@@ -17,26 +17,38 @@ void convolution(double *input, double *output, int rows, int cols) {
     }
 }
 
-int main() {
-    int R = 2000;
-    int C = 2000;
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long ws = bench_class_bytes();
+    int side = ws ? (int)sqrt(ws / (2.0 * sizeof(double))) : 2000;
+    int R = (int)bench_param_long("rows", side);
+    int C = (int)bench_param_long("cols", side);
+    int steps = (int)bench_param_long("steps", 5);
     double *input = (double*)malloc(R * C * sizeof(double));
     double *output = (double*)malloc(R * C * sizeof(double));
     
-    for(int i=0; i<R*C; i++) input[i] = (double)(i % 255);
-    
     printf("Applying convolution to %dx%d image...\n", R, C);
-    clock_t start = clock();
     
-    for(int i=0; i<5; i++) {
-        convolution(input, output, R, C);
-        double *temp = input;
-        input = output;
-        output = temp;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        for(int i=0; i<R*C; i++) input[i] = (double)(i % 255);
+        for(int i=0; i<R*C; i++) output[i] = 0.0;
+        double start = bench_now();
+        
+        for(int i=0; i<steps; i++) {
+            convolution(input, output, R, C);
+            double *temp = input;
+            input = output;
+            output = temp;
+        }
+        
+        bench_record(bench_now() - start);
     }
     
-    clock_t end = clock();
-    printf("Elapsed: %.2fs\n", (double)(end - start) / CLOCKS_PER_SEC);
+    double checksum = 0.0;
+    for (int i = 0; i < R * C; i++) checksum += input[i];
+    printf("Center: %.6f\n", input[(R/2)*C + C/2]);
+    printf("Checksum: %.6e\n", checksum);
+    bench_report("convolution");
     
     free(input); free(output);
     return 0;
@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 #include <string.h>
+#include "bench.h"
 
 void merge(int *arr, int l, int m, int r) {
     int i, j, k;
@@ -40,28 +40,30 @@ void merge_sort(int *arr, int l, int r) {
     }
 }
 
-int main() {
-    int n = 500000;
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long ws = bench_class_bytes();
+    int n = (int)bench_param_long("n", ws ? ws / (2 * (long)sizeof(int)) : 500000);
     int *arr = (int*)malloc(n * sizeof(int));
     
-    srand(42);
-    for(int i=0; i<n; i++) arr[i] = rand() % n;
-    
     printf("Sorting %d elements with Merge Sort...\n", n);
-    clock_t start = clock();
-    
-    merge_sort(arr, 0, n - 1);
     
-    clock_t end = clock();
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
-    
-    printf("Elapsed: %.2fs\n", time_spent);
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        srand(42);
+        for(int i=0; i<n; i++) arr[i] = rand() % n;
+        double start = bench_now();
+        
+        merge_sort(arr, 0, n - 1);
+        
+        bench_record(bench_now() - start);
+    }
     
     int sorted = 1;
     for(int i=0; i<n-1; i++) {
         if(arr[i] > arr[i+1]) { sorted = 0; break; }
     }
     printf("Sorted: %s\n", sorted ? "YES" : "NO");
+    bench_report("merge_sort");
     
     free(arr);
     return 0;
@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 #include <math.h>
+#include "bench.h"
 
 int is_prime(int n) {
     if (n <= 1) return 0;
@@ -25,18 +25,20 @@ int count_primes(int start, int end) {
     return count;
 }
 
-int main() {
-    int limit = 500000;
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    int limit = (int)bench_param_long("limit", 500000);
     
     printf("Counting primes up to %d...\n", limit);
-    clock_t start = clock();
     
-    int result = count_primes(0, limit);
-    
-    clock_t end = clock();
-    double time_spent = (double)(end - start) / CLOCKS_PER_SEC;
+    int result = 0;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        result = count_primes(0, limit);
+        bench_record(bench_now() - start);
+    }
     
     printf("Found %d primes.\n", result);
-    printf("Elapsed: %.2fs\n", time_spent);
+    bench_report("count_primes");
     return 0;
 }
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+double transform(double x, int work) {
+    double y = x;
+    for (int k = 0; k < work; k++) {
+        y = y * 0.5 + x / (1.0 + y * y);
+    }
+    return y;
+}
+
+long write_dataset(const char *path, long records) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    long bytes = 0;
+    for (long i = 0; i < records; i++) {
+        unsigned long h = (unsigned long)i * 2654435761UL % 1000000UL;
+        bytes += fprintf(f, "%ld,%.3f\n", i, h / 1000.0);
+    }
+    fclose(f);
+    return bytes;
+}
+
+/* Parses the complete "id,value" lines of buf[0:len); returns the bytes consumed. */
+long parse_records(const char *buf, long len, long *ids, double *values, long *count) {
+    long pos = 0;
+    long n = 0;
+    while (pos < len) {
+        const char *nl = memchr(buf + pos, '\n', len - pos);
+        if (!nl) break;
+        char *end;
+        ids[n] = strtol(buf + pos, &end, 10);
+        values[n] = strtod(end + 1, NULL);
+        n++;
+        pos = (nl - buf) + 1;
+    }
+    *count = n;
+    return pos;
+}
+
+long format_records(char *out, const long *ids, const double *results, long n) {
+    long bytes = 0;
+    for (long i = 0; i < n; i++) {
+        bytes += sprintf(out + bytes, "%ld,%.6f\n", ids[i], results[i]);
+    }
+    return bytes;
+}
+
+long process_file(const char *in_path, const char *out_path, int work, long chunk, long *checksum, long *written) {
+    FILE *in = fopen(in_path, "rb");
+    FILE *out = fopen(out_path, "wb");
+    if (!in || !out) return -1;
+    long max_records = chunk / 2 + 1;
+    char *buf = (char*)malloc(chunk);
+    long *ids = (long*)malloc(max_records * sizeof(long));
+    double *values = (double*)malloc(max_records * sizeof(double));
+    double *results = (double*)malloc(max_records * sizeof(double));
+    char *text = (char*)malloc(max_records * 48);
+    long have = 0;
+    long records = 0;
+    *checksum = 0;
+    *written = 0;
+
+    for (;;) {
+        long got = (long)fread(buf + have, 1, chunk - have, in);
+        have += got;
+        if (have == 0) break;
+
+        long n;
+        long used = parse_records(buf, have, ids, values, &n);
+        for (long i = 0; i < n; i++) {
+            results[i] = transform(values[i], work);
+        }
+        for (long i = 0; i < n; i++) {
+            *checksum += (long)(results[i] * 1000.0);
+        }
+        long bytes = format_records(text, ids, results, n);
+        fwrite(text, 1, bytes, out);
+
+        records += n;
+        *written += bytes;
+        memmove(buf, buf + used, have - used);
+        have -= used;
+        if (got == 0) break;
+    }
+
+    fclose(in);
+    fclose(out);
+    free(buf); free(ids); free(values); free(results); free(text);
+    return records;
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long records = bench_param_long("records", 1000000);
+    int work = (int)bench_param_long("work", 64);
+    long chunk = bench_param_long("chunk", 1 << 20);
+    char in_path[4096], out_path[4096];
+    snprintf(in_path, sizeof(in_path), "%s.in.csv", argv[0]);
+    snprintf(out_path, sizeof(out_path), "%s.out.csv", argv[0]);
+
+    long size = write_dataset(in_path, records);
+    printf("Processing %ld records (%ld bytes)...\n", records, size);
+
+    long count = 0, checksum = 0, written = 0;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        count = process_file(in_path, out_path, work, chunk, &checksum, &written);
+        bench_record(bench_now() - start);
+    }
+
+    printf("Records: %ld\n", count);
+    printf("Checksum: %ld\n", checksum);
+    printf("Output bytes: %ld\n", written);
+    bench_report("process_file");
+
+    remove(in_path);
+    remove(out_path);
+    return 0;
+}
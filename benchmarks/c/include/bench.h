@@ -0,0 +1,221 @@
+/*
+ * bench.h - shared wall-clock timing harness for the MAAP C benchmarks.
+ *
+ * Header-only so that original.c / refactored.c still compile as a single
+ * translation unit:
+ *
+ *     bench_init(argc, argv);
+ *     for (int rep = 0; rep < bench_runs(); rep++) {
+ *         ... reset inputs (untimed) ...
+ *         double start = bench_now();
+ *         kernel(...);
+ *         bench_record(bench_now() - start);
+ *     }
+ *     bench_report("kernel");
+ *
+ * Time is wall-clock (omp_get_wtime when built with OpenMP, CLOCK_MONOTONIC
+ * otherwise), never process CPU time, so parallel speedups are visible.
+ *
+ * Warmup and measured repeat counts come from --warmup=N / --repeats=N or
+ * the BENCH_WARMUP / BENCH_REPEATS environment variables. The first
+ * `warmup` recorded samples are discarded.
+ *
+ * Problem sizes are runtime parameters: bench_param_long("n", 100000) reads
+ * --n=VALUE, else BENCH_N, else the default. A size class (--size-class= or
+ * BENCH_SIZE_CLASS = l2 | llc | dram) turns into a target working set in
+ * bytes through bench_class_bytes(), which benchmarks use to derive their
+ * default size so one kernel can be measured cache-resident and DRAM-resident.
+ *
+ * bench_report prints exactly one JSON line on stdout, which the validator parses:
+ *
+ *     {"bench": "kernel", "clock": "wall", "threads": 4, "warmup": 1,
+ *      "repeats": 5, "min": ..., "median": ..., "p95": ..., "mean": ...,
+ *      "samples": [...]}
+ */
+#ifndef MAAP_BENCH_H
+#define MAAP_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#include <time.h>
+#endif
+
+#define BENCH_DEFAULT_WARMUP 1
+#define BENCH_DEFAULT_REPEATS 5
+#define BENCH_MAX_SAMPLES 1024
+
+static struct {
+    int argc;
+    char **argv;
+    int warmup;
+    int repeats;
+    int recorded;
+    double samples[BENCH_MAX_SAMPLES];
+} bench_state_ = { 0, NULL, BENCH_DEFAULT_WARMUP, BENCH_DEFAULT_REPEATS, 0, { 0 } };
+
+/* Option names match with '-' and '_' interchangeable: --tile-i= and --tile_i= are the same. */
+static inline int bench_name_matches_(const char *arg, const char *name, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char a = arg[i] == '-' ? '_' : arg[i];
+        char b = name[i] == '-' ? '_' : name[i];
+        if (a != b) return 0;
+    }
+    return 1;
+}
+
+/* String option from "--<name>=<value>" in argv, else env var, else NULL. */
+static inline const char *bench_option_(int argc, char **argv, const char *name, const char *env_name) {
+    size_t len = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) == 0 && strlen(arg + 2) > len && arg[2 + len] == '='
+            && bench_name_matches_(arg + 2, name, len)) {
+            return arg + 3 + len;
+        }
+    }
+    const char *env = getenv(env_name);
+    return (env && *env) ? env : NULL;
+}
+
+/* Integer option from "--<name>=<value>" in argv, else env var, else fallback. */
+static inline long bench_option_long_(int argc, char **argv, const char *name,
+                                      const char *env_name, long fallback) {
+    const char *value = bench_option_(argc, argv, name, env_name);
+    return value ? strtol(value, NULL, 10) : fallback;
+}
+
+static inline void bench_init(int argc, char **argv) {
+    long warmup = bench_option_long_(argc, argv, "warmup", "BENCH_WARMUP", BENCH_DEFAULT_WARMUP);
+    long repeats = bench_option_long_(argc, argv, "repeats", "BENCH_REPEATS", BENCH_DEFAULT_REPEATS);
+
+    if (warmup < 0) warmup = 0;
+    if (repeats < 1) repeats = 1;
+    if (repeats > BENCH_MAX_SAMPLES) repeats = BENCH_MAX_SAMPLES;
+
+    bench_state_.argc = argc;
+    bench_state_.argv = argv;
+    bench_state_.warmup = (int)warmup;
+    bench_state_.repeats = (int)repeats;
+    bench_state_.recorded = 0;
+}
+
+/* Runtime parameter: --<name>=V, else BENCH_<NAME> (upper-cased), else fallback. */
+static inline long bench_param_long(const char *name, long fallback) {
+    char env_name[64] = "BENCH_";
+    size_t len = strlen(name);
+    if (len > sizeof(env_name) - 7) len = sizeof(env_name) - 7;
+    for (size_t i = 0; i < len; i++) {
+        char ch = name[i];
+        if (ch == '-') ch = '_';
+        env_name[6 + i] = (ch >= 'a' && ch <= 'z') ? (char)(ch - 'a' + 'A') : ch;
+    }
+    env_name[6 + len] = '\0';
+    long value = bench_option_long_(bench_state_.argc, bench_state_.argv, name, env_name, fallback);
+    return value > 0 ? value : fallback;
+}
+
+/* Cache size in bytes from sysconf, overridable through BENCH_<which>_BYTES. */
+static inline long bench_cache_bytes_(const char *env_name, int level, long fallback) {
+    const char *env = getenv(env_name);
+    if (env && *env) return strtol(env, NULL, 10);
+    long bytes = -1;
+#if defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    bytes = sysconf(level == 2 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE);
+#else
+    (void)level;
+#endif
+    return bytes > 0 ? bytes : fallback;
+}
+
+/*
+ * Target working-set size for the selected size class, or 0 when none is set:
+ * l2 = half of L2, llc = half of the last-level cache, dram = 8x the LLC.
+ */
+static inline long bench_class_bytes(void) {
+    const char *cls = bench_option_(bench_state_.argc, bench_state_.argv, "size-class", "BENCH_SIZE_CLASS");
+    if (!cls) return 0;
+    long l2 = bench_cache_bytes_("BENCH_L2_BYTES", 2, 1L << 20);
+    long llc = bench_cache_bytes_("BENCH_LLC_BYTES", 3, 32L << 20);
+    if (strcmp(cls, "l2") == 0) return l2 / 2;
+    if (strcmp(cls, "llc") == 0) return llc / 2;
+    if (strcmp(cls, "dram") == 0) return llc * 8;
+    fprintf(stderr, "bench: unknown size class '%s' (expected l2, llc or dram)\n", cls);
+    return 0;
+}
+
+/* Total number of kernel invocations: warmup runs followed by measured runs. */
+static inline int bench_runs(void) {
+    return bench_state_.warmup + bench_state_.repeats;
+}
+
+/* Wall-clock time in seconds from a monotonic clock. */
+static inline double bench_now(void) {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* Record one run; the first `warmup` calls are discarded. */
+static inline void bench_record(double seconds) {
+    int index = bench_state_.recorded++ - bench_state_.warmup;
+    if (index >= 0 && index < bench_state_.repeats) {
+        bench_state_.samples[index] = seconds;
+    }
+}
+
+static inline int bench_compare_double_(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Print the single machine-readable result line for this benchmark. */
+static inline void bench_report(const char *name) {
+    int n = bench_state_.recorded - bench_state_.warmup;
+    if (n > bench_state_.repeats) n = bench_state_.repeats;
+    if (n < 1) {
+        printf("{\"bench\": \"%s\", \"clock\": \"wall\", \"error\": \"no samples recorded\"}\n", name);
+        fflush(stdout);
+        return;
+    }
+
+    double sorted[BENCH_MAX_SAMPLES];
+    double sum = 0.0;
+    memcpy(sorted, bench_state_.samples, (size_t)n * sizeof(double));
+    qsort(sorted, (size_t)n, sizeof(double), bench_compare_double_);
+    for (int i = 0; i < n; i++) sum += sorted[i];
+
+    double median = (n % 2) ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+    /* Nearest-rank percentile: smallest sample with at least 95% at or below it. */
+    int p95_rank = (95 * n + 99) / 100;
+    double p95 = sorted[p95_rank - 1];
+
+#ifdef _OPENMP
+    int threads = omp_get_max_threads();
+#else
+    int threads = 1;
+#endif
+
+    printf("{\"bench\": \"%s\", \"clock\": \"wall\", \"threads\": %d, \"warmup\": %d, \"repeats\": %d, "
+           "\"min\": %.9f, \"median\": %.9f, \"p95\": %.9f, \"mean\": %.9f, \"samples\": [",
+           name, threads, bench_state_.warmup, n, sorted[0], median, p95, sum / n);
+    for (int i = 0; i < n; i++) {
+        printf("%s%.9f", i ? ", " : "", bench_state_.samples[i]);
+    }
+    printf("]}\n");
+    fflush(stdout);
+}
+
+#endif /* MAAP_BENCH_H */
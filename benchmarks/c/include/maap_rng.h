@@ -0,0 +1,139 @@
+/*
+ * maap_rng.h - counter-based random streams (Philox4x32-10) for parallel kernels.
+ *
+ * rand() keeps one hidden global state: threads calling it serialize on it
+ * (glibc locks) or race on it, and results depend on the interleaving. A
+ * counter-based generator has no shared state. Output i of stream s is a pure
+ * function philox(key = seed, counter = {i, s}), so every thread, task or
+ * block of iterations can own a stream and results are reproducible for any
+ * thread count:
+ *
+ *     #pragma omp parallel for reduction(+:count)
+ *     for (long b = 0; b < nblocks; b++) {
+ *         maap_rng rng;
+ *         maap_rng_init(&rng, 1, (uint64_t)b);      // stream = block index
+ *         double x[MAAP_RNG_BATCH], y[MAAP_RNG_BATCH];
+ *         maap_rng_fill_uniform(&rng, x, MAAP_RNG_BATCH);
+ *         maap_rng_fill_uniform(&rng, y, MAAP_RNG_BATCH);
+ *         ...
+ *     }
+ *
+ * Index streams by a unit of work (a block of iterations), not by
+ * omp_get_thread_num(), when results must not depend on the thread count.
+ *
+ * maap_rng_fill_u32 / maap_rng_fill_uniform produce a batch with independent
+ * counter values per lane, so the loop has no carried state and vectorizes.
+ * Header-only, like bench.h.
+ */
+#ifndef MAAP_RNG_H
+#define MAAP_RNG_H
+
+#include <stdint.h>
+
+#define MAAP_RNG_BATCH 256
+
+#define MAAP_PHILOX_M0 0xD2511F53u
+#define MAAP_PHILOX_M1 0xCD9E8D57u
+#define MAAP_PHILOX_W0 0x9E3779B9u
+#define MAAP_PHILOX_W1 0xBB67AE85u
+
+typedef struct {
+    uint32_t key[2];
+    uint64_t stream;
+    uint64_t counter;     /* next block of 4 outputs */
+    uint32_t buffer[4];
+    int used;             /* outputs of `buffer` already handed out */
+} maap_rng;
+
+/* One Philox4x32-10 evaluation: 4 random words for a 128-bit counter. */
+static inline void maap_philox4x32_10(const uint32_t ctr_in[4], const uint32_t key_in[2], uint32_t out[4]) {
+    uint32_t c0 = ctr_in[0], c1 = ctr_in[1], c2 = ctr_in[2], c3 = ctr_in[3];
+    uint32_t k0 = key_in[0], k1 = key_in[1];
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)MAAP_PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)MAAP_PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += MAAP_PHILOX_W0;
+        k1 += MAAP_PHILOX_W1;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+static inline void maap_rng_block_(const maap_rng *rng, uint64_t counter, uint32_t out[4]) {
+    uint32_t ctr[4] = {
+        (uint32_t)counter, (uint32_t)(counter >> 32),
+        (uint32_t)rng->stream, (uint32_t)(rng->stream >> 32)
+    };
+    maap_philox4x32_10(ctr, rng->key, out);
+}
+
+/* Stream `stream` of generator `seed`; distinct (seed, stream) pairs never overlap. */
+static inline void maap_rng_init(maap_rng *rng, uint64_t seed, uint64_t stream) {
+    rng->key[0] = (uint32_t)seed;
+    rng->key[1] = (uint32_t)(seed >> 32);
+    rng->stream = stream;
+    rng->counter = 0;
+    rng->used = 4;
+}
+
+/* Jumps to output `position` of the stream in O(1). */
+static inline void maap_rng_seek(maap_rng *rng, uint64_t position) {
+    rng->counter = position / 4;
+    maap_rng_block_(rng, rng->counter++, rng->buffer);
+    rng->used = (int)(position % 4);
+}
+
+static inline uint32_t maap_rng_u32(maap_rng *rng) {
+    if (rng->used == 4) {
+        maap_rng_block_(rng, rng->counter++, rng->buffer);
+        rng->used = 0;
+    }
+    return rng->buffer[rng->used++];
+}
+
+/* Maps a word to the open interval (0, 1). */
+static inline double maap_u32_to_unit(uint32_t x) {
+    return ((double)x + 0.5) * (1.0 / 4294967296.0);
+}
+
+static inline double maap_rng_uniform(maap_rng *rng) {
+    return maap_u32_to_unit(maap_rng_u32(rng));
+}
+
+/*
+ * Fills out[0..n) with the next n words of the stream. Whole blocks of four are
+ * generated with one counter per iteration and no carried state.
+ */
+static inline void maap_rng_fill_u32(maap_rng *rng, uint32_t *out, int n) {
+    int i = 0;
+    while (i < n && rng->used < 4) out[i++] = rng->buffer[rng->used++];
+    int blocks = (n - i) / 4;
+    uint64_t base = rng->counter;
+    #pragma omp simd
+    for (int b = 0; b < blocks; b++) {
+        maap_rng_block_(rng, base + (uint64_t)b, out + i + 4 * b);
+    }
+    rng->counter += (uint64_t)blocks;
+    i += 4 * blocks;
+    while (i < n) out[i++] = maap_rng_u32(rng);
+}
+
+/* Fills out[0..n) with uniform doubles in (0, 1); same sequence as n calls of maap_rng_uniform. */
+static inline void maap_rng_fill_uniform(maap_rng *rng, double *out, int n) {
+    uint32_t words[MAAP_RNG_BATCH];
+    while (n > 0) {
+        int chunk = n < MAAP_RNG_BATCH ? n : MAAP_RNG_BATCH;
+        maap_rng_fill_u32(rng, words, chunk);
+        #pragma omp simd
+        for (int i = 0; i < chunk; i++) out[i] = maap_u32_to_unit(words[i]);
+        out += chunk;
+        n -= chunk;
+    }
+}
+
+#endif /* MAAP_RNG_H */
@@ -0,0 +1,66 @@
+/*
+ * Reference variant of 05_monte_carlo_pi.c.
+ *
+ * The benchmark draws every sample from rand(), whose hidden global state
+ * serializes threads. Here the samples are split into blocks of --block
+ * samples; block b draws from Philox stream b (maap_rng.h), so blocks are
+ * independent, run as a parallel for with a count reduction, and the estimate
+ * is the same for every thread count and schedule. Coordinates are generated
+ * MAAP_RNG_BATCH at a time, so the hit test runs over plain arrays and
+ * vectorizes.
+ *
+ * The stream differs from rand(), so the estimate differs from the benchmark
+ * in the 4th decimal (statistical error ~ 1.6 / sqrt(samples)). Validate it
+ * with a statistical tolerance, e.g. --rel-tol 1e-3.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "maap_rng.h"
+
+long monte_carlo_pi_blocks(long samples, long block, uint64_t seed) {
+    long nblocks = (samples + block - 1) / block;
+    long count = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+:count)
+    for (long b = 0; b < nblocks; b++) {
+        maap_rng rng;
+        maap_rng_init(&rng, seed, (uint64_t)b);
+        double x[MAAP_RNG_BATCH];
+        double y[MAAP_RNG_BATCH];
+        long remaining = samples - b * block < block ? samples - b * block : block;
+        while (remaining > 0) {
+            int batch = remaining < MAAP_RNG_BATCH ? (int)remaining : MAAP_RNG_BATCH;
+            maap_rng_fill_uniform(&rng, x, batch);
+            maap_rng_fill_uniform(&rng, y, batch);
+            long hits = 0;
+            #pragma omp simd reduction(+:hits)
+            for (int i = 0; i < batch; i++) hits += (x[i]*x[i] + y[i]*y[i] <= 1.0);
+            count += hits;
+            remaining -= batch;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long total_samples = bench_param_long("samples", 10000000);
+    long block = bench_param_long("block", 4096);
+    long seed = bench_param_long("seed", 1);
+    long count = 0;
+
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+
+        count = monte_carlo_pi_blocks(total_samples, block, (uint64_t)seed);
+
+        bench_record(bench_now() - start);
+    }
+
+    double pi = 4.0 * count / total_samples;
+
+    printf("Pi Estimate: %.5f\n", pi);
+    bench_report("monte_carlo_pi_rng");
+    return 0;
+}
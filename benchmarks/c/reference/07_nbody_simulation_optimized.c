@@ -0,0 +1,193 @@
+/*
+ * Reference variant of 07_nbody_simulation.c.
+ *
+ * - Scratch force buffers are allocated once and reused by every step
+ *   (the benchmark mallocs/frees them per step).
+ * - All steps run inside one parallel region: each step is an `omp for`
+ *   force phase and an `omp for` integrate phase separated by barriers,
+ *   instead of two fork/joins per step.
+ * - --mode=1 uses Newton's third law: every pair (i, j > i) is computed
+ *   once and applied to both bodies through per-thread force accumulators
+ *   that are reduced after the pair loop. Summation order differs from the
+ *   benchmark, so results agree within floating-point tolerance.
+ *
+ * --mode=0  fused region, full pair loop (default)
+ * --mode=1  fused region, symmetric pairs + per-thread accumulators
+ *
+ * The default layout stacks body i on body i+100. Their mutual force stays
+ * zero only while both see bit-identical force sums, so any reordering of
+ * the sums (mode 1) blows up. Compare mode 1 with the benchmark under
+ * --layout=1, which gives every body a distinct position.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+
+#ifdef _OPENMP
+#define NBODY_THREAD_NUM() omp_get_thread_num()
+#define NBODY_NUM_THREADS() omp_get_num_threads()
+#define NBODY_MAX_THREADS() omp_get_max_threads()
+#else
+#define NBODY_THREAD_NUM() 0
+#define NBODY_NUM_THREADS() 1
+#define NBODY_MAX_THREADS() 1
+#endif
+
+struct nbody_workspace {
+    int n;
+    int threads;         /* accumulator slots; a team never exceeds omp_get_max_threads() */
+    double *forces_x;
+    double *forces_y;
+    double *thread_fx;   /* threads x n accumulators, mode 1 only */
+    double *thread_fy;
+};
+
+void workspace_init(struct nbody_workspace *ws, int n, int symmetric) {
+    ws->n = n;
+    ws->threads = NBODY_MAX_THREADS();
+    ws->forces_x = (double*)malloc(n * sizeof(double));
+    ws->forces_y = (double*)malloc(n * sizeof(double));
+    ws->thread_fx = symmetric ? (double*)malloc((size_t)ws->threads * n * sizeof(double)) : NULL;
+    ws->thread_fy = symmetric ? (double*)malloc((size_t)ws->threads * n * sizeof(double)) : NULL;
+}
+
+void workspace_free(struct nbody_workspace *ws) {
+    free(ws->forces_x); free(ws->forces_y);
+    free(ws->thread_fx); free(ws->thread_fy);
+}
+
+/* Integrate phase shared by both modes; runs as an orphaned `omp for`. */
+static void integrate(double *pos_x, double *pos_y, double *vel_x, double *vel_y, double *mass,
+                      const struct nbody_workspace *ws, double dt, int n) {
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n; i++) {
+        vel_x[i] += ws->forces_x[i] * dt / mass[i];
+        vel_y[i] += ws->forces_y[i] * dt / mass[i];
+        pos_x[i] += vel_x[i] * dt;
+        pos_y[i] += vel_y[i] * dt;
+    }
+}
+
+void simulate_fused(double *pos_x, double *pos_y, double *vel_x, double *vel_y, double *mass,
+                    struct nbody_workspace *ws, double dt, int n, int steps) {
+    #pragma omp parallel
+    for (int s = 0; s < steps; s++) {
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            double fx = 0.0;
+            double fy = 0.0;
+            for (int j = 0; j < n; j++) {
+                if (i != j) {
+                    double dx = pos_x[j] - pos_x[i];
+                    double dy = pos_y[j] - pos_y[i];
+                    double dist = sqrt(dx*dx + dy*dy) + 1e-9;
+                    double f = (mass[i] * mass[j]) / (dist * dist);
+                    fx += f * dx / dist;
+                    fy += f * dy / dist;
+                }
+            }
+            ws->forces_x[i] = fx;
+            ws->forces_y[i] = fy;
+        }
+        /* implicit barrier: all forces computed before any position moves */
+        integrate(pos_x, pos_y, vel_x, vel_y, mass, ws, dt, n);
+        /* implicit barrier: positions final before the next force phase */
+    }
+}
+
+void simulate_symmetric(double *pos_x, double *pos_y, double *vel_x, double *vel_y, double *mass,
+                        struct nbody_workspace *ws, double dt, int n, int steps) {
+    #pragma omp parallel
+    for (int s = 0; s < steps; s++) {
+        double *my_fx = ws->thread_fx + (size_t)NBODY_THREAD_NUM() * n;
+        double *my_fy = ws->thread_fy + (size_t)NBODY_THREAD_NUM() * n;
+        for (int i = 0; i < n; i++) { my_fx[i] = 0.0; my_fy[i] = 0.0; }
+
+        /* Row i has n-1-i pairs: dynamic scheduling evens out the triangle. */
+        #pragma omp for schedule(dynamic, 16)
+        for (int i = 0; i < n; i++) {
+            double fx = 0.0;
+            double fy = 0.0;
+            for (int j = i + 1; j < n; j++) {
+                double dx = pos_x[j] - pos_x[i];
+                double dy = pos_y[j] - pos_y[i];
+                double dist = sqrt(dx*dx + dy*dy) + 1e-9;
+                double f = (mass[i] * mass[j]) / (dist * dist);
+                double pair_x = f * dx / dist;
+                double pair_y = f * dy / dist;
+                fx += pair_x;
+                fy += pair_y;
+                my_fx[j] -= pair_x;
+                my_fy[j] -= pair_y;
+            }
+            my_fx[i] += fx;
+            my_fy[i] += fy;
+        }
+        /* implicit barrier: every thread's accumulators are complete */
+
+        int team = NBODY_NUM_THREADS();
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            double fx = 0.0;
+            double fy = 0.0;
+            for (int t = 0; t < team; t++) {
+                fx += ws->thread_fx[(size_t)t * n + i];
+                fy += ws->thread_fy[(size_t)t * n + i];
+            }
+            ws->forces_x[i] = fx;
+            ws->forces_y[i] = fy;
+        }
+
+        integrate(pos_x, pos_y, vel_x, vel_y, mass, ws, dt, n);
+    }
+}
+
+void init_bodies(double *pos_x, double *pos_y, double *vel_x, double *vel_y, double *mass, int n, int layout) {
+    for(int i=0; i<n; i++) {
+        /* layout 0 stacks body i on body i+100; layout 1 offsets them so no two coincide */
+        double offset = layout ? (double)(i / 100) * 0.01 : 0.0;
+        pos_x[i] = (double)(i % 100) + offset;
+        pos_y[i] = (double)((i*2) % 100) + offset;
+        vel_x[i] = 0.0;
+        vel_y[i] = 0.0;
+        mass[i] = 1.0;
+    }
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    int N = (int)bench_param_long("n", 2000);
+    int steps = (int)bench_param_long("steps", 5);
+    int layout = (int)bench_param_long("layout", 0);
+    int mode = (int)bench_param_long("mode", 0);
+    double *pos_x = (double*)malloc(N * sizeof(double));
+    double *pos_y = (double*)malloc(N * sizeof(double));
+    double *vel_x = (double*)malloc(N * sizeof(double));
+    double *vel_y = (double*)malloc(N * sizeof(double));
+    double *mass = (double*)malloc(N * sizeof(double));
+    struct nbody_workspace ws;
+    workspace_init(&ws, N, mode == 1);
+
+    printf("Simulating %d bodies...\n", N);
+
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        init_bodies(pos_x, pos_y, vel_x, vel_y, mass, N, layout);
+        double start = bench_now();
+
+        if (mode == 1) simulate_symmetric(pos_x, pos_y, vel_x, vel_y, mass, &ws, 0.01, N, steps);
+        else simulate_fused(pos_x, pos_y, vel_x, vel_y, mass, &ws, 0.01, N, steps);
+
+        bench_record(bench_now() - start);
+    }
+
+    double checksum = 0.0;
+    for (int i = 0; i < N; i++) checksum += pos_x[i] + pos_y[i];
+    printf("Body 0: (%.6f, %.6f)\n", pos_x[0], pos_y[0]);
+    printf("Checksum: %.6e\n", checksum);
+    bench_report(mode == 1 ? "nbody_step_symmetric" : "nbody_step_fused");
+
+    workspace_free(&ws);
+    free(pos_x); free(pos_y); free(vel_x); free(vel_y); free(mass);
+    return 0;
+}
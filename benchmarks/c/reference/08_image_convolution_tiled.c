@@ -0,0 +1,226 @@
+/*
+ * Reference variant of 08_image_convolution.c.
+ *
+ * The benchmark streams the whole grid through memory once per step. Here
+ * the grid is cut into row bands and up to --fuse steps are advanced per
+ * band before moving on (overlapped tiling): a band of B rows is loaded with
+ * a halo of `fuse` rows on each side, every fused step shrinks the valid
+ * region by one row per side, and after the last step exactly the band's
+ * own rows remain and are written out. Halo rows are recomputed by the
+ * neighbouring bands instead of exchanged, so bands are fully independent.
+ * Intermediate levels live in small per-thread buffers that stay in cache.
+ *
+ * The benchmark never writes the outer frame (rows 0/R-1, cols 0/C-1), so
+ * after each swap the frame alternates between the input's original frame
+ * and the output buffer's. Both frames are saved up front and the frame for
+ * step t is taken from frames[t % 2], which keeps results identical even
+ * when an odd number of steps is fused.
+ *
+ * --mode=0  overlapped row-band tiling, direct 9-point stencil (default)
+ * --mode=1  overlapped row-band tiling, separable box blur: one horizontal
+ *           3-point pass then one vertical 3-point pass (6 adds, not 9)
+ * --band=B  rows per band (default 64)
+ * --fuse=T  steps fused per band (default: all steps)
+ *
+ * Mode 1 sums in a different order, so it agrees within tolerance.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+
+#ifdef _OPENMP
+#define STENCIL_THREAD_NUM() omp_get_thread_num()
+#define STENCIL_MAX_THREADS() omp_get_max_threads()
+#else
+#define STENCIL_THREAD_NUM() 0
+#define STENCIL_MAX_THREADS() 1
+#endif
+
+struct frame {
+    double *top;      /* row 0, cols values */
+    double *bottom;   /* row R-1 */
+    double *left;     /* col 0, rows values */
+    double *right;    /* col C-1 */
+};
+
+struct stencil_workspace {
+    int rows, cols, band, fuse, threads;
+    struct frame frames[2];
+    double *levels;   /* per thread: 2 ping-pong level buffers of (band + 2*fuse) rows */
+    double *hsum;     /* per thread: horizontal sums for mode 1, same height */
+};
+
+void frame_alloc(struct frame *f, int rows, int cols) {
+    f->top = (double*)malloc(cols * sizeof(double));
+    f->bottom = (double*)malloc(cols * sizeof(double));
+    f->left = (double*)malloc(rows * sizeof(double));
+    f->right = (double*)malloc(rows * sizeof(double));
+}
+
+void frame_free(struct frame *f) {
+    free(f->top); free(f->bottom); free(f->left); free(f->right);
+}
+
+void frame_save(struct frame *f, const double *grid, int rows, int cols) {
+    for (int c = 0; c < cols; c++) {
+        f->top[c] = grid[c];
+        f->bottom[c] = grid[(rows - 1) * cols + c];
+    }
+    for (int r = 0; r < rows; r++) {
+        f->left[r] = grid[r * cols];
+        f->right[r] = grid[r * cols + cols - 1];
+    }
+}
+
+void workspace_init(struct stencil_workspace *ws, int rows, int cols, int band, int fuse) {
+    ws->rows = rows;
+    ws->cols = cols;
+    ws->band = band;
+    ws->fuse = fuse;
+    ws->threads = STENCIL_MAX_THREADS();
+    frame_alloc(&ws->frames[0], rows, cols);
+    frame_alloc(&ws->frames[1], rows, cols);
+    size_t height = (size_t)band + 2 * (size_t)fuse;
+    ws->levels = (double*)malloc((size_t)ws->threads * 2 * height * cols * sizeof(double));
+    ws->hsum = (double*)malloc((size_t)ws->threads * height * cols * sizeof(double));
+}
+
+void workspace_free(struct stencil_workspace *ws) {
+    frame_free(&ws->frames[0]);
+    frame_free(&ws->frames[1]);
+    free(ws->levels);
+    free(ws->hsum);
+}
+
+/* Row `gr` of level t (0 = src, steps = dst, otherwise a local buffer). */
+static inline double *level_row(double *src, double *dst, double *local[2], int t, int steps,
+                                int gr, int base, int cols) {
+    if (t == 0) return src + (size_t)gr * cols;
+    if (t == steps) return dst + (size_t)gr * cols;
+    return local[t % 2] + (size_t)(gr - base) * cols;
+}
+
+/*
+ * Advance rows [r0, r1) by `steps` steps from src (level `first`) into dst.
+ * Level t covers rows [r0 - (steps - t), r1 + (steps - t)) clipped to the grid.
+ */
+static void advance_band(double *src, double *dst, const struct stencil_workspace *ws,
+                         int r0, int r1, int first, int steps, int separable) {
+    int R = ws->rows, C = ws->cols;
+    size_t height = (size_t)ws->band + 2 * (size_t)ws->fuse;
+    double *mine = ws->levels + (size_t)STENCIL_THREAD_NUM() * 2 * height * C;
+    double *local[2] = { mine, mine + height * C };
+    double *hs = ws->hsum + (size_t)STENCIL_THREAD_NUM() * height * C;
+    int base = r0 - steps > 0 ? r0 - steps : 0;
+
+    for (int t = 1; t <= steps; t++) {
+        const struct frame *f = &ws->frames[(first + t) % 2];
+        int lo = r0 - (steps - t) > 0 ? r0 - (steps - t) : 0;
+        int hi = r1 + (steps - t) < R ? r1 + (steps - t) : R;
+
+        if (separable) {
+            /* Pass 1: horizontal 3-point sums of every previous-level row the vertical pass reads. */
+            int plo = lo > 1 ? lo - 1 : 0;
+            int phi = hi + 1 < R ? hi + 1 : R;
+            for (int gr = plo; gr < phi; gr++) {
+                const double *in = level_row(src, dst, local, t - 1, steps, gr, base, C);
+                double *h = hs + (size_t)(gr - base) * C;
+                for (int c = 1; c < C - 1; c++) h[c] = in[c - 1] + in[c] + in[c + 1];
+            }
+        }
+
+        for (int gr = lo; gr < hi; gr++) {
+            double *out = level_row(src, dst, local, t, steps, gr, base, C);
+            if (gr == 0 || gr == R - 1) {
+                const double *edge = gr == 0 ? f->top : f->bottom;
+                for (int c = 0; c < C; c++) out[c] = edge[c];
+                continue;
+            }
+            out[0] = f->left[gr];
+            out[C - 1] = f->right[gr];
+            if (separable) {
+                /* Pass 2: vertical 3-point sum of the horizontal sums. */
+                const double *up = hs + (size_t)(gr - 1 - base) * C;
+                const double *mid = up + C;
+                const double *down = mid + C;
+                for (int c = 1; c < C - 1; c++) out[c] = (up[c] + mid[c] + down[c]) / 9.0;
+            } else {
+                const double *up = level_row(src, dst, local, t - 1, steps, gr - 1, base, C);
+                const double *mid = level_row(src, dst, local, t - 1, steps, gr, base, C);
+                const double *down = level_row(src, dst, local, t - 1, steps, gr + 1, base, C);
+                for (int c = 1; c < C - 1; c++) {
+                    double sum = 0.0;
+                    sum += up[c - 1]; sum += up[c]; sum += up[c + 1];
+                    sum += mid[c - 1]; sum += mid[c]; sum += mid[c + 1];
+                    sum += down[c - 1]; sum += down[c]; sum += down[c + 1];
+                    out[c] = sum / 9.0;
+                }
+            }
+        }
+    }
+}
+
+/* Runs `steps` steps over input/output and returns the buffer holding the final image. */
+double *convolution_tiled(double *input, double *output, struct stencil_workspace *ws,
+                          int steps, int separable) {
+    int R = ws->rows;
+    int nbands = (R + ws->band - 1) / ws->band;
+    frame_save(&ws->frames[0], input, R, ws->cols);
+    frame_save(&ws->frames[1], output, R, ws->cols);
+
+    for (int t0 = 0; t0 < steps; t0 += ws->fuse) {
+        int block = steps - t0 < ws->fuse ? steps - t0 : ws->fuse;
+        #pragma omp parallel for schedule(static)
+        for (int b = 0; b < nbands; b++) {
+            int r0 = b * ws->band;
+            int r1 = r0 + ws->band < R ? r0 + ws->band : R;
+            advance_band(input, output, ws, r0, r1, t0, block, separable);
+        }
+        /* implicit barrier: every band has read `input` before it is overwritten */
+        double *temp = input;
+        input = output;
+        output = temp;
+    }
+    return input;
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long wsb = bench_class_bytes();
+    int side = wsb ? (int)sqrt(wsb / (2.0 * sizeof(double))) : 2000;
+    int R = (int)bench_param_long("rows", side);
+    int C = (int)bench_param_long("cols", side);
+    int steps = (int)bench_param_long("steps", 5);
+    int band = (int)bench_param_long("band", 64);
+    int fuse = (int)bench_param_long("fuse", steps);
+    int mode = (int)bench_param_long("mode", 0);
+    if (fuse > steps) fuse = steps;
+    double *input = (double*)malloc(R * C * sizeof(double));
+    double *output = (double*)malloc(R * C * sizeof(double));
+    struct stencil_workspace ws;
+    workspace_init(&ws, R, C, band, fuse);
+
+    printf("Applying convolution to %dx%d image...\n", R, C);
+
+    double *result = input;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        for(int i=0; i<R*C; i++) input[i] = (double)(i % 255);
+        for(int i=0; i<R*C; i++) output[i] = 0.0;
+        double start = bench_now();
+
+        result = convolution_tiled(input, output, &ws, steps, mode == 1);
+
+        bench_record(bench_now() - start);
+    }
+
+    double checksum = 0.0;
+    for (int i = 0; i < R * C; i++) checksum += result[i];
+    printf("Center: %.6f\n", result[(R/2)*C + C/2]);
+    printf("Checksum: %.6e\n", checksum);
+    bench_report(mode == 1 ? "convolution_tiled_separable" : "convolution_tiled");
+
+    workspace_free(&ws);
+    free(input); free(output);
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Reference variant of 09_merge_sort.c.
+ *
+ * - One scratch buffer of n elements is allocated up front; recursion
+ *   levels ping-pong between the array and the scratch buffer, so a merge
+ *   never copies its halves out first and never calls malloc/free (the
+ *   benchmark does both for every merge, ~n allocations per sort).
+ * - Ranges of at most --cutoff elements are insertion-sorted in place.
+ * - Halves larger than --task-cutoff are sorted as OpenMP tasks; smaller
+ *   subtrees run serially so task overhead stays bounded.
+ * - --mode=1 also merges the top levels in parallel: the larger run is split
+ *   at its midpoint, the split value is binary-searched in the other run and
+ *   both halves are merged as independent tasks, down to --merge-cutoff.
+ *
+ * --mode=0  task-parallel sort, serial merges (default)
+ * --mode=1  task-parallel sort, parallel merges above --merge-cutoff
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+struct sort_params {
+    int cutoff;        /* insertion sort at or below this many elements */
+    int task_cutoff;   /* spawn tasks only for ranges larger than this */
+    int merge_cutoff;  /* parallel merge only for outputs larger than this */
+    int parallel_merge;
+};
+
+static void insertion_sort(int *a, int l, int r) {
+    for (int i = l + 1; i <= r; i++) {
+        int key = a[i];
+        int j = i - 1;
+        while (j >= l && a[j] > key) {
+            a[j + 1] = a[j];
+            j--;
+        }
+        a[j + 1] = key;
+    }
+}
+
+/* Merges src[l1..r1] and src[l2..r2] into dst starting at k (stable: ties take the left run). */
+static void merge_serial(const int *src, int l1, int r1, int l2, int r2, int *dst, int k) {
+    while (l1 <= r1 && l2 <= r2) {
+        if (src[l1] <= src[l2]) dst[k++] = src[l1++];
+        else dst[k++] = src[l2++];
+    }
+    while (l1 <= r1) dst[k++] = src[l1++];
+    while (l2 <= r2) dst[k++] = src[l2++];
+}
+
+/* First index in src[l..r] whose value is > key (left run) or >= key (right run), keeping it stable. */
+static int split_point(const int *src, int l, int r, int key, int upper) {
+    int lo = l, hi = r + 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (upper ? src[mid] <= key : src[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void merge_parallel(const int *src, int l1, int r1, int l2, int r2, int *dst, int k,
+                           const struct sort_params *p) {
+    int n1 = r1 - l1 + 1;
+    int n2 = r2 - l2 + 1;
+    if (n1 + n2 <= p->merge_cutoff) {
+        merge_serial(src, l1, r1, l2, r2, dst, k);
+        return;
+    }
+    int m1, m2;
+    if (n1 >= n2) {
+        m1 = l1 + n1 / 2;
+        m2 = split_point(src, l2, r2, src[m1], 0);
+    } else {
+        m2 = l2 + n2 / 2;
+        m1 = split_point(src, l1, r1, src[m2], 1);
+    }
+    int k2 = k + (m1 - l1) + (m2 - l2);
+    #pragma omp taskgroup
+    {
+        #pragma omp task
+        merge_parallel(src, l1, m1 - 1, l2, m2 - 1, dst, k, p);
+        merge_parallel(src, m1, r1, m2, r2, dst, k2, p);
+    }
+}
+
+/*
+ * Sorts src[l..r] into dst[l..r]; on entry both hold the same values in that
+ * range. Children sort dst into src, so each level swaps the roles.
+ */
+static void sort_into(int *src, int *dst, int l, int r, const struct sort_params *p) {
+    if (r - l + 1 <= p->cutoff) {
+        insertion_sort(dst, l, r);
+        return;
+    }
+    int m = l + (r - l) / 2;
+    if (r - l + 1 > p->task_cutoff) {
+        #pragma omp task
+        sort_into(dst, src, l, m, p);
+        sort_into(dst, src, m + 1, r, p);
+        #pragma omp taskwait
+    } else {
+        sort_into(dst, src, l, m, p);
+        sort_into(dst, src, m + 1, r, p);
+    }
+    if (p->parallel_merge && r - l + 1 > p->merge_cutoff) merge_parallel(src, l, m, m + 1, r, dst, l, p);
+    else merge_serial(src, l, m, m + 1, r, dst, l);
+}
+
+void merge_sort_tasks(int *arr, int *scratch, int n, const struct sort_params *p) {
+    memcpy(scratch, arr, (size_t)n * sizeof(int));
+    #pragma omp parallel
+    #pragma omp single
+    sort_into(scratch, arr, 0, n - 1, p);
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long ws = bench_class_bytes();
+    int n = (int)bench_param_long("n", ws ? ws / (2 * (long)sizeof(int)) : 500000);
+    struct sort_params params;
+    params.cutoff = (int)bench_param_long("cutoff", 32);
+    params.task_cutoff = (int)bench_param_long("task-cutoff", 10000);
+    params.merge_cutoff = (int)bench_param_long("merge-cutoff", 50000);
+    params.parallel_merge = bench_param_long("mode", 0) == 1;
+    int *arr = (int*)malloc(n * sizeof(int));
+    int *scratch = (int*)malloc(n * sizeof(int));
+
+    printf("Sorting %d elements with Merge Sort...\n", n);
+
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        srand(42);
+        for(int i=0; i<n; i++) arr[i] = rand() % n;
+        double start = bench_now();
+
+        merge_sort_tasks(arr, scratch, n, &params);
+
+        bench_record(bench_now() - start);
+    }
+
+    int sorted = 1;
+    for(int i=0; i<n-1; i++) {
+        if(arr[i] > arr[i+1]) { sorted = 0; break; }
+    }
+    printf("Sorted: %s\n", sorted ? "YES" : "NO");
+    bench_report(params.parallel_merge ? "merge_sort_tasks_parallel_merge" : "merge_sort_tasks");
+
+    free(arr); free(scratch);
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Reference variant of 10_prime_sieve.c.
+ *
+ * The benchmark tests every number by trial division, so iteration cost grows
+ * with i and a static split leaves the last thread with the most work. This
+ * variant replaces the algorithm: a segmented Sieve of Eratosthenes.
+ *
+ * - Base primes up to sqrt(limit) come from a small serial sieve.
+ * - [0, limit) is cut into segments of --segment bytes (default 32 KiB, about
+ *   one L1 data cache). Only odd numbers are stored, one byte each, so a segment
+ *   covers 2 * segment integers and stays cache-resident while every base
+ *   prime crosses it off.
+ * - Segments are independent and cost about the same, so they are spread
+ *   over threads with schedule(dynamic) and counted with a reduction. The
+ *   marking buffer is allocated once per thread, not once per segment.
+ *
+ * The count is exact, so the output matches the benchmark.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bench.h"
+
+/* Odd primes <= bound (2 is handled separately). Returns how many were stored. */
+int base_primes(int bound, int *primes) {
+    char *composite = (char*)calloc(bound + 1, 1);
+    int count = 0;
+    for (int p = 3; p <= bound; p += 2) {
+        if (composite[p]) continue;
+        primes[count++] = p;
+        for (long q = (long)p * p; q <= bound; q += 2L * p) composite[q] = 1;
+    }
+    free(composite);
+    return count;
+}
+
+/* Number of primes in [0, limit). */
+int count_primes_segmented(int limit, int segment_bytes) {
+    if (limit <= 2) return 0;
+    int bound = (int)sqrt((double)limit) + 1;
+    int *primes = (int*)malloc((bound / 2 + 1) * sizeof(int));
+    int nprimes = base_primes(bound, primes);
+
+    /* Segment s holds the odd numbers in [s * span, (s + 1) * span). */
+    long span = 2L * segment_bytes;
+    long nsegments = (limit + span - 1) / span;
+    int count = 1;   /* the prime 2 */
+
+    #pragma omp parallel reduction(+:count)
+    {
+        char *composite = (char*)malloc(segment_bytes);
+
+        #pragma omp for schedule(dynamic)
+        for (long s = 0; s < nsegments; s++) {
+            long lo = s * span;
+            long hi = lo + span < limit ? lo + span : limit;
+            memset(composite, 0, segment_bytes);
+            for (int k = 0; k < nprimes; k++) {
+                long p = primes[k];
+                if (p * p >= hi) break;
+                /* First odd multiple of p in [lo, hi), never below p*p. */
+                long q = p * p;
+                if (q < lo) {
+                    q = (lo + p - 1) / p * p;
+                    if (q % 2 == 0) q += p;
+                }
+                for (; q < hi; q += 2 * p) composite[(q - lo) / 2] = 1;
+            }
+            for (long v = lo + 1; v < hi; v += 2) {
+                if (v > 1 && !composite[(v - lo) / 2]) count++;
+            }
+        }
+        free(composite);
+    }
+
+    free(primes);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    int limit = (int)bench_param_long("limit", 500000);
+    int segment = (int)bench_param_long("segment", 32768);
+
+    printf("Counting primes up to %d...\n", limit);
+
+    int result = 0;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        result = count_primes_segmented(limit, segment);
+        bench_record(bench_now() - start);
+    }
+
+    printf("Found %d primes.\n", result);
+    bench_report("count_primes_segmented");
+    return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * Reference variant of 11_io_pipeline.c.
+ *
+ * The benchmark reads a chunk, parses, transforms and formats it, writes it,
+ * and only then reads the next chunk. Each stage waits for the previous one,
+ * and everything runs on one thread.
+ *
+ * --mode=0  mmap zero-copy reader. The input is mapped read-only and cut
+ *           into --parts spans at line boundaries. Spans are parsed in
+ *           place (no fread copy), then transformed and formatted in
+ *           parallel with schedule(dynamic). Each span's text goes out with
+ *           pwrite at its prefix-sum offset, in parallel as well (default).
+ * --mode=1  double-buffered task pipeline. The chunks cycle through
+ *           --buffers slots (2 by default). Reading chunk k+1, computing
+ *           chunk k and writing chunk k-1 are tasks ordered by depend
+ *           clauses:
+ *             read   inout(reader) out(slot)    reads serialize on the file offset
+ *             compute inout(slot)               spans of a chunk as a taskloop
+ *             write  in(slot) inout(writer)     output order is the input order
+ *           A slot is only read into again after its chunk was written.
+ *
+ * The checksum sums integers and the output bytes are identical, so the
+ * printed result matches the benchmark exactly.
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bench.h"
+
+#ifdef _OPENMP
+#define PIPE_MAX_THREADS() omp_get_max_threads()
+#else
+#define PIPE_MAX_THREADS() 1
+#endif
+
+#define PIPE_MAX_BUFFERS 16
+#define PIPE_LINE_BYTES 48   /* upper bound of one formatted output line */
+
+double transform(double x, int work) {
+    double y = x;
+    for (int k = 0; k < work; k++) {
+        y = y * 0.5 + x / (1.0 + y * y);
+    }
+    return y;
+}
+
+long write_dataset(const char *path, long records) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    long bytes = 0;
+    for (long i = 0; i < records; i++) {
+        unsigned long h = (unsigned long)i * 2654435761UL % 1000000UL;
+        bytes += fprintf(f, "%ld,%.3f\n", i, h / 1000.0);
+    }
+    fclose(f);
+    return bytes;
+}
+
+/* Output of one span of complete lines. */
+struct span_out {
+    char *text;
+    long capacity;
+    long bytes;
+    long records;
+    long checksum;
+};
+
+/* Parses, transforms and formats the complete lines of buf[0:len) into out (grown as needed). */
+void process_span(const char *buf, long len, int work, struct span_out *out) {
+    out->bytes = out->records = out->checksum = 0;
+    long pos = 0;
+    while (pos < len) {
+        const char *nl = memchr(buf + pos, '\n', len - pos);
+        if (!nl) break;
+        char *end;
+        long id = strtol(buf + pos, &end, 10);
+        double y = transform(strtod(end + 1, NULL), work);
+        if (out->capacity - out->bytes < PIPE_LINE_BYTES) {
+            out->capacity = 2 * out->capacity + 4096;
+            out->text = (char*)realloc(out->text, out->capacity);
+        }
+        out->bytes += sprintf(out->text + out->bytes, "%ld,%.6f\n", id, y);
+        out->checksum += (long)(y * 1000.0);
+        out->records++;
+        pos = (nl - buf) + 1;
+    }
+}
+
+/* Cuts buf[0:len) into at most `parts` spans ending at newlines: span p is [cut[p], cut[p+1]). */
+int split_lines(const char *buf, long len, int parts, long *cut) {
+    int count = 0;
+    cut[0] = 0;
+    for (int p = 1; p <= parts; p++) {
+        long at = p == parts ? len : len / parts * p;
+        if (at < cut[count]) at = cut[count];
+        if (p < parts) {
+            const char *nl = at < len ? memchr(buf + at, '\n', len - at) : NULL;
+            at = nl ? (nl - buf) + 1 : len;
+        }
+        if (at > cut[count]) cut[++count] = at;
+    }
+    return count;
+}
+
+/* ---- mode 0: mmap zero-copy ------------------------------------------------ */
+
+long process_mapped(const char *in_path, const char *out_path, int work, int parts, struct span_out *outs,
+                    long *checksum, long *written) {
+    int in = open(in_path, O_RDONLY);
+    int out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    struct stat st;
+    if (in < 0 || out < 0 || fstat(in, &st) != 0) return -1;
+    long size = (long)st.st_size;
+    long records = 0, sum = 0;
+    *checksum = *written = 0;
+    if (size == 0) {
+        close(in); close(out);
+        return 0;
+    }
+    const char *data = (const char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, in, 0);
+    if (data == MAP_FAILED) return -1;
+    madvise((void*)data, size, MADV_WILLNEED);
+
+    long *cut = (long*)malloc((parts + 1) * sizeof(long));
+    long *offset = (long*)malloc((parts + 1) * sizeof(long));
+    int spans = split_lines(data, size, parts, cut);
+
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:records, sum)
+    for (int p = 0; p < spans; p++) {
+        process_span(data + cut[p], cut[p + 1] - cut[p], work, &outs[p]);
+        records += outs[p].records;
+        sum += outs[p].checksum;
+    }
+
+    offset[0] = 0;
+    for (int p = 0; p < spans; p++) offset[p + 1] = offset[p] + outs[p].bytes;
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < spans; p++) {
+        long done = 0;
+        while (done < outs[p].bytes) {
+            ssize_t n = pwrite(out, outs[p].text + done, outs[p].bytes - done, offset[p] + done);
+            if (n <= 0) break;
+            done += n;
+        }
+    }
+
+    munmap((void*)data, size);
+    close(in);
+    close(out);
+    *checksum = sum;
+    *written = offset[spans];
+    free(cut);
+    free(offset);
+    return records;
+}
+
+/* ---- mode 1: double-buffered read/compute/write tasks ---------------------- */
+
+struct pipe_slot {
+    char *in;
+    long len;             /* bytes of complete lines in `in` */
+    int spans;
+    long *cut;
+    struct span_out *outs;
+};
+
+struct pipe_reader {
+    FILE *file;
+    char *carry;          /* partial last line of the previous chunk */
+    long carry_len;
+};
+
+struct pipe_writer {
+    FILE *file;
+    long records;
+    long checksum;
+    long bytes;
+};
+
+void read_chunk(struct pipe_reader *r, struct pipe_slot *s, long chunk, int last) {
+    memcpy(s->in, r->carry, r->carry_len);
+    long have = r->carry_len + (long)fread(s->in + r->carry_len, 1, chunk, r->file);
+    long end = have;
+    if (!last) {
+        while (end > 0 && s->in[end - 1] != '\n') end--;
+    }
+    r->carry_len = have - end;
+    memcpy(r->carry, s->in + end, r->carry_len);
+    s->len = end;
+}
+
+void compute_chunk(struct pipe_slot *s, int work, int parts) {
+    s->spans = split_lines(s->in, s->len, parts, s->cut);
+    #pragma omp taskloop grainsize(1)
+    for (int p = 0; p < s->spans; p++) {
+        process_span(s->in + s->cut[p], s->cut[p + 1] - s->cut[p], work, &s->outs[p]);
+    }
+}
+
+void write_chunk(struct pipe_writer *w, struct pipe_slot *s) {
+    for (int p = 0; p < s->spans; p++) {
+        fwrite(s->outs[p].text, 1, s->outs[p].bytes, w->file);
+        w->records += s->outs[p].records;
+        w->checksum += s->outs[p].checksum;
+        w->bytes += s->outs[p].bytes;
+    }
+}
+
+long process_pipelined(const char *in_path, const char *out_path, int work, long chunk, int buffers, int parts,
+                       struct pipe_slot *slots, long *checksum, long *written) {
+    struct stat st;
+    if (stat(in_path, &st) != 0) return -1;
+    long nchunks = ((long)st.st_size + chunk - 1) / chunk;
+    struct pipe_reader reader = { fopen(in_path, "rb"), (char*)malloc(chunk), 0 };
+    struct pipe_writer writer = { fopen(out_path, "wb"), 0, 0, 0 };
+    if (!reader.file || !writer.file) return -1;
+
+    #pragma omp parallel
+    #pragma omp single
+    for (long k = 0; k < nchunks; k++) {
+        int b = (int)(k % buffers);
+        int last = k == nchunks - 1;
+        #pragma omp task depend(inout: reader) depend(out: slots[b]) firstprivate(b, last)
+        read_chunk(&reader, &slots[b], chunk, last);
+        #pragma omp task depend(inout: slots[b]) firstprivate(b)
+        compute_chunk(&slots[b], work, parts);
+        #pragma omp task depend(in: slots[b]) depend(inout: writer) firstprivate(b)
+        write_chunk(&writer, &slots[b]);
+    }
+
+    fclose(reader.file);
+    fclose(writer.file);
+    free(reader.carry);
+    *checksum = writer.checksum;
+    *written = writer.bytes;
+    return writer.records;
+}
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+    long records = bench_param_long("records", 1000000);
+    int work = (int)bench_param_long("work", 64);
+    long chunk = bench_param_long("chunk", 1 << 20);
+    int mode = (int)bench_param_long("mode", 0);
+    int buffers = (int)bench_param_long("buffers", 2);
+    int parts = (int)bench_param_long("parts", mode == 0 ? 8 * PIPE_MAX_THREADS() : PIPE_MAX_THREADS());
+    if (buffers < 1) buffers = 1;
+    if (buffers > PIPE_MAX_BUFFERS) buffers = PIPE_MAX_BUFFERS;
+    char in_path[4096], out_path[4096];
+    snprintf(in_path, sizeof(in_path), "%s.in.csv", argv[0]);
+    snprintf(out_path, sizeof(out_path), "%s.out.csv", argv[0]);
+
+    long size = write_dataset(in_path, records);
+    printf("Processing %ld records (%ld bytes)...\n", records, size);
+
+    /* Span outputs and slot buffers are allocated once and reused by every run */
+    struct span_out *outs = (struct span_out*)calloc((size_t)buffers * parts, sizeof(struct span_out));
+    struct pipe_slot slots[PIPE_MAX_BUFFERS];
+    for (int b = 0; b < buffers; b++) {
+        slots[b].in = (char*)malloc(2 * chunk);
+        slots[b].cut = (long*)malloc((parts + 1) * sizeof(long));
+        slots[b].outs = outs + (size_t)b * parts;
+    }
+
+    long count = 0, checksum = 0, written = 0;
+    for (int rep = 0; rep < bench_runs(); rep++) {
+        double start = bench_now();
+        if (mode == 1) count = process_pipelined(in_path, out_path, work, chunk, buffers, parts, slots, &checksum, &written);
+        else count = process_mapped(in_path, out_path, work, parts, outs, &checksum, &written);
+        bench_record(bench_now() - start);
+    }
+
+    printf("Records: %ld\n", count);
+    printf("Checksum: %ld\n", checksum);
+    printf("Output bytes: %ld\n", written);
+    bench_report(mode == 1 ? "process_file_pipelined" : "process_file_mmap");
+
+    for (int b = 0; b < buffers; b++) {
+        free(slots[b].in);
+        free(slots[b].cut);
+    }
+    for (int i = 0; i < buffers * parts; i++) free(outs[i].text);
+    free(outs);
+    remove(in_path);
+    remove(out_path);
+    return 0;
+}
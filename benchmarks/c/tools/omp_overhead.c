@@ -0,0 +1,125 @@
+/*
+ * omp_overhead.c - one-time calibration for the MAAP cost model (agents/c_cost_model.py).
+ *
+ * Measures, at OMP_NUM_THREADS threads:
+ *   fork_join_ns     an empty `#pragma omp parallel` region (fork, barrier, join)
+ *   parallel_for_ns  a `parallel for` over one iteration per thread
+ *   task_ns          one `#pragma omp task` spawned and completed, per task
+ *   ns_per_op        one dependent floating-point add/multiply, single thread
+ *   ns_per_libm      one sin() call, single thread
+ *
+ * Each figure is the median of several batches. Prints one JSON line:
+ *
+ *     {"threads": 8, "fork_join_ns": 1800.0, "parallel_for_ns": 2100.0,
+ *      "task_ns": 150.0, "ns_per_op": 0.9, "ns_per_libm": 12.0}
+ *
+ * Build: gcc -O2 -fopenmp omp_overhead.c -o omp_overhead -lm
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#define BATCHES 15
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, int n) {
+    qsort(v, n, sizeof(double), cmp_double);
+    return v[n / 2];
+}
+
+static volatile double sink;
+
+static double fork_join_ns(int reps) {
+    double t[BATCHES];
+    for (int b = 0; b < BATCHES; b++) {
+        double start = omp_get_wtime();
+        for (int r = 0; r < reps; r++) {
+            #pragma omp parallel
+            {
+                sink = 0.0;
+            }
+        }
+        t[b] = (omp_get_wtime() - start) * 1e9 / reps;
+    }
+    return median(t, BATCHES);
+}
+
+static double parallel_for_ns(int reps) {
+    double t[BATCHES];
+    int n = omp_get_max_threads();
+    for (int b = 0; b < BATCHES; b++) {
+        double start = omp_get_wtime();
+        for (int r = 0; r < reps; r++) {
+            double acc = 0.0;
+            #pragma omp parallel for reduction(+:acc)
+            for (int i = 0; i < n; i++) acc += i;
+            sink = acc;
+        }
+        t[b] = (omp_get_wtime() - start) * 1e9 / reps;
+    }
+    return median(t, BATCHES);
+}
+
+static double task_ns(int tasks) {
+    double t[BATCHES];
+    for (int b = 0; b < BATCHES; b++) {
+        double start = 0.0, elapsed = 0.0;
+        #pragma omp parallel
+        #pragma omp single
+        {
+            start = omp_get_wtime();
+            for (int k = 0; k < tasks; k++) {
+                #pragma omp task
+                sink = k;
+            }
+            #pragma omp taskwait
+            elapsed = omp_get_wtime() - start;
+        }
+        t[b] = elapsed * 1e9 / tasks;
+    }
+    return median(t, BATCHES);
+}
+
+static double ns_per_op(long ops) {
+    double t[BATCHES];
+    for (int b = 0; b < BATCHES; b++) {
+        double x = 1.0, start = omp_get_wtime();
+        /* Dependent chain: one add and one multiply per step, so 2 ops of latency each */
+        for (long i = 0; i < ops / 2; i++) x = x * 0.999999 + 1e-7;
+        t[b] = (omp_get_wtime() - start) * 1e9 / ops;
+        sink = x;
+    }
+    return median(t, BATCHES);
+}
+
+static double ns_per_libm(long calls) {
+    double t[BATCHES];
+    for (int b = 0; b < BATCHES; b++) {
+        double acc = 0.0, start = omp_get_wtime();
+        for (long i = 0; i < calls; i++) acc += sin(i * 1e-3);
+        t[b] = (omp_get_wtime() - start) * 1e9 / calls;
+        sink = acc;
+    }
+    return median(t, BATCHES);
+}
+
+int main(void) {
+    /* Warm the thread pool so the first region's thread creation is not measured */
+    fork_join_ns(100);
+
+    double fj = fork_join_ns(2000);
+    double pf = parallel_for_ns(2000);
+    double task = task_ns(20000);
+    double op = ns_per_op(20000000);
+    double libm = ns_per_libm(2000000);
+
+    printf("{\"threads\": %d, \"fork_join_ns\": %.1f, \"parallel_for_ns\": %.1f, "
+           "\"task_ns\": %.1f, \"ns_per_op\": %.3f, \"ns_per_libm\": %.2f}\n",
+           omp_get_max_threads(), fj, pf, task, op, libm);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * roofline.c - one-time machine characterization for the MAAP roofline (agents/c_roofline.py).
+ *
+ * Measures, at OMP_NUM_THREADS threads and on one thread:
+ *   triad_gbs    STREAM triad a[i] = b[i] + s * c[i] over arrays 4x the last-level cache
+ *                (24 bytes per element, write-allocate traffic not counted, as in STREAM)
+ *   peak_gflops  a multiply-add loop over 32 independent accumulators per thread, which the
+ *                compiler vectorizes and contracts to FMA (2 flops per element per step)
+ *
+ * Each figure is the best of several trials. Prints one JSON line:
+ *
+ *     {"threads": 8, "triad_gbs": 38.1, "triad_gbs_1t": 12.4,
+ *      "peak_gflops": 410.0, "peak_gflops_1t": 52.0}
+ *
+ * Build: gcc -O3 -march=native -fopenmp roofline.c -o roofline
+ * ROOFLINE_N overrides the triad array length.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <omp.h>
+
+#define TRIALS 7
+#define ACC 32
+
+static volatile double sink;
+
+static long triad_length(void) {
+    const char *env = getenv("ROOFLINE_N");
+    if (env) return atol(env);
+    long llc = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    if (llc <= 0) llc = 32L << 20;
+    long n = 4 * llc / (3 * (long)sizeof(double));
+    return n < (2L << 20) ? (2L << 20) : n;
+}
+
+static double triad_gbs(double *a, const double *b, const double *c, long n, int threads) {
+    double best = 0.0;
+    for (int t = 0; t < TRIALS; t++) {
+        double start = omp_get_wtime();
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (long i = 0; i < n; i++) a[i] = b[i] + 3.0 * c[i];
+        double elapsed = omp_get_wtime() - start;
+        double gbs = 3.0 * sizeof(double) * n / elapsed / 1e9;
+        if (gbs > best) best = gbs;
+    }
+    sink = a[n / 2];
+    return best;
+}
+
+static double peak_gflops(long steps, int threads) {
+    double best = 0.0;
+    for (int t = 0; t < TRIALS; t++) {
+        double start = omp_get_wtime();
+        #pragma omp parallel num_threads(threads)
+        {
+            double x[ACC];
+            for (int k = 0; k < ACC; k++) x[k] = 1.0 + k * 1e-3;
+            for (long s = 0; s < steps; s++) {
+                #pragma omp simd
+                for (int k = 0; k < ACC; k++) x[k] = x[k] * 0.999999 + 1e-7;
+            }
+            double acc = 0.0;
+            for (int k = 0; k < ACC; k++) acc += x[k];
+            #pragma omp atomic
+            sink += acc;
+        }
+        double elapsed = omp_get_wtime() - start;
+        double gflops = 2.0 * ACC * steps * threads / elapsed / 1e9;
+        if (gflops > best) best = gflops;
+    }
+    return best;
+}
+
+int main(void) {
+    int threads = omp_get_max_threads();
+    long n = triad_length();
+    double *a = malloc(n * sizeof(double)), *b = malloc(n * sizeof(double)), *c = malloc(n * sizeof(double));
+    if (!a || !b || !c) {
+        fprintf(stderr, "roofline: cannot allocate %ld doubles\n", 3 * n);
+        return 1;
+    }
+    /* First touch in parallel so pages are spread like the kernels' data */
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) { a[i] = 0.0; b[i] = 1.0; c[i] = 2.0; }
+
+    double bw = triad_gbs(a, b, c, n, threads);
+    double bw1 = triad_gbs(a, b, c, n, 1);
+    long steps = 20000000;
+    double peak = peak_gflops(steps, threads);
+    double peak1 = peak_gflops(steps, 1);
+
+    printf("{\"threads\": %d, \"triad_gbs\": %.2f, \"triad_gbs_1t\": %.2f, "
+           "\"peak_gflops\": %.2f, \"peak_gflops_1t\": %.2f}\n", threads, bw, bw1, peak, peak1);
+    free(a); free(b); free(c);
+    return 0;
+}
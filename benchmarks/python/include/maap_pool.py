@@ -0,0 +1,276 @@
+"""
+maap_pool - persistent process pool and shared-memory arrays for parallel Python loops.
+
+A fresh ProcessPoolExecutor or joblib call per loop pays for spawning its
+workers on every loop. It also pickles every input for every task. For the
+CPU-bound benchmarks that costs more than the work. This module starts one
+pool per program, on first use, and reuses it for every loop. Large inputs are
+copied once into multiprocessing.shared_memory blocks, so a task carries only
+the block name:
+
+    import maap_pool
+
+    def rows(lo, hi, A, B):                  # top level, so workers find it by name
+        return [[sum(A[i][p] * B[p][j] for p in range(len(B))) for j in range(len(B[0]))]
+                for i in range(lo, hi)]
+
+    B_shared = maap_pool.share(B)          # list, list of lists, array.array or ndarray
+    maap_pool.update(B_shared, B)          # after B changes (time steps); same block, same shape
+    C = maap_pool.map_range(rows, len(A), A, B_shared)     # rows in sequential order
+    total = maap_pool.reduce_range(partial_sum, n, data)   # chunk results folded with +
+
+Inside a worker, a shared argument arrives as a view: a NumPy array when
+NumPy is installed and the input was one, otherwise a memoryview. A 2-D view
+is indexed as M[i][j]. Views are read-only by convention, and results are
+returned rather than written in place.
+
+Iterations are handed out in guided chunks that shrink as the loop drains.
+After each task the smallest chunk is resized from measured timings, so the
+per-task overhead (pickling and the round trip) stays under OVERHEAD_SHARE of
+the task's compute time. MAAP_POOL_WORKERS sets the worker count. With one
+worker, loops run inline.
+
+Spawn, serialization and compute time are accumulated per program and written
+as JSON to $MAAP_POOL_STATS at exit, for the MAAP validator.
+"""
+
+import array
+import atexit
+import json
+import math
+import multiprocessing
+import operator
+import os
+import pickle
+import time
+from concurrent.futures import FIRST_COMPLETED, ProcessPoolExecutor, wait
+from multiprocessing import shared_memory
+
+try:
+    import numpy
+except ImportError:  # memoryview views only
+    numpy = None
+
+OVERHEAD_SHARE = 0.05
+IN_FLIGHT = 2                         # tasks queued per worker
+
+_pool = None
+_blocks = []                          # shared memory created by this process, unlinked at exit
+_attached = {}                        # worker side: block name -> SharedMemory
+_stats = {"workers": 0, "spawn_s": 0.0, "round_trip_s": 0.0, "serialize_s": 0.0, "compute_s": 0.0, "wall_s": 0.0, "tasks": 0,
+          "items": 0, "bytes_sent": 0, "bytes_received": 0, "shared_bytes": 0, "loops": {}}
+
+
+def workers():
+    return int(os.environ.get("MAAP_POOL_WORKERS") or os.cpu_count() or 1)
+
+
+def _noop():
+    return os.getpid()
+
+
+def pool():
+    """The program's pool, started (and its workers spawned) on first use."""
+    global _pool
+    if _pool is None:
+        start = time.perf_counter()
+        methods = multiprocessing.get_all_start_methods()
+        context = multiprocessing.get_context("fork" if "fork" in methods else "spawn")
+        _pool = ProcessPoolExecutor(max_workers=workers(), mp_context=context)
+        # Workers start on demand; wait for all of them so spawn time is not hidden in the first loop
+        for future in [_pool.submit(_noop) for _ in range(workers())]:
+            future.result()
+        _stats["spawn_s"] += time.perf_counter() - start
+        _stats["workers"] = workers()
+        trip = time.perf_counter()
+        _pool.submit(_noop).result()
+        _stats["round_trip_s"] = time.perf_counter() - trip
+    return _pool
+
+
+class Shared:
+    """A picklable handle to an array in shared memory: name, shape and element type."""
+
+    def __init__(self, name, shape, typecode, ndarray):
+        self.name, self.shape, self.typecode, self.ndarray = name, shape, typecode, ndarray
+
+    def view(self):
+        block = _attached.get(self.name)
+        if block is None:
+            block = _attached[self.name] = _attach(self.name)
+        if self.ndarray and numpy is not None:
+            return numpy.ndarray(self.shape, dtype=numpy.dtype(self.typecode), buffer=block.buf)
+        flat = block.buf.cast(self.typecode)[:math.prod(self.shape)]
+        return _Rows(flat, self.shape[1]) if len(self.shape) == 2 else flat
+
+
+class _Rows:
+    """Row access M[i][j] over a flat memoryview."""
+
+    def __init__(self, flat, cols):
+        self.flat, self.cols = flat, cols
+
+    def __len__(self):
+        return len(self.flat) // self.cols if self.cols else 0
+
+    def __getitem__(self, i):
+        if i < 0:
+            i += len(self)
+        return self.flat[i * self.cols:(i + 1) * self.cols]
+
+
+def _attach(name):
+    try:
+        return shared_memory.SharedMemory(name=name, track=False)
+    except TypeError:  # Python < 3.13: stop the resource tracker from unlinking the parent's block
+        from multiprocessing import resource_tracker
+        block = shared_memory.SharedMemory(name=name)
+        resource_tracker.unregister(block._name, "shared_memory")
+        return block
+
+
+def _flatten(data):
+    rows = bool(data) and isinstance(data[0], (list, tuple, array.array))
+    if rows and any(len(row) != len(data[0]) for row in data):
+        raise ValueError("share() needs rows of equal length")
+    flat = [x for row in data for x in row] if rows else list(data)
+    return flat, ((len(data), len(data[0])) if rows else (len(flat),))
+
+
+def share(data):
+    """Copies a list, list of equal-length lists, array.array or ndarray into shared memory."""
+    if numpy is not None and isinstance(data, numpy.ndarray):
+        block = shared_memory.SharedMemory(create=True, size=max(data.nbytes, 1))
+        numpy.ndarray(data.shape, dtype=data.dtype, buffer=block.buf)[...] = data
+        handle = Shared(block.name, data.shape, data.dtype.str, True)
+    else:
+        flat, shape = _flatten(data)
+        typecode = "q" if all(isinstance(x, int) and not isinstance(x, bool) for x in flat) else "d"
+        values = array.array(typecode, flat)
+        block = shared_memory.SharedMemory(create=True, size=max(len(values) * values.itemsize, 1))
+        block.buf[:len(values) * values.itemsize] = values.tobytes()
+        handle = Shared(block.name, shape, typecode, False)
+    _blocks.append(block)
+    _stats["shared_bytes"] += block.size
+    return handle
+
+
+def update(handle, data):
+    """Rewrites a shared array in place (same shape), e.g. positions after each time step."""
+    block = next(b for b in _blocks if b.name == handle.name)
+    if handle.ndarray and numpy is not None:
+        numpy.ndarray(handle.shape, dtype=numpy.dtype(handle.typecode), buffer=block.buf)[...] = data
+        return
+    flat, shape = _flatten(data)
+    if tuple(shape) != tuple(handle.shape):
+        raise ValueError(f"update() needs shape {handle.shape}, got {shape}")
+    values = array.array(handle.typecode, flat)
+    block.buf[:len(values) * values.itemsize] = values.tobytes()
+
+
+def _task(payload):
+    start = time.perf_counter()
+    fn, lo, hi, args = pickle.loads(payload)
+    args = [a.view() if isinstance(a, Shared) else a for a in args]
+    loaded = time.perf_counter()
+    result = fn(lo, hi, *args)
+    computed = time.perf_counter()
+    out = pickle.dumps(result, protocol=pickle.HIGHEST_PROTOCOL)
+    return out, (loaded - start) + (time.perf_counter() - computed), computed - loaded
+
+
+def _chunks(fn, n, args, chunk):
+    """(lo, result) for every chunk of range(n), in completion order."""
+    loop = _stats["loops"].setdefault(getattr(fn, "__qualname__", repr(fn)),
+                                      {"calls": 0, "tasks": 0, "wall_s": 0.0, "compute_s": 0.0, "min_chunk": 0})
+    loop["calls"] += 1
+    start = time.perf_counter()
+    count = workers()
+    if count <= 1 or n <= 1:
+        computed = time.perf_counter()
+        results = [(0, fn(0, n, *[a.view() if isinstance(a, Shared) else a for a in args]))]
+        elapsed = time.perf_counter() - computed
+        _stats["compute_s"] += elapsed
+        _stats["items"] += n
+        loop["compute_s"] += elapsed
+        loop["wall_s"] += time.perf_counter() - start
+        return results
+
+    executor = pool()
+    smallest = chunk or 1
+    pending, results, lo = {}, [], 0
+    while lo < n or pending:
+        while lo < n and len(pending) < IN_FLIGHT * count:
+            size = chunk or max(smallest, math.ceil((n - lo) / (IN_FLIGHT * count)))
+            hi = min(n, lo + size)
+            packed = time.perf_counter()
+            payload = pickle.dumps((fn, lo, hi, args), protocol=pickle.HIGHEST_PROTOCOL)
+            packing = time.perf_counter() - packed
+            _stats["serialize_s"] += packing
+            _stats["bytes_sent"] += len(payload)
+            pending[executor.submit(_task, payload)] = (lo, hi, packing)
+            lo = hi
+        done, _ = wait(pending, return_when=FIRST_COMPLETED)
+        for future in done:
+            first, last, packing = pending.pop(future)
+            out, serialize, compute = future.result()
+            unpacked = time.perf_counter()
+            results.append((first, pickle.loads(out)))
+            finished = time.perf_counter()
+            _stats["serialize_s"] += serialize + finished - unpacked
+            _stats["compute_s"] += compute
+            _stats["bytes_received"] += len(out)
+            _stats["tasks"] += 1
+            _stats["items"] += last - first
+            loop["tasks"] += 1
+            loop["compute_s"] += compute
+            # Per-task overhead: pickling on both sides plus an empty round trip (queueing is not overhead)
+            overhead = packing + serialize + (finished - unpacked) + _stats["round_trip_s"]
+            per_item = compute / max(last - first, 1)
+            if chunk is None and per_item > 0:
+                smallest = max(1, math.ceil(overhead / (OVERHEAD_SHARE * per_item)))
+                loop["min_chunk"] = smallest
+    loop["wall_s"] += time.perf_counter() - start
+    results.sort(key=lambda r: r[0])
+    return results
+
+
+def map_range(fn, n, *args, chunk=None):
+    """Runs fn(lo, hi, *args) over chunks of range(n) in the pool; concatenates the returned lists in order."""
+    start = time.perf_counter()
+    out = []
+    for _, part in _chunks(fn, n, args, chunk):
+        out.extend(part)
+    _stats["wall_s"] += time.perf_counter() - start
+    return out
+
+
+def reduce_range(fn, n, *args, op=operator.add, initial=None, chunk=None):
+    """Runs fn(lo, hi, *args) over chunks of range(n) and folds the chunk results with op, in index order."""
+    start = time.perf_counter()
+    parts = [part for _, part in _chunks(fn, n, args, chunk)]
+    total = initial
+    for part in parts:
+        total = part if total is None else op(total, part)
+    _stats["wall_s"] += time.perf_counter() - start
+    return total
+
+
+def stats():
+    return json.loads(json.dumps(_stats))
+
+
+@atexit.register
+def _shutdown():
+    path = os.environ.get("MAAP_POOL_STATS")
+    if path and _stats["loops"]:
+        with open(path, "w", encoding="utf-8") as f:
+            json.dump(_stats, f)
+    if _pool is not None:
+        _pool.shutdown(wait=True)
+    for block in _blocks:
+        try:
+            block.close()
+        except BufferError:  # a view is still referenced; the mapping goes away with the process
+            pass
+        block.unlink()
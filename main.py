@@ -2,7 +2,10 @@ import os
 import sys
 import shutil
 import argparse
+import json
 import logging
+import time
+from concurrent.futures import ThreadPoolExecutor
 from dotenv import load_dotenv
 sys.dont_write_bytecode = True
 
@@ -21,14 +24,115 @@ load_dotenv()
 
 # Import graph after env check (in case module loading depends on env)
 try:
-    from graphs.workflow import app
+    from graphs.workflow import app, c_frontend_job
+    from agents.batch import (discover_sources, available_cpus, CpuSetAllocator, set_allocator, ThreadLog,
+                              batch_summary, format_batch_summary)
+    from agents.c_cost_model import calibrate
+    from agents.pool_report import install_runtime, uses_pool
+    from agents.c_frontend import analyze_units, compile_flags_for, format_frontend_summary
+    from agents.c_validation_engine import CValidationConfig
 except ImportError as e:
     logger.error(f"Failed to import workflow: {e}")
     sys.exit(1)
 
+def size_sets(args) -> list:
+    """--size n=4000 -> {"BENCH_N": "4000"}; --size-class llc -> {"BENCH_SIZE_CLASS": "llc"}."""
+    sets = []
+    for spec in args.size:
+        size_set = {}
+        for assignment in spec.split(","):
+            name, _, value = assignment.partition("=")
+            size_set["BENCH_" + name.strip().upper().replace("-", "_")] = value.strip()
+        sets.append(size_set)
+    sets += [{"BENCH_SIZE_CLASS": cls} for cls in args.size_class]
+    return sets
+
+def scaling_options(args) -> dict:
+    options = {"max_threads": args.scaling_max_threads, "efficiency_threshold": args.efficiency_threshold}
+    if args.weak_scaling:
+        var, _, base = args.weak_scaling.partition("=")
+        options.update({"weak_var": var, "weak_base": int(base)})
+    return options
+
+def validation_options(args, extra_cflags=(), threads=None) -> dict:
+    return {
+        "num_threads": threads or args.threads,
+        "warmup": args.warmup,
+        "repeats": args.repeats,
+        "rel_tol": args.rel_tol,
+        "size_sets": size_sets(args),
+        "reference_source": os.path.abspath(args.reference) if args.reference else None,
+        "schedules": args.schedule,
+        "vec_report": not args.no_vec_report,
+        "counters": not args.no_counters,
+        "memory": not args.no_memory,
+        "roofline": not args.no_roofline,
+        "offload": args.offload,
+        "region_fusion": not args.no_region_fusion,
+        "profile": not args.no_profile,
+        "extra_cflags": list(extra_cflags),
+    }
+
 def main():
     parser = argparse.ArgumentParser(description="MAAP: Multi-Agentic for Auto Parallelization")
-    parser.add_argument("input_file", help="Path to the Python file to optimize")
+    parser.add_argument("input_file", help="Python or C file to optimize, or a directory / compile_commands.json (batch mode)")
+    parser.add_argument("--c-validator", choices=["native", "llm"], default="native",
+                        help="C validation: built-in engine (default) or LLM-generated script")
+    parser.add_argument("--threads", type=int, default=None, help="OMP_NUM_THREADS for C validation (default: all CPUs)")
+    parser.add_argument("--warmup", type=int, default=1, help="Untimed warmup runs per C binary")
+    parser.add_argument("--repeats", type=int, default=5, help="Measured runs per C binary")
+    parser.add_argument("--rel-tol", type=float, default=1e-6, help="Relative tolerance for numeric output comparison")
+    parser.add_argument("--min-speedup", type=float, default=1.0,
+                        help="Accept a transformation only when the lower bound of its speedup interval exceeds this")
+    parser.add_argument("--ci", choices=["bootstrap", "welch"], default="bootstrap",
+                        help="Speedup confidence interval: bootstrap of the median ratio or Welch's t on log-times")
+    parser.add_argument("--confidence", type=float, default=0.95, help="Confidence level of the speedup interval")
+    parser.add_argument("--max-memory-growth", type=float, default=2.0,
+                        help="Reject a C transformation whose peak RSS exceeds this multiple of the original's (0 disables)")
+    parser.add_argument("--history", default=os.path.join("output", "history.jsonl"), metavar="PATH",
+                        help="Append every validation result to this JSONL store ('' to disable)")
+    parser.add_argument("--size", action="append", default=[], metavar="PARAM=VALUE[,PARAM=VALUE]",
+                        help="Also measure at this problem size (repeatable), e.g. --size n=4000000 or --size rows=4000,cols=4000")
+    parser.add_argument("--size-class", action="append", default=[], choices=["l2", "llc", "dram"],
+                        help="Also measure with the working set sized to fit L2, the LLC, or spill to DRAM (repeatable)")
+    parser.add_argument("--reference", default=None, metavar="PATH",
+                        help="Hand-optimized C variant to compare against, e.g. benchmarks/c/reference/06_matrix_multiplication_tiled.c")
+    parser.add_argument("--schedule", action="append", default=[], metavar="KIND[,CHUNK]",
+                        help="OMP_SCHEDULE candidate tried for schedule(runtime) loops (repeatable; default: a built-in set)")
+    parser.add_argument("--no-vec-report", action="store_true",
+                        help="Skip the compiler vectorization remarks appended to C validation output")
+    parser.add_argument("--no-counters", action="store_true",
+                        help="Skip the perf stat hardware counters collected for both C binaries")
+    parser.add_argument("--no-memory", action="store_true",
+                        help="Skip the peak RSS and allocation counts measured for both C binaries")
+    parser.add_argument("--offload", choices=["nvptx-none", "amdgcn-amdhsa", "host"], default=None,
+                        help="Plan GPU offload (omp target) for heavy C kernels and build for this device; "
+                             "'host' builds target regions for host fallback only")
+    parser.add_argument("--no-roofline", action="store_true",
+                        help="Skip the roofline calibration and the arithmetic-intensity verdicts for C kernels")
+    parser.add_argument("--no-region-fusion", action="store_true",
+                        help="Keep one parallel region per C loop instead of merging adjacent parallel loops")
+    parser.add_argument("--no-profile", action="store_true",
+                        help="Skip the profiled run of the original C program that ranks its loops by runtime share")
+    parser.add_argument("--variants", type=int, default=1, metavar="K",
+                        help="Ask the C implementer for K alternative transformations, time them concurrently on "
+                             "disjoint CPU sets and keep the fastest correct one (up to 6)")
+    parser.add_argument("--autotune", action="store_true",
+                        help="After validation, search flags, tile sizes, collapse, schedule and threads for the fastest C build")
+    parser.add_argument("--autotune-budget", type=int, default=32, help="Maximum configurations timed by --autotune")
+    parser.add_argument("--no-cache", action="store_true",
+                        help="Do not read or write cached AST reports, LLM outputs and validated builds")
+    parser.add_argument("--cache-dir", default=".maap_cache", help="Directory of the artifact cache")
+    parser.add_argument("--scaling", action="store_true", help="Rerun the validated C binary at 1, 2, 4, ... N threads")
+    parser.add_argument("--scaling-max-threads", type=int, default=None, help="Largest thread count in the sweep (default: all CPUs)")
+    parser.add_argument("--efficiency-threshold", type=float, default=0.5, help="Flag thread counts whose parallel efficiency falls below this")
+    parser.add_argument("--weak-scaling", metavar="VAR=BASE", default=None,
+                        help="Weak scaling: set env VAR to BASE * threads for every run (e.g. BENCH_N=100000)")
+    
+    parser.add_argument("--jobs", type=int, default=4,
+                        help="Batch mode: pipelines run concurrently (validations still wait for a free CPU set)")
+    parser.add_argument("--exclude", action="append", default=[], metavar="GLOB",
+                        help="Batch mode: skip sources matching this path pattern relative to the root (repeatable)")
     
     args = parser.parse_args()
     file_path = args.input_file
@@ -37,15 +141,32 @@ def main():
         logger.error(f"Input file not found: {file_path}")
         sys.exit(1)
 
+    if os.path.isdir(file_path) or file_path.endswith(".json"):
+        run_batch(args, file_path)
+        return
+
+    source_basename = os.path.splitext(os.path.basename(file_path))[0]
+    # A compile_commands.json next to the file or above it supplies its -I/-D flags
+    extra_cflags = compile_flags_for(file_path) if file_path.endswith(".c") else []
+    record = run_file(args, file_path, os.path.join("output", source_basename), "temp_env", extra_cflags)
+    if record["status"] == "error" and record.get("error", "").startswith("Failed to read"):
+        sys.exit(1)
+
+def run_file(args, file_path: str, output_dir: str, work_dir: str, extra_cflags=(), threads=None) -> dict:
+    """Runs the workflow on one source and writes its outputs; returns a summary record for batch mode."""
     # Structured Output Directory
     source_basename = os.path.splitext(os.path.basename(file_path))[0]
     source_extension = os.path.splitext(file_path)[1]
+    record = {"name": os.path.relpath(output_dir, "output"), "file": file_path, "status": "error", "speedup": None,
+              "original_time": None, "refactored_time": None, "iterations": 0, "seconds": None}
+    started = time.perf_counter()
     
-    output_dir = os.path.join("output", source_basename)
     os.makedirs(output_dir, exist_ok=True)
     
     optimized_path = os.path.join(output_dir, "optimized.py" if source_extension != ".c" else "optimized.c")
     report_path = os.path.join(output_dir, "report.txt")
+    metrics_path = os.path.join(output_dir, "metrics.json")
+    tuning_path = os.path.join(output_dir, "tuning.json")
     validation_script_path = os.path.join(output_dir, "validation_script.py")
 
     logger.info(f"Reading source code from {file_path}...")
@@ -54,7 +175,8 @@ def main():
             source_code = f.read()
     except Exception as e:
         logger.error(f"Failed to read input file: {e}")
-        sys.exit(1)
+        record["error"] = f"Failed to read input file: {e}"
+        return record
 
     logger.info("Starting Auto-Parallelization Workflow...")
     
@@ -63,12 +185,23 @@ def main():
         "source_filename": source_basename,
         "source_extension": source_extension,
         "output_dir": output_dir,
+        "source_dir": os.path.dirname(os.path.abspath(file_path)),
+        "work_dir": work_dir,
+        "c_validator": args.c_validator,
+        "cache_dir": None if args.no_cache else args.cache_dir,
+        "validation_options": validation_options(args, extra_cflags, threads),
+        "scaling_options": scaling_options(args) if args.scaling else {},
+        "autotune_options": {"budget": args.autotune_budget} if args.autotune else {},
+        "variant_options": {"count": args.variants} if args.variants > 1 else {},
+        "gate_options": {"min_speedup": args.min_speedup, "method": args.ci, "confidence": args.confidence,
+                         "max_memory_growth": args.max_memory_growth},
+        "history_path": args.history or None,
         "iterations": 0,
         "messages": []
     }
     
     # Create temp environment
-    TEMP_DIR = "temp_env"
+    TEMP_DIR = work_dir
     if os.path.exists(TEMP_DIR):
         shutil.rmtree(TEMP_DIR, ignore_errors=True)
     os.makedirs(TEMP_DIR)
@@ -83,6 +216,13 @@ def main():
             logger.error(f"Workflow execution failed: {e}")
             # Ensure we have a result object to write partial logs
             result = {"validation_output": f"Workflow failed with error: {e}", "is_valid": False}
+            record["error"] = str(e)
+        else:
+            metrics = result.get("validation_metrics") or {}
+            record.update({"status": "passed" if result.get("is_valid") else "failed",
+                           "speedup": metrics.get("speedup"), "original_time": metrics.get("original_time"),
+                           "refactored_time": metrics.get("refactored_time"),
+                           "iterations": result.get("iterations", 0), "error": metrics.get("error")})
         
         logger.info("=== FINAL RESULT ===")
         
@@ -90,6 +230,15 @@ def main():
         with open(report_path, "w", encoding="utf-8") as f:
             f.write(result.get("validation_output", "No validation output."))
         logger.info(f"Validation report saved to '{report_path}'")
+        if result.get("validation_metrics"):
+            with open(metrics_path, "w", encoding="utf-8") as f:
+                json.dump(result["validation_metrics"], f, indent=2)
+            logger.info(f"Validation metrics saved to '{metrics_path}'")
+        
+        if result.get("tuning"):
+            with open(tuning_path, "w", encoding="utf-8") as f:
+                json.dump(result["tuning"], f, indent=2)
+            logger.info(f"Tuned configuration saved to '{tuning_path}'")
         
         # Copy generated validation script if exists
         # It's in temp_env/validate_agentic.py (if agentic)
@@ -104,6 +253,8 @@ def main():
             try:
                 with open(optimized_path, "w", encoding="utf-8") as f:
                     f.write(result.get("modified_code", ""))
+                if source_extension != ".c" and uses_pool(result.get("modified_code", "")):
+                    install_runtime(output_dir)
                 logger.info(f"Optimized code saved to '{optimized_path}'")
             except IOError as e:
                 logger.error(f"Failed to save optimized code: {e}")
@@ -127,6 +278,77 @@ def main():
         if os.path.exists(TEMP_DIR):
             logger.info(f"Cleaning up temporary environment: {TEMP_DIR}")
             shutil.rmtree(TEMP_DIR, ignore_errors=True)
+        record["seconds"] = time.perf_counter() - started
+    return record
+
+def run_batch(args, root: str):
+    """
+    Runs every source under a directory (or in a compile_commands.json) with up to
+    --jobs pipelines at once. Each pipeline gets its own work directory and holds a
+    disjoint CPU set while it times binaries; console output goes to run.log per file.
+    """
+    sources = discover_sources(root, args.exclude)
+    if not sources:
+        logger.error(f"No .c or .py sources found in {root}")
+        sys.exit(1)
+    cpus = available_cpus()
+    jobs = max(1, min(args.jobs, len(sources)))
+    threads = args.threads or max(1, len(cpus) // jobs)
+    allocator = CpuSetAllocator(cpus, threads)
+    set_allocator(allocator)
+    logger.info(f"Batch: {len(sources)} source(s), {jobs} concurrent pipeline(s), "
+                f"{len(allocator.slots)} CPU set(s) of {threads} CPU(s) for validation")
+    # Prebuilt AST reports reach the pipelines through the cache, so --no-cache skips them
+    c_sources = [] if args.no_cache else [s for s in sources if s.path.endswith(".c")]
+    # Calibrate once up front; concurrent first runs would all build the calibration binary
+    with allocator.lease() as slot:
+        try:
+            calibrate(CValidationConfig(num_threads=threads, cpus=slot), args.cache_dir)
+        except Exception as e:
+            logger.warning(f"OpenMP overhead calibration failed ({e}); pipelines will use default overheads")
+        units = [c_frontend_job({"validation_options": validation_options(args, s.extra_cflags, threads),
+                                 "source_dir": os.path.dirname(os.path.abspath(s.path)),
+                                 "cache_dir": args.cache_dir}, s.path) for s in c_sources]
+    # Parse and analyze every translation unit across all CPUs; each analyzer then finds its report cached
+    # (only the parsed AST when profiling is on, since the report then waits for the profile)
+    if units:
+        started = time.perf_counter()
+        reports = analyze_units(units, args.cache_dir, len(cpus))
+        logger.info(format_frontend_summary(reports, len(units), time.perf_counter() - started, len(cpus)))
+
+    console = sys.stdout
+    log = ThreadLog(console)
+    sys.stdout = log
+
+    def run_one(index, source):
+        output_dir = os.path.join("output", source.name)
+        os.makedirs(output_dir, exist_ok=True)
+        work_dir = os.path.join("temp_env", f"{index:03d}_{os.path.basename(source.name)}")
+        with log.to_file(os.path.join(output_dir, "run.log")):
+            record = run_file(args, source.path, output_dir, work_dir, source.extra_cflags, threads)
+        logger.info(f"[{index + 1}/{len(sources)}] {source.name}: {record['status']}"
+                    + (f" ({record['speedup']:.2f}x)" if record.get("speedup") else ""))
+        return record
+
+    started = time.perf_counter()
+    try:
+        with ThreadPoolExecutor(max_workers=jobs) as pool:
+            records = list(pool.map(run_one, range(len(sources)), sources))
+    finally:
+        sys.stdout = console
+        set_allocator(None)
+        shutil.rmtree("temp_env", ignore_errors=True)
+
+    summary = batch_summary(records, time.perf_counter() - started)
+    os.makedirs("output", exist_ok=True)
+    with open(os.path.join("output", "batch_summary.json"), "w", encoding="utf-8") as f:
+        json.dump(summary, f, indent=2)
+    text = format_batch_summary(summary)
+    with open(os.path.join("output", "batch_summary.txt"), "w", encoding="utf-8") as f:
+        f.write(text)
+    print(text)
+    logger.info("Batch summary saved to 'output/batch_summary.txt' and 'output/batch_summary.json'")
+
 
 if __name__ == "__main__":
     main()